@@ -3,12 +3,15 @@
 #include "util.hpp"
 
 #include "manifest/manifest.hpp"
+#include "ec/reed-solomon.hpp"
+#include "fetch/congestion-control.hpp"
 
 #include <ndn-cxx/face.hpp>
 #include <ndn-cxx/security/command-interest-signer.hpp>
 #include <ndn-cxx/security/hc-key-chain.hpp>
 #include <ndn-cxx/security/signing-helpers.hpp>
 #include <ndn-cxx/util/scheduler.hpp>
+#include <ndn-cxx/util/sha256.hpp>
 
 #include "difs.hpp"
 
@@ -18,6 +21,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <time.h>
 
@@ -26,6 +30,7 @@
 #include <boost/iostreams/read.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/property_tree/info_parser.hpp>
+#include <boost/property_tree/json_parser.hpp>
 
 static const uint64_t DEFAULT_BLOCK_SIZE = 1000;
 static const uint64_t DEFAULT_INTEREST_LIFETIME = 4000;
@@ -47,6 +52,9 @@ using std::placeholders::_2;
 using namespace repo;
 
 static const int MAX_RETRY = 3;
+static const size_t STRIPE_WINDOW = 12;
+static const uint64_t CODED_ROW_WINDOW = 8;
+static const size_t EXTRA_FRAGMENTS = 1;
 
 void
 DIFS::parseConfig()
@@ -140,6 +148,19 @@ DIFS::setBlockSize(size_t blockSize)
   m_blockSize = blockSize;
 }
 
+void
+DIFS::setErasureCoding(int k, int m)
+{
+  m_dataFragments = k;
+  m_parityFragments = m;
+}
+
+void
+DIFS::setCongestionControl(const std::string& name)
+{
+  m_congestionControl = repo::CongestionControl::create(name);
+}
+
 void
 DIFS::setIdentityForData(std::string identityForData) 
 {
@@ -219,9 +240,166 @@ DIFS::onDeleteNodeCommandNack(const Interest& interest)
   // }
 }
 
+// Keyspace cache
+
+ndn::Name
+DIFS::getClusterPrefix() const
+{
+  return m_common_name.empty() ? m_repoPrefix : m_common_name;
+}
+
+void
+DIFS::refreshKeySpace(const std::function<void()>& done)
+{
+  RepoCommandParameter parameter;
+
+  Name cmd = getClusterPrefix();
+  cmd.append("ringInfo")
+    .append(parameter.wireEncode());
+
+  ndn::Interest commandInterest = m_cmdSigner.makeCommandInterest(cmd);
+  commandInterest.setInterestLifetime(m_interestLifetime);
+  commandInterest.setMustBeFresh(true);
+  if(!m_forwardingHint.empty()) {
+    commandInterest.setForwardingHint(m_forwardingHint);
+  }
+
+  m_face.expressInterest(commandInterest,
+                        [this, done] (const Interest&, const Data& data) {
+                          onRefreshKeySpaceResponse(data);
+                          done();
+                        },
+                        [this, done] (const Interest& interest, const ndn::lp::Nack&) {
+                          if (m_verbose) {
+                            std::cerr << "NACK: keyspace not refreshed " << interest.getName() << std::endl;
+                          }
+                          done();
+                        },
+                        [this, done] (const Interest& interest) {
+                          if (m_verbose) {
+                            std::cerr << "TIMEOUT: keyspace not refreshed " << interest.getName() << std::endl;
+                          }
+                          done();
+                        });
+}
+
+void
+DIFS::onRefreshKeySpaceResponse(const Data& data)
+{
+  auto content = data.getContent();
+  std::istringstream json(std::string(content.value_begin(), content.value_end()));
+
+  using namespace boost::property_tree;
+  ptree root;
+  std::vector<KeySpaceRange> keySpace;
+  try {
+    read_json(json, root);
+    for (const auto& item : root.get_child("keyspaces")) {
+      KeySpaceRange range;
+      range.node = Name(item.second.get<std::string>("node"));
+      range.start = std::stoi(item.second.get<std::string>("start"), nullptr, 16);
+      range.end = std::stoi(item.second.get<std::string>("end"), nullptr, 16);
+      keySpace.push_back(range);
+    }
+  }
+  catch (const std::exception& e) {
+    if (m_verbose) {
+      std::cerr << "Malformed keyspace " << data.getName() << ": " << e.what() << std::endl;
+    }
+    return;
+  }
+
+  m_keySpace = keySpace;
+  m_keySpaceVersion = root.get<std::string>("version", "");
+}
+
+ndn::Name
+DIFS::getOwner(const std::string& hash) const
+{
+  if (hash.size() < 2) {
+    return Name();
+  }
+
+  int bucket = std::stoi(hash.substr(0, 2), nullptr, 16);
+  for (const auto& range : m_keySpace) {
+    if (bucket >= range.start && bucket <= range.end) {
+      return range.node;
+    }
+  }
+  return Name();
+}
+
 // Delete
 void
 DIFS::deleteFile(const Name& name)
+{
+  m_fileName = name;
+  if (m_keySpace.empty()) {
+    refreshKeySpace([this, name] { sendDeleteManifestCommand(name, false); });
+    return;
+  }
+  sendDeleteManifestCommand(name, true);
+}
+
+void
+DIFS::sendDeleteManifestCommand(const Name& name, bool canRefresh)
+{
+  auto hash = Manifest::getHash(name.toUri());
+  Name owner = getOwner(hash);
+  if (owner.empty()) {
+    sendDeleteCommand(name);
+    return;
+  }
+
+  RepoCommandParameter parameter;
+  parameter.setName(hash);
+  parameter.setProcessId(0);
+
+  Name cmd = owner;
+  cmd.append("delete-manifest")
+    .append(parameter.wireEncode());
+
+  ndn::Interest commandInterest = m_cmdSigner.makeCommandInterest(cmd);
+  commandInterest.setInterestLifetime(m_interestLifetime);
+  commandInterest.setMustBeFresh(true);
+
+  m_face.expressInterest(commandInterest,
+                        std::bind(&DIFS::onDeleteManifestCommandResponse, this, _2, name, canRefresh),
+                        [this, name] (const Interest&, const ndn::lp::Nack&) { sendDeleteCommand(name); },
+                        [this, name] (const Interest&) {
+                          // the owner may be down, let the cluster fail over
+                          sendDeleteCommand(name);
+                          refreshKeySpace([] {});
+                        });
+}
+
+void
+DIFS::onDeleteManifestCommandResponse(const Data& data, const Name& name, bool canRefresh)
+{
+  RepoCommandResponse response(data.getContent().blockFromValue());
+  if (response.getCode() < 400) {
+    return;
+  }
+
+  // a node that does not have the manifest may no longer own it
+  if (!canRefresh) {
+    sendDeleteCommand(name);
+    return;
+  }
+
+  auto version = m_keySpaceVersion;
+  refreshKeySpace([this, name, version] {
+    if (m_keySpaceVersion != version) {
+      sendDeleteManifestCommand(name, false);
+    }
+    else {
+      sendDeleteCommand(name);
+    }
+  });
+}
+
+void
+DIFS::sendDeleteCommand(const Name& name)
 {
   RepoCommandParameter parameter;
   parameter.setProcessId(0);  // FIXME: set process id properly
@@ -262,7 +440,7 @@ void
 DIFS::onDeleteCommandTimeout(const Interest& interest)
 {
   if (m_retryCount++ < MAX_RETRY) {
-    deleteFile(interest.getName());
+    sendDeleteCommand(m_fileName);
     if (m_verbose) {
       std::cerr << "TIMEOUT: retransmit interest for " << interest.getName() << std::endl;
     }
@@ -276,7 +454,7 @@ void
 DIFS::onDeleteCommandNack(const Interest& interest)
 {
   if (m_retryCount++ < MAX_RETRY) {
-    deleteFile(interest.getName());
+    sendDeleteCommand(m_fileName);
     if (m_verbose) {
       std::cerr << "NACK: retransmit interest for " << interest.getName() << std::endl;
     }
@@ -400,11 +578,79 @@ DIFS::onGetKeySpaceInfoCommandNack(const Interest& interest)
 
 void
 DIFS::getFile(const Name& data_name, std::ostream& os)
+{
+  m_os = &os;
+  m_fileName = data_name;
+  if (m_keySpace.empty()) {
+    refreshKeySpace([this, data_name] { sendFindCommand(data_name, false); });
+    return;
+  }
+  sendFindCommand(data_name, true);
+}
+
+void
+DIFS::sendFindCommand(const Name& name, bool canRefresh)
+{
+  auto hash = Manifest::getHash(name.toUri());
+  Name owner = getOwner(hash);
+  if (owner.empty()) {
+    sendGetCommand(name);
+    return;
+  }
+
+  RepoCommandParameter parameter;
+  parameter.setName(hash);
+
+  Name cmd = owner;
+  cmd.append("find")
+    .append(parameter.wireEncode());
+
+  ndn::Interest commandInterest = m_cmdSigner.makeCommandInterest(cmd);
+  commandInterest.setInterestLifetime(m_interestLifetime);
+  commandInterest.setMustBeFresh(true);
+
+  m_face.expressInterest(commandInterest,
+                        std::bind(&DIFS::onFindCommandResponse, this, _1, _2, name, canRefresh),
+                        [this, name] (const Interest&, const ndn::lp::Nack&) { sendGetCommand(name); },
+                        [this, name] (const Interest&) {
+                          // the owner may be down, the cluster races the replicas
+                          sendGetCommand(name);
+                          refreshKeySpace([] {});
+                        });
+}
+
+void
+DIFS::onFindCommandResponse(const Interest& interest, const Data& data, const Name& name,
+                            bool canRefresh)
+{
+  if (data.getContent().value_size() > 0) {
+    onGetCommandResponse(interest, data);
+    return;
+  }
+
+  // a node that does not have the manifest may no longer own it
+  if (!canRefresh) {
+    sendGetCommand(name);
+    return;
+  }
+
+  auto version = m_keySpaceVersion;
+  refreshKeySpace([this, name, version] {
+    if (m_keySpaceVersion != version) {
+      sendFindCommand(name, false);
+    }
+    else {
+      sendGetCommand(name);
+    }
+  });
+}
+
+void
+DIFS::sendGetCommand(const Name& data_name)
 {
   RepoCommandParameter parameter;
   parameter.setName(data_name);
 
-  m_os = &os;
   Name cmd = m_repoPrefix;
   cmd.append("get")
     .append(parameter.wireEncode());
@@ -423,6 +669,69 @@ DIFS::getFile(const Name& data_name, std::ostream& os)
                         std::bind(&DIFS::onGetCommandTimeout, this, _1));
 }
 
+void
+DIFS::findManifests(const std::vector<Name>& names, std::ostream& os)
+{
+  Name hashes;
+  for (const auto& name : names) {
+    hashes.append(Manifest::getHash(name.toUri()));
+  }
+
+  RepoCommandParameter parameter;
+  parameter.setName(hashes);
+
+  m_os = &os;
+  Name cmd = m_repoPrefix;
+  cmd.append("get-batch")
+    .append(parameter.wireEncode());
+
+  ndn::Interest commandInterest = m_cmdSigner.makeCommandInterest(cmd);
+  commandInterest.setInterestLifetime(m_interestLifetime);
+  if(!m_forwardingHint.empty()) {
+    commandInterest.setForwardingHint(m_forwardingHint);
+  }
+
+  ndn::util::SegmentFetcher::Options options;
+  options.interestLifetime = m_interestLifetime;
+
+  auto fetcher = ndn::util::SegmentFetcher::start(m_face, commandInterest, m_validatorConfig, options);
+  fetcher->afterSegmentValidated.connect([this] (const Data& data) {
+    onFindManifestsSegment(data);
+  });
+  fetcher->onError.connect([] (uint32_t errorCode, const std::string& errorMsg) {
+    std::cerr << "Error: " << errorMsg << std::endl;
+  });
+}
+
+void
+DIFS::onFindManifestsSegment(const Data& data)
+{
+  auto content = data.getContent();
+  if (content.value_size() == 0) {
+    return;
+  }
+
+  using namespace boost::property_tree;
+  ptree root;
+  std::istringstream json(std::string(content.value_begin(), content.value_end()));
+  try {
+    read_json(json, root);
+  }
+  catch (const ptree_error& e) {
+    std::cerr << "Malformed manifest segment " << data.getName() << std::endl;
+    return;
+  }
+
+  auto manifests = root.get_child_optional("manifests");
+  if (!manifests) {
+    return;
+  }
+
+  for (const auto& item : *manifests) {
+    write_json(*m_os, item.second, false);
+  }
+}
+
 void
 DIFS::onGetCommandResponse(const Interest& interest, const Data& data)
 {
@@ -446,7 +755,7 @@ void
 DIFS::onGetCommandTimeout(const Interest& interest)
 {
   if (m_retryCount++ < MAX_RETRY) {
-    getFile(interest.getName(), *m_os);
+    sendGetCommand(m_fileName);
     if (m_verbose) {
       std::cerr << "TIMEOUT: retransmit interest for " << interest.getName() << std::endl;
     }
@@ -460,7 +769,7 @@ void
 DIFS::onGetCommandNack(const Interest& interest)
 {
   if (m_retryCount++ < MAX_RETRY) {
-    getFile(interest.getName(), *m_os);
+    sendGetCommand(m_fileName);
     if (m_verbose) {
       std::cerr << "TIMEOUT: retransmit interest for " << interest.getName() << std::endl;
     }
@@ -475,6 +784,14 @@ DIFS::fetch(int start)
 {
   auto manifest = Manifest::fromJson(m_manifest);
   auto repos = manifest.getRepos();
+  if (manifest.isErasureCoded()) {
+    fetchErasureCoded();
+    return;
+  }
+  if (repos.size() > 1) {
+    fetchStripes();
+    return;
+  }
 
   ndn::Interest interest(Name(manifest.getName()).appendSegment(0));
   std::cout << interest.getName() << std::endl;
@@ -488,17 +805,46 @@ DIFS::fetch(int start)
 
   ndn::security::Validator& m_validator(m_validatorConfig);
 
+  if (!m_congestionControl) {
+    m_congestionControl = repo::CongestionControl::create("aimd");
+  }
+  if (!m_pathHistory) {
+    m_pathHistory = std::make_shared<repo::PathHistory>();
+  }
+  std::string path = repos.begin()->name;
+  repo::FetchWindow window = m_congestionControl->makeWindow(m_pathHistory->get(path));
+
   ndn::util::SegmentFetcher::Options options;
-  options.initCwnd = 12;
+  options.initCwnd = window.initCwnd;
+  options.initSsthresh = window.initSsthresh;
+  options.aiStep = window.aiStep;
+  options.mdCoef = window.mdCoef;
+  options.useConstantCwnd = window.useConstantCwnd;
   options.interestLifetime = lifeTime;
   options.maxTimeout = lifeTime;
 
+  auto fetchStart = ndn::time::steady_clock::now();
+  auto firstSegmentAt = std::make_shared<ndn::time::steady_clock::TimePoint>();
+  auto nFetched = std::make_shared<uint64_t>(0);
+
   std::shared_ptr<ndn::util::HCSegmentFetcher> hc_fetcher;
   auto hcFetcher = hc_fetcher->start(m_face, interest, m_validator, options);
   hcFetcher->onError.connect([](uint32_t errorCode, const std::string &errorMsg)
       { std::cout << "Error: " << errorMsg << std::endl; });
-  hcFetcher->afterSegmentValidated.connect([this, hcFetcher](const Data &data)
-              { onDataCommandResponse(data); });
+  hcFetcher->afterSegmentValidated.connect([this, hcFetcher, path, fetchStart, firstSegmentAt, nFetched](const Data &data)
+    {
+      auto now = ndn::time::steady_clock::now();
+      if (++*nFetched == 1) {
+        *firstSegmentAt = now;
+      }
+      if (data.getFinalBlock() && *data.getFinalBlock() == data.getName().get(-1)) {
+        using ndn::time::microseconds;
+        double rtt = ndn::time::duration_cast<microseconds>(*firstSegmentAt - fetchStart).count() / 1e6;
+        double seconds = ndn::time::duration_cast<microseconds>(now - *firstSegmentAt).count() / 1e6;
+        m_pathHistory->addSample(path, rtt, seconds > 0 ? (*nFetched - 1) / seconds : 0);
+      }
+      onDataCommandResponse(data);
+    });
   hcFetcher->afterSegmentTimedOut.connect([this, hcFetcher]()
             { onDataCommandTimeout(*hcFetcher); });
 }
@@ -516,6 +862,351 @@ DIFS::onDataCommandTimeout(ndn::util::HCSegmentFetcher& fetcher)
   std::cout << "Timeout" << std::endl;
 }
 
+void
+DIFS::fetchStripes()
+{
+  auto manifest = Manifest::fromJson(m_manifest);
+  m_dataPrefix = Name(manifest.getName());
+  m_stripes.clear();
+  m_reorderBuffer.clear();
+  m_segmentRetries.clear();
+  m_nextSegmentToWrite = manifest.getStartBlockId();
+  m_lastSegment = manifest.getEndBlockId();
+
+  for (const auto& repo : manifest.getRepos()) {
+    ndn::Delegation d;
+    d.name = Name(repo.name);
+
+    Stripe stripe;
+    stripe.forwardingHint = ndn::DelegationList{d};
+    stripe.nextSegment = repo.start;
+    stripe.endSegment = repo.end;
+    m_stripes.push_back(stripe);
+  }
+
+  for (size_t i = 0; i < m_stripes.size(); ++i) {
+    stripeSendInterests(i);
+  }
+}
+
+void
+DIFS::stripeSendInterests(size_t stripe)
+{
+  Stripe& s = m_stripes[stripe];
+
+  // do not run too far ahead of the next segment to write, except for the stripe holding it
+  uint64_t maxBuffered = STRIPE_WINDOW * m_stripes.size() * 4;
+  bool isHead = m_nextSegmentToWrite <= s.endSegment &&
+                s.nextSegment <= m_nextSegmentToWrite + STRIPE_WINDOW;
+  while (s.nInFlight < STRIPE_WINDOW && s.nextSegment <= s.endSegment &&
+         (isHead || m_reorderBuffer.size() < maxBuffered)) {
+    ndn::Interest interest(Name(m_dataPrefix).appendSegment(s.nextSegment++));
+    interest.setInterestLifetime(m_interestLifetime);
+    interest.setMustBeFresh(true);
+    interest.setForwardingHint(s.forwardingHint);
+
+    ++s.nInFlight;
+    m_face.expressInterest(interest,
+                           std::bind(&DIFS::onStripeData, this, _1, _2, stripe),
+                           std::bind(&DIFS::onStripeTimeout, this, _1, stripe), // Nack
+                           std::bind(&DIFS::onStripeTimeout, this, _1, stripe));
+  }
+}
+
+void
+DIFS::onStripeData(const Interest& interest, const Data& data, size_t stripe)
+{
+  m_validatorConfig.validate(data,
+    [this, stripe] (const Data& data) {
+      --m_stripes[stripe].nInFlight;
+      uint64_t segment = data.getName().get(-1).toSegment();
+      if (segment >= m_nextSegmentToWrite) {
+        m_reorderBuffer.emplace(segment, std::make_shared<Data>(data));
+      }
+      writeStripedSegments();
+      for (size_t i = 0; i < m_stripes.size(); ++i) {
+        stripeSendInterests(i);
+      }
+    },
+    [this, stripe] (const Data& data, const ndn::security::v2::ValidationError& error) {
+      std::cerr << "ERROR: " << data.getName() << " " << error << std::endl;
+      retryStripeSegment(data.getName(), stripe);
+    });
+}
+
+void
+DIFS::onStripeTimeout(const Interest& interest, size_t stripe)
+{
+  if (m_verbose) {
+    std::cerr << "TIMEOUT: retransmit interest for " << interest.getName() << std::endl;
+  }
+  retryStripeSegment(interest.getName(), stripe);
+}
+
+void
+DIFS::retryStripeSegment(const Name& name, size_t stripe)
+{
+  uint64_t segment = name.get(-1).toSegment();
+  if (m_segmentRetries[segment]++ >= MAX_RETRY) {
+    m_face.getIoService().stop();
+    BOOST_THROW_EXCEPTION(std::runtime_error("Abort fetching " + name.toUri() + " after " +
+                                             boost::lexical_cast<std::string>(MAX_RETRY) +
+                                             " times of retry"));
+  }
+
+  ndn::Interest retryInterest(name);
+  retryInterest.setInterestLifetime(m_interestLifetime);
+  retryInterest.setMustBeFresh(true);
+  retryInterest.setForwardingHint(m_stripes[stripe].forwardingHint);
+  m_face.expressInterest(retryInterest,
+                         std::bind(&DIFS::onStripeData, this, _1, _2, stripe),
+                         std::bind(&DIFS::onStripeTimeout, this, _1, stripe), // Nack
+                         std::bind(&DIFS::onStripeTimeout, this, _1, stripe));
+}
+
+void
+DIFS::writeStripedSegments()
+{
+  auto it = m_reorderBuffer.begin();
+  while (it != m_reorderBuffer.end() && it->first == m_nextSegmentToWrite) {
+    onDataCommandResponse(*it->second);
+    it = m_reorderBuffer.erase(it);
+    ++m_nextSegmentToWrite;
+  }
+
+  if (m_nextSegmentToWrite > m_lastSegment) {
+    m_os->flush();
+  }
+}
+
+void
+DIFS::fetchErasureCoded()
+{
+  auto manifest = Manifest::fromJson(m_manifest);
+  m_dataPrefix = Name(manifest.getName());
+  m_dataFragments = manifest.getDataFragments();
+  m_parityFragments = manifest.getParityFragments();
+  m_erasureCode = std::make_shared<repo::ReedSolomon>(m_dataFragments, m_parityFragments);
+  m_lastSegment = manifest.getEndBlockId();
+  m_nRows = (m_lastSegment + m_dataFragments) / m_dataFragments;
+
+  m_fragmentHints.clear();
+  for (const auto& repo : manifest.getRepos()) {
+    ndn::Delegation d;
+    d.name = Name(repo.name);
+    m_fragmentHints.push_back(ndn::DelegationList{d});
+  }
+  if (m_fragmentHints.size() != static_cast<size_t>(m_dataFragments + m_parityFragments)) {
+    std::cerr << "ERROR: manifest lists " << m_fragmentHints.size() << " fragments, expected "
+              << m_dataFragments + m_parityFragments << std::endl;
+    return;
+  }
+
+  m_codedRows.clear();
+  m_fragmentRetries.clear();
+  m_nextRow = 0;
+  m_nextRowToWrite = 0;
+  while (m_nextRow < m_nRows && m_nextRow < CODED_ROW_WINDOW) {
+    startCodedRow(m_nextRow++);
+  }
+}
+
+void
+DIFS::startCodedRow(uint64_t row)
+{
+  size_t k = m_dataFragments;
+  size_t n = m_fragmentHints.size();
+
+  CodedRow& codedRow = m_codedRows[row];
+  codedRow.fragments.resize(n);
+  for (size_t i = 0; i < k; ++i) {
+    if (row * k + i > m_lastSegment) {
+      ++codedRow.nAvailable;
+    }
+    else {
+      sendFragmentInterest(row, i);
+    }
+  }
+
+  codedRow.nextFragment = std::min(n, k + EXTRA_FRAGMENTS);
+  for (size_t i = k; i < codedRow.nextFragment; ++i) {
+    sendFragmentInterest(row, i);
+  }
+}
+
+Name
+DIFS::getFragmentName(uint64_t row, size_t fragment) const
+{
+  size_t k = m_dataFragments;
+  if (fragment < k) {
+    return Name(m_dataPrefix).appendSegment(row * k + fragment);
+  }
+  return Name(m_dataPrefix).append("parity").appendNumber(fragment - k).appendSegment(row);
+}
+
+void
+DIFS::sendFragmentInterest(uint64_t row, size_t fragment)
+{
+  ndn::Interest interest(getFragmentName(row, fragment));
+  interest.setInterestLifetime(m_interestLifetime);
+  interest.setMustBeFresh(true);
+  interest.setForwardingHint(m_fragmentHints[fragment]);
+
+  m_face.expressInterest(interest,
+                         std::bind(&DIFS::onFragmentData, this, _1, _2, row, fragment),
+                         std::bind(&DIFS::onFragmentTimeout, this, _1, row, fragment), // Nack
+                         std::bind(&DIFS::onFragmentTimeout, this, _1, row, fragment));
+}
+
+void
+DIFS::onFragmentData(const Interest& interest, const Data& data, uint64_t row, size_t fragment)
+{
+  m_validatorConfig.validate(data,
+    [this, row, fragment] (const Data& data) {
+      auto it = m_codedRows.find(row);
+      if (it == m_codedRows.end() || it->second.isDecoded || it->second.fragments[fragment] != nullptr) {
+        return;
+      }
+
+      it->second.fragments[fragment] = std::make_shared<Data>(data);
+      if (++it->second.nAvailable >= static_cast<size_t>(m_dataFragments)) {
+        decodeCodedRow(row);
+      }
+    },
+    [] (const Data& data, const ndn::security::v2::ValidationError& error) {
+      std::cerr << "ERROR: " << data.getName() << " " << error << std::endl;
+    });
+}
+
+void
+DIFS::onFragmentTimeout(const Interest& interest, uint64_t row, size_t fragment)
+{
+  auto it = m_codedRows.find(row);
+  if (it == m_codedRows.end() || it->second.isDecoded) {
+    return;
+  }
+
+  // ask another node first, the late one may still answer
+  CodedRow& codedRow = it->second;
+  if (codedRow.nextFragment < codedRow.fragments.size()) {
+    sendFragmentInterest(row, codedRow.nextFragment++);
+    return;
+  }
+
+  if (m_fragmentRetries[interest.getName()]++ >= MAX_RETRY) {
+    std::cerr << "TIMEOUT: cannot rebuild row " << row << " after "
+              << MAX_RETRY << " times of retry" << std::endl;
+    return;
+  }
+
+  if (m_verbose) {
+    std::cerr << "TIMEOUT: retransmit interest for " << interest.getName() << std::endl;
+  }
+  sendFragmentInterest(row, fragment);
+}
+
+void
+DIFS::decodeCodedRow(uint64_t row)
+{
+  size_t k = m_dataFragments;
+  size_t n = m_fragmentHints.size();
+  CodedRow& codedRow = m_codedRows[row];
+
+  std::vector<uint32_t> lengths(k, 0);
+  bool hasAllData = true;
+  for (size_t i = 0; i < k; ++i) {
+    if (codedRow.fragments[i] != nullptr) {
+      lengths[i] = codedRow.fragments[i]->getContent().value_size();
+    }
+    else if (row * k + i <= m_lastSegment) {
+      hasAllData = false;
+    }
+  }
+
+  codedRow.contents.assign(k, std::string());
+  if (hasAllData) {
+    for (size_t i = 0; i < k; ++i) {
+      if (codedRow.fragments[i] != nullptr) {
+        const auto& content = codedRow.fragments[i]->getContent();
+        codedRow.contents[i].assign(content.value_begin(), content.value_end());
+      }
+    }
+  }
+  else {
+    // lengths of the data contents come with every parity fragment
+    size_t len = 0;
+    for (size_t i = k; i < n; ++i) {
+      if (codedRow.fragments[i] == nullptr) {
+        continue;
+      }
+      const auto& content = codedRow.fragments[i]->getContent();
+      if (content.value_size() < 4 * k) {
+        std::cerr << "ERROR: malformed parity " << codedRow.fragments[i]->getName() << std::endl;
+        codedRow.fragments[i] = nullptr;
+        --codedRow.nAvailable;
+        return;
+      }
+      for (size_t d = 0; d < k; ++d) {
+        const uint8_t* p = content.value() + 4 * d;
+        lengths[d] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+      }
+      len = content.value_size() - 4 * k;
+      break;
+    }
+
+    std::vector<std::vector<uint8_t>> buffers(n, std::vector<uint8_t>(len, 0));
+    std::vector<uint8_t*> pointers;
+    std::vector<bool> isPresent(n, false);
+    for (size_t i = 0; i < n; ++i) {
+      pointers.push_back(buffers[i].data());
+      if (i < k && row * k + i > m_lastSegment) {
+        isPresent[i] = true;
+        continue;
+      }
+      if (codedRow.fragments[i] == nullptr) {
+        continue;
+      }
+      const auto& content = codedRow.fragments[i]->getContent();
+      auto begin = content.value_begin() + (i < k ? 0 : 4 * k);
+      std::copy(begin, begin + std::min<size_t>(len, content.value_end() - begin), buffers[i].begin());
+      isPresent[i] = true;
+    }
+
+    if (!m_erasureCode->reconstruct(pointers.data(), isPresent, len)) {
+      return;
+    }
+    for (size_t i = 0; i < k; ++i) {
+      codedRow.contents[i].assign(reinterpret_cast<const char*>(buffers[i].data()),
+                                  std::min<size_t>(lengths[i], len));
+    }
+  }
+
+  codedRow.isDecoded = true;
+  codedRow.fragments.clear();
+  writeCodedRows();
+}
+
+void
+DIFS::writeCodedRows()
+{
+  auto it = m_codedRows.find(m_nextRowToWrite);
+  while (it != m_codedRows.end() && it->second.isDecoded) {
+    for (const auto& content : it->second.contents) {
+      m_os->write(content.data(), content.size());
+    }
+    m_codedRows.erase(it);
+    it = m_codedRows.find(++m_nextRowToWrite);
+  }
+
+  while (m_nextRow < m_nRows && m_nextRow < m_nextRowToWrite + CODED_ROW_WINDOW) {
+    startCodedRow(m_nextRow++);
+  }
+
+  if (m_nextRowToWrite == m_nRows) {
+    m_os->flush();
+  }
+}
+
 // Put
 
 void
@@ -533,6 +1224,17 @@ DIFS::putFile(const ndn::Name& ndnName, std::istream& is)
 
   putFilePrepareNextData();
 
+  // lets the repo reuse the segments of a file with the same content
+  ndn::util::Sha256 digest;
+  for (const auto& data : m_data) {
+    digest.update(data->getContent().value(), data->getContent().value_size());
+  }
+  m_contentDigest = digest.toString();
+
+  if (m_dataFragments > 0) {
+    putFileEncodeParity();
+  }
+
   m_face.setInterestFilter(m_dataPrefix,
                            bind(&DIFS::onPutFileInterest, this, _1, _2),
                            bind(&DIFS::onPutFileRegisterSuccess, this, _1),
@@ -551,6 +1253,23 @@ DIFS::onPutFileInterest(const ndn::Name& prefix, const ndn::Interest& interest)
     return;
   }
 
+  // <prefix>/parity/<fragment>/<row>
+  if (interest.getName().size() == prefix.size() + 3 &&
+      interest.getName().get(prefix.size()) == ndn::Name::Component("parity")) {
+    try {
+      uint64_t fragment = interest.getName().get(prefix.size() + 1).toNumber();
+      uint64_t row = interest.getName().get(prefix.size() + 2).toSegment();
+      if (fragment < m_parity.size() && row < m_parity[fragment].size()) {
+        m_face.put(*m_parity[fragment][row]);
+        return;
+      }
+    }
+    catch (const tlv::Error&) {
+    }
+    m_face.put(ndn::lp::Nack(interest));
+    return;
+  }
+
   uint64_t segmentNo;
   try {
     ndn::Name::Component segmentComponent = interest.getName().get(prefix.size());
@@ -626,13 +1345,21 @@ DIFS::onPutFileInsertCommandResponse(const ndn::Interest& interest, const ndn::D
 {
   RepoCommandResponse response(data.getContent().blockFromValue());
   auto statusCode = response.getCode();
+  // an overloaded repo tells when to come back
+  if (statusCode == 503 && response.hasRetryAfter() && m_retryCount++ < MAX_RETRY) {
+    if (m_verbose) {
+      std::cerr << "OVERLOADED: retry insert after " << response.getRetryAfter() << std::endl;
+    }
+    m_scheduler.schedule(response.getRetryAfter(), [this] { putFileStartInsertCommand(); });
+    return;
+  }
   if (statusCode >= 400) {
     BOOST_THROW_EXCEPTION(std::runtime_error("insert command failed with code: " + 
                                               boost::lexical_cast<std::string>(statusCode)));
   }
   m_processId = response.getProcessId();
 
-  m_scheduler.schedule(m_checkPeriod, [this] { putFileStartCheckCommand(); });
+  putFileWaitForCompletion();
 }
 
 void
@@ -710,12 +1437,53 @@ DIFS::onPutFileCheckCommandResponse(const ndn::Interest& interest, const ndn::Da
   // Technically, the check should not infer, but directly has signal from repo that
   // write operation has been finished
 
-  if (insertCount == m_currentSegmentNo) {
+  if (statusCode == 200 || insertCount == m_currentSegmentNo) {
+    m_face.getIoService().stop();
+    return;
+  }
+
+  putFileWaitForCompletion();
+}
+
+void
+DIFS::putFileWaitForCompletion()
+{
+  Name name = m_repoPrefix;
+  name
+    .append("insert-done")
+    .appendNumber(m_processId);
+
+  ndn::Interest doneInterest(name);
+  doneInterest.setCanBePrefix(false);
+  doneInterest.setMustBeFresh(true);
+  if(!m_forwardingHint.empty())
+    doneInterest.setForwardingHint(m_forwardingHint);
+  doneInterest.setInterestLifetime(ndn::time::milliseconds(DEFAULT_COMPLETION_WAIT));
+
+  m_face.expressInterest(doneInterest,
+                         bind(&DIFS::onPutFileDoneResponse, this, _1, _2),
+                         [this] (const ndn::Interest&, const ndn::lp::Nack&) {
+                           m_scheduler.schedule(m_checkPeriod, [this] { putFileStartCheckCommand(); });
+                         },
+                         [this] (const ndn::Interest&) { putFileStartCheckCommand(); });
+}
+
+void
+DIFS::onPutFileDoneResponse(const ndn::Interest& interest, const ndn::Data& data)
+{
+  RepoCommandResponse response(data.getContent().blockFromValue());
+  auto statusCode = response.getCode();
+  if (statusCode >= 400) {
+    BOOST_THROW_EXCEPTION(std::runtime_error("Insert failed with code: " +
+                                              boost::lexical_cast<std::string>(statusCode)));
+  }
+
+  if (statusCode == 200) {
     m_face.getIoService().stop();
     return;
   }
 
-  m_scheduler.schedule(m_checkPeriod, [this] { putFileStartCheckCommand(); });
+  putFileWaitForCompletion();
 }
 
 void
@@ -777,7 +1545,8 @@ DIFS::putFilePrepareNextData()
       data->setContent(content);
       data->setFinalBlock(finalBlockId);
 
-      if(count == chunkSize) {
+      // erasure coded segments are fetched with a stride, which the chain cannot follow
+      if(count == chunkSize || m_dataFragments > 0) {
         m_hcKeyChain.sign(*data, nextHash);
       } else {
         m_hcKeyChain.sign(*data, nextHash, ndn::signingWithSha256());
@@ -844,6 +1613,8 @@ DIFS::putFileSendManifest(const ndn::Name& prefix, const ndn::Interest& interest
   auto blockCount = m_bytes / m_blockSize + (m_bytes % m_blockSize != 0);
 
   Manifest manifest(interest.getName().toUri(), 0, blockCount - 1);
+  manifest.setErasureCoding(m_dataFragments, m_parityFragments);
+  manifest.setDigest(m_contentDigest);
   std::string json = manifest.toInfoJson();
   data.setContent((uint8_t*) json.data(), (size_t) json.size());
   data.setFreshnessPeriod(3_s);
@@ -852,6 +1623,58 @@ DIFS::putFileSendManifest(const ndn::Name& prefix, const ndn::Interest& interest
   m_face.put(data);
 }
 
+void
+DIFS::putFileEncodeParity()
+{
+  size_t k = m_dataFragments;
+  size_t m = m_parityFragments;
+  repo::ReedSolomon rs(k, m);
+
+  uint64_t nRows = (m_data.size() + k - 1) / k;
+  m_parity.assign(m, std::vector<shared_ptr<Data>>(nRows));
+
+  for (uint64_t row = 0; row < nRows; ++row) {
+    // parity content: the k data content lengths, then the parity of the zero-padded contents
+    std::vector<uint32_t> lengths(k, 0);
+    size_t len = 0;
+    for (size_t i = 0; i < k && row * k + i < m_data.size(); ++i) {
+      lengths[i] = m_data[row * k + i]->getContent().value_size();
+      len = std::max<size_t>(len, lengths[i]);
+    }
+
+    std::vector<std::vector<uint8_t>> data(k, std::vector<uint8_t>(len, 0));
+    std::vector<const uint8_t*> dataPointers;
+    for (size_t i = 0; i < k; ++i) {
+      if (lengths[i] > 0) {
+        const auto& content = m_data[row * k + i]->getContent();
+        std::copy(content.value_begin(), content.value_end(), data[i].begin());
+      }
+      dataPointers.push_back(data[i].data());
+    }
+
+    std::vector<std::vector<uint8_t>> parity(m, std::vector<uint8_t>(4 * k + len));
+    std::vector<uint8_t*> parityPointers;
+    for (size_t j = 0; j < m; ++j) {
+      for (size_t i = 0; i < k; ++i) {
+        for (int b = 0; b < 4; ++b) {
+          parity[j][4 * i + b] = static_cast<uint8_t>(lengths[i] >> (24 - 8 * b));
+        }
+      }
+      parityPointers.push_back(parity[j].data() + 4 * k);
+    }
+    rs.encode(dataPointers.data(), parityPointers.data(), len);
+
+    for (size_t j = 0; j < m; ++j) {
+      auto data = std::make_shared<Data>(Name(m_dataPrefix).append("parity").appendNumber(j).appendSegment(row));
+      data->setFreshnessPeriod(m_freshnessPeriod);
+      data->setContent(parity[j].data(), parity[j].size());
+      data->setFinalBlock(ndn::name::Component::fromSegment(nRows - 1));
+      m_hcKeyChain.ndn::KeyChain::sign(*data);
+      m_parity[j][row] = data;
+    }
+  }
+}
+
 void
 DIFS::putFileStopProcess()
 {
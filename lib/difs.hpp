@@ -11,6 +11,12 @@
 #include <ndn-cxx/util/segment-fetcher.hpp>
 #include <ndn-cxx/util/hc-segment-fetcher.hpp>
 
+namespace repo {
+class ReedSolomon;
+class CongestionControl;
+class PathHistory;
+} // namespace repo
+
 namespace difs {
 
 using std::shared_ptr;
@@ -19,6 +25,7 @@ static const uint64_t DEFAULT_BLOCK_SIZE = 8600;
 static const uint64_t DEFAULT_INTEREST_LIFETIME = 4000;
 static const uint64_t DEFAULT_FRESHNESS_PERIOD = 10000;
 static const uint64_t DEFAULT_CHECK_PERIOD = 1000;
+static const uint64_t DEFAULT_COMPLETION_WAIT = 30000;
 
 class DIFS : boost::noncopyable
 {
@@ -34,6 +41,7 @@ public:
     , m_interestLifetime(interestLifetime)
     , m_timeout(timeout)
     , m_verbose(verbose)
+    , m_checkPeriod(DEFAULT_CHECK_PERIOD)
     , m_validatorConfig(m_face)
     , m_scheduler(m_face.getIoService())
     , m_cmdSigner((ndn::KeyChain&)m_hcKeyChain)
@@ -92,21 +100,54 @@ public:
   void
   setBlockSize(size_t blockSize);
 
+  /**
+   * @brief store the next files as @p k data and @p m parity fragments on distinct nodes
+   */
+  void
+  setErasureCoding(int k, int m);
+
+  /**
+   * @brief fetch files with the "aimd", "cubic" or "bbr" window policy
+   *
+   * The window of a fetch is seeded with what the earlier fetches of this object learnt about
+   * the node serving the file.
+   */
+  void
+  setCongestionControl(const std::string& name);
+
   void
   setIdentityForData(std::string identityForData);
 
   void
   setIdentityForCommand(std::string identityForCommand);
 
+  /**
+   * @brief delete a file, sending delete-manifest straight to the owner of its manifest
+   *
+   * The owner comes from the cached keyspace, fetched with ringInfo on first use. A node
+   * that does not have the manifest makes the keyspace refresh; the command is resent only
+   * if the version changed, and otherwise goes through the cluster like on a timeout.
+   */
   void
   deleteFile(const ndn::Name& name);
 
   void
   deleteNode(const std::string from, const std::string to);
 
+  /**
+   * @brief fetch a file, asking the owner of its manifest directly like deleteFile()
+   */
   void
   getFile(const ndn::Name& name, std::ostream& os);
 
+  /**
+   * @brief resolve manifests of many files with one get-batch command
+   *
+   * Each manifest found is written to @p os as one line of JSON.
+   */
+  void
+  findManifests(const std::vector<ndn::Name>& names, std::ostream& os);
+
   void
   putFile(const ndn::Name& name, std::istream& is);
 
@@ -120,6 +161,51 @@ public:
   run();
 
 private:
+  ndn::Name
+  getClusterPrefix() const;
+
+  /**
+   * @brief fetch the keyspace and its version with ringInfo, then call @p done
+   *
+   * The cache is kept as it was if the keyspace cannot be fetched.
+   */
+  void
+  refreshKeySpace(const std::function<void()>& done);
+
+  void
+  onRefreshKeySpaceResponse(const ndn::Data& data);
+
+  /**
+   * @return the node owning @p hash in the cached keyspace, or an empty name
+   */
+  ndn::Name
+  getOwner(const std::string& hash) const;
+
+  void
+  sendFindCommand(const ndn::Name& name, bool canRefresh);
+
+  void
+  onFindCommandResponse(const ndn::Interest& interest, const ndn::Data& data,
+                        const ndn::Name& name, bool canRefresh);
+
+  /**
+   * @brief fall back to the get command, served by any node of the cluster
+   */
+  void
+  sendGetCommand(const ndn::Name& name);
+
+  void
+  sendDeleteManifestCommand(const ndn::Name& name, bool canRefresh);
+
+  void
+  onDeleteManifestCommandResponse(const ndn::Data& data, const ndn::Name& name, bool canRefresh);
+
+  /**
+   * @brief fall back to the delete command, served by any node of the cluster
+   */
+  void
+  sendDeleteCommand(const ndn::Name& name);
+
   void 
   fetch(int start);
 
@@ -129,6 +215,75 @@ private:
 	void 
   onDataCommandTimeout(ndn::util::HCSegmentFetcher& fetcher);
 
+  /**
+   * @brief fetch a file whose manifest lists several stripes, all stripes in parallel
+   *
+   * Segments arriving out of order wait in a reorder buffer until they can be written.
+   */
+  void
+  fetchStripes();
+
+  void
+  stripeSendInterests(size_t stripe);
+
+  void
+  onStripeData(const ndn::Interest& interest, const ndn::Data& data, size_t stripe);
+
+  void
+  onStripeTimeout(const ndn::Interest& interest, size_t stripe);
+
+  /**
+   * @brief request a stripe segment again, or abort the get once it was retried MAX_RETRY times
+   *
+   * The reorder buffer cannot drain past a missing segment, so a get that gives up on one
+   * throws out of run() instead of waiting forever.
+   */
+  void
+  retryStripeSegment(const ndn::Name& name, size_t stripe);
+
+  void
+  writeStripedSegments();
+
+  /**
+   * @brief fetch an erasure-coded file row by row
+   *
+   * Each row asks for its data fragments and one parity fragment more than needed, and is
+   * decoded as soon as any k fragments have arrived. A fragment that times out is replaced
+   * by the next parity fragment.
+   */
+  void
+  fetchErasureCoded();
+
+  void
+  startCodedRow(uint64_t row);
+
+  ndn::Name
+  getFragmentName(uint64_t row, size_t fragment) const;
+
+  void
+  sendFragmentInterest(uint64_t row, size_t fragment);
+
+  void
+  onFragmentData(const ndn::Interest& interest, const ndn::Data& data, uint64_t row, size_t fragment);
+
+  void
+  onFragmentTimeout(const ndn::Interest& interest, uint64_t row, size_t fragment);
+
+  void
+  decodeCodedRow(uint64_t row);
+
+  void
+  writeCodedRows();
+
+  /**
+   * @brief compute the parity fragments of m_data
+   */
+  void
+  putFileEncodeParity();
+
+  void
+  onFindManifestsSegment(const ndn::Data& data);
+
   void
   onDeleteCommandTimeout(const ndn::Interest& interest);
 
@@ -211,6 +366,18 @@ private:
   void
   putFileStartCheckCommand();
 
+  /**
+   * @brief wait for the repo to announce the end of the insert
+   *
+   * The repo answers the insert-done Interest when the insert completes or fails. If it
+   * does not answer in time, one insert check tells whether the insert is still going on.
+   */
+  void
+  putFileWaitForCompletion();
+
+  void
+  onPutFileDoneResponse(const ndn::Interest& interest, const ndn::Data& data);
+
   void
   putFileonCheckCommandResponse(const ndn::Interest& interest, const ndn::Data& data);
 
@@ -258,11 +425,57 @@ private:
 
   std::ostream* m_os;
   size_t m_bytes;
+  std::string m_contentDigest;  ///< SHA-256 of the file, sent with its info
+
+  struct KeySpaceRange
+  {
+    ndn::Name node;
+    int start;
+    int end;
+  };
+  std::vector<KeySpaceRange> m_keySpace;  ///< empty until fetched
+  std::string m_keySpaceVersion;
+  ndn::Name m_fileName;  ///< file of the pending get or delete
   boost::property_tree::ptree m_validatorNode;
 
   // repo::Manifest m_manifest;
   std::string m_manifest;
 
+  struct Stripe
+  {
+    ndn::DelegationList forwardingHint;
+    uint64_t nextSegment;
+    uint64_t endSegment;
+    size_t nInFlight = 0;
+  };
+  std::vector<Stripe> m_stripes;
+  std::map<uint64_t, std::shared_ptr<const ndn::Data>> m_reorderBuffer;
+  std::map<uint64_t, int> m_segmentRetries;
+  uint64_t m_nextSegmentToWrite;
+  uint64_t m_lastSegment;
+
+  struct CodedRow
+  {
+    std::vector<std::shared_ptr<const ndn::Data>> fragments;  ///< data fragments first
+    size_t nAvailable = 0;   ///< fragments received, plus data fragments past the end of file
+    size_t nextFragment = 0; ///< next fragment to ask for when one is late
+    bool isDecoded = false;
+    std::vector<std::string> contents;
+  };
+  int m_dataFragments = 0;
+  int m_parityFragments = 0;
+  std::shared_ptr<repo::ReedSolomon> m_erasureCode;
+
+  std::shared_ptr<repo::CongestionControl> m_congestionControl;
+  std::shared_ptr<repo::PathHistory> m_pathHistory;
+  std::vector<ndn::DelegationList> m_fragmentHints;
+  std::map<uint64_t, CodedRow> m_codedRows;
+  std::map<ndn::Name, int> m_fragmentRetries;
+  uint64_t m_nextRow;
+  uint64_t m_nextRowToWrite;
+  uint64_t m_nRows;
+  std::vector<std::vector<shared_ptr<ndn::Data>>> m_parity;
+
 	std::map<int, const ndn::Block> map;
 	int m_currentSegment, m_totalSize;
 
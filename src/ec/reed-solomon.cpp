@@ -0,0 +1,315 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "reed-solomon.hpp"
+
+#include <cstring>
+
+#include <boost/throw_exception.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define REPO_EC_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace repo {
+
+namespace {
+
+/**
+ * @brief log and exp tables of GF(2^8) with polynomial x^8 + x^4 + x^3 + x^2 + 1
+ */
+struct GaloisField
+{
+  uint8_t exp[512];
+  uint8_t log[256];
+
+  GaloisField()
+  {
+    unsigned x = 1;
+    for (int i = 0; i < 255; ++i) {
+      exp[i] = static_cast<uint8_t>(x);
+      log[x] = static_cast<uint8_t>(i);
+      x <<= 1;
+      if (x & 0x100) {
+        x ^= 0x11d;
+      }
+    }
+    for (int i = 255; i < 512; ++i) {
+      exp[i] = exp[i - 255];
+    }
+    log[0] = 0;
+  }
+
+  uint8_t
+  mul(uint8_t a, uint8_t b) const
+  {
+    if (a == 0 || b == 0) {
+      return 0;
+    }
+    return exp[log[a] + log[b]];
+  }
+
+  uint8_t
+  inv(uint8_t a) const
+  {
+    return exp[255 - log[a]];
+  }
+};
+
+const GaloisField&
+gf()
+{
+  static const GaloisField field;
+  return field;
+}
+
+void
+dotProductScalar(const uint8_t* tables, const uint8_t* const* src, size_t nSrc,
+                 uint8_t* dst, size_t offset, size_t len)
+{
+  for (size_t pos = offset; pos < len; ++pos) {
+    uint8_t acc = 0;
+    for (size_t i = 0; i < nSrc; ++i) {
+      const uint8_t* t = tables + 32 * i;
+      uint8_t x = src[i][pos];
+      acc ^= t[x & 0x0f] ^ t[16 + (x >> 4)];
+    }
+    dst[pos] = acc;
+  }
+}
+
+#ifdef REPO_EC_HAVE_X86_KERNELS
+
+__attribute__((target("ssse3"))) size_t
+dotProductSsse3(const uint8_t* tables, const uint8_t* const* src, size_t nSrc,
+                uint8_t* dst, size_t len)
+{
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  size_t pos = 0;
+  for (; pos + 16 <= len; pos += 16) {
+    __m128i acc = _mm_setzero_si128();
+    for (size_t i = 0; i < nSrc; ++i) {
+      __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables + 32 * i));
+      __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables + 32 * i + 16));
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src[i] + pos));
+      __m128i xl = _mm_and_si128(x, mask);
+      __m128i xh = _mm_and_si128(_mm_srli_epi64(x, 4), mask);
+      acc = _mm_xor_si128(acc, _mm_shuffle_epi8(low, xl));
+      acc = _mm_xor_si128(acc, _mm_shuffle_epi8(high, xh));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + pos), acc);
+  }
+  return pos;
+}
+
+__attribute__((target("avx2"))) size_t
+dotProductAvx2(const uint8_t* tables, const uint8_t* const* src, size_t nSrc,
+               uint8_t* dst, size_t len)
+{
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  size_t pos = 0;
+  for (; pos + 32 <= len; pos += 32) {
+    __m256i acc = _mm256_setzero_si256();
+    for (size_t i = 0; i < nSrc; ++i) {
+      __m256i low = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables + 32 * i)));
+      __m256i high = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables + 32 * i + 16)));
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src[i] + pos));
+      __m256i xl = _mm256_and_si256(x, mask);
+      __m256i xh = _mm256_and_si256(_mm256_srli_epi64(x, 4), mask);
+      acc = _mm256_xor_si256(acc, _mm256_shuffle_epi8(low, xl));
+      acc = _mm256_xor_si256(acc, _mm256_shuffle_epi8(high, xh));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + pos), acc);
+  }
+  return pos;
+}
+
+enum class Kernel {
+  SCALAR,
+  SSSE3,
+  AVX2
+};
+
+Kernel
+detectKernel()
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Kernel::AVX2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return Kernel::SSSE3;
+  }
+  return Kernel::SCALAR;
+}
+
+#endif // REPO_EC_HAVE_X86_KERNELS
+
+} // namespace
+
+ReedSolomon::ReedSolomon(size_t k, size_t m)
+  : m_k(k)
+  , m_m(m)
+{
+  if (k == 0 || k + m > 256) {
+    BOOST_THROW_EXCEPTION(Error("Unsupported erasure code " + std::to_string(k) + "+" + std::to_string(m)));
+  }
+
+  const GaloisField& field = gf();
+  size_t n = k + m;
+  m_matrix.assign(n * k, 0);
+  for (size_t i = 0; i < k; ++i) {
+    m_matrix[i * k + i] = 1;
+  }
+  for (size_t i = k; i < n; ++i) {
+    for (size_t j = 0; j < k; ++j) {
+      m_matrix[i * k + j] = field.inv(static_cast<uint8_t>(i ^ j));
+    }
+  }
+
+  m_parityTables = makeTables(m_matrix.data() + k * k, m * k);
+}
+
+std::vector<uint8_t>
+ReedSolomon::makeTables(const uint8_t* coefficients, size_t n)
+{
+  const GaloisField& field = gf();
+  std::vector<uint8_t> tables(32 * n);
+  for (size_t i = 0; i < n; ++i) {
+    for (uint8_t x = 0; x < 16; ++x) {
+      tables[32 * i + x] = field.mul(coefficients[i], x);
+      tables[32 * i + 16 + x] = field.mul(coefficients[i], static_cast<uint8_t>(x << 4));
+    }
+  }
+  return tables;
+}
+
+void
+ReedSolomon::dotProduct(const uint8_t* tables, const uint8_t* const* src, size_t nSrc,
+                        uint8_t* dst, size_t len)
+{
+  size_t done = 0;
+#ifdef REPO_EC_HAVE_X86_KERNELS
+  static const Kernel kernel = detectKernel();
+  switch (kernel) {
+    case Kernel::AVX2:
+      done = dotProductAvx2(tables, src, nSrc, dst, len);
+      break;
+    case Kernel::SSSE3:
+      done = dotProductSsse3(tables, src, nSrc, dst, len);
+      break;
+    case Kernel::SCALAR:
+      break;
+  }
+#endif // REPO_EC_HAVE_X86_KERNELS
+  dotProductScalar(tables, src, nSrc, dst, done, len);
+}
+
+void
+ReedSolomon::encode(const uint8_t* const* data, uint8_t* const* parity, size_t len) const
+{
+  for (size_t j = 0; j < m_m; ++j) {
+    dotProduct(&m_parityTables[32 * m_k * j], data, m_k, parity[j], len);
+  }
+}
+
+bool
+ReedSolomon::reconstruct(uint8_t* const* fragments, const std::vector<bool>& isPresent, size_t len) const
+{
+  const GaloisField& field = gf();
+  size_t n = m_k + m_m;
+
+  std::vector<size_t> missing;
+  for (size_t i = 0; i < m_k; ++i) {
+    if (!isPresent[i]) {
+      missing.push_back(i);
+    }
+  }
+  if (missing.empty()) {
+    return true;
+  }
+
+  // the first k fragments present and the rows of the encoding matrix that produced them
+  std::vector<size_t> rows;
+  for (size_t i = 0; i < n && rows.size() < m_k; ++i) {
+    if (isPresent[i]) {
+      rows.push_back(i);
+    }
+  }
+  if (rows.size() < m_k) {
+    return false;
+  }
+
+  std::vector<uint8_t> a(m_k * m_k);
+  std::vector<uint8_t> inverse(m_k * m_k, 0);
+  for (size_t r = 0; r < m_k; ++r) {
+    std::memcpy(&a[r * m_k], &m_matrix[rows[r] * m_k], m_k);
+    inverse[r * m_k + r] = 1;
+  }
+
+  // Gauss-Jordan elimination
+  for (size_t col = 0; col < m_k; ++col) {
+    size_t pivot = col;
+    while (pivot < m_k && a[pivot * m_k + col] == 0) {
+      ++pivot;
+    }
+    if (pivot == m_k) {
+      return false;
+    }
+    if (pivot != col) {
+      for (size_t j = 0; j < m_k; ++j) {
+        std::swap(a[pivot * m_k + j], a[col * m_k + j]);
+        std::swap(inverse[pivot * m_k + j], inverse[col * m_k + j]);
+      }
+    }
+
+    uint8_t scale = field.inv(a[col * m_k + col]);
+    for (size_t j = 0; j < m_k; ++j) {
+      a[col * m_k + j] = field.mul(a[col * m_k + j], scale);
+      inverse[col * m_k + j] = field.mul(inverse[col * m_k + j], scale);
+    }
+
+    for (size_t r = 0; r < m_k; ++r) {
+      uint8_t factor = a[r * m_k + col];
+      if (r == col || factor == 0) {
+        continue;
+      }
+      for (size_t j = 0; j < m_k; ++j) {
+        a[r * m_k + j] ^= field.mul(factor, a[col * m_k + j]);
+        inverse[r * m_k + j] ^= field.mul(factor, inverse[col * m_k + j]);
+      }
+    }
+  }
+
+  std::vector<const uint8_t*> src;
+  for (size_t row : rows) {
+    src.push_back(fragments[row]);
+  }
+
+  for (size_t i : missing) {
+    dotProduct(makeTables(&inverse[i * m_k], m_k).data(), src.data(), m_k, fragments[i], len);
+  }
+
+  return true;
+}
+
+} // namespace repo
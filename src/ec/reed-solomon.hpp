@@ -0,0 +1,107 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_EC_REED_SOLOMON_HPP
+#define REPO_EC_REED_SOLOMON_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace repo {
+
+/**
+ * @brief systematic Reed-Solomon code over GF(2^8) with k data and m parity fragments
+ *
+ * The encoding matrix is the identity on top of a Cauchy matrix, so that any k of the k+m
+ * fragments are enough to rebuild the data. Fragments of a stripe all have the same length.
+ *
+ * Like ISA-L, every coefficient is expanded to two 16-byte tables (products with the low and
+ * the high nibble of a byte), and a region is multiplied with PSHUFB lookups. The SSSE3 and
+ * AVX2 kernels are picked at run time; other CPUs use the same tables one byte at a time.
+ */
+class ReedSolomon
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+public:
+  /**
+   * @throw Error k is zero or k+m is above 256
+   */
+  ReedSolomon(size_t k, size_t m);
+
+  size_t
+  getDataFragments() const
+  {
+    return m_k;
+  }
+
+  size_t
+  getParityFragments() const
+  {
+    return m_m;
+  }
+
+  /**
+   * @brief compute the m parity fragments of k data fragments of @p len bytes each
+   */
+  void
+  encode(const uint8_t* const* data, uint8_t* const* parity, size_t len) const;
+
+  /**
+   * @brief rebuild the missing data fragments
+   * @param fragments k+m buffers of @p len bytes, data fragments first
+   * @param isPresent which fragments hold valid content
+   * @return false if fewer than k fragments are present
+   */
+  bool
+  reconstruct(uint8_t* const* fragments, const std::vector<bool>& isPresent, size_t len) const;
+
+private:
+  /**
+   * @brief dst = sum of coefficients[i] * src[i], with coefficient tables from makeTables()
+   */
+  static void
+  dotProduct(const uint8_t* tables, const uint8_t* const* src, size_t nSrc,
+             uint8_t* dst, size_t len);
+
+  static std::vector<uint8_t>
+  makeTables(const uint8_t* coefficients, size_t n);
+
+private:
+  size_t m_k;
+  size_t m_m;
+  std::vector<uint8_t> m_matrix;        ///< (k+m) x k encoding matrix
+  std::vector<uint8_t> m_parityTables;  ///< nibble tables of the parity rows
+};
+
+} // namespace repo
+
+#endif // REPO_EC_REED_SOLOMON_HPP
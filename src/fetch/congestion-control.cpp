@@ -0,0 +1,151 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "congestion-control.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <boost/throw_exception.hpp>
+
+namespace repo {
+
+static const double DEFAULT_CWND = 12;
+static const double MIN_CWND = 2;
+static const double MAX_CWND = 4096;
+static const double CUBIC_BETA = 0.7;
+static const double CUBIC_STEP = 0.1;  // share of the window added per round trip
+static const double BBR_CWND_GAIN = 2;
+
+static FetchWindow
+makeDefaultWindow()
+{
+  return {DEFAULT_CWND, std::numeric_limits<double>::max(), 1, 0.5, false};
+}
+
+static double
+clampWindow(double cwnd)
+{
+  return std::min(std::max(cwnd, MIN_CWND), MAX_CWND);
+}
+
+std::unique_ptr<CongestionControl>
+CongestionControl::create(const std::string& name)
+{
+  if (name == "aimd") {
+    return std::unique_ptr<CongestionControl>(new AimdControl);
+  }
+  if (name == "cubic") {
+    return std::unique_ptr<CongestionControl>(new CubicControl);
+  }
+  if (name == "bbr") {
+    return std::unique_ptr<CongestionControl>(new BbrControl);
+  }
+  BOOST_THROW_EXCEPTION(Error("Unknown congestion control " + name));
+}
+
+FetchWindow
+AimdControl::makeWindow(const PathEstimate& path) const
+{
+  FetchWindow window = makeDefaultWindow();
+  if (path.isKnown()) {
+    window.initCwnd = clampWindow(path.getBdp());
+    window.initSsthresh = clampWindow(2 * path.getBdp());
+  }
+  return window;
+}
+
+FetchWindow
+CubicControl::makeWindow(const PathEstimate& path) const
+{
+  FetchWindow window = makeDefaultWindow();
+  window.mdCoef = CUBIC_BETA;
+  if (path.isKnown()) {
+    window.initCwnd = clampWindow(path.getBdp());
+    window.initSsthresh = window.initCwnd;
+  }
+  window.aiStep = std::max(1.0, CUBIC_STEP * window.initCwnd);
+  return window;
+}
+
+FetchWindow
+BbrControl::makeWindow(const PathEstimate& path) const
+{
+  FetchWindow window = makeDefaultWindow();
+  if (path.isKnown()) {
+    window.initCwnd = clampWindow(BBR_CWND_GAIN * path.getBdp());
+    window.useConstantCwnd = true;
+  }
+  return window;
+}
+
+PathHistory::PathHistory(size_t maxPaths, double gain)
+  : m_maxPaths(std::max<size_t>(maxPaths, 1))
+  , m_gain(gain)
+  , m_nSamples(0)
+{
+}
+
+void
+PathHistory::addSample(const std::string& path, double rtt, double rate)
+{
+  if (rtt <= 0) {
+    return;
+  }
+
+  auto it = m_paths.find(path);
+  if (it == m_paths.end()) {
+    if (m_paths.size() >= m_maxPaths) {
+      m_paths.erase(std::min_element(m_paths.begin(), m_paths.end(),
+                                     [] (const std::pair<const std::string, Entry>& a,
+                                         const std::pair<const std::string, Entry>& b) {
+                                       return a.second.lastUse < b.second.lastUse;
+                                     }));
+    }
+
+    Entry entry;
+    entry.estimate.rtt = rtt;
+    entry.estimate.minRtt = rtt;
+    entry.estimate.rate = rate;
+    entry.lastUse = ++m_nSamples;
+    m_paths[path] = entry;
+    return;
+  }
+
+  PathEstimate& estimate = it->second.estimate;
+  estimate.rtt += m_gain * (rtt - estimate.rtt);
+  estimate.minRtt = std::min(estimate.minRtt, rtt);
+  if (rate > 0) {
+    estimate.rate = estimate.rate > 0 ? estimate.rate + m_gain * (rate - estimate.rate) : rate;
+  }
+  it->second.lastUse = ++m_nSamples;
+}
+
+PathEstimate
+PathHistory::get(const std::string& path) const
+{
+  auto it = m_paths.find(path);
+  if (it == m_paths.end()) {
+    return PathEstimate();
+  }
+  return it->second.estimate;
+}
+
+} // namespace repo
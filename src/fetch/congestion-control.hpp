@@ -0,0 +1,185 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_FETCH_CONGESTION_CONTROL_HPP
+#define REPO_FETCH_CONGESTION_CONTROL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace repo {
+
+/**
+ * @brief what the last fetches learnt about the path to a producer
+ */
+struct PathEstimate
+{
+  double rtt = 0;     ///< smoothed seconds until the first segment, zero if never fetched
+  double minRtt = 0;  ///< lowest of those
+  double rate = 0;    ///< smoothed segments per second once data flows
+
+  bool
+  isKnown() const
+  {
+    return rtt > 0 && rate > 0;
+  }
+
+  /**
+   * @return segments in flight that fill the path, bandwidth times the base delay
+   */
+  double
+  getBdp() const
+  {
+    return rate * minRtt;
+  }
+};
+
+/**
+ * @brief initial window of a segment fetcher and how it reacts to congestion
+ *
+ * The fields map one to one onto the options of the ndn-cxx segment fetchers, which grow the
+ * window themselves: slow start up to the threshold, then additive increase per window.
+ */
+struct FetchWindow
+{
+  double initCwnd;
+  double initSsthresh;
+  double aiStep;
+  double mdCoef;
+  bool useConstantCwnd;
+};
+
+/**
+ * @brief congestion control of the repo's segment fetchers
+ *
+ * A control turns the history of a path into the window a new fetch starts with. Without
+ * history every control starts like the fetchers always did, with 12 Interests in flight.
+ */
+class CongestionControl
+{
+public:
+  class Error : public std::invalid_argument
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::invalid_argument(what)
+    {
+    }
+  };
+
+public:
+  virtual
+  ~CongestionControl() = default;
+
+  virtual FetchWindow
+  makeWindow(const PathEstimate& path) const = 0;
+
+  /**
+   * @param name "aimd", "cubic" or "bbr"
+   * @throw Error @p name is none of those
+   */
+  static std::unique_ptr<CongestionControl>
+  create(const std::string& name);
+};
+
+/**
+ * @brief additive increase, halving on loss; slow start ends past twice the path's BDP
+ */
+class AimdControl : public CongestionControl
+{
+public:
+  FetchWindow
+  makeWindow(const PathEstimate& path) const override;
+};
+
+/**
+ * @brief CUBIC's gentler decrease to 0.7, and a step that regains the window within a few
+ *        round trips whatever its size, as CUBIC does near the last maximum
+ */
+class CubicControl : public CongestionControl
+{
+public:
+  FetchWindow
+  makeWindow(const PathEstimate& path) const override;
+};
+
+/**
+ * @brief BBR-style model: a constant window of twice the measured bandwidth-delay product
+ *
+ * The model is refreshed by every finished fetch. Paths without history start like AIMD.
+ */
+class BbrControl : public CongestionControl
+{
+public:
+  FetchWindow
+  makeWindow(const PathEstimate& path) const override;
+};
+
+/**
+ * @brief per-producer path estimates, smoothed over the fetches from that producer
+ *
+ * Only the most recently used paths are kept.
+ */
+class PathHistory
+{
+public:
+  explicit
+  PathHistory(size_t maxPaths = 1024, double gain = 0.25);
+
+  /**
+   * @param rtt seconds until the first segment of a fetch
+   * @param rate segments per second over the fetch, zero if too short to tell
+   */
+  void
+  addSample(const std::string& path, double rtt, double rate);
+
+  /**
+   * @return the estimate of @p path, unknown if it was never sampled
+   */
+  PathEstimate
+  get(const std::string& path) const;
+
+  size_t
+  size() const
+  {
+    return m_paths.size();
+  }
+
+private:
+  struct Entry
+  {
+    PathEstimate estimate;
+    uint64_t lastUse;
+  };
+
+  size_t m_maxPaths;
+  double m_gain;
+  uint64_t m_nSamples;
+  std::map<std::string, Entry> m_paths;
+};
+
+} // namespace repo
+
+#endif // REPO_FETCH_CONGESTION_CONTROL_HPP
@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "hash-chain-verifier.hpp"
+#include "multi-buffer-sha256.hpp"
+
+#include <algorithm>
+
+namespace repo {
+
+HashChainVerifier::HashChainVerifier(size_t batchSize)
+  : m_batchSize(std::max<size_t>(batchSize, 1))
+  , m_hasNext(false)
+  , m_nextSegmentNo(0)
+{
+}
+
+std::vector<HashChainVerifier::Run>
+HashChainVerifier::setAnchor(uint64_t segmentNo, std::vector<uint8_t> digest)
+{
+  if (isLinked(segmentNo) || (m_hasNext && segmentNo == m_nextSegmentNo)) {
+    return {};
+  }
+
+  std::vector<Run> runs = flush();
+  m_hasNext = !digest.empty();
+  m_nextSegmentNo = segmentNo;
+  m_nextHash = std::move(digest);
+  link(runs);
+  return runs;
+}
+
+std::vector<HashChainVerifier::Run>
+HashChainVerifier::add(Segment segment)
+{
+  std::vector<Run> runs;
+  if (isLinked(segment.segmentNo)) {
+    // already linked, a retransmission
+    return runs;
+  }
+
+  // the first copy of a segment is kept; a forged one fails its run and the fetch with it
+  m_held.emplace(segment.segmentNo, std::move(segment));
+  link(runs);
+  return runs;
+}
+
+void
+HashChainVerifier::link(std::vector<Run>& runs)
+{
+  while (m_hasNext) {
+    auto it = m_held.find(m_nextSegmentNo);
+    if (it == m_held.end()) {
+      return;
+    }
+
+    if (m_current.segments.empty()) {
+      m_current.anchor = m_nextHash;
+    }
+    m_nextHash = it->second.nextHash;
+    m_hasNext = !m_nextHash.empty();
+    ++m_nextSegmentNo;
+    m_current.segments.push_back(std::move(it->second));
+    m_held.erase(it);
+
+    if (m_current.segments.size() >= m_batchSize) {
+      runs.push_back(std::move(m_current));
+      m_current = Run();
+    }
+  }
+}
+
+std::vector<HashChainVerifier::Run>
+HashChainVerifier::flush()
+{
+  std::vector<Run> runs;
+  if (!m_current.segments.empty()) {
+    runs.push_back(std::move(m_current));
+    m_current = Run();
+  }
+  return runs;
+}
+
+std::vector<bool>
+HashChainVerifier::verify(const Run& run)
+{
+  std::vector<MultiBufferSha256::Message> messages;
+  messages.reserve(run.segments.size());
+  for (const auto& segment : run.segments) {
+    messages.push_back({segment.signedPortion.data(), segment.signedPortion.size()});
+  }
+  auto digests = MultiBufferSha256::compute(messages);
+
+  std::vector<bool> isValid(run.segments.size());
+  const std::vector<uint8_t>* expected = &run.anchor;
+  bool isPreviousValid = true;
+  for (size_t i = 0; i < run.segments.size(); ++i) {
+    const Segment& segment = run.segments[i];
+    bool isDigestValid = segment.signatureValue.size() == digests[i].size() &&
+                         std::equal(digests[i].begin(), digests[i].end(), segment.signatureValue.begin());
+    // a segment the chain does not reach is not trusted, whatever its digest
+    bool isLinkValid = !expected->empty() && *expected == segment.signatureValue;
+
+    isValid[i] = isPreviousValid && isDigestValid && isLinkValid;
+    isPreviousValid = isValid[i];
+    expected = &segment.nextHash;
+  }
+  return isValid;
+}
+
+} // namespace repo
@@ -0,0 +1,134 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_FETCH_HASH_CHAIN_VERIFIER_HPP
+#define REPO_FETCH_HASH_CHAIN_VERIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace repo {
+
+/**
+ * @brief checks hash-chained segments a run at a time instead of one packet at a time
+ *
+ * Each segment is signed with DigestSha256: its signature value is the SHA-256 of its signed
+ * portion, which includes the digest of the next segment (nextHash). Since anyone can compute
+ * a digest, a segment is only trusted once the chain reaches it from an anchor: the nextHash
+ * of a segment validated with a key, or of a segment already trusted.
+ *
+ * Segments are held until the chain from the anchor reaches them, then grouped into runs of
+ * up to batchSize consecutive segments. All digests of a run are computed with one
+ * MultiBufferSha256 call, which can run on a ValidationPool thread. A run starts from the
+ * nextHash of the last segment of the run before it, so it is only valid if that run was:
+ * runs must be checked, and their results used, in the order they are returned.
+ */
+class HashChainVerifier
+{
+public:
+  struct Segment
+  {
+    uint64_t segmentNo = 0;
+    std::vector<uint8_t> signedPortion;
+    std::vector<uint8_t> signatureValue;
+    std::vector<uint8_t> nextHash;  ///< empty when the segment has no link
+  };
+
+  struct Run
+  {
+    std::vector<Segment> segments;
+    std::vector<uint8_t> anchor;  ///< digest the first segment must have
+  };
+
+public:
+  /**
+   * @param batchSize segments per run
+   */
+  explicit
+  HashChainVerifier(size_t batchSize = 8);
+
+  /**
+   * @brief trust @p digest as the signature value of segment @p segmentNo
+   *
+   * Ignored if the chain already reaches @p segmentNo, so that a repeated anchor links
+   * nothing twice.
+   *
+   * @return the runs that are complete once the held segments it reaches are linked
+   */
+  std::vector<Run>
+  setAnchor(uint64_t segmentNo, std::vector<uint8_t> digest);
+
+  /**
+   * @return the runs that are complete after adding @p segment
+   */
+  std::vector<Run>
+  add(Segment segment);
+
+  /**
+   * @return the linked segments not yet returned, as one run; held segments stay held
+   */
+  std::vector<Run>
+  flush();
+
+  /**
+   * @return segments the chain has not reached yet
+   */
+  size_t
+  getHeld() const
+  {
+    return m_held.size();
+  }
+
+  /**
+   * @return whether the chain reached @p segmentNo already
+   */
+  bool
+  isLinked(uint64_t segmentNo) const
+  {
+    return segmentNo < m_nextSegmentNo;
+  }
+
+  /**
+   * @return whether each segment of @p run is valid; safe to call from any thread
+   */
+  static std::vector<bool>
+  verify(const Run& run);
+
+private:
+  /**
+   * @brief move the held segments the chain reaches into runs
+   */
+  void
+  link(std::vector<Run>& runs);
+
+private:
+  size_t m_batchSize;
+  Run m_current;
+  std::map<uint64_t, Segment> m_held;
+  bool m_hasNext;                     ///< whether the digest of m_nextSegmentNo is known
+  uint64_t m_nextSegmentNo;
+  std::vector<uint8_t> m_nextHash;
+};
+
+} // namespace repo
+
+#endif // REPO_FETCH_HASH_CHAIN_VERIFIER_HPP
@@ -0,0 +1,209 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ingest-scheduler.hpp"
+
+#include <algorithm>
+
+namespace repo {
+
+static const double SAMPLE_INTERVAL = 1;     // seconds between throughput samples
+static const double THROUGHPUT_GAIN = 0.25;
+static const double MIN_THROUGHPUT = 100;    // segments per second assumed before any sample
+static const double MIN_RETRY_AFTER = 1;
+static const double MAX_RETRY_AFTER = 300;
+
+constexpr size_t IngestScheduler::UNLIMITED;
+
+IngestScheduler::IngestScheduler(const Limits& limits)
+  : m_limits(limits)
+  , m_virtualTime(0)
+  , m_nEnqueued(0)
+  , m_inFlight(0)
+  , m_tokens(limits.maxBytesPerSecond)
+  , m_lastRefill(-1)
+  , m_nStored(0)
+  , m_lastSample(-1)
+  , m_throughput(0)
+{
+}
+
+IngestScheduler::Admission
+IngestScheduler::checkAdmission() const
+{
+  if (m_queued.size() < m_limits.maxQueued) {
+    return {true, 0};
+  }
+
+  double backlog = 0;
+  for (const auto& running : m_running) {
+    backlog += running.second.remaining;
+  }
+  for (const auto& queued : m_queued) {
+    backlog += queued.second.job.nSegments;
+  }
+
+  double retryAfter = backlog / std::max(m_throughput, MIN_THROUGHPUT);
+  return {false, std::min(std::max(retryAfter, MIN_RETRY_AFTER), MAX_RETRY_AFTER)};
+}
+
+void
+IngestScheduler::enqueue(const Job& job)
+{
+  finish(job.id);
+
+  double weight = job.weight > 0 ? job.weight : 1;
+  double& lastFinish = m_lastFinish[job.flow];
+  double tag = std::max(m_virtualTime, lastFinish) + job.nSegments / weight;
+  lastFinish = tag;
+
+  QueueKey key(job.nSegments > m_limits.smallSegments, tag, m_nEnqueued++);
+  m_queue.emplace(key, job.id);
+  m_queued.emplace(job.id, Queued{job, key});
+  ++m_flowJobs[job.flow];
+}
+
+std::vector<IngestScheduler::Grant>
+IngestScheduler::poll(double now)
+{
+  refill(now);
+
+  if (m_lastSample < 0) {
+    m_lastSample = now;
+  }
+  else if (now - m_lastSample >= SAMPLE_INTERVAL) {
+    double rate = m_nStored / (now - m_lastSample);
+    m_throughput += THROUGHPUT_GAIN * (rate - m_throughput);
+    m_nStored = 0;
+    m_lastSample = now;
+  }
+
+  std::vector<Grant> grants;
+  while (!m_queue.empty()) {
+    if (m_limits.maxBytesPerSecond > 0 && m_tokens <= 0) {
+      break;
+    }
+
+    auto next = m_queue.begin();
+    const Job& job = m_queued.at(next->second).job;
+    size_t window = getWindow(job);
+    bool isLimited = m_limits.maxInFlightSegments > 0;
+    // strictly in order, so that a large insert is not overtaken forever;
+    // the first one always starts, even if its window is above the budget
+    if (isLimited && !m_running.empty() && m_inFlight + window > m_limits.maxInFlightSegments) {
+      break;
+    }
+
+    m_virtualTime = std::max(m_virtualTime, std::get<1>(next->first));
+    if (isLimited) {
+      m_inFlight += window;
+    }
+    m_running[job.id] = Running{job.flow, window, job.nSegments};
+    grants.push_back({job.id, window});
+
+    m_queued.erase(next->second);
+    m_queue.erase(next);
+  }
+
+  // flows whose last insert is behind the virtual time start from it anyway
+  for (auto it = m_lastFinish.begin(); it != m_lastFinish.end();) {
+    if (it->second <= m_virtualTime) {
+      it = m_lastFinish.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  return grants;
+}
+
+void
+IngestScheduler::onStored(JobId id, size_t bytes, double now)
+{
+  refill(now);
+  if (m_limits.maxBytesPerSecond > 0) {
+    m_tokens -= bytes;
+  }
+  ++m_nStored;
+
+  auto it = m_running.find(id);
+  if (it != m_running.end() && it->second.remaining > 0) {
+    --it->second.remaining;
+  }
+}
+
+void
+IngestScheduler::finish(JobId id)
+{
+  auto running = m_running.find(id);
+  if (running != m_running.end()) {
+    if (m_limits.maxInFlightSegments > 0) {
+      m_inFlight -= running->second.window;
+    }
+    removeFromFlow(running->second.flow);
+    m_running.erase(running);
+    return;
+  }
+
+  auto queued = m_queued.find(id);
+  if (queued != m_queued.end()) {
+    removeFromFlow(queued->second.job.flow);
+    m_queue.erase(queued->second.key);
+    m_queued.erase(queued);
+  }
+}
+
+void
+IngestScheduler::removeFromFlow(const std::string& flow)
+{
+  auto it = m_flowJobs.find(flow);
+  if (it != m_flowJobs.end() && --it->second == 0) {
+    m_flowJobs.erase(it);
+  }
+}
+
+void
+IngestScheduler::refill(double now)
+{
+  if (m_limits.maxBytesPerSecond <= 0) {
+    return;
+  }
+  if (m_lastRefill >= 0 && now > m_lastRefill) {
+    // at most one second worth of bytes is saved up
+    m_tokens = std::min(m_limits.maxBytesPerSecond,
+                        m_tokens + (now - m_lastRefill) * m_limits.maxBytesPerSecond);
+  }
+  m_lastRefill = std::max(m_lastRefill, now);
+}
+
+size_t
+IngestScheduler::getWindow(const Job& job) const
+{
+  if (m_limits.maxInFlightSegments == 0) {
+    return UNLIMITED;
+  }
+
+  size_t share = m_limits.maxInFlightSegments / std::max<size_t>(m_flowJobs.size(), 1);
+  size_t window = std::min(std::max(share, m_limits.minWindow), m_limits.maxInFlightSegments);
+  return static_cast<size_t>(std::max<uint64_t>(std::min<uint64_t>(window, job.nSegments), 1));
+}
+
+} // namespace repo
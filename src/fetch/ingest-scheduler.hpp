@@ -0,0 +1,197 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_FETCH_INGEST_SCHEDULER_HPP
+#define REPO_FETCH_INGEST_SCHEDULER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace repo {
+
+/**
+ * @brief admission control and fair scheduling of the inserts a node fetches
+ *
+ * The node has a budget of segments in flight over all inserts and, optionally, of bytes
+ * stored per second. Inserts wait in a queue until the budget has room for their window.
+ *
+ * The queue is weighted fair across flows, a flow being a client or a name prefix: every
+ * insert gets a virtual finish tag, its size over the weight of its flow added to the tag
+ * of the previous insert of that flow, and inserts start in tag order. A flow with many
+ * large files thus gets its share, not the whole node. Inserts of at most a few segments go
+ * before the others, since they finish almost at once.
+ *
+ * When the queue is full, new inserts are refused with a hint of when to retry, the time
+ * the node needs to drain its backlog at the throughput it has been reaching.
+ *
+ * Times are seconds on any steady clock.
+ */
+class IngestScheduler
+{
+public:
+  struct Limits
+  {
+    size_t maxInFlightSegments = 0;  ///< over all inserts, zero for no limit
+    double maxBytesPerSecond = 0;    ///< zero for no limit
+    size_t maxQueued = 256;          ///< inserts waiting to start before new ones are refused
+    uint64_t smallSegments = 16;     ///< inserts up to this many segments go first
+    size_t minWindow = 4;            ///< smallest window an insert starts with
+  };
+
+  using JobId = uint64_t;
+
+  struct Job
+  {
+    JobId id;
+    std::string flow;
+    uint64_t nSegments;
+    double weight = 1;
+  };
+
+  struct Grant
+  {
+    JobId id;
+    size_t window;  ///< segments the insert may keep in flight
+  };
+
+  struct Admission
+  {
+    bool isAccepted;
+    double retryAfter;  ///< seconds, zero when accepted
+  };
+
+  static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+public:
+  explicit
+  IngestScheduler(const Limits& limits);
+
+  /**
+   * @brief whether a new insert may be queued now
+   */
+  Admission
+  checkAdmission() const;
+
+  /**
+   * @brief queue an insert; it starts once poll() grants it
+   */
+  void
+  enqueue(const Job& job);
+
+  /**
+   * @brief start the queued inserts the budget has room for
+   * @return the inserts to start, with their window, UNLIMITED when there is no budget
+   */
+  std::vector<Grant>
+  poll(double now);
+
+  /**
+   * @brief account for a segment of @p id stored
+   */
+  void
+  onStored(JobId id, size_t bytes, double now);
+
+  /**
+   * @brief forget @p id, queued or started, and release its window
+   */
+  void
+  finish(JobId id);
+
+  size_t
+  getQueued() const
+  {
+    return m_queued.size();
+  }
+
+  size_t
+  getRunning() const
+  {
+    return m_running.size();
+  }
+
+  size_t
+  getInFlight() const
+  {
+    return m_inFlight;
+  }
+
+  /**
+   * @return smoothed segments stored per second
+   */
+  double
+  getThroughput() const
+  {
+    return m_throughput;
+  }
+
+private:
+  /// small first, then finish tag, then arrival
+  using QueueKey = std::tuple<bool, double, uint64_t>;
+
+  struct Queued
+  {
+    Job job;
+    QueueKey key;
+  };
+
+  struct Running
+  {
+    std::string flow;
+    size_t window;
+    uint64_t remaining;
+  };
+
+  void
+  refill(double now);
+
+  size_t
+  getWindow(const Job& job) const;
+
+  void
+  removeFromFlow(const std::string& flow);
+
+private:
+  Limits m_limits;
+
+  std::map<QueueKey, JobId> m_queue;
+  std::map<JobId, Queued> m_queued;
+  std::map<JobId, Running> m_running;
+  std::map<std::string, double> m_lastFinish;  ///< finish tag of the last insert of each flow
+  std::map<std::string, size_t> m_flowJobs;    ///< inserts queued or running, of each flow
+  double m_virtualTime;
+  uint64_t m_nEnqueued;
+  size_t m_inFlight;
+
+  double m_tokens;  ///< bytes that may still be stored, negative when over the rate
+  double m_lastRefill;
+
+  uint64_t m_nStored;
+  double m_lastSample;
+  double m_throughput;
+};
+
+} // namespace repo
+
+#endif // REPO_FETCH_INGEST_SCHEDULER_HPP
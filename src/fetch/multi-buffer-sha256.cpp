@@ -0,0 +1,405 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "multi-buffer-sha256.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define REPO_SHA256_HAVE_X86_KERNELS
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace repo {
+
+namespace {
+
+const uint32_t K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const uint32_t INITIAL_STATE[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+uint32_t
+loadBigEndian(const uint8_t* p)
+{
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+/**
+ * @brief a message cut into 64-byte blocks, the padded tail kept aside
+ */
+class PaddedMessage
+{
+public:
+  explicit
+  PaddedMessage(const MultiBufferSha256::Message& message)
+    : m_data(message.data)
+    , m_nFullBlocks(message.size / 64)
+  {
+    size_t rest = message.size % 64;
+    m_nBlocks = m_nFullBlocks + (rest + 9 > 64 ? 2 : 1);
+
+    std::memset(m_tail, 0, sizeof(m_tail));
+    if (rest > 0) {
+      std::memcpy(m_tail, message.data + 64 * m_nFullBlocks, rest);
+    }
+    m_tail[rest] = 0x80;
+
+    uint64_t bits = static_cast<uint64_t>(message.size) * 8;
+    uint8_t* end = m_tail + 64 * (m_nBlocks - m_nFullBlocks);
+    for (int i = 1; i <= 8; ++i) {
+      end[-i] = static_cast<uint8_t>(bits >> (8 * (i - 1)));
+    }
+  }
+
+  size_t
+  getBlocks() const
+  {
+    return m_nBlocks;
+  }
+
+  const uint8_t*
+  getBlock(size_t i) const
+  {
+    return i < m_nFullBlocks ? m_data + 64 * i : m_tail + 64 * (i - m_nFullBlocks);
+  }
+
+private:
+  const uint8_t* m_data;
+  size_t m_nFullBlocks;
+  size_t m_nBlocks;
+  uint8_t m_tail[128];
+};
+
+MultiBufferSha256::Digest
+makeDigest(const uint32_t state[8])
+{
+  MultiBufferSha256::Digest digest;
+  for (int i = 0; i < 8; ++i) {
+    digest[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+    digest[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+    digest[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+    digest[4 * i + 3] = static_cast<uint8_t>(state[i]);
+  }
+  return digest;
+}
+
+uint32_t
+rotr(uint32_t x, int n)
+{
+  return (x >> n) | (x << (32 - n));
+}
+
+void
+compressScalar(uint32_t state[8], const uint8_t* block)
+{
+  uint32_t w[64];
+  for (int t = 0; t < 16; ++t) {
+    w[t] = loadBigEndian(block + 4 * t);
+  }
+  for (int t = 16; t < 64; ++t) {
+    uint32_t s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+    uint32_t s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+    w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+  }
+
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int t = 0; t < 64; ++t) {
+    uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[t] + w[t];
+    uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+  state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+MultiBufferSha256::Digest
+hashScalar(const MultiBufferSha256::Message& message)
+{
+  PaddedMessage padded(message);
+  uint32_t state[8];
+  std::memcpy(state, INITIAL_STATE, sizeof(state));
+  for (size_t i = 0; i < padded.getBlocks(); ++i) {
+    compressScalar(state, padded.getBlock(i));
+  }
+  return makeDigest(state);
+}
+
+#ifdef REPO_SHA256_HAVE_X86_KERNELS
+
+__attribute__((target("sha,sse4.1,ssse3"))) MultiBufferSha256::Digest
+hashShaNi(const MultiBufferSha256::Message& message)
+{
+  PaddedMessage padded(message);
+  const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  // the SHA instructions keep the state as ABEF and CDGH
+  __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&INITIAL_STATE[0]));
+  __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&INITIAL_STATE[4]));
+  tmp = _mm_shuffle_epi32(tmp, 0xB1);
+  state1 = _mm_shuffle_epi32(state1, 0x1B);
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+  for (size_t i = 0; i < padded.getBlocks(); ++i) {
+    const uint8_t* block = padded.getBlock(i);
+    __m128i abefSave = state0;
+    __m128i cdghSave = state1;
+    __m128i w[4];
+
+    // four rounds per step; the schedule of step g + 1 is finished during step g
+    for (int g = 0; g < 16; ++g) {
+      if (g < 4) {
+        w[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * g)),
+                                byteSwap);
+      }
+      __m128i msg = _mm_add_epi32(w[g % 4], _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K[4 * g])));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      if (g >= 3 && g < 15) {
+        __m128i& next = w[(g + 1) % 4];
+        next = _mm_add_epi32(next, _mm_alignr_epi8(w[g % 4], w[(g + 3) % 4], 4));
+        next = _mm_sha256msg2_epu32(next, w[g % 4]);
+      }
+      msg = _mm_shuffle_epi32(msg, 0x0E);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+      if (g >= 1 && g < 13) {
+        w[(g + 3) % 4] = _mm_sha256msg1_epu32(w[(g + 3) % 4], w[g % 4]);
+      }
+    }
+
+    state0 = _mm_add_epi32(state0, abefSave);
+    state1 = _mm_add_epi32(state1, cdghSave);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B);
+  state1 = _mm_shuffle_epi32(state1, 0xB1);
+  state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+  state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+  uint32_t state[8];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+  return makeDigest(state);
+}
+
+#define REPO_SHA256_ROTR8(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+/**
+ * @brief hash up to eight messages, one per lane; lanes past their last block keep their state
+ */
+__attribute__((target("avx2"))) void
+hashAvx2(const PaddedMessage* const* messages, size_t n, MultiBufferSha256::Digest* digests)
+{
+  __m256i state[8];
+  for (int i = 0; i < 8; ++i) {
+    state[i] = _mm256_set1_epi32(static_cast<int>(INITIAL_STATE[i]));
+  }
+
+  size_t nBlocks = 0;
+  for (size_t lane = 0; lane < n; ++lane) {
+    nBlocks = std::max(nBlocks, messages[lane]->getBlocks());
+  }
+
+  for (size_t i = 0; i < nBlocks; ++i) {
+    const uint8_t* blocks[8];
+    int32_t active[8];
+    for (size_t lane = 0; lane < 8; ++lane) {
+      bool isActive = lane < n && i < messages[lane]->getBlocks();
+      blocks[lane] = isActive ? messages[lane]->getBlock(i) : messages[0]->getBlock(0);
+      active[lane] = isActive ? -1 : 0;
+    }
+    __m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(active));
+
+    __m256i w[64];
+    for (int t = 0; t < 16; ++t) {
+      w[t] = _mm256_setr_epi32(static_cast<int>(loadBigEndian(blocks[0] + 4 * t)),
+                               static_cast<int>(loadBigEndian(blocks[1] + 4 * t)),
+                               static_cast<int>(loadBigEndian(blocks[2] + 4 * t)),
+                               static_cast<int>(loadBigEndian(blocks[3] + 4 * t)),
+                               static_cast<int>(loadBigEndian(blocks[4] + 4 * t)),
+                               static_cast<int>(loadBigEndian(blocks[5] + 4 * t)),
+                               static_cast<int>(loadBigEndian(blocks[6] + 4 * t)),
+                               static_cast<int>(loadBigEndian(blocks[7] + 4 * t)));
+    }
+    for (int t = 16; t < 64; ++t) {
+      __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(REPO_SHA256_ROTR8(w[t - 15], 7),
+                                                     REPO_SHA256_ROTR8(w[t - 15], 18)),
+                                    _mm256_srli_epi32(w[t - 15], 3));
+      __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(REPO_SHA256_ROTR8(w[t - 2], 17),
+                                                     REPO_SHA256_ROTR8(w[t - 2], 19)),
+                                    _mm256_srli_epi32(w[t - 2], 10));
+      w[t] = _mm256_add_epi32(_mm256_add_epi32(w[t - 16], s0), _mm256_add_epi32(w[t - 7], s1));
+    }
+
+    __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+    __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int t = 0; t < 64; ++t) {
+      __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(REPO_SHA256_ROTR8(e, 6), REPO_SHA256_ROTR8(e, 11)),
+                                        REPO_SHA256_ROTR8(e, 25));
+      __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+      __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, sigma1),
+                                    _mm256_add_epi32(_mm256_add_epi32(ch, w[t]),
+                                                     _mm256_set1_epi32(static_cast<int>(K[t]))));
+      __m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(REPO_SHA256_ROTR8(a, 2), REPO_SHA256_ROTR8(a, 13)),
+                                        REPO_SHA256_ROTR8(a, 22));
+      __m256i maj = _mm256_xor_si256(_mm256_and_si256(a, _mm256_xor_si256(b, c)), _mm256_and_si256(b, c));
+      __m256i t2 = _mm256_add_epi32(sigma0, maj);
+      h = g;
+      g = f;
+      f = e;
+      e = _mm256_add_epi32(d, t1);
+      d = c;
+      c = b;
+      b = a;
+      a = _mm256_add_epi32(t1, t2);
+    }
+
+    __m256i result[8] = {a, b, c, d, e, f, g, h};
+    for (int j = 0; j < 8; ++j) {
+      state[j] = _mm256_blendv_epi8(state[j], _mm256_add_epi32(state[j], result[j]), mask);
+    }
+  }
+
+  uint32_t words[8][8];
+  for (int j = 0; j < 8; ++j) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(words[j]), state[j]);
+  }
+  for (size_t lane = 0; lane < n; ++lane) {
+    uint32_t laneState[8];
+    for (int j = 0; j < 8; ++j) {
+      laneState[j] = words[j][lane];
+    }
+    digests[lane] = makeDigest(laneState);
+  }
+}
+
+#undef REPO_SHA256_ROTR8
+
+#endif // REPO_SHA256_HAVE_X86_KERNELS
+
+} // namespace
+
+MultiBufferSha256::Kernel
+MultiBufferSha256::getBestKernel()
+{
+  static const Kernel kernel = isSupported(Kernel::SHA_NI) ? Kernel::SHA_NI :
+                               isSupported(Kernel::AVX2) ? Kernel::AVX2 : Kernel::SCALAR;
+  return kernel;
+}
+
+bool
+MultiBufferSha256::isSupported(Kernel kernel)
+{
+  switch (kernel) {
+    case Kernel::SCALAR:
+      return true;
+#ifdef REPO_SHA256_HAVE_X86_KERNELS
+    case Kernel::AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+    case Kernel::SHA_NI: {
+      // GCC has no __builtin_cpu_supports("sha") before version 11
+      unsigned int eax, ebx, ecx, edx;
+      __builtin_cpu_init();
+      if (!__builtin_cpu_supports("sse4.1") || __get_cpuid_max(0, nullptr) < 7) {
+        return false;
+      }
+      __cpuid_count(7, 0, eax, ebx, ecx, edx);
+      return (ebx >> 29) & 1;
+    }
+#else
+    case Kernel::AVX2:
+    case Kernel::SHA_NI:
+      return false;
+#endif // REPO_SHA256_HAVE_X86_KERNELS
+  }
+  return false;
+}
+
+std::vector<MultiBufferSha256::Digest>
+MultiBufferSha256::compute(const std::vector<Message>& messages, Kernel kernel)
+{
+  std::vector<Digest> digests(messages.size());
+
+#ifdef REPO_SHA256_HAVE_X86_KERNELS
+  if (kernel == Kernel::SHA_NI) {
+    for (size_t i = 0; i < messages.size(); ++i) {
+      digests[i] = hashShaNi(messages[i]);
+    }
+    return digests;
+  }
+
+  if (kernel == Kernel::AVX2) {
+    // lanes wait for the longest message of their group, so messages of similar length go together
+    std::vector<size_t> order(messages.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&] (size_t a, size_t b) { return messages[a].size < messages[b].size; });
+
+    for (size_t first = 0; first < order.size(); first += 8) {
+      size_t n = std::min<size_t>(8, order.size() - first);
+      std::vector<PaddedMessage> padded;
+      padded.reserve(n);
+      const PaddedMessage* lanes[8];
+      for (size_t lane = 0; lane < n; ++lane) {
+        padded.emplace_back(messages[order[first + lane]]);
+        lanes[lane] = &padded.back();
+      }
+
+      Digest result[8];
+      hashAvx2(lanes, n, result);
+      for (size_t lane = 0; lane < n; ++lane) {
+        digests[order[first + lane]] = result[lane];
+      }
+    }
+    return digests;
+  }
+#endif // REPO_SHA256_HAVE_X86_KERNELS
+
+  for (size_t i = 0; i < messages.size(); ++i) {
+    digests[i] = hashScalar(messages[i]);
+  }
+  return digests;
+}
+
+} // namespace repo
@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_FETCH_MULTI_BUFFER_SHA256_HPP
+#define REPO_FETCH_MULTI_BUFFER_SHA256_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace repo {
+
+/**
+ * @brief SHA-256 of many independent messages at once
+ *
+ * The AVX2 kernel hashes eight messages side by side, one per 32-bit lane, like the
+ * multi-buffer hashing of ISA-L; messages of similar length fill the lanes best. The SHA-NI
+ * kernel hashes one message at a time with the SHA extensions, which beats eight lanes of
+ * AVX2 on the CPUs that have them. The kernel is picked at run time.
+ */
+class MultiBufferSha256
+{
+public:
+  using Digest = std::array<uint8_t, 32>;
+
+  struct Message
+  {
+    const uint8_t* data;
+    size_t size;
+  };
+
+  enum class Kernel {
+    SCALAR,
+    AVX2,
+    SHA_NI
+  };
+
+public:
+  /**
+   * @return the fastest kernel this CPU supports
+   */
+  static Kernel
+  getBestKernel();
+
+  static bool
+  isSupported(Kernel kernel);
+
+  /**
+   * @return the digest of every message, in order
+   * @pre @p kernel is supported
+   */
+  static std::vector<Digest>
+  compute(const std::vector<Message>& messages, Kernel kernel = getBestKernel());
+};
+
+} // namespace repo
+
+#endif // REPO_FETCH_MULTI_BUFFER_SHA256_HPP
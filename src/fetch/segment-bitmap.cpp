@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "segment-bitmap.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include <boost/throw_exception.hpp>
+
+namespace repo {
+
+SegmentBitmap::SegmentBitmap(uint64_t first, uint64_t last)
+  : m_first(first)
+  , m_last(last)
+  , m_count(0)
+{
+  if (last < first) {
+    BOOST_THROW_EXCEPTION(Error("Empty segment range " + std::to_string(first) + "-" + std::to_string(last)));
+  }
+  m_words.assign((last - first) / 64 + 1, 0);
+}
+
+bool
+SegmentBitmap::set(uint64_t segmentNo)
+{
+  if (segmentNo < m_first || segmentNo > m_last) {
+    return false;
+  }
+
+  uint64_t i = segmentNo - m_first;
+  uint64_t bit = uint64_t(1) << (i % 64);
+  if (m_words[i / 64] & bit) {
+    return false;
+  }
+  m_words[i / 64] |= bit;
+  ++m_count;
+  return true;
+}
+
+bool
+SegmentBitmap::has(uint64_t segmentNo) const
+{
+  if (segmentNo < m_first || segmentNo > m_last) {
+    return false;
+  }
+
+  uint64_t i = segmentNo - m_first;
+  return (m_words[i / 64] >> (i % 64)) & 1;
+}
+
+std::vector<SegmentBitmap::Range>
+SegmentBitmap::getRanges(bool value) const
+{
+  std::vector<Range> ranges;
+  auto append = [&ranges] (uint64_t from, uint64_t to) {
+    if (!ranges.empty() && ranges.back().second + 1 == from) {
+      ranges.back().second = to;
+    }
+    else {
+      ranges.emplace_back(from, to);
+    }
+  };
+
+  for (size_t w = 0; w < m_words.size(); ++w) {
+    uint64_t word = value ? m_words[w] : ~m_words[w];
+    uint64_t base = m_first + 64 * w;
+    uint64_t nBits = std::min<uint64_t>(64, m_last - base + 1);
+    if (word == 0) {
+      continue;
+    }
+    if (word == ~uint64_t(0) && nBits == 64) {
+      append(base, base + 63);
+      continue;
+    }
+    for (uint64_t bit = 0; bit < nBits; ++bit) {
+      if ((word >> bit) & 1) {
+        append(base + bit, base + bit);
+      }
+    }
+  }
+  return ranges;
+}
+
+std::vector<SegmentBitmap::Range>
+SegmentBitmap::getMissingRanges(size_t maxRanges) const
+{
+  std::vector<Range> ranges = getRanges(false);
+  maxRanges = std::max<size_t>(maxRanges, 1);
+
+  while (ranges.size() > maxRanges) {
+    size_t closest = 0;
+    for (size_t i = 1; i + 1 < ranges.size(); ++i) {
+      if (ranges[i + 1].first - ranges[i].second < ranges[closest + 1].first - ranges[closest].second) {
+        closest = i;
+      }
+    }
+    ranges[closest].second = ranges[closest + 1].second;
+    ranges.erase(ranges.begin() + closest + 1);
+  }
+  return ranges;
+}
+
+std::string
+SegmentBitmap::toString() const
+{
+  std::ostringstream os;
+  for (const auto& range : getRanges(true)) {
+    if (os.tellp() > 0) {
+      os << ",";
+    }
+    os << range.first << "-" << range.second;
+  }
+  return os.str();
+}
+
+SegmentBitmap
+SegmentBitmap::fromString(uint64_t first, uint64_t last, const std::string& ranges)
+{
+  SegmentBitmap bitmap(first, last);
+
+  std::istringstream is(ranges);
+  std::string item;
+  while (std::getline(is, item, ',')) {
+    uint64_t from = 0;
+    uint64_t to = 0;
+    char dash = 0;
+    std::istringstream range(item);
+    if (!(range >> from >> dash >> to) || dash != '-' || !range.eof() ||
+        from > to || from < first || to > last) {
+      BOOST_THROW_EXCEPTION(Error("Malformed segment range " + item));
+    }
+    for (uint64_t segmentNo = from; segmentNo <= to; ++segmentNo) {
+      bitmap.set(segmentNo);
+    }
+  }
+  return bitmap;
+}
+
+std::vector<SegmentBitmap::Range>
+SegmentBitmap::split(uint64_t first, uint64_t last, size_t maxRanges, uint64_t minSize)
+{
+  if (last < first) {
+    return {};
+  }
+
+  uint64_t nSegments = last - first + 1;
+  uint64_t nRanges = std::min<uint64_t>(maxRanges, nSegments / std::max<uint64_t>(minSize, 1));
+  nRanges = std::max<uint64_t>(nRanges, 1);
+
+  // the first nSegments % nRanges ranges take one segment more
+  std::vector<Range> ranges;
+  uint64_t start = first;
+  for (uint64_t i = 0; i < nRanges; ++i) {
+    uint64_t size = nSegments / nRanges + (i < nSegments % nRanges ? 1 : 0);
+    ranges.emplace_back(start, start + size - 1);
+    start += size;
+  }
+  return ranges;
+}
+
+} // namespace repo
@@ -0,0 +1,137 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_FETCH_SEGMENT_BITMAP_HPP
+#define REPO_FETCH_SEGMENT_BITMAP_HPP
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace repo {
+
+/**
+ * @brief which segments of the range [first, last] have been received
+ *
+ * One bit per segment in memory. It is saved as the list of received ranges, such as
+ * "0-1023,1100-2047", which stays short for segments that mostly arrive in order.
+ */
+class SegmentBitmap
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  using Range = std::pair<uint64_t, uint64_t>;  ///< first and last segment, both included
+
+public:
+  /**
+   * @throw Error @p last is below @p first
+   */
+  SegmentBitmap(uint64_t first, uint64_t last);
+
+  uint64_t
+  getFirst() const
+  {
+    return m_first;
+  }
+
+  uint64_t
+  getLast() const
+  {
+    return m_last;
+  }
+
+  /**
+   * @return false if @p segmentNo was already set or is outside the range
+   */
+  bool
+  set(uint64_t segmentNo);
+
+  bool
+  has(uint64_t segmentNo) const;
+
+  uint64_t
+  count() const
+  {
+    return m_count;
+  }
+
+  bool
+  isComplete() const
+  {
+    return m_count == m_last - m_first + 1;
+  }
+
+  /**
+   * @brief the segments still missing, in order
+   *
+   * When there are more than @p maxRanges gaps, the ones closest to each other are merged,
+   * so that the result also covers some segments already received.
+   */
+  std::vector<Range>
+  getMissingRanges(size_t maxRanges = std::numeric_limits<size_t>::max()) const;
+
+  /**
+   * @return the received ranges, like "0-1023,1100-2047"
+   */
+  std::string
+  toString() const;
+
+  /**
+   * @brief parse what toString() wrote
+   * @throw Error malformed ranges, or ranges outside [first, last]
+   */
+  static SegmentBitmap
+  fromString(uint64_t first, uint64_t last, const std::string& ranges);
+
+  /**
+   * @brief cut [first, last] into contiguous ranges of nearly equal size
+   *
+   * There are at most @p maxRanges ranges, none shorter than @p minSize unless the whole
+   * range is, and never an empty one.
+   */
+  static std::vector<Range>
+  split(uint64_t first, uint64_t last, size_t maxRanges, uint64_t minSize = 1);
+
+private:
+  std::vector<Range>
+  getRanges(bool value) const;
+
+private:
+  uint64_t m_first;
+  uint64_t m_last;
+  uint64_t m_count;
+  std::vector<uint64_t> m_words;
+};
+
+} // namespace repo
+
+#endif // REPO_FETCH_SEGMENT_BITMAP_HPP
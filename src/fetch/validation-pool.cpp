@@ -0,0 +1,129 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "validation-pool.hpp"
+
+namespace repo {
+
+ValidationPool::ValidationPool(boost::asio::io_service& io, size_t nThreads)
+  : m_io(io)
+  , m_state(std::make_shared<State>())
+{
+  for (size_t i = 0; i < nThreads; ++i) {
+    m_threads.emplace_back([this] { work(); });
+  }
+}
+
+ValidationPool::~ValidationPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->isStopped = true;
+  }
+  m_state->hasTasks.notify_all();
+
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+void
+ValidationPool::submit(const Check& check, const Done& done)
+{
+  if (m_threads.empty()) {
+    done(check());
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    uint64_t sequence = m_state->nextSequence++;
+    m_state->pending[sequence] = done;
+    m_state->tasks.emplace_back(sequence, check);
+  }
+  m_state->hasTasks.notify_one();
+}
+
+void
+ValidationPool::work()
+{
+  std::shared_ptr<State> state = m_state;
+  std::weak_ptr<State> weakState = state;
+
+  while (true) {
+    std::pair<uint64_t, Check> task;
+    {
+      std::unique_lock<std::mutex> lock(state->mutex);
+      state->hasTasks.wait(lock, [&] { return state->isStopped || !state->tasks.empty(); });
+      if (state->isStopped) {
+        return;
+      }
+      task = std::move(state->tasks.front());
+      state->tasks.pop_front();
+    }
+
+    bool isValid = false;
+    try {
+      isValid = task.second();
+    }
+    catch (const std::exception&) {
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->results[task.first] = isValid;
+    }
+
+    m_io.post([weakState] {
+      auto state = weakState.lock();
+      if (state != nullptr) {
+        deliver(state);
+      }
+    });
+  }
+}
+
+void
+ValidationPool::deliver(const std::shared_ptr<State>& state)
+{
+  while (true) {
+    Done done;
+    bool isValid;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      auto result = state->results.find(state->nextToDeliver);
+      if (result == state->results.end()) {
+        return;
+      }
+      isValid = result->second;
+      state->results.erase(result);
+
+      auto callback = state->pending.find(state->nextToDeliver);
+      done = std::move(callback->second);
+      state->pending.erase(callback);
+      ++state->nextToDeliver;
+    }
+
+    // a callback may submit more checks, so it runs without the lock
+    done(isValid);
+  }
+}
+
+} // namespace repo
@@ -0,0 +1,103 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_FETCH_VALIDATION_POOL_HPP
+#define REPO_FETCH_VALIDATION_POOL_HPP
+
+#include <boost/asio/io_service.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace repo {
+
+/**
+ * @brief runs packet checks on worker threads and reports back on the io_service thread
+ *
+ * A check must only touch what it captured, since it runs outside the io_service thread.
+ * Results are delivered in the order the checks were submitted, whatever order the workers
+ * finish in, so that packets are processed in the order they arrived.
+ *
+ * Without workers, a check runs and its result is delivered within submit().
+ */
+class ValidationPool
+{
+public:
+  using Check = std::function<bool()>;
+  using Done = std::function<void(bool)>;
+
+public:
+  ValidationPool(boost::asio::io_service& io, size_t nThreads);
+
+  ~ValidationPool();
+
+  size_t
+  getThreads() const
+  {
+    return m_threads.size();
+  }
+
+  /**
+   * @param check runs on a worker thread
+   * @param done gets the result of @p check on the io_service thread
+   */
+  void
+  submit(const Check& check, const Done& done);
+
+private:
+  /**
+   * @brief state shared with the handlers posted to the io_service, which can run after
+   *        the pool is gone
+   */
+  struct State
+  {
+    std::mutex mutex;
+    std::condition_variable hasTasks;
+    bool isStopped = false;
+
+    std::deque<std::pair<uint64_t, Check>> tasks;
+    std::map<uint64_t, Done> pending;   ///< callbacks of submitted checks by sequence number
+    std::map<uint64_t, bool> results;   ///< finished checks not delivered yet
+    uint64_t nextSequence = 0;
+    uint64_t nextToDeliver = 0;
+  };
+
+  void
+  work();
+
+  static void
+  deliver(const std::shared_ptr<State>& state);
+
+private:
+  boost::asio::io_service& m_io;
+  std::shared_ptr<State> m_state;
+  std::vector<std::thread> m_threads;
+};
+
+} // namespace repo
+
+#endif // REPO_FETCH_VALIDATION_POOL_HPP
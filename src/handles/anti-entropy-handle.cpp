@@ -0,0 +1,390 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "anti-entropy-handle.hpp"
+#include "util.hpp"
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <ndn-cxx/util/logger.hpp>
+#include <ndn-cxx/util/segment-fetcher.hpp>
+
+namespace repo {
+
+NDN_LOG_INIT(repo.AntiEntropyHandle);
+
+namespace pt = boost::property_tree;
+
+static const milliseconds DEFAULT_INTEREST_LIFETIME(4000_ms);
+static const size_t MAX_NODES_PER_REQUEST = 64;
+static const size_t MANIFEST_BATCH_SIZE = 64;
+
+AntiEntropyHandle::AntiEntropyHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle,
+                                     Scheduler& scheduler, Validator& validator,
+                                     ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+                                     ndn::time::milliseconds interval)
+  : CommandBaseHandle(face, storageHandle, scheduler, validator)
+  , m_keySpaceHandle(keySpaceHandle)
+  , m_validator(validator)
+  , m_interval(interval)
+  , m_interestLifetime(DEFAULT_INTEREST_LIFETIME)
+  , m_nextPeer(0)
+  , m_nPending(0)
+  , m_nRepaired(0)
+  , m_repoPrefix(Name(clusterNodePrefix).append(clusterPrefix))
+{
+  for (const auto& item : storageHandle.readManifests()) {
+    m_tree.insert(item.second.get<std::string>("key"));
+  }
+
+  m_afterManifestInsertionConnection = storageHandle.afterManifestInsertion.connect(
+    [this] (const std::string& hash) { m_tree.insert(hash); });
+  m_afterManifestDeletionConnection = storageHandle.afterManifestDeletion.connect(
+    [this] (const std::string& hash) { m_tree.erase(hash); });
+
+  ndn::InterestFilter filterNodes = Name(m_repoPrefix).append("merkle-nodes");
+  face.setInterestFilter(filterNodes,
+                           std::bind(&AntiEntropyHandle::handleNodesCommand, this, _1, _2),
+                           std::bind(&AntiEntropyHandle::onRegisterFailed, this, _1, _2));
+
+  ndn::InterestFilter filterBucket = Name(m_repoPrefix).append("merkle-bucket");
+  face.setInterestFilter(filterBucket,
+                           std::bind(&AntiEntropyHandle::handleBucketCommand, this, _1, _2),
+                           std::bind(&AntiEntropyHandle::onRegisterFailed, this, _1, _2));
+
+  if (m_interval > ndn::time::milliseconds::zero()) {
+    m_roundEvent = scheduler.schedule(m_interval, [this] { startRound(); });
+  }
+}
+
+void
+AntiEntropyHandle::handleNodesCommand(const Name& prefix, const Interest& interest)
+{
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  }
+  catch (const RepoCommandParameter::Error&) {
+    negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+
+  pt::ptree nodes;
+  for (const auto& component : repoParameter.getName()) {
+    if (!component.isNumber() || nodes.size() == MAX_NODES_PER_REQUEST) {
+      continue;
+    }
+    size_t index = component.toNumber();
+    if (index < ManifestTree::ROOT || index >= 2 * ManifestTree::N_BUCKETS) {
+      continue;
+    }
+
+    const ManifestTree::Node& node = m_tree.getNode(index);
+    pt::ptree item;
+    item.put("index", index);
+    item.put("digest", ManifestTree::toHex(node.digest));
+    item.put("count", node.count);
+    nodes.push_back(std::make_pair("", item));
+  }
+
+  pt::ptree root;
+  root.add_child("nodes", nodes);
+  std::stringstream os;
+  pt::write_json(os, root, false);
+
+  reply(interest, os.str());
+}
+
+void
+AntiEntropyHandle::handleBucketCommand(const Name& prefix, const Interest& interest)
+{
+  if (replyFromDataset(interest)) {
+    return;
+  }
+
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  }
+  catch (const RepoCommandParameter::Error&) {
+    negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+
+  int bucket = repoParameter.hasStartBlockId() ? repoParameter.getStartBlockId() : -1;
+  if (bucket < 0 || bucket >= static_cast<int>(ManifestTree::N_BUCKETS)) {
+    negativeReply(interest, "StartBlockId must be a bucket", 403);
+    return;
+  }
+
+  pt::ptree manifests;
+  for (const auto& hash : m_tree.getBucket(bucket)) {
+    pt::ptree item;
+    item.put("key", hash);
+    manifests.push_back(std::make_pair("", item));
+  }
+
+  replySegmented(interest, util::segmentJsonArray("manifests", manifests));
+}
+
+void
+AntiEntropyHandle::startRound()
+{
+  m_roundEvent = scheduler.schedule(m_interval, [this] { startRound(); });
+  if (!m_peer.empty()) {
+    return;
+  }
+
+  std::vector<Name> peers;
+  for (const auto& node : m_keySpaceHandle.getNodes()) {
+    if (node != m_repoPrefix && m_keySpaceHandle.isAlive(node)) {
+      peers.push_back(node);
+    }
+  }
+  if (peers.empty()) {
+    return;
+  }
+
+  std::vector<size_t> indices;
+  for (const auto& range : m_keySpaceHandle.getReplicaRanges(m_repoPrefix)) {
+    for (size_t index : ManifestTree::getRangeNodes(range.first, range.second)) {
+      indices.push_back(index);
+    }
+  }
+  if (indices.empty()) {
+    return;
+  }
+
+  m_peer = peers[m_nextPeer++ % peers.size()];
+  m_nRepaired = 0;
+  NDN_LOG_DEBUG("Anti-entropy round with " << m_peer);
+
+  for (size_t i = 0; i < indices.size(); i += MAX_NODES_PER_REQUEST) {
+    requestNodes(std::vector<size_t>(indices.begin() + i,
+                                     indices.begin() + std::min(i + MAX_NODES_PER_REQUEST, indices.size())));
+  }
+}
+
+void
+AntiEntropyHandle::requestNodes(const std::vector<size_t>& indices)
+{
+  Name list;
+  for (size_t index : indices) {
+    list.appendNumber(index);
+  }
+
+  RepoCommandParameter parameters;
+  parameters.setName(list);
+
+  Interest interest = util::generateCommandInterest(m_peer, "merkle-nodes", parameters, m_interestLifetime);
+  interest.setMustBeFresh(true);
+
+  ++m_nPending;
+  face.expressInterest(interest,
+                       [this] (const Interest&, const Data& data) {
+                         onNodesResponse(data);
+                         onRequestDone();
+                       },
+                       [this] (const Interest&, const ndn::lp::Nack&) { onRequestDone(); },
+                       [this] (const Interest&) {
+                         NDN_LOG_DEBUG("merkle-nodes timeout on " << m_peer);
+                         onRequestDone();
+                       });
+}
+
+void
+AntiEntropyHandle::onNodesResponse(const Data& data)
+{
+  auto content = data.getContent();
+  pt::ptree root;
+  std::istringstream json(std::string(content.value_begin(), content.value_end()));
+  try {
+    pt::read_json(json, root);
+  }
+  catch (const pt::ptree_error& e) {
+    NDN_LOG_ERROR("Malformed merkle-nodes reply from " << m_peer << ": " << e.what());
+    return;
+  }
+
+  std::vector<size_t> children;
+  auto nodes = root.get_child_optional("nodes");
+  if (nodes) {
+    for (const auto& item : *nodes) {
+      size_t index = item.second.get<size_t>("index", 0);
+      size_t count = item.second.get<size_t>("count", 0);
+      if (index < ManifestTree::ROOT || index >= 2 * ManifestTree::N_BUCKETS || count == 0 ||
+          item.second.get<std::string>("digest", "") == ManifestTree::toHex(m_tree.getNode(index).digest)) {
+        continue;
+      }
+
+      if (ManifestTree::isLeaf(index)) {
+        requestBucket(ManifestTree::getLeafBucket(index));
+      }
+      else {
+        children.push_back(2 * index);
+        children.push_back(2 * index + 1);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < children.size(); i += MAX_NODES_PER_REQUEST) {
+    requestNodes(std::vector<size_t>(children.begin() + i,
+                                     children.begin() + std::min(i + MAX_NODES_PER_REQUEST, children.size())));
+  }
+}
+
+void
+AntiEntropyHandle::requestBucket(int bucket)
+{
+  RepoCommandParameter parameters;
+  parameters.setStartBlockId(bucket);
+
+  Interest interest = util::generateCommandInterest(m_peer, "merkle-bucket", parameters, m_interestLifetime);
+
+  ndn::util::SegmentFetcher::Options options;
+  options.interestLifetime = m_interestLifetime;
+
+  auto missing = std::make_shared<std::vector<std::string>>();
+
+  ++m_nPending;
+  auto fetcher = ndn::util::SegmentFetcher::start(face, interest, m_validator, options);
+  fetcher->afterSegmentValidated.connect([this, missing] (const Data& data) {
+    onBucketSegment(data, missing);
+  });
+  fetcher->onComplete.connect([this, missing] (const ndn::ConstBufferPtr&) {
+    for (size_t i = 0; i < missing->size(); i += MANIFEST_BATCH_SIZE) {
+      requestManifests(std::vector<std::string>(missing->begin() + i,
+                                                missing->begin() + std::min(i + MANIFEST_BATCH_SIZE, missing->size())));
+    }
+    onRequestDone();
+  });
+  fetcher->onError.connect([this, bucket] (uint32_t, const std::string& reason) {
+    NDN_LOG_DEBUG("merkle-bucket " << bucket << " failed: " << reason);
+    onRequestDone();
+  });
+}
+
+void
+AntiEntropyHandle::onBucketSegment(const Data& data, std::shared_ptr<std::vector<std::string>> missing)
+{
+  auto content = data.getContent();
+  pt::ptree root;
+  std::istringstream json(std::string(content.value_begin(), content.value_end()));
+  try {
+    pt::read_json(json, root);
+  }
+  catch (const pt::ptree_error& e) {
+    NDN_LOG_ERROR("Malformed merkle-bucket segment " << data.getName() << ": " << e.what());
+    return;
+  }
+
+  auto manifests = root.get_child_optional("manifests");
+  if (manifests) {
+    for (const auto& item : *manifests) {
+      auto hash = item.second.get<std::string>("key", "");
+      int bucket = util::getHashBucket(hash);
+      // a manifest deleted here may linger on a peer whose copy could not be dropped
+      if (bucket >= 0 && m_tree.getBucket(bucket).count(hash) == 0 &&
+          !storageHandle.isManifestDeleted(hash)) {
+        missing->push_back(hash);
+      }
+    }
+  }
+}
+
+void
+AntiEntropyHandle::requestManifests(const std::vector<std::string>& hashes)
+{
+  Name list;
+  for (const auto& hash : hashes) {
+    list.append(hash);
+  }
+
+  RepoCommandParameter parameters;
+  parameters.setName(list);
+
+  Interest interest = util::generateCommandInterest(m_peer, "find-batch", parameters, m_interestLifetime);
+
+  ndn::util::SegmentFetcher::Options options;
+  options.interestLifetime = m_interestLifetime;
+
+  ++m_nPending;
+  auto fetcher = ndn::util::SegmentFetcher::start(face, interest, m_validator, options);
+  fetcher->afterSegmentValidated.connect([this] (const Data& data) {
+    onManifestsSegment(data);
+  });
+  fetcher->onComplete.connect([this] (const ndn::ConstBufferPtr&) {
+    onRequestDone();
+  });
+  fetcher->onError.connect([this] (uint32_t, const std::string& reason) {
+    NDN_LOG_DEBUG("find-batch for repair failed: " << reason);
+    onRequestDone();
+  });
+}
+
+void
+AntiEntropyHandle::onManifestsSegment(const Data& data)
+{
+  auto content = data.getContent();
+  if (content.value_size() == 0) {
+    return;
+  }
+
+  pt::ptree root;
+  std::istringstream json(std::string(content.value_begin(), content.value_end()));
+  try {
+    pt::read_json(json, root);
+  }
+  catch (const pt::ptree_error& e) {
+    NDN_LOG_ERROR("Malformed find-batch segment " << data.getName() << ": " << e.what());
+    return;
+  }
+
+  auto manifests = root.get_child_optional("manifests");
+  if (manifests) {
+    for (const auto& item : *manifests) {
+      auto manifest = Manifest::fromPtree(item.second);
+      if (storageHandle.insertManifest(manifest)) {
+        ++m_nRepaired;
+      }
+    }
+  }
+}
+
+void
+AntiEntropyHandle::onRequestDone()
+{
+  if (m_nPending > 0 && --m_nPending > 0) {
+    return;
+  }
+
+  if (m_nRepaired > 0) {
+    NDN_LOG_INFO("Repaired " << m_nRepaired << " manifests from " << m_peer);
+  }
+  m_peer.clear();
+}
+
+void
+AntiEntropyHandle::onRegisterFailed(const Name& prefix, const std::string& reason)
+{
+  NDN_LOG_ERROR("ERROR: Failed to register prefix in local hub's daemon");
+  face.shutdown();
+}
+
+} // namespace repo
@@ -0,0 +1,137 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_HANDLES_ANTI_ENTROPY_HANDLE_HPP
+#define REPO_HANDLES_ANTI_ENTROPY_HANDLE_HPP
+
+#include "command-base-handle.hpp"
+#include "keyspace-handle.hpp"
+#include "../manifest/manifest-tree.hpp"
+
+#include <ndn-cxx/util/signal.hpp>
+
+namespace repo {
+
+/**
+ * @brief AntiEntropyHandle repairs the manifests a node misses compared to its peers.
+ *
+ * A ManifestTree over the local manifests is kept up to date from the storage signals.
+ * Every interval, the node picks the next reachable peer and compares, for each keyspace
+ * range it holds as owner or replica, the subtrees covering the range with `merkle-nodes`.
+ * It only descends into subtrees whose digests differ and where the peer has manifests,
+ * lists the differing buckets with `merkle-bucket`, and pulls the manifests it lacks with
+ * `find-batch`. A repair therefore costs in proportion to the divergence, not to the number
+ * of manifests.
+ *
+ * Repair is pull only: a node that lost manifests, or that should have received them in a
+ * migration that timed out, gets them back on its own rounds.
+ */
+class AntiEntropyHandle : public CommandBaseHandle
+{
+public:
+  class Error : public CommandBaseHandle::Error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : CommandBaseHandle::Error(what)
+    {
+    }
+  };
+
+public:
+  /**
+   * @param interval time between two rounds, zero to only answer peers
+   */
+  AntiEntropyHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle,
+                    Scheduler& scheduler, Validator& validator,
+                    ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+                    ndn::time::milliseconds interval);
+
+  const ManifestTree&
+  getTree() const
+  {
+    return m_tree;
+  }
+
+private:
+  /**
+   * @brief reply with the digest and count of the tree nodes listed in Name
+   */
+  void
+  handleNodesCommand(const Name& prefix, const Interest& interest);
+
+  /**
+   * @brief reply with the hashes of bucket StartBlockId as a segmented dataset
+   */
+  void
+  handleBucketCommand(const Name& prefix, const Interest& interest);
+
+  void
+  startRound();
+
+  void
+  requestNodes(const std::vector<size_t>& indices);
+
+  void
+  onNodesResponse(const Data& data);
+
+  void
+  requestBucket(int bucket);
+
+  void
+  onBucketSegment(const Data& data, std::shared_ptr<std::vector<std::string>> missing);
+
+  void
+  requestManifests(const std::vector<std::string>& hashes);
+
+  void
+  onManifestsSegment(const Data& data);
+
+  /**
+   * @brief account for a finished request and end the round after the last one
+   */
+  void
+  onRequestDone();
+
+  void
+  onRegisterFailed(const Name& prefix, const std::string& reason);
+
+private:
+  KeySpaceHandle& m_keySpaceHandle;
+  Validator& m_validator;
+  ManifestTree m_tree;
+  ndn::util::signal::ScopedConnection m_afterManifestInsertionConnection;
+  ndn::util::signal::ScopedConnection m_afterManifestDeletionConnection;
+
+  ndn::time::milliseconds m_interval;
+  ndn::time::milliseconds m_interestLifetime;
+  ndn::scheduler::ScopedEventId m_roundEvent;
+
+  size_t m_nextPeer;
+  ndn::Name m_peer;         ///< peer of the current round, empty between rounds
+  size_t m_nPending;        ///< requests of the round not finished yet
+  size_t m_nRepaired;
+
+  ndn::Name m_repoPrefix;
+};
+
+} // namespace repo
+
+#endif // REPO_HANDLES_ANTI_ENTROPY_HANDLE_HPP
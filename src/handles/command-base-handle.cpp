@@ -23,6 +23,8 @@
 
 namespace repo {
 
+static const milliseconds DATASET_LIFETIME(10_s);
+
 /** \brief an Interest tag to indicate command signer
  */
 using SignerTag = ndn::SimpleTag<ndn::Name, 20>;
@@ -71,6 +73,65 @@ CommandBaseHandle::makeAuthorization()
   };
 }
 
+void
+CommandBaseHandle::replySegmented(const Interest& commandInterest,
+                                  const std::vector<std::string>& segments)
+{
+  Name datasetName = Name(commandInterest.getName()).appendVersion();
+  auto& dataset = m_datasets[datasetName];
+
+  uint64_t nSegments = std::max<uint64_t>(segments.size(), 1);
+  auto finalBlockId = name::Component::fromSegment(nSegments - 1);
+
+  HCKeyChain hcKeyChain;
+  for (uint64_t segmentNo = 0; segmentNo < nSegments; ++segmentNo) {
+    auto data = std::make_shared<Data>(Name(datasetName).appendSegment(segmentNo));
+    if (segmentNo < segments.size()) {
+      const std::string& content = segments[segmentNo];
+      data->setContent(reinterpret_cast<const uint8_t*>(content.data()), content.size());
+    }
+    data->setFinalBlock(finalBlockId);
+    data->setFreshnessPeriod(3_s);
+    hcKeyChain.ndn::KeyChain::sign(*data, ndn::signingWithSha256());
+    dataset.segments.push_back(data);
+  }
+
+  face.put(*dataset.segments.front());
+
+  scheduleDatasetExpiry(datasetName, dataset);
+}
+
+bool
+CommandBaseHandle::replyFromDataset(const Interest& interest)
+{
+  const Name& name = interest.getName();
+  if (name.size() < 2 || !name.get(-1).isSegment()) {
+    return false;
+  }
+
+  auto it = m_datasets.find(name.getPrefix(-1));
+  if (it == m_datasets.end()) {
+    return false;
+  }
+
+  uint64_t segmentNo = name.get(-1).toSegment();
+  if (segmentNo >= it->second.segments.size()) {
+    return false;
+  }
+
+  face.put(*it->second.segments[segmentNo]);
+  scheduleDatasetExpiry(it->first, it->second);
+  return true;
+}
+
+void
+CommandBaseHandle::scheduleDatasetExpiry(const Name& datasetName, Dataset& dataset)
+{
+  dataset.expiry = scheduler.schedule(DATASET_LIFETIME, [this, datasetName] {
+    m_datasets.erase(datasetName);
+  });
+}
+
 ndn::Data
 CommandBaseHandle::sign(const Name& name, const Data& data)
 {
@@ -85,6 +85,24 @@ protected:
   void
   negativeReply(const Interest& commandInterest, const std::string& reason, int statusCode);
 
+  /**
+   * @brief reply with a versioned, segmented dataset
+   *
+   * Segments are named <command Interest name>/<version>/<segment> and kept until the dataset
+   * has not been accessed for a while, so that a SegmentFetcher started with the command
+   * Interest can retrieve the remaining ones. Segment 0 is sent right away as the reply to
+   * @p commandInterest.
+   */
+  void
+  replySegmented(const Interest& commandInterest, const std::vector<std::string>& segments);
+
+  /**
+   * @brief answer @p interest from a dataset published by replySegmented()
+   * @return whether a segment was sent
+   */
+  bool
+  replyFromDataset(const Interest& interest);
+
   ndn::Data
   sign(const Name& name, const Data& data);
 
@@ -93,8 +111,19 @@ protected:
   RepoStorage& storageHandle;
   Scheduler& scheduler;
 
+private:
+  struct Dataset
+  {
+    std::vector<std::shared_ptr<Data>> segments;
+    ndn::scheduler::ScopedEventId expiry;
+  };
+
+  void
+  scheduleDatasetExpiry(const Name& datasetName, Dataset& dataset);
+
 private:
   Validator& m_validator;
+  std::map<Name, Dataset> m_datasets;
 };
 
 inline void
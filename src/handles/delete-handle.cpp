@@ -19,23 +19,37 @@
 
 #include "delete-handle.hpp"
 #include "../util.hpp"
+#include "../manifest/content-record.hpp"
 
 #include <ndn-cxx/util/logger.hpp>
 #include <ndn-cxx/util/random.hpp>
 
+#include <algorithm>
+
 namespace repo {
 
 NDN_LOG_INIT(repo.DeleteHandle);
 
 static const milliseconds DEFAULT_INTEREST_LIFETIME(4000);
+static const size_t MAX_PARALLEL_DELETES = 8;  // delete-data commands in flight per file
+static const int DELETE_DATA_RETRY = 3;
+static const milliseconds RECLAIM_INTERVAL(100);
+static const uint64_t MAX_RECLAIM_BATCH = 1024;  // segments erased at once when the rate is unlimited
+static const milliseconds REPLICA_RETRY_DELAY(1000);
+static const milliseconds MAX_REPLICA_RETRY_DELAY(60000);
 
 DeleteHandle::DeleteHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle,
                            ndn::mgmt::Dispatcher& dispatcher, Scheduler& scheduler,
-                           Validator& validator, ndn::Name const& clusterNodePrefix, std::string clusterPrefix)
+                           Validator& validator, ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+                           uint64_t reclaimRate)
   : CommandBaseHandle(face, storageHandle, scheduler, validator)
   , m_interestLifetime(DEFAULT_INTEREST_LIFETIME)
   , m_keySpaceHandle(keySpaceHandle)
   , m_repoPrefix(Name(clusterNodePrefix).append(clusterPrefix))
+  , m_reclaimBatch(reclaimRate > 0 ? std::max<uint64_t>(1, reclaimRate * RECLAIM_INTERVAL.count() / 1000)
+                                   : MAX_RECLAIM_BATCH)
+  , m_reclaimInterval(reclaimRate > 0 ? RECLAIM_INTERVAL : milliseconds::zero())
+  , m_isReclaiming(false)
 {
   ndn::InterestFilter filterDeleteManifest = Name(m_repoPrefix).append("delete-manifest");
   NDN_LOG_DEBUG(m_repoPrefix << " Listening " << filterDeleteManifest);
@@ -77,6 +91,10 @@ DeleteHandle::DeleteHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStora
   //   makeAuthorization(),
   //   std::bind(&DeleteHandle::validateParameters<DeleteDataCommand>, this, _1),
   //   std::bind(&DeleteHandle::handleDeleteDataCommand, this, _1, _2, _3, _4));
+
+  // resume the reclamation of deletes made before a restart
+  scheduleReclaim();
+  resumeManifestReplicaDeletes();
 }
 
 void
@@ -94,6 +112,7 @@ DeleteHandle::handleDeleteCommand(const Name& prefix, const Interest& interest,
   ProcessId processId = repoParameter.getProcessId();
   ProcessInfo& process = m_processes[processId];
   process.interest = interest;
+  process.hash = hash;
 
   RepoCommandParameter parameters;
   parameters.setName(hash);
@@ -129,6 +148,95 @@ DeleteHandle::onDeleteManifestCommandResponse(const Interest& interest, const Da
   m_processes.erase(processId);
 }
 
+void
+DeleteHandle::deleteManifestReplicas(const std::string& hash)
+{
+  // this node already dropped its manifest along with the data
+  std::vector<Name> replicas;
+  for (const auto& storage : m_keySpaceHandle.getManifestStorages(hash)) {
+    if (storage != m_repoPrefix) {
+      replicas.push_back(storage);
+    }
+  }
+  if (replicas.empty()) {
+    storageHandle.releaseManifestTombstone(hash);
+    return;
+  }
+
+  storageHandle.holdManifestTombstone(hash);
+  m_replicaDeletes[hash] += replicas.size();
+  for (const auto& storage : replicas) {
+    deleteManifestReplica(hash, storage, 0);
+  }
+}
+
+void
+DeleteHandle::deleteManifestReplica(const std::string& hash, const Name& storage, int nAttempts)
+{
+  // the manifest was inserted again since, its copies are to stay
+  if (!storageHandle.isManifestDeleted(hash)) {
+    onManifestReplicaDeleted(hash);
+    return;
+  }
+
+  RepoCommandParameter parameters;
+  parameters.setName(hash);
+  Interest deleteManifestInterest = util::generateCommandInterest(
+    storage, "only-delete-manifest", parameters, m_interestLifetime);
+
+  // any answer will do, a storage without the manifest answers that it is not found
+  face.expressInterest(
+    deleteManifestInterest,
+    std::bind(&DeleteHandle::onManifestReplicaDeleted, this, hash),
+    std::bind(&DeleteHandle::onDeleteManifestReplicaFailure, this, hash, storage, nAttempts), // Nack
+    std::bind(&DeleteHandle::onDeleteManifestReplicaFailure, this, hash, storage, nAttempts));
+}
+
+void
+DeleteHandle::onDeleteManifestReplicaFailure(const std::string& hash, const Name& storage, int nAttempts)
+{
+  auto delay = std::min(REPLICA_RETRY_DELAY * (1 << std::min(nAttempts, 6)), MAX_REPLICA_RETRY_DELAY);
+  NDN_LOG_DEBUG("Delete manifest replica " << hash << " on " << storage << " failed, retry in " << delay.count() << " ms");
+
+  scheduler.schedule(delay, [this, hash, storage, nAttempts] {
+    deleteManifestReplica(hash, storage, nAttempts + 1);
+  });
+}
+
+void
+DeleteHandle::onManifestReplicaDeleted(const std::string& hash)
+{
+  auto it = m_replicaDeletes.find(hash);
+  if (it == m_replicaDeletes.end() || --it->second > 0) {
+    return;
+  }
+
+  m_replicaDeletes.erase(it);
+  storageHandle.releaseManifestTombstone(hash);
+}
+
+void
+DeleteHandle::resumeManifestReplicaDeletes()
+{
+  std::vector<std::string> hashes(storageHandle.getHeldManifestTombstones().begin(),
+                                  storageHandle.getHeldManifestTombstones().end());
+  if (hashes.empty()) {
+    return;
+  }
+
+  // the storages are only known once the keyspace is
+  if (m_keySpaceHandle.getManifestStorages(hashes.front()).empty()) {
+    scheduler.schedule(REPLICA_RETRY_DELAY, [this] { resumeManifestReplicaDeletes(); });
+    return;
+  }
+
+  for (const auto& hash : hashes) {
+    if (m_replicaDeletes.count(hash) == 0) {
+      deleteManifestReplicas(hash);
+    }
+  }
+}
+
 void
 DeleteHandle::onTimeout(const Interest& interest, const ProcessId processId)
 {
@@ -167,10 +275,6 @@ DeleteHandle::handleDeleteManifestCommand(const Name& prefix, const Interest& in
   hash = hash.substr(1, hash.length() - 1);
 
   NDN_LOG_DEBUG("Got delete manifest " << hash);
-  ProcessId processId = ndn::random::generateWord64();
-  ProcessInfo& process = m_processes[processId];
-
-  process.interest = interest;
 
   auto manifest = storageHandle.readManifest(hash);
   if (manifest == nullptr) {
@@ -179,30 +283,120 @@ DeleteHandle::handleDeleteManifestCommand(const Name& prefix, const Interest& in
     return;
   }
 
-  process.repos = manifest->getRepos();
+  ProcessId processId = ndn::random::generateWord64();
+  ProcessInfo& process = m_processes[processId];
+  process.interest = interest;
+  process.parameter = repoParameter;
+  auto repos = manifest->getRepos();
+  process.repos.assign(repos.begin(), repos.end());
   process.name = manifest->getName();
   process.hash = hash;
+  process.manifest = manifest;
+
+  if (ContentRecord::isDigest(manifest->getDigest())) {
+    releaseContent(processId);
+    return;
+  }
 
-  deleteData(repoParameter, processId);
+  if (process.repos.empty()) {
+    finishDelete(processId);
+    return;
+  }
+
+  sendDeleteData(processId);
 }
 
 void
-DeleteHandle::deleteData(const RepoCommandParameter repoParameter, ProcessId processId)
+DeleteHandle::releaseContent(ProcessId processId)
 {
   ProcessInfo& process = m_processes[processId];
+  const std::string& digest = process.manifest->getDigest();
+  Name contentStorage = m_keySpaceHandle.getContentStorage(digest);
+  if (contentStorage.empty()) {
+    onReleaseContentFailure(processId);
+    return;
+  }
+
+  RepoCommandParameter parameters;
+  parameters.setName(Name().append(digest).append(process.hash));
+  Interest releaseInterest = util::generateCommandInterest(
+    contentStorage, "content-release", parameters, m_interestLifetime);
 
-  Manifest::Repo repo = process.repos.front();
-  process.repos.pop_front();
+  face.expressInterest(
+    releaseInterest,
+    std::bind(&DeleteHandle::onReleaseContentResponse, this, _1, _2, processId),
+    std::bind(&DeleteHandle::onReleaseContentFailure, this, processId), // Nack
+    std::bind(&DeleteHandle::onReleaseContentFailure, this, processId));
+}
 
-  auto newProcessId = ndn::random::generateWord64();
+void
+DeleteHandle::onReleaseContentResponse(const Interest& interest, const Data& data, ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  RepoCommandResponse response(data.getContent().blockFromValue());
+  if (response.getCode() == 200 && response.getDeleteNum() > 0) {
+    // other keys still refer to the segments, only the manifest goes
+    NDN_LOG_DEBUG("Segments of " << process.hash << " still shared by " << response.getDeleteNum() << " keys");
+    process.repos.clear();
+  }
+
+  if (process.repos.empty()) {
+    finishDelete(processId);
+    return;
+  }
+
+  sendDeleteData(processId);
+}
+
+void
+DeleteHandle::onReleaseContentFailure(ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  // without the reference count the segments may be shared, keep them and the manifest
+  NDN_LOG_DEBUG("Cannot release the content of " << it->second.hash);
+  it->second.hasFailed = true;
+  finishDelete(processId);
+}
+
+void
+DeleteHandle::sendDeleteData(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  while (process.nInFlight < MAX_PARALLEL_DELETES && process.nextRepo < process.repos.size()) {
+    ++process.nInFlight;
+    deleteData(processId, process.nextRepo++);
+  }
+}
+
+void
+DeleteHandle::deleteData(ProcessId processId, size_t index)
+{
+  ProcessInfo& process = m_processes[processId];
+  const Manifest::Repo& repo = process.repos[index];
 
   RepoCommandParameter parameters;
 
   auto name = ndn::Name(process.name);
+  if (process.manifest != nullptr && process.manifest->isErasureCoded()) {
+    size_t k = process.manifest->getDataFragments();
+    if (index < k)
+      parameters.setStride(k);
+    else
+      name = process.manifest->getParityName(index - k);
+  }
   parameters.setName(name);
   parameters.setStartBlockId(repo.start);
   parameters.setEndBlockId(repo.end);
-  parameters.setProcessId(newProcessId);
+  parameters.setProcessId(ndn::random::generateWord64());
 
   Interest deleteDataInterest = util::generateCommandInterest(
     ndn::Name(repo.name), "delete-data", parameters, m_interestLifetime);
@@ -211,35 +405,84 @@ DeleteHandle::deleteData(const RepoCommandParameter repoParameter, ProcessId pro
 
   face.expressInterest(
     deleteDataInterest,
-    std::bind(&DeleteHandle::onDeleteDataCommandResponse, this, _1, _2, repoParameter, processId),
-    std::bind(&DeleteHandle::onTimeout, this, _1, processId),
-    std::bind(&DeleteHandle::onTimeout, this, _1, processId));
+    std::bind(&DeleteHandle::onDeleteDataCommandResponse, this, _1, _2, processId, index),
+    std::bind(&DeleteHandle::onDeleteDataCommandFailure, this, processId, index),
+    std::bind(&DeleteHandle::onDeleteDataCommandFailure, this, processId, index));
 }
 
 void
 DeleteHandle::onDeleteDataCommandResponse(const Interest& interest, const Data& data,
-                                          const RepoCommandParameter& parameters,
-                                          const ProcessId processId)
+                                          ProcessId processId, size_t index)
 {
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
   RepoCommandResponse response(data.getContent().blockFromValue());
-  NDN_LOG_DEBUG("Got delete data response " << response.getCode());
+  NDN_LOG_DEBUG("Got delete data response " << response.getCode() << " from "
+                << it->second.repos[index].name);
 
-  ProcessInfo& process = m_processes[processId];
+  if (response.getCode() >= 400) {
+    onDeleteDataCommandFailure(processId, index);
+    return;
+  }
+
+  if (response.hasDeleteNum()) {
+    it->second.nDeletedData += response.getDeleteNum();
+  }
+  onRepoDone(processId);
+}
+
+void
+DeleteHandle::onDeleteDataCommandFailure(ProcessId processId, size_t index)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  if (process.retryCounts[index]++ < DELETE_DATA_RETRY) {
+    NDN_LOG_DEBUG("Retry delete data on " << process.repos[index].name);
+    deleteData(processId, index);
+    return;
+  }
 
-  if (response.getCode() > 400) {
-    reply(interest, negativeReply(process.interest, 405, "Delete data failed"));
+  NDN_LOG_ERROR("Give up delete data on " << process.repos[index].name << " after "
+                << DELETE_DATA_RETRY << " retries");
+  process.hasFailed = true;
+  onRepoDone(processId);
+}
+
+void
+DeleteHandle::onRepoDone(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  --process.nInFlight;
+  if (++process.nDoneRepos < process.repos.size()) {
+    sendDeleteData(processId);
     return;
   }
 
-  auto repos = process.repos;
+  finishDelete(processId);
+}
+
+void
+DeleteHandle::finishDelete(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
 
-  if (repos.size() == 0) {
-    reply(process.interest, positiveReply(process.interest, parameters, 200, 1));
+  // the manifest stays while any segment may be left, so that the delete can be repeated
+  if (process.hasFailed) {
+    reply(process.interest, negativeReply(process.interest, 405, "Delete data failed"));
+  }
+  else {
+    reply(process.interest, positiveReply(process.interest, process.parameter, 200, process.nDeletedData));
     storageHandle.deleteManifest(process.hash);
-    m_processes.erase(processId);
-  } else {
-    deleteData(parameters, processId);
+    deleteManifestReplicas(process.hash);
   }
+  m_processes.erase(processId);
 }
 
 void
@@ -255,26 +498,38 @@ DeleteHandle::handleDeleteDataCommand(const Name& prefix, const Interest& intere
 
   SegmentNo start = repoParameter.getStartBlockId();
   SegmentNo end = repoParameter.getEndBlockId();
+  SegmentNo stride = repoParameter.getStride();
 
-  if (start > end ) {
+  if (start > end || stride == 0) {
     reply(interest, negativeReply(interest, 403, "Start block id > End block id"));
     return;
   }
 
   NDN_LOG_DEBUG("Got delete data " << repoParameter.getName() << " " << start << "~" << end);
 
-  const Name dataName = repoParameter.getName();
-  uint64_t nDeletedData = 0;
-  for (SegmentNo i = start; i <= end; ++i) {
-    Name name = dataName;
-    name.appendSegment(i);
-    NDN_LOG_DEBUG("Delete data " << name);
-    if (storageHandle.deleteData(name)) {
-      nDeletedData += 1;
-    }
-  }
+  uint64_t nDeletedData = storageHandle.deleteDataRange(repoParameter.getName(), start, end, stride);
 
   reply(interest, positiveReply(interest, repoParameter, 200, nDeletedData));
+  scheduleReclaim();
+}
+
+void
+DeleteHandle::scheduleReclaim()
+{
+  if (m_isReclaiming || !storageHandle.hasDataToReclaim()) {
+    return;
+  }
+
+  m_isReclaiming = true;
+  m_reclaimEvent = scheduler.schedule(m_reclaimInterval, [this] { reclaim(); });
+}
+
+void
+DeleteHandle::reclaim()
+{
+  m_isReclaiming = false;
+  storageHandle.reclaimData(m_reclaimBatch);
+  scheduleReclaim();
 }
 
 RepoCommandResponse
@@ -21,12 +21,24 @@
 #define REPO_HANDLES_DELETE_HANDLE_HPP
 
 #include "command-base-handle.hpp"
+#include "process-table.hpp"
 #include "keyspace-handle.hpp"
 
 #include <ndn-cxx/mgmt/dispatcher.hpp>
 
 namespace repo {
 
+/**
+ * @brief DeleteHandle deletes files: their manifest and the segments on every repo.
+ *
+ * delete-data only marks the segments deleted in the storage and replies at once. Their
+ * space is reclaimed in the background, a batch every RECLAIM_INTERVAL, so that a large
+ * delete does not hold up reads and inserts.
+ *
+ * Files inserted with a content digest may share their segments with other files. Their
+ * reference is released on the content index first, and the segments are only deleted by
+ * the last file referring to them.
+ */
 class DeleteHandle : public CommandBaseHandle
 {
 
@@ -45,15 +57,24 @@ private:
   struct ProcessInfo
   {
     Interest interest;
-    std::list<Manifest::Repo> repos;
+    RepoCommandParameter parameter;  ///< of the delete-manifest command
+    std::vector<Manifest::Repo> repos;
     ndn::Name name;
     std::string hash;
+    std::shared_ptr<Manifest> manifest;
+    size_t nextRepo = 0;    ///< index in the manifest of the next repo to ask
+    size_t nInFlight = 0;
+    size_t nDoneRepos = 0;
+    std::map<size_t, int> retryCounts;
+    uint64_t nDeletedData = 0;
+    bool hasFailed = false;  ///< a repo still failed after its retries
   };
 
 public:
   DeleteHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle,
                ndn::mgmt::Dispatcher& dispatcher, Scheduler& scheduler, Validator& validator,
-               ndn::Name const& clusterNodePrefix, std::string clusterPrefix);
+               ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+               uint64_t reclaimRate = 0);
 
 private:
   void
@@ -67,6 +88,36 @@ private:
                                                 const RepoCommandParameter& repoParameter,
                                                 const ProcessId processid);
 
+  /**
+   * @brief drop the manifest copies kept by the other storages of @p hash
+   *
+   * Called by the node that deleted the data, which is the owner unless the coordinator
+   * failed over or a client with a cached keyspace sent delete-manifest directly. Each
+   * storage is asked until it answers, and the tombstone of the manifest is held until all
+   * have, so that anti-entropy does not copy the manifest back from a storage that missed
+   * the delete.
+   */
+  void
+  deleteManifestReplicas(const std::string& hash);
+
+  void
+  deleteManifestReplica(const std::string& hash, const Name& storage, int nAttempts);
+
+  /**
+   * @brief ask @p storage again after a delay that doubles with every attempt
+   */
+  void
+  onDeleteManifestReplicaFailure(const std::string& hash, const Name& storage, int nAttempts);
+
+  void
+  onManifestReplicaDeleted(const std::string& hash);
+
+  /**
+   * @brief resume the replica deletes that were outstanding before a restart
+   */
+  void
+  resumeManifestReplicaDeletes();
+
   void
   onTimeout(const Interest& interest, const ProcessId processId);
 
@@ -76,17 +127,63 @@ private:
   void
   handleOnlyDeleteManifestCommand(const Name& prefix, const Interest& interest);
 
+  /**
+   * @brief drop the reference of the file to its content, so that shared segments are
+   *        only deleted with the last file
+   */
+  void
+  releaseContent(ProcessId processId);
+
+  void
+  onReleaseContentResponse(const Interest& interest, const Data& data, ProcessId processId);
+
   void
-  deleteData(const RepoCommandParameter repoParameter, ProcessId processId);
+  onReleaseContentFailure(ProcessId processId);
+
+  /**
+   * @brief send delete-data to the next repos of the manifest, up to MAX_PARALLEL_DELETES
+   *        at a time
+   */
+  void
+  sendDeleteData(ProcessId processId);
+
+  void
+  deleteData(ProcessId processId, size_t index);
 
   void
   onDeleteDataCommandResponse(const Interest& interest, const Data& data,
-                              const RepoCommandParameter& parameters,
-                              const ProcessId processId);
+                              ProcessId processId, size_t index);
+
+  /**
+   * @brief retry delete-data on the repo at @p index, or give it up
+   */
+  void
+  onDeleteDataCommandFailure(ProcessId processId, size_t index);
+
+  /**
+   * @brief account for a repo done with, and finish once all are
+   */
+  void
+  onRepoDone(ProcessId processId);
+
+  /**
+   * @brief reply, and delete the manifest if every repo succeeded
+   */
+  void
+  finishDelete(ProcessId processId);
 
   void
   handleDeleteDataCommand(const Name& prefix, const Interest& interest);
 
+  /**
+   * @brief schedule the next reclamation batch, unless one is scheduled or nothing is left
+   */
+  void
+  scheduleReclaim();
+
+  void
+  reclaim();
+
   RepoCommandResponse
   positiveReply(const Interest& interest, const RepoCommandParameter& parameter,
                 uint64_t statusCode, uint64_t nDeletedData) const;
@@ -98,11 +195,18 @@ private:
   onRegisterFailed(const Name& prefix, const std::string& reason);
 
 private:
-  std::map<ProcessId, ProcessInfo> m_processes;
+  ProcessTable<ProcessInfo> m_processes;
 
   ndn::time::milliseconds m_interestLifetime;
   KeySpaceHandle& m_keySpaceHandle;
   ndn::Name m_repoPrefix;
+
+  uint64_t m_reclaimBatch;               ///< segments erased per reclamation
+  ndn::time::milliseconds m_reclaimInterval;
+  ndn::scheduler::ScopedEventId m_reclaimEvent;
+  bool m_isReclaiming;
+
+  std::map<std::string, size_t> m_replicaDeletes;  ///< storages yet to answer, per manifest
 };
 
 } // namespace repo
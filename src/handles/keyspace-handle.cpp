@@ -23,6 +23,9 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+#include <set>
+
 #include <ndn-cxx/security/command-interest-signer.hpp>
 #include <ndn-cxx/security/hc-key-chain.hpp>
 #include <ndn-cxx/security/signing-helpers.hpp>
@@ -39,6 +42,56 @@ static const milliseconds MAX_TIMEOUT(60_s);
 static const milliseconds NOEND_TIMEOUT(10000_ms);
 static const milliseconds PROCESS_DELETE_TIME(10000_ms);
 static const milliseconds DEFAULT_INTEREST_LIFETIME(4000_ms);
+static const size_t MANIFEST_BATCH_SIZE = 64;
+static const int MANIFEST_BATCH_RETRY = 3;
+static const size_t MAX_MANIFEST_BATCHES = 8;
+static const size_t MANIFEST_LIST_PAGE = 4096;  // keys per manifestlist reply
+static const milliseconds RETRY_BACKOFF(250_ms);
+static const milliseconds MAX_RETRY_BACKOFF(8_s);
+static const char* KEYSPACE_RECORD = "keyspace";
+static const double MIN_HOT_RATE = 100;  // manifest requests per second below which no range is hot
+static const milliseconds MAX_REBALANCE_TIME(10_min);
+
+static std::set<std::string>
+readKeySpaceNodes(const std::string& keySpaceFile)
+{
+  pt::ptree root;
+  std::istringstream is(keySpaceFile);
+  pt::read_json(is, root);
+
+  std::set<std::string> nodes;
+  for (const auto& item : root.get_child("keyspaces")) {
+    nodes.insert(item.second.get<std::string>("node"));
+  }
+  return nodes;
+}
+
+/**
+ * @brief check that the ranges of @p keySpaceFile cover 0x00 ~ 0xff without gap or overlap
+ */
+static bool
+isCompleteKeySpace(const std::string& keySpaceFile)
+{
+  pt::ptree root;
+  std::istringstream is(keySpaceFile);
+  pt::read_json(is, root);
+
+  std::vector<std::pair<int, int>> ranges;
+  for (const auto& item : root.get_child("keyspaces")) {
+    ranges.emplace_back(stoi(item.second.get<std::string>("start"), 0, 16),
+                        stoi(item.second.get<std::string>("end"), 0, 16));
+  }
+  std::sort(ranges.begin(), ranges.end());
+
+  int next = 0x00;
+  for (const auto& range : ranges) {
+    if (range.first != next || range.second < range.first) {
+      return false;
+    }
+    next = range.second + 1;
+  }
+  return next == 0x100;
+}
 
 void
 KeySpaceHandle::initKeySpaceFile() {
@@ -54,15 +107,85 @@ KeySpaceHandle::initKeySpaceFile() {
   std::stringstream os;
   pt::write_json(os, root, false);
   m_keySpaceFile = os.str();
+  updateRing();
 
   m_version = "v" + std::to_string(m_versionNum++);
+  saveKeySpace();
+}
+
+bool
+KeySpaceHandle::loadKeySpace()
+{
+  std::string record = CommandBaseHandle::storageHandle.readRecord(KEYSPACE_RECORD);
+  if (record.empty()) {
+    return false;
+  }
+
+  try {
+    pt::ptree root;
+    std::istringstream is(record);
+    pt::read_json(is, root);
+
+    auto keySpaceFile = root.get<std::string>("keyspace");
+    if (!isCompleteKeySpace(keySpaceFile)) {
+      NDN_LOG_ERROR("Saved keyspace does not cover all hashes, ignored");
+      return false;
+    }
+
+    m_keySpaceFile = keySpaceFile;
+    updateRing();
+    if (!isMember()) {
+      NDN_LOG_ERROR("Saved keyspace does not include " << m_repoPrefix << ", ignored");
+      m_keySpaceFile.clear();
+      m_ring.clear();
+      return false;
+    }
+
+    m_version = root.get<std::string>("version");
+    m_versionNum = root.get<uint64_t>("versionNum");
+  }
+  catch (const std::exception& e) {
+    NDN_LOG_ERROR("Saved keyspace is malformed, ignored: " << e.what());
+    m_keySpaceFile.clear();
+    m_ring.clear();
+    return false;
+  }
+
+  for (const auto& range : m_ring) {
+    if (range.node == m_repoPrefix) {
+      m_start = range.start;
+      m_end = range.end;
+    }
+  }
+
+  NDN_LOG_INFO("Loaded keyspace " << m_version << " with " << m_ring.size() << " nodes");
+  return true;
+}
+
+void
+KeySpaceHandle::saveKeySpace()
+{
+  try {
+    pt::ptree root;
+    root.put("version", m_version);
+    root.put("versionNum", m_versionNum);
+    root.put("keyspace", m_keySpaceFile);
+
+    std::stringstream os;
+    pt::write_json(os, root, false);
+    CommandBaseHandle::storageHandle.writeRecord(KEYSPACE_RECORD, os.str());
+  }
+  catch (const std::exception& e) {
+    NDN_LOG_ERROR("Cannot save keyspace " << m_version << ": " << e.what());
+  }
 }
 
 KeySpaceHandle::KeySpaceHandle(Face& face, RepoStorage& storageHandle, ndn::mgmt::Dispatcher& dispatcher,
                          Scheduler& scheduler, Validator& validator,
                          ndn::Name const& clusterNodePrefix, std::string clusterPrefix, ndn::Name const& managerPrefix, 
-                         std::string clusterType, std::string from)
+                         std::string clusterType, std::string from, size_t replicationFactor)
   : CommandBaseHandle(face, storageHandle, scheduler, validator)
+  , m_validator(validator)
   , m_versionNum(0)
   , m_credit(DEFAULT_CREDIT)
   , m_canBePrefix(DEFAULT_CANBE_PREFIX)
@@ -71,10 +194,24 @@ KeySpaceHandle::KeySpaceHandle(Face& face, RepoStorage& storageHandle, ndn::mgmt
   , m_interestLifetime(DEFAULT_INTEREST_LIFETIME)
   , m_managerPrefix(managerPrefix)
   , m_clusterType(clusterType)
+  , m_start(0)
+  , m_end(-1)
   , m_from(from)
+  , m_handoverStart(0)
+  , m_handoverEnd(-1)
   , m_repoPrefix(Name(clusterNodePrefix).append(clusterPrefix))
+  , m_replicationFactor(std::max<size_t>(replicationFactor, 1))
+  , m_pendingManifestBatches(0)
+  , m_manifestListReceived(false)
+  , m_manifestListDone(false)
+  , m_manifestListRetry(0)
+  , m_isCoordinationPending(false)
+  , m_rebalanceInterval(0)
+  , m_hotRangeRatio(0)
+  , m_isRebalancePending(false)
 {
-  if (m_clusterType == "manager")
+  // a restarted node routes with its last keyspace right away
+  if (!loadKeySpace() && m_clusterType == "manager")
     initKeySpaceFile();
 
   ndn::InterestFilter filterAddNode = Name(m_repoPrefix).append("add-node");
@@ -137,42 +274,66 @@ KeySpaceHandle::onVersionCommand()
   pt::read_json(keyFile, root);
   keySpaces = root.get_child("keyspaces");
 
+  m_pendingVersionNodes.clear();
   for(auto it = keySpaces.begin(); it != keySpaces.end(); it++) {
     if(it == keySpaces.begin())
       continue;
 
-    auto nodeName = it->second.get<std::string>("node");
-    
-    Name cmd = Name(nodeName);
-    cmd
-      .append("keyspace")
-      .append("ver")
-      .append(m_version);
+    Name node(it->second.get<std::string>("node"));
+    m_pendingVersionNodes.insert(node);
+    sendVersionCommand(node);
+  }
+}
 
-    Interest verInterest(cmd);
-    verInterest.setCanBePrefix(true);
-    verInterest.setMustBeFresh(true);
-    verInterest.setInterestLifetime(6_s);
+void
+KeySpaceHandle::sendVersionCommand(const Name& node, int retryCount)
+{
+  Name cmd = Name(node);
+  cmd
+    .append("keyspace")
+    .append("ver")
+    .append(m_version);
 
-    face.expressInterest(
-      verInterest,
-      std::bind(&KeySpaceHandle::onVersionCommandResponse, this, _1, _2),
-      std::bind(&KeySpaceHandle::onVersionCommandTimeout, this, _1),
-      std::bind(&KeySpaceHandle::onVersionCommandTimeout, this, _1));
-  }
+  Interest verInterest(cmd);
+  verInterest.setCanBePrefix(true);
+  verInterest.setMustBeFresh(true);
+  verInterest.setInterestLifetime(6_s);
+
+  face.expressInterest(
+    verInterest,
+    std::bind(&KeySpaceHandle::onVersionCommandResponse, this, _1, _2, node),
+    std::bind(&KeySpaceHandle::onVersionCommandTimeout, this, _1, node, retryCount),
+    std::bind(&KeySpaceHandle::onVersionCommandTimeout, this, _1, node, retryCount));
 }
 
 void
-KeySpaceHandle::onVersionCommandResponse(const Interest& interest, const Data& data) 
+KeySpaceHandle::onVersionCommandResponse(const Interest& interest, const Data& data, const Name& node)
 {
   NDN_LOG_DEBUG("Version Command Response");
+  if (interest.getName().at(-1).toUri() == m_version) {
+    m_pendingVersionNodes.erase(node);
+  }
 }
 
 void
-KeySpaceHandle::onVersionCommandTimeout(const Interest& interest) 
+KeySpaceHandle::onVersionCommandTimeout(const Interest& interest, const Name& node, int retryCount)
 {
-  onVersionCommand();
   NDN_LOG_ERROR("Version Command Timeout");
+  // a newer version was announced in the meantime
+  if (interest.getName().at(-1).toUri() != m_version || m_pendingVersionNodes.count(node) == 0) {
+    return;
+  }
+
+  if (!isAlive(node)) {
+    NDN_LOG_DEBUG("Version of " << node << " postponed until it recovers");
+    return;
+  }
+
+  scheduler.schedule(getRetryDelay(retryCount), [this, node, retryCount] {
+    if (m_pendingVersionNodes.count(node) > 0) {
+      sendVersionCommand(node, retryCount + 1);
+    }
+  });
 }
 
 void
@@ -189,7 +350,9 @@ KeySpaceHandle::handleFetchCommand(const Name& prefix, const Interest& interest)
 }
 
 void
-KeySpaceHandle::onFetchCommand(std::string versionNum) {
+KeySpaceHandle::onFetchCommand(std::string versionNum, int retryCount) {
+  m_pendingFetchVersion = versionNum;
+
   Name cmd = m_managerPrefix; 
   cmd
     .append("keyspace")
@@ -204,22 +367,29 @@ KeySpaceHandle::onFetchCommand(std::string versionNum) {
   face.expressInterest(
     fetchInterest,
     std::bind(&KeySpaceHandle::onFetchCommandResponse, this, _1, _2),
-    std::bind(&KeySpaceHandle::onFetchCommandTimeout, this, _1),
-    std::bind(&KeySpaceHandle::onFetchCommandTimeout, this, _1));
+    std::bind(&KeySpaceHandle::onFetchCommandTimeout, this, _1, retryCount),
+    std::bind(&KeySpaceHandle::onFetchCommandTimeout, this, _1, retryCount));
 }
 
 void
 KeySpaceHandle::onFetchCommandResponse(const Interest& interest, const Data& data)
 {
+  if (interest.getName().at(-1).toUri() == m_pendingFetchVersion) {
+    m_pendingFetchVersion.clear();
+  }
+
   auto content = data.getContent();
   if(content.value_size() == 0) {
     NDN_LOG_ERROR("Keyspacefile Version Diff");
     return;
   }
 
+  auto oldKeySpaceFile = m_keySpaceFile;
   m_version = interest.getName().at(-1).toUri();
   m_keySpaceFile = reinterpret_cast<const char*>(content.value());
   m_keySpaceFile = m_keySpaceFile.substr(0, content.value_size());
+  updateRing();
+  saveKeySpace();
 
   pt::ptree root, keySpaces;
   std::istringstream keyFile(m_keySpaceFile);
@@ -237,13 +407,29 @@ KeySpaceHandle::onFetchCommandResponse(const Interest& interest, const Data& dat
       break;
     }
   }
+
+  notifyRemovedNodes(oldKeySpaceFile);
 }
 
 void
-KeySpaceHandle::onFetchCommandTimeout(const Interest& interest)
+KeySpaceHandle::onFetchCommandTimeout(const Interest& interest, int retryCount)
 {
-  onFetchCommand(interest.getName().at(-1).toUri());
   NDN_LOG_ERROR("Fetch timeout");
+  auto version = interest.getName().at(-1).toUri();
+  if (version != m_pendingFetchVersion) {
+    return;
+  }
+
+  if (!isAlive(m_managerPrefix)) {
+    NDN_LOG_DEBUG("Fetch of " << version << " postponed until the manager recovers");
+    return;
+  }
+
+  scheduler.schedule(getRetryDelay(retryCount), [this, version, retryCount] {
+    if (version == m_pendingFetchVersion) {
+      onFetchCommand(version, retryCount + 1);
+    }
+  });
 }
 
 void
@@ -293,12 +479,16 @@ KeySpaceHandle::handleAddCommand(const Name& prefix, const Interest& interest)
 
       keySpaces.push_back(std::make_pair("", toNode));
       root.put_child("keyspaces", keySpaces);
+      m_handoverStart = fromStart;
+      m_handoverEnd = fromEnd;
 
       std::stringstream os;
       pt::write_json(os, root, false);
 
       m_keySpaceFile = os.str();
+      updateRing();
       m_version = "v" + std::to_string(m_versionNum++);
+      saveKeySpace();
 
       negativeReply(interest, "", 200);
       onVersionCommand();
@@ -337,6 +527,8 @@ KeySpaceHandle::handleDeleteCommand(const Name& prefix, const Interest& interest
     if (m_from == nodeName) {
       fromStart = stoi(node.get<std::string>("start"), 0, 16);
       fromEnd = stoi(node.get<std::string>("end"), 0, 16);
+      m_handoverStart = fromStart;
+      m_handoverEnd = fromEnd;
       keySpaces.erase(it);
       break;
     }
@@ -363,92 +555,229 @@ KeySpaceHandle::handleDeleteCommand(const Name& prefix, const Interest& interest
   std::stringstream os;
   pt::write_json(os, root, false);
 
+  auto oldKeySpaceFile = m_keySpaceFile;
   m_keySpaceFile = os.str();
+  updateRing();
   m_version = "v" + std::to_string(m_versionNum++);
+  saveKeySpace();
 
   negativeReply(interest, "", 200);
   onVersionCommand();
+  notifyRemovedNodes(oldKeySpaceFile);
 }
 
 void
 KeySpaceHandle::handleRingInfoCommand(const Name& prefix, const Interest& interest) 
 {
-  reply(interest, m_keySpaceFile);
+  if (m_keySpaceFile.empty()) {
+    reply(interest, m_keySpaceFile);
+    return;
+  }
+
+  // clients cache the ranges and compare versions to find out they are stale
+  pt::ptree root;
+  std::istringstream is(m_keySpaceFile);
+  pt::read_json(is, root);
+  root.put("version", m_version);
+
+  std::stringstream os;
+  pt::write_json(os, root, false);
+  reply(interest, os.str());
 }
 
 void
 KeySpaceHandle::handleManifestListCommand(const Name& prefix, const Interest& interest) 
 {
-  pt::ptree root;
-  auto manifests = CommandBaseHandle::storageHandle.readManifests();
+  if (replyFromDataset(interest)) {
+    return;
+  }
 
-  root.add_child("manifests", manifests);
+  int start = 0x00;
+  int end = 0xff;
+  std::string after;
+  if (interest.getName().size() > prefix.size()) {
+    RepoCommandParameter repoParameter;
+    try {
+      extractParameter(interest, prefix, repoParameter);
+    }
+    catch (const RepoCommandParameter::Error&) {
+      negativeReply(interest, "command parameter malformed", 403);
+      return;
+    }
 
-  std::stringstream os;
-  pt::write_json(os, root, false);
+    if (repoParameter.hasStartBlockId())
+      start = repoParameter.getStartBlockId();
+    if (repoParameter.hasEndBlockId())
+      end = repoParameter.getEndBlockId();
+    if (repoParameter.hasName() && !repoParameter.getName().empty())
+      after = repoParameter.getName().get(0).toUri();
+  }
+  after = std::max(after, util::getBucketPrefix(std::max(start, 0)));
 
-  reply(interest, os.str());
+  // one page per command, read in key order from where the previous page stopped
+  pt::ptree manifests;
+  pt::ptree trailer;
+  for (const auto& key : CommandBaseHandle::storageHandle.readManifestKeys(after, MANIFEST_LIST_PAGE + 1)) {
+    if (util::getHashBucket(key) > end) {
+      break;
+    }
+    if (manifests.size() == MANIFEST_LIST_PAGE) {
+      trailer.put("next", manifests.back().second.get<std::string>("key"));
+      break;
+    }
+
+    pt::ptree item;
+    item.put("key", key);
+    manifests.push_back(std::make_pair("", item));
+  }
+  NDN_LOG_DEBUG("Manifest list " << start << "~" << end << " after " << after << ": "
+                << manifests.size() << " manifests");
+
+  replySegmented(interest, util::segmentJsonArray("manifests", manifests, trailer));
 }
 
 void
 KeySpaceHandle::onManifestListCommand() 
 {
-  Name cmd = Name(m_from);
-  cmd
-    .append("manifestlist");
+  m_migratedManifests.clear();
+  m_manifestBatch.clear();
+  std::queue<std::vector<std::string>>().swap(m_manifestBatchQueue);
+  m_pendingManifestBatches = 0;
+  m_manifestListDone = false;
+  m_manifestListCursor.clear();
+  m_manifestListNext.clear();
+
+  requestManifestList();
+}
 
-  Interest manifestListInterest(cmd);
-  manifestListInterest.setCanBePrefix(true);
-  manifestListInterest.setMustBeFresh(true);
-  manifestListInterest.setInterestLifetime(6_s);
+void
+KeySpaceHandle::requestManifestList()
+{
+  m_manifestListReceived = false;
 
-  face.expressInterest(
-    manifestListInterest,
-    std::bind(&KeySpaceHandle::onManifestListCommandResponse, this, _1, _2),
-    std::bind(&KeySpaceHandle::onManifestListCommandTimeout, this, _1),
-    std::bind(&KeySpaceHandle::onManifestListCommandTimeout, this, _1));
+  RepoCommandParameter parameter;
+  parameter.setStartBlockId(m_handoverStart);
+  parameter.setEndBlockId(m_handoverEnd);
+  if (!m_manifestListCursor.empty()) {
+    parameter.setName(Name().append(m_manifestListCursor));
+  }
+
+  Interest manifestListInterest = util::generateCommandInterest(
+    m_from, "manifestlist", parameter, m_interestLifetime);
+
+  ndn::util::SegmentFetcher::Options options;
+  options.interestLifetime = m_interestLifetime;
+  options.maxTimeout = m_maxTimeout;
+
+  auto fetcher = ndn::util::SegmentFetcher::start(face, manifestListInterest, m_validator, options);
+  fetcher->afterSegmentValidated.connect([this] (const Data& data) {
+    onManifestListCommandResponse(data);
+  });
+  fetcher->onComplete.connect([this] (const ndn::ConstBufferPtr&) {
+    onManifestListCommandComplete();
+  });
+  fetcher->onError.connect([this] (uint32_t, const std::string& reason) {
+    onManifestListCommandError(reason);
+  });
 }
 
 void
-KeySpaceHandle::onManifestListCommandResponse(const Interest& interest, const Data& data)
+KeySpaceHandle::onManifestListCommandResponse(const Data& data)
 {
+  m_manifestListReceived = true;
+
   auto content = data.getContent();
-  if(content.value_size() == 0) {
-    NDN_LOG_ERROR("ManifestList Command Failed");
+  if (content.value_size() == 0) {
     return;
   }
 
-  m_manifestList = reinterpret_cast<const char*>(content.value());
-  m_manifestList = m_manifestList.substr(0, content.value_size());
-
-  pt::ptree root, manifests;
-  std::istringstream manifestList(m_manifestList);
+  pt::ptree root;
+  std::istringstream manifestList(std::string(content.value_begin(), content.value_end()));
+  try {
+    pt::read_json(manifestList, root);
+  }
+  catch (const pt::ptree_error& e) {
+    NDN_LOG_ERROR("Malformed manifest list segment " << data.getName() << ": " << e.what());
+    return;
+  }
 
-  pt::read_json(manifestList, root);
-  manifests = root.get_child("manifests");
+  m_manifestListNext = root.get<std::string>("next", m_manifestListNext);
 
-  for (auto it = manifests.begin(); it != manifests.end(); it++) {
-    auto node = it->second;
-    auto manifestName = node.get<std::string>("key");
+  auto manifests = root.get_child_optional("manifests");
+  if (!manifests) {
+    return;
+  }
 
-    for (auto start = m_start; start <= m_end; start++) {
-      std::stringstream stream;
-      stream << std::hex << start;
+  for (const auto& item : *manifests) {
+    auto manifestName = item.second.get<std::string>("key");
+    auto bucket = util::getHashBucket(manifestName);
 
-      if (!strncmp(manifestName.c_str(), stream.str().c_str(), stream.str().length())) {
-        onManifestCommand(manifestName);
+    if (bucket >= m_handoverStart && bucket <= m_handoverEnd) {
+      m_manifestBatch.push_back(manifestName);
+      if (m_manifestBatch.size() == MANIFEST_BATCH_SIZE) {
+        m_manifestBatchQueue.push(std::move(m_manifestBatch));
+        m_manifestBatch.clear();
       }
     }
   }
 
-  onCompleteCommand();
+  dispatchManifestBatches();
 }
 
 void
-KeySpaceHandle::onManifestListCommandTimeout(const Interest& interest)
+KeySpaceHandle::onManifestListCommandComplete()
 {
-  onManifestListCommand();
-  NDN_LOG_ERROR("Manifest List timeout");
+  if (!m_manifestListNext.empty()) {
+    m_manifestListCursor = m_manifestListNext;
+    m_manifestListNext.clear();
+    m_manifestListRetry = 0;
+    requestManifestList();
+    return;
+  }
+
+  if (!m_manifestBatch.empty()) {
+    m_manifestBatchQueue.push(std::move(m_manifestBatch));
+    m_manifestBatch.clear();
+  }
+  m_manifestListDone = true;
+  m_manifestListRetry = 0;
+
+  dispatchManifestBatches();
+}
+
+void
+KeySpaceHandle::onManifestListCommandError(const std::string& reason)
+{
+  NDN_LOG_ERROR("Manifest List failed: " << reason);
+
+  if (!m_manifestListReceived && m_manifestListRetry++ < MANIFEST_BATCH_RETRY) {
+    requestManifestList();
+    return;
+  }
+
+  // keep what has been migrated so far, the rest stays on m_from
+  m_manifestListNext.clear();
+  onManifestListCommandComplete();
+}
+
+void
+KeySpaceHandle::dispatchManifestBatches()
+{
+  while (m_pendingManifestBatches < MAX_MANIFEST_BATCHES && !m_manifestBatchQueue.empty()) {
+    ++m_pendingManifestBatches;
+    onManifestCommand(m_manifestBatchQueue.front());
+    m_manifestBatchQueue.pop();
+  }
+
+  if (m_manifestListDone && m_manifestBatchQueue.empty() && m_pendingManifestBatches == 0) {
+    m_manifestListDone = false;
+    onCompleteCommand();
+
+    // manifests taken over from a node that is leaving still point at its segments
+    if (!m_keySpaceFile.empty() && readKeySpaceNodes(m_keySpaceFile).count(m_from) == 0) {
+      afterNodeRemoved(Name(m_from));
+    }
+  }
 }
 
 void
@@ -459,39 +788,90 @@ KeySpaceHandle::handleManifestCommand(const Name& prefix, const Interest& intere
 }
 
 void
-KeySpaceHandle::onManifestCommand(std::string manifestName) 
+KeySpaceHandle::onManifestCommand(const std::vector<std::string>& manifestNames, int retryCount)
 {
+  Name hashes;
+  for (const auto& manifestName : manifestNames) {
+    hashes.append(manifestName);
+  }
+
   RepoCommandParameter parameter;
-  parameter.setName(manifestName);
+  parameter.setName(hashes);
 
   Interest manifestInterest = util::generateCommandInterest(
-   m_from, "find", parameter, 4_s);
-  manifestInterest.setMustBeFresh(true);
-
-  face.expressInterest(
-    manifestInterest,
-    std::bind(&KeySpaceHandle::onManifestCommandResponse, this, _1, _2),
-    std::bind(&KeySpaceHandle::onManifestCommandTimeout, this, _1),
-    std::bind(&KeySpaceHandle::onManifestCommandTimeout, this, _1));
+   m_from, "find-batch", parameter, m_interestLifetime);
+
+  ndn::util::SegmentFetcher::Options options;
+  options.interestLifetime = m_interestLifetime;
+  options.maxTimeout = m_maxTimeout;
+
+  auto fetcher = ndn::util::SegmentFetcher::start(face, manifestInterest, m_validator, options);
+  fetcher->afterSegmentValidated.connect([this] (const Data& data) {
+    onManifestCommandResponse(data);
+  });
+  fetcher->onComplete.connect([this] (const ndn::ConstBufferPtr&) {
+    onManifestCommandComplete();
+  });
+  fetcher->onError.connect([this, manifestNames, retryCount] (uint32_t, const std::string& reason) {
+    onManifestCommandError(manifestNames, retryCount, reason);
+  });
 }
 
 void
-KeySpaceHandle::onManifestCommandResponse(const Interest& interest, const Data& data)
+KeySpaceHandle::onManifestCommandResponse(const Data& data)
 {
   auto content = data.getContent();
-  std::string json(
-    content.value_begin(),
-    content.value_end());
+  if (content.value_size() == 0) {
+    return;
+  }
 
-  auto manifest = Manifest::fromJson(json);
-  CommandBaseHandle::storageHandle.insertManifest(manifest);
+  pt::ptree root;
+  std::istringstream json(std::string(content.value_begin(), content.value_end()));
+  try {
+    pt::read_json(json, root);
+  }
+  catch (const pt::ptree_error& e) {
+    NDN_LOG_ERROR("Malformed find-batch segment " << data.getName() << ": " << e.what());
+    return;
+  }
+
+  auto manifests = root.get_child_optional("manifests");
+  if (!manifests) {
+    return;
+  }
+
+  for (const auto& item : *manifests) {
+    auto manifest = Manifest::fromPtree(item.second);
+    if (CommandBaseHandle::storageHandle.insertManifest(manifest)) {
+      m_migratedManifests.push_back(manifest.getHash());
+    }
+  }
 }
 
 void
-KeySpaceHandle::onManifestCommandTimeout(const Interest& interest)
+KeySpaceHandle::onManifestCommandComplete()
 {
-  // onManifestListCommand(interest.getName().at(-2).toUri());
-  NDN_LOG_ERROR("Manifest timeout");
+  if (m_pendingManifestBatches > 0) {
+    --m_pendingManifestBatches;
+  }
+
+  dispatchManifestBatches();
+}
+
+void
+KeySpaceHandle::onManifestCommandError(const std::vector<std::string>& manifestNames, int retryCount,
+                                       const std::string& reason)
+{
+  NDN_LOG_ERROR("Manifest batch failed: " << reason);
+
+  if (retryCount < MANIFEST_BATCH_RETRY) {
+    onManifestCommand(manifestNames, retryCount + 1);
+    return;
+  }
+
+  NDN_LOG_ERROR("Give up " << manifestNames.size() << " manifests after "
+                << MANIFEST_BATCH_RETRY << " retries");
+  onManifestCommandComplete();
 }
 
 void
@@ -513,16 +893,32 @@ KeySpaceHandle::handleCoordinationCommand(const Name& prefix, const Interest& in
     m_from = m_from.substr(0, repoParameter.getFrom().value_size());
   }
 
+  // a manager that does not say which buckets move hands over this node's whole range
+  if (repoParameter.hasStartBlockId() && repoParameter.hasEndBlockId()) {
+    m_handoverStart = repoParameter.getStartBlockId();
+    m_handoverEnd = repoParameter.getEndBlockId();
+  }
+  else {
+    m_handoverStart = m_start;
+    m_handoverEnd = m_end;
+  }
+
   negativeReply(interest, "", 200);
 
   onManifestListCommand();
 }
 
 void
-KeySpaceHandle::onCoordinationCommand() 
+KeySpaceHandle::onCoordinationCommand(int retryCount)
 {
+  m_isCoordinationPending = true;
+
   RepoCommandParameter parameter;
   parameter.setFrom(ndn::encoding::makeBinaryBlock(tlv::From, m_from.c_str(), m_from.length()));
+  if (m_handoverStart <= m_handoverEnd) {
+    parameter.setStartBlockId(m_handoverStart);
+    parameter.setEndBlockId(m_handoverEnd);
+  }
   Name cmd = Name(m_to);
   cmd
     .append("coordination")
@@ -538,29 +934,162 @@ KeySpaceHandle::onCoordinationCommand()
   face.expressInterest(
     coordinationInterest,
     std::bind(&KeySpaceHandle::onCoordinationCommandResponse, this, _1, _2),
-    std::bind(&KeySpaceHandle::onCoordinationCommandTimeout, this, _1),
-    std::bind(&KeySpaceHandle::onCoordinationCommandTimeout, this, _1));
+    std::bind(&KeySpaceHandle::onCoordinationCommandTimeout, this, _1, retryCount),
+    std::bind(&KeySpaceHandle::onCoordinationCommandTimeout, this, _1, retryCount));
 }
 
 void
 KeySpaceHandle::onCoordinationCommandResponse(const Interest& interest, const Data& data)
 {
   NDN_LOG_DEBUG("Coordination Command Response");
+  m_isCoordinationPending = false;
 }
 
 void
-KeySpaceHandle::onCoordinationCommandTimeout(const Interest& interest)
+KeySpaceHandle::onCoordinationCommandTimeout(const Interest& interest, int retryCount)
 {
-  onCoordinationCommand();
   NDN_LOG_ERROR("Coordination timeout");
+  if (!m_isCoordinationPending) {
+    return;
+  }
+
+  if (!isAlive(Name(m_to))) {
+    NDN_LOG_DEBUG("Coordination postponed until " << m_to << " recovers");
+    return;
+  }
+
+  scheduler.schedule(getRetryDelay(retryCount), [this, retryCount] {
+    if (m_isCoordinationPending) {
+      onCoordinationCommand(retryCount + 1);
+    }
+  });
+}
+
+milliseconds
+KeySpaceHandle::getRetryDelay(int retryCount)
+{
+  return std::min(RETRY_BACKOFF * (1 << std::min(retryCount, 5)), MAX_RETRY_BACKOFF);
+}
+
+void
+KeySpaceHandle::onNodeRecovered(const ndn::Name& node)
+{
+  if (m_pendingVersionNodes.count(node) > 0) {
+    sendVersionCommand(node);
+  }
+  if (node == m_managerPrefix && !m_pendingFetchVersion.empty()) {
+    onFetchCommand(m_pendingFetchVersion);
+  }
+  if (m_isCoordinationPending && node == Name(m_to)) {
+    onCoordinationCommand();
+  }
 }
 
 void
 KeySpaceHandle::handleCompleteCommand(const Name& prefix, const Interest& interest)
 {
+  m_isRebalancePending = false;
   negativeReply(interest, "", 200);
 }
 
+void
+KeySpaceHandle::startRebalancing(const RequestRateSource& requestRates,
+                                 milliseconds interval, double hotRatio)
+{
+  m_requestRates = requestRates;
+  m_rebalanceInterval = interval;
+  m_hotRangeRatio = hotRatio;
+  m_rebalanceEvent = scheduler.schedule(m_rebalanceInterval, [this] { rebalance(); });
+}
+
+void
+KeySpaceHandle::rebalance()
+{
+  m_rebalanceEvent = scheduler.schedule(m_rebalanceInterval, [this] { rebalance(); });
+
+  // one change at a time, until the nodes know the keyspace and the manifests have moved
+  if (m_isRebalancePending &&
+      ndn::time::steady_clock::now() - m_rebalanceStarted < MAX_REBALANCE_TIME) {
+    return;
+  }
+  if (m_isCoordinationPending || !m_pendingVersionNodes.empty() || m_ring.size() < 2) {
+    return;
+  }
+
+  std::vector<HotRangeDetector::Range> ranges;
+  for (const auto& range : m_ring) {
+    ranges.push_back({range.start, range.end});
+  }
+
+  auto shift = HotRangeDetector::findShift(ranges, m_requestRates(), m_hotRangeRatio, MIN_HOT_RATE);
+  if (shift) {
+    shiftBoundary(*shift);
+  }
+}
+
+void
+KeySpaceHandle::shiftBoundary(const HotRangeDetector::Shift& shift)
+{
+  const KeySpaceRange from = m_ring[shift.from];
+  const KeySpaceRange to = m_ring[shift.to];
+  bool isToAfter = shift.to > shift.from;
+
+  auto toHex = [] (int bucket) {
+    std::stringstream stream;
+    stream << "0x" << std::hex << bucket;
+    return stream.str();
+  };
+
+  pt::ptree root;
+  std::istringstream keyFile(m_keySpaceFile);
+  pt::read_json(keyFile, root);
+
+  for (auto& item : root.get_child("keyspaces")) {
+    Name node(item.second.get<std::string>("node"));
+    int start = stoi(item.second.get<std::string>("start"), 0, 16);
+
+    if (node == from.node && start == from.start) {
+      if (isToAfter)
+        item.second.put("end", toHex(shift.start - 1));
+      else
+        item.second.put("start", toHex(shift.end + 1));
+    }
+    else if (node == to.node && start == to.start) {
+      if (isToAfter)
+        item.second.put("start", toHex(shift.start));
+      else
+        item.second.put("end", toHex(shift.end));
+    }
+  }
+
+  std::stringstream os;
+  pt::write_json(os, root, false);
+
+  m_keySpaceFile = os.str();
+  updateRing();
+  m_version = "v" + std::to_string(m_versionNum++);
+  saveKeySpace();
+
+  for (const auto& range : m_ring) {
+    if (range.node == m_repoPrefix) {
+      m_start = range.start;
+      m_end = range.end;
+    }
+  }
+
+  NDN_LOG_INFO("Hot range of " << from.node << ": buckets " << shift.start << "~" << shift.end
+               << " go to " << to.node << " in " << m_version);
+
+  m_from = from.node.toUri();
+  m_to = to.node.toUri();
+  m_handoverStart = shift.start;
+  m_handoverEnd = shift.end;
+  m_isRebalancePending = true;
+  m_rebalanceStarted = ndn::time::steady_clock::now();
+
+  onVersionCommand();
+}
+
 void
 KeySpaceHandle::onCompleteCommand() 
 {
@@ -583,24 +1112,10 @@ KeySpaceHandle::onCompleteCommand()
 void
 KeySpaceHandle::onCompleteCommandResponse(const Interest& interest, const Data& data)
 {
-  pt::ptree root, manifests;
-  std::istringstream manifestList(m_manifestList);
-
-  pt::read_json(manifestList, root);
-  manifests = root.get_child("manifests");
-
-  for (auto it = manifests.begin(); it != manifests.end(); it++) {
-    auto manifestName = it->second.get<std::string>("key");
-
-    for (auto start = m_start; start <= m_end; start++) {
-      std::stringstream stream;
-      stream << std::hex << start;
-
-      if (!strncmp(manifestName.c_str(), stream.str().c_str(), stream.str().length())) {
-        onDeleteManifestCommand(manifestName);
-      }
-    } 
+  for (const auto& manifestName : m_migratedManifests) {
+    onDeleteManifestCommand(manifestName);
   }
+  m_migratedManifests.clear();
 }
 
 void
@@ -638,35 +1153,132 @@ KeySpaceHandle::onDeleteManifestCommandTimeout(const Interest& interest)
   NDN_LOG_ERROR("Delete Manifest Command Tiemout");
 }
 
-ndn::Name
-KeySpaceHandle::getManifestStorage(const std::string hash)
+void
+KeySpaceHandle::notifyRemovedNodes(const std::string& oldKeySpaceFile)
 {
-  pt::ptree root, keySpaces;
-  std::istringstream keySpaceFile(m_keySpaceFile);
+  if (oldKeySpaceFile.empty()) {
+    return;
+  }
+
+  auto nodes = readKeySpaceNodes(m_keySpaceFile);
+  for (const auto& node : readKeySpaceNodes(oldKeySpaceFile)) {
+    if (nodes.count(node) == 0) {
+      NDN_LOG_DEBUG("Node " << node << " left the keyspace");
+      afterNodeRemoved(Name(node));
+    }
+  }
+}
 
+void
+KeySpaceHandle::updateRing()
+{
+  pt::ptree root;
+  std::istringstream keySpaceFile(m_keySpaceFile);
   pt::read_json(keySpaceFile, root);
-  keySpaces = root.get_child("keyspaces");
 
-  for (auto it = keySpaces.begin(); it != keySpaces.end(); it++) {
-    auto node = it->second;
-    auto nodeName = node.get<std::string>("node");
+  m_ring.clear();
+  for (const auto& item : root.get_child("keyspaces")) {
+    KeySpaceRange range;
+    range.node = Name(item.second.get<std::string>("node"));
+    range.start = stoi(item.second.get<std::string>("start"), 0, 16);
+    range.end = stoi(item.second.get<std::string>("end"), 0, 16);
+    m_ring.push_back(range);
+  }
 
-    auto start = stoi(node.get<std::string>("start"), 0, 16);
-    auto end = stoi(node.get<std::string>("end"), 0, 16);
+  std::sort(m_ring.begin(), m_ring.end(),
+            [] (const KeySpaceRange& a, const KeySpaceRange& b) { return a.start < b.start; });
+}
 
-    for (; start <= end; start++) {
-      std::stringstream stream;
-      stream << std::hex << start; 
-      
-      std::string startHash = str(boost::format("%02x") % stream.str());
+ndn::Name
+KeySpaceHandle::getManifestStorage(const std::string hash)
+{
+  auto bucket = util::getHashBucket(hash);
+  for (const auto& range : m_ring) {
+    if (bucket >= range.start && bucket <= range.end) {
+      if (isAlive(range.node)) {
+        return range.node;
+      }
 
-      if(!strncmp(hash.c_str(), startHash.c_str(),startHash.length())) {
-        return nodeName;
+      // fail over to the replicas on the successors
+      for (const auto& node : getManifestStorages(hash)) {
+        if (isAlive(node)) {
+          return node;
+        }
       }
+      return range.node;
     }
   }
 
   return Name("");
 }
 
+ndn::Name
+KeySpaceHandle::getContentStorage(const std::string& digest) const
+{
+  auto bucket = util::getHashBucket(digest);
+  for (const auto& range : m_ring) {
+    if (bucket >= range.start && bucket <= range.end) {
+      return range.node;
+    }
+  }
+  return Name();
+}
+
+std::vector<ndn::Name>
+KeySpaceHandle::getNodes() const
+{
+  std::vector<ndn::Name> nodes;
+  for (const auto& range : m_ring) {
+    nodes.push_back(range.node);
+  }
+  return nodes;
+}
+
+bool
+KeySpaceHandle::isMember() const
+{
+  return std::any_of(m_ring.begin(), m_ring.end(),
+                     [this] (const KeySpaceRange& range) { return range.node == m_repoPrefix; });
+}
+
+std::vector<std::pair<int, int>>
+KeySpaceHandle::getReplicaRanges(const ndn::Name& node) const
+{
+  std::vector<std::pair<int, int>> ranges;
+  for (size_t i = 0; i < m_ring.size(); ++i) {
+    for (size_t j = 0; j < m_ring.size() && j < m_replicationFactor; ++j) {
+      if (m_ring[(i + j) % m_ring.size()].node == node) {
+        ranges.emplace_back(m_ring[i].start, m_ring[i].end);
+        break;
+      }
+    }
+  }
+  return ranges;
+}
+
+std::vector<ndn::Name>
+KeySpaceHandle::getManifestStorages(const std::string& hash)
+{
+  std::vector<ndn::Name> storages;
+
+  auto bucket = util::getHashBucket(hash);
+  for (size_t i = 0; i < m_ring.size(); ++i) {
+    if (bucket < m_ring[i].start || bucket > m_ring[i].end) {
+      continue;
+    }
+
+    for (size_t j = 0; j < m_ring.size() && storages.size() < m_replicationFactor; ++j) {
+      const Name& node = m_ring[(i + j) % m_ring.size()].node;
+      if (std::find(storages.begin(), storages.end(), node) == storages.end()) {
+        storages.push_back(node);
+      }
+    }
+    break;
+  }
+
+  std::stable_partition(storages.begin(), storages.end(),
+                        [this] (const Name& node) { return isAlive(node); });
+  return storages;
+}
+
 }
\ No newline at end of file
@@ -21,8 +21,15 @@
 #define REPO_HANDLES_KEYSPACE_HANDLE_HPP
 
 #include "command-base-handle.hpp"
+#include "process-table.hpp"
+#include "../keyspace/hot-range-detector.hpp"
 
 #include <ndn-cxx/mgmt/dispatcher.hpp>
+#include <ndn-cxx/util/segment-fetcher.hpp>
+#include <ndn-cxx/util/signal.hpp>
+
+#include <queue>
+#include <set>
 
 namespace repo {
 
@@ -65,7 +72,7 @@ public:
   KeySpaceHandle(Face& face, RepoStorage& storageHandle,
               ndn::mgmt::Dispatcher& dispatcher, Scheduler& scheduler,
               Validator& validator, ndn::Name const& clusterNodePrefix, std::string clusterPrefix, ndn::Name const& managerPrefix,
-              std::string clusterType, std::string from);
+              std::string clusterType, std::string from, size_t replicationFactor = 1);
 
 private:
   /**
@@ -75,11 +82,6 @@ private:
   struct ProcessInfo
   {
     RepoCommandResponse response;
-    std::queue<SegmentNo> nextSegmentQueue;  ///< queue of waiting segment
-                                        ///  to be sent when having credits
-    SegmentNo nextSegment;  ///< last segment put into the nextSegmentQueue
-    std::map<SegmentNo, int> retryCounts;  ///< to store retrying times of timeout segment
-    int credit;  ///< congestion control credits of process
 
     /**
      * @brief the latest time point at which EndBlockId must be determined
@@ -100,10 +102,43 @@ private:
     bool manifestSent = false;
   };
 
+  /**
+   * @brief a node and the hash range (first hash byte) it owns
+   */
+  struct KeySpaceRange
+  {
+    ndn::Name node;
+    int start;
+    int end;
+  };
+
 private:
   void
   initKeySpaceFile();
 
+  /**
+   * @brief rebuild m_ring from m_keySpaceFile
+   */
+  void
+  updateRing();
+
+  /**
+   * @brief restore the keyspace and its version saved by saveKeySpace()
+   * @return false if nothing was saved, or if the saved keyspace does not cover all hashes
+   *         or does not include this node
+   */
+  bool
+  loadKeySpace();
+
+  /**
+   * @brief persist m_keySpaceFile with its version, called on every change
+   */
+  void
+  saveKeySpace();
+
+  /**
+   * @brief reply with the keyspace ranges and their version, for clients that cache them
+   */
   void
   handleRingInfoCommand(const Name& prefix, const Interest& interest);
 
@@ -122,6 +157,11 @@ private:
   void
   handleCoordinationCommand(const Name &prefix, const Interest &interest);
 
+  /**
+   * @brief serve the hashes of local manifests as a segmented dataset
+   *
+   * The optional StartBlockId and EndBlockId restrict the list to a keyspace range.
+   */
   void
   handleManifestListCommand(const Name& prefix, const Interest& interest);
 
@@ -132,49 +172,87 @@ private:
   handleCompleteCommand(const Name& prefix, const Interest& interest);
 
   void
-  onFetchCommand(std::string versionNum);
+  onFetchCommand(std::string versionNum, int retryCount = 0);
 
   void
   onFetchCommandResponse(const Interest& interest, const Data& data);
 
   void
-  onFetchCommandTimeout(const Interest& interest);
+  onFetchCommandTimeout(const Interest& interest, int retryCount);
 
   void
   onVersionCommand(); 
 
+  /**
+   * @brief announce the current version to @p node
+   */
   void
-  onVersionCommandResponse(const Interest& interest, const Data& data);
+  sendVersionCommand(const Name& node, int retryCount = 0);
 
   void
-  onVersionCommandTimeout(const Interest& interest);
+  onVersionCommandResponse(const Interest& interest, const Data& data, const Name& node);
 
+  /**
+   * @brief retry with backoff while @p node is alive; a suspected node gets the version
+   *        again when it recovers
+   */
+  void
+  onVersionCommandTimeout(const Interest& interest, const Name& node, int retryCount);
+
+  /**
+   * @brief fetch the manifest list of m_from for [m_start, m_end]
+   *
+   * Each segment is turned into find-batch commands as soon as it arrives.
+   */
   void
   onManifestListCommand();
 
+  /**
+   * @brief request the page of the manifest list that follows m_manifestListCursor
+   */
+  void
+  requestManifestList();
+
+  void
+  onManifestListCommandResponse(const Data& data);
+
+  void
+  onManifestListCommandComplete();
+
+  void
+  onManifestListCommandError(const std::string& reason);
+
+  /**
+   * @brief send queued manifest batches while fewer than MAX_MANIFEST_BATCHES are in flight,
+   *        and report completion once the list is exhausted
+   */
   void
-  onManifestListCommandResponse(const Interest& interest, const Data& data);
+  dispatchManifestBatches();
 
+  /**
+   * @brief fetch a batch of manifests from m_from with one find-batch command
+   */
   void
-  onManifestListCommandTimeout(const Interest& interest);
+  onManifestCommand(const std::vector<std::string>& manifestNames, int retryCount = 0);
 
   void
-  onManifestCommand(std::string manifestName);
+  onManifestCommandResponse(const Data& data);
 
   void
-  onManifestCommandResponse(const Interest& interest, const Data& data);
+  onManifestCommandComplete();
 
   void
-  onManifestCommandTimeout(const Interest& interest);
+  onManifestCommandError(const std::vector<std::string>& manifestNames, int retryCount,
+                         const std::string& reason);
 
   void
-  onCoordinationCommand();
+  onCoordinationCommand(int retryCount = 0);
 
   void
   onCoordinationCommandResponse(const Interest& interest, const Data& data);
 
   void
-  onCoordinationCommandTimeout(const Interest& interest);
+  onCoordinationCommandTimeout(const Interest& interest, int retryCount);
 
   void
   onCompleteCommand();
@@ -197,12 +275,124 @@ private:
   void
   onRegisterFailed(const Name& prefix, const std::string& reason);
 
+  /**
+   * @brief emit afterNodeRemoved for nodes present in @p oldKeySpaceFile but not in
+   *        m_keySpaceFile
+   */
+  void
+  notifyRemovedNodes(const std::string& oldKeySpaceFile);
+
+  /**
+   * @brief look for a hot range and shift its boundary, then schedule the next check
+   */
+  void
+  rebalance();
+
+  /**
+   * @brief hand buckets of a hot range over to its neighbour, which then pulls their
+   *        manifests through the usual coordination
+   */
+  void
+  shiftBoundary(const HotRangeDetector::Shift& shift);
+
+  /**
+   * @brief delay before the next try of a command that timed out
+   */
+  static ndn::time::milliseconds
+  getRetryDelay(int retryCount);
+
 public:
+  /**
+   * @brief the first node holding the manifest of @p hash that is not suspected, or the
+   *        owner if all of them are
+   */
   ndn::Name
   getManifestStorage(const std::string hash);
 
+  /**
+   * @brief nodes holding the manifest of @p hash
+   *
+   * The owner of @p hash comes first, followed by the nodes owning the next ranges on the
+   * ring, up to the replication factor. Suspected nodes are moved to the end.
+   */
+  std::vector<ndn::Name>
+  getManifestStorages(const std::string& hash);
+
+  /**
+   * @brief owner of @p digest, which keeps its content index entry; not replicated
+   * @return empty if the keyspace is not known yet
+   */
+  ndn::Name
+  getContentStorage(const std::string& digest) const;
+
+  /**
+   * @brief nodes of the keyspace in ring order
+   */
+  std::vector<ndn::Name>
+  getNodes() const;
+
+  /**
+   * @return whether this node is part of the keyspace
+   */
+  bool
+  isMember() const;
+
+  /**
+   * @brief hash ranges whose manifests @p node holds, as its own or as a replica
+   */
+  std::vector<std::pair<int, int>>
+  getReplicaRanges(const ndn::Name& node) const;
+
+  size_t
+  getReplicationFactor() const
+  {
+    return m_replicationFactor;
+  }
+
+  using LivenessCheck = std::function<bool(const ndn::Name&)>;
+
+  /**
+   * @brief set how to tell whether a node is reachable; all nodes are by default
+   */
+  void
+  setLivenessCheck(const LivenessCheck& isAlive)
+  {
+    m_isAlive = isAlive;
+  }
+
+  bool
+  isAlive(const ndn::Name& node) const
+  {
+    return !m_isAlive || m_isAlive(node);
+  }
+
+  /**
+   * @brief resend the commands that were given up while @p node was suspected
+   */
+  void
+  onNodeRecovered(const ndn::Name& node);
+
+  using RequestRateSource = std::function<HotRangeDetector::Rates()>;
+
+  /**
+   * @brief on the manager, shift the boundaries of hot ranges every @p interval
+   * @param requestRates manifest requests per second of every bucket over the cluster
+   * @param hotRatio how much busier than the average of the others a range must be
+   */
+  void
+  startRebalancing(const RequestRateSource& requestRates, ndn::time::milliseconds interval,
+                   double hotRatio);
+
+public:
+  /**
+   * @brief emitted when a node leaves the keyspace, before its data is moved elsewhere
+   */
+  ndn::util::Signal<KeySpaceHandle, ndn::Name> afterNodeRemoved;
+
 private:
-  std::map<ProcessId, ProcessInfo> m_processes;
+  Validator& m_validator;
+
+  ProcessTable<ProcessInfo> m_processes;
 
   uint64_t m_versionNum;
   int m_credit;
@@ -215,8 +405,33 @@ private:
   std::string m_clusterType;
   int m_start, m_end;
   std::string m_from, m_to;
+  int m_handoverStart, m_handoverEnd;  ///< buckets moving from m_from to m_to
   ndn::Name m_repoPrefix;
-  std::string m_version, m_keySpaceFile, m_manifestList;
+  std::string m_version, m_keySpaceFile;
+  std::vector<KeySpaceRange> m_ring;  ///< ranges ordered by start
+  size_t m_replicationFactor;
+  LivenessCheck m_isAlive;
+
+  std::set<ndn::Name> m_pendingVersionNodes;  ///< nodes that did not acknowledge m_version
+  std::string m_pendingFetchVersion;          ///< version still to fetch from the manager
+  bool m_isCoordinationPending;
+
+  RequestRateSource m_requestRates;
+  ndn::time::milliseconds m_rebalanceInterval;
+  double m_hotRangeRatio;
+  ndn::scheduler::ScopedEventId m_rebalanceEvent;
+  bool m_isRebalancePending;  ///< a shift waits for the complete command
+  ndn::time::steady_clock::TimePoint m_rebalanceStarted;
+
+  std::vector<std::string> m_migratedManifests;  ///< manifests copied from m_from
+  std::vector<std::string> m_manifestBatch;
+  std::queue<std::vector<std::string>> m_manifestBatchQueue;
+  size_t m_pendingManifestBatches;
+  bool m_manifestListReceived;
+  bool m_manifestListDone;
+  int m_manifestListRetry;
+  std::string m_manifestListCursor;  ///< last key of the previous page
+  std::string m_manifestListNext;    ///< last key of the current page, if more follow
 };
 
 }
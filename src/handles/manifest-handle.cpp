@@ -25,6 +25,9 @@
 #include "manifest/manifest.hpp"
 #include "util.hpp"
 
+#include <boost/property_tree/json_parser.hpp>
+
+#include <algorithm>
 #include <iostream>
 
 namespace repo {
@@ -35,8 +38,11 @@ static const int DEFAULT_CREDIT = 12;
 static const bool DEFAULT_CANBE_PREFIX = false;
 static const milliseconds MAX_TIMEOUT(60_s);
 static const milliseconds NOEND_TIMEOUT(10000_ms);
-static const milliseconds PROCESS_DELETE_TIME(10000_ms);
+static const milliseconds PROCESS_TICK(1000_ms);
+static const uint64_t PROCESS_DELETE_TICKS = 10;
 static const milliseconds DEFAULT_INTEREST_LIFETIME(4000_ms);
+static const size_t MAX_BATCH_MANIFESTS = 1024;
+static const char* CONTENT_RECORD_PREFIX = "content-";
 
 ManifestHandle::ManifestHandle(Face& face, RepoStorage& storageHandle, ndn::mgmt::Dispatcher& dispatcher,
                          Scheduler& scheduler, Validator& validator,
@@ -64,6 +70,32 @@ ManifestHandle::ManifestHandle(Face& face, RepoStorage& storageHandle, ndn::mgmt
                            std::bind(&ManifestHandle::handleFindCommand, this, _1, _2),
                            std::bind(&ManifestHandle::onRegisterFailed, this, _1, _2));
 
+  ndn::InterestFilter filterFindBatch = Name(m_repoPrefix).append("find-batch");
+  NDN_LOG_DEBUG(m_repoPrefix << " Listening " << filterFindBatch);
+  face.setInterestFilter(filterFindBatch,
+                           std::bind(&ManifestHandle::handleFindBatchCommand, this, _1, _2),
+                           std::bind(&ManifestHandle::onRegisterFailed, this, _1, _2));
+
+  ndn::InterestFilter filterContentFind = Name(m_repoPrefix).append("content-find");
+  face.setInterestFilter(filterContentFind,
+                           std::bind(&ManifestHandle::handleContentFindCommand, this, _1, _2),
+                           std::bind(&ManifestHandle::onRegisterFailed, this, _1, _2));
+
+  ndn::InterestFilter filterContentRef = Name(m_repoPrefix).append("content-ref");
+  face.setInterestFilter(filterContentRef,
+                           std::bind(&ManifestHandle::handleContentRefCommand, this, _1, _2),
+                           std::bind(&ManifestHandle::onRegisterFailed, this, _1, _2));
+
+  ndn::InterestFilter filterContentRegister = Name(m_repoPrefix).append("content-register");
+  face.setInterestFilter(filterContentRegister,
+                           std::bind(&ManifestHandle::handleContentRegisterCommand, this, _1, _2),
+                           std::bind(&ManifestHandle::onRegisterFailed, this, _1, _2));
+
+  ndn::InterestFilter filterContentRelease = Name(m_repoPrefix).append("content-release");
+  face.setInterestFilter(filterContentRelease,
+                           std::bind(&ManifestHandle::handleContentReleaseCommand, this, _1, _2),
+                           std::bind(&ManifestHandle::onRegisterFailed, this, _1, _2));
+
   // dispatcher.addControlCommand<RepoCommandParameter>(
   //   ndn::PartialName(clusterPrefix).append("create"),
   //   makeAuthorization(),
@@ -75,12 +107,15 @@ ManifestHandle::ManifestHandle(Face& face, RepoStorage& storageHandle, ndn::mgmt
   //   makeAuthorization(),
   //   std::bind(&ManifestHandle::validateParameters<FindCommand>, this, _1),
   //   std::bind(&ManifestHandle::handleFindCommand, this, _1, _2, _3, _4));
+
+  m_expiryEvent = scheduler.schedule(PROCESS_TICK, [this] { expireProcesses(); });
 }
 
 void
-ManifestHandle::deleteProcess(ProcessId processId)
+ManifestHandle::expireProcesses()
 {
-  m_processes.erase(processId);
+  m_processes.advance();
+  m_expiryEvent = scheduler.schedule(PROCESS_TICK, [this] { expireProcesses(); });
 }
 
 void
@@ -96,6 +131,25 @@ ManifestHandle::handleCreateCommand(const Name& prefix, const Interest& interest
 
   NDN_LOG_DEBUG("Got create hash " << hash << " from " << clusterNodePrefix);
 
+  // small manifests come with the command, which saves the write-info round trip
+  if (repoParameter.hasManifest()) {
+    try {
+      auto manifest = Manifest::fromJson(repoParameter.getManifest());
+      if (Name(manifest.getHash()) != hash) {
+        negativeReply(interest, "Manifest does not match its hash", 403);
+        return;
+      }
+      storageHandle.insertManifest(manifest);
+    }
+    catch (const std::exception& e) {
+      NDN_LOG_ERROR("Malformed manifest in create: " << e.what());
+      negativeReply(interest, "Malformed manifest", 403);
+      return;
+    }
+    negativeReply(interest, "", 200);
+    return;
+  }
+
   ProcessId processId = repoParameter.getProcessId();
 
   ProcessInfo& process = m_processes[processId];
@@ -192,6 +246,7 @@ ManifestHandle::handleFindCommand(const Name& prefix, const Interest& interest)
   auto hash = repoParameter.getName().toUri();
   hash = hash.substr(1, hash.length() - 1);  // Remove prepended /
   NDN_LOG_DEBUG("Got find interest " << hash);
+  afterManifestRequested(hash);
   auto manifest = storageHandle.readManifest(hash);
   if (manifest != nullptr) {
     auto json = manifest->toJson();
@@ -202,6 +257,222 @@ ManifestHandle::handleFindCommand(const Name& prefix, const Interest& interest)
   }
 }
 
+void
+ManifestHandle::handleFindBatchCommand(const Name& prefix, const Interest& interest)
+{
+  namespace pt = boost::property_tree;
+
+  if (replyFromDataset(interest)) {
+    return;
+  }
+
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  } catch (RepoCommandParameter::Error&) {
+    negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+
+  std::vector<std::string> hashes;
+  pt::ptree trailer;
+
+  if (repoParameter.hasStartBlockId() && repoParameter.hasEndBlockId()) {
+    int start = std::max<int>(repoParameter.getStartBlockId(), 0);
+    int end = repoParameter.getEndBlockId();
+    std::string after = util::getBucketPrefix(start);
+    if (repoParameter.hasName() && !repoParameter.getName().empty()) {
+      after = std::max(after, repoParameter.getName().get(0).toUri());
+    }
+
+    // keys sort by bucket, so a page is read in order starting from the continuation key
+    for (const auto& hash : storageHandle.readManifestKeys(after, MAX_BATCH_MANIFESTS + 1)) {
+      if (util::getHashBucket(hash) > end) {
+        break;
+      }
+      hashes.push_back(hash);
+    }
+
+    if (hashes.size() > MAX_BATCH_MANIFESTS) {
+      hashes.resize(MAX_BATCH_MANIFESTS);
+      trailer.put("next", hashes.back());
+    }
+  }
+  else if (repoParameter.hasName()) {
+    for (const auto& component : repoParameter.getName()) {
+      hashes.push_back(component.toUri());
+      afterManifestRequested(hashes.back());
+    }
+  }
+  else {
+    negativeReply(interest, "Name or keyspace range required", 403);
+    return;
+  }
+
+  pt::ptree manifests;
+  for (const auto& hash : hashes) {
+    auto manifest = storageHandle.readManifest(hash);
+    if (manifest != nullptr) {
+      manifests.push_back(std::make_pair("", manifest->toPtree()));
+    }
+  }
+  NDN_LOG_DEBUG("Got find-batch interest for " << hashes.size() << " hashes, found " << manifests.size());
+
+  replySegmented(interest, util::segmentJsonArray("manifests", manifests, trailer));
+}
+
+void
+ManifestHandle::handleContentFindCommand(const Name& prefix, const Interest& interest)
+{
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  } catch (RepoCommandParameter::Error&) {
+    negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+  if (!repoParameter.hasName() || repoParameter.getName().size() != 1) {
+    negativeReply(interest, "Digest required", 403);
+    return;
+  }
+
+  auto record = readContentRecord(repoParameter.getName().get(0).toUri());
+  if (record == nullptr) {
+    reply(interest, "");
+    return;
+  }
+
+  std::stringstream os;
+  boost::property_tree::write_json(os, record->getManifest(), false);
+  reply(interest, os.str());
+}
+
+void
+ManifestHandle::handleContentRefCommand(const Name& prefix, const Interest& interest)
+{
+  addContentRef(prefix, interest, false);
+}
+
+void
+ManifestHandle::handleContentRegisterCommand(const Name& prefix, const Interest& interest)
+{
+  // the record vouches for the segments of every later insert with the same digest, so only
+  // a node of the cluster, which hashed the segments it stored, may create one
+  m_validator.validate(interest,
+    [this, prefix] (const Interest& interest) {
+      addContentRef(prefix, interest, true);
+    },
+    [this] (const Interest& interest, const ValidationError& error) {
+      NDN_LOG_ERROR("Content register " << interest.getName() << " rejected: " << error);
+      negativeReply(interest, "Unauthorized", 401);
+    });
+}
+
+void
+ManifestHandle::addContentRef(const Name& prefix, const Interest& interest, bool canCreate)
+{
+  namespace pt = boost::property_tree;
+
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  } catch (RepoCommandParameter::Error&) {
+    negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+  if (!repoParameter.hasName() || repoParameter.getName().size() != 2 || !repoParameter.hasManifest()) {
+    negativeReply(interest, "Digest, key and manifest required", 403);
+    return;
+  }
+
+  std::string digest = repoParameter.getName().get(0).toUri();
+  std::string key = repoParameter.getName().get(1).toUri();
+
+  pt::ptree manifest;
+  auto record = readContentRecord(digest);
+  if (record == nullptr && !canCreate) {
+    negativeReply(interest, "No such content", 404);
+    return;
+  }
+  try {
+    std::istringstream is(repoParameter.getManifest());
+    pt::read_json(is, manifest);
+    if (record == nullptr) {
+      record = std::make_shared<ContentRecord>(manifest);
+    }
+  }
+  catch (const std::exception& e) {
+    NDN_LOG_ERROR("Malformed manifest in content-ref: " << e.what());
+    negativeReply(interest, "Malformed manifest", 403);
+    return;
+  }
+
+  if (!record->addRef(manifest.get<std::string>("info.name", ""), key)) {
+    NDN_LOG_DEBUG("Content " << digest << " is already stored as " << record->getName());
+    negativeReply(interest, "Content is stored under another name", 409);
+    return;
+  }
+  storageHandle.writeRecord(CONTENT_RECORD_PREFIX + digest, record->toJson());
+
+  NDN_LOG_DEBUG("Content " << digest << " used by " << record->getRefCount() << " keys");
+  negativeReply(interest, "", 200);
+}
+
+void
+ManifestHandle::handleContentReleaseCommand(const Name& prefix, const Interest& interest)
+{
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  } catch (RepoCommandParameter::Error&) {
+    negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+  if (!repoParameter.hasName() || repoParameter.getName().size() != 2) {
+    negativeReply(interest, "Digest and key required", 403);
+    return;
+  }
+
+  std::string digest = repoParameter.getName().get(0).toUri();
+  std::string key = repoParameter.getName().get(1).toUri();
+
+  auto record = readContentRecord(digest);
+  if (record == nullptr || !record->release(key)) {
+    negativeReply(interest, "Not a reference of the content", 404);
+    return;
+  }
+
+  if (record->getRefCount() == 0) {
+    storageHandle.eraseRecord(CONTENT_RECORD_PREFIX + digest);
+  }
+  else {
+    storageHandle.writeRecord(CONTENT_RECORD_PREFIX + digest, record->toJson());
+  }
+
+  NDN_LOG_DEBUG("Content " << digest << " released by " << key << ", "
+                << record->getRefCount() << " keys left");
+  RepoCommandResponse response(200, "");
+  response.setDeleteNum(record->getRefCount());
+  reply(interest, response);
+}
+
+std::shared_ptr<ContentRecord>
+ManifestHandle::readContentRecord(const std::string& digest)
+{
+  std::string json = storageHandle.readRecord(CONTENT_RECORD_PREFIX + digest);
+  if (json.empty()) {
+    return nullptr;
+  }
+
+  try {
+    return std::make_shared<ContentRecord>(ContentRecord::fromJson(json));
+  }
+  catch (const std::exception& e) {
+    NDN_LOG_ERROR("Content record " << digest << " is malformed, ignored: " << e.what());
+    return nullptr;
+  }
+}
+
 void
 ManifestHandle::onRegisterFailed(const Name& prefix, const std::string& reason)
 {
@@ -212,7 +483,7 @@ ManifestHandle::onRegisterFailed(const Name& prefix, const std::string& reason)
 void
 ManifestHandle::deferredDeleteProcess(ProcessId processId)
 {
-  scheduler.schedule(PROCESS_DELETE_TIME, [=] { deleteProcess(processId); });
+  m_processes.expireAfter(processId, PROCESS_DELETE_TICKS);
 }
 
 void
@@ -21,11 +21,13 @@
 #define REPO_HANDLES_MANIFEST_HANDLE_HPP
 
 #include "command-base-handle.hpp"
+#include "process-table.hpp"
+#include "../manifest/content-record.hpp"
 
 #include <ndn-cxx/mgmt/dispatcher.hpp>
 #include <ndn-cxx/util/hc-segment-fetcher.hpp>
+#include <ndn-cxx/util/signal.hpp>
 
-#include <queue>
 
 namespace repo {
 
@@ -49,6 +51,12 @@ namespace repo {
  * If client sends a insert check command, the noendTimeout timer will be set to 0.
  *
  * If repo cannot get FinalBlockId in noendTimeout time, the fetching process will terminate.
+ *
+ * The node that owns a whole-file digest in the keyspace also keeps its ContentRecord.
+ * content-find returns the manifest of the copy already stored, content-register indexes a
+ * copy, content-ref adds the key of a manifest that uses those segments, and content-release
+ * removes it and tells how many keys are left, so that the segments are deleted with the
+ * last one.
  */
 class ManifestHandle : public CommandBaseHandle
 {
@@ -71,6 +79,12 @@ public:
               Validator& validator,
               ndn::Name const& clusterNodePrefix, std::string clusterPrefix);
 
+public:
+  /**
+   * @brief emitted with the hash of every manifest looked up by find or find-batch
+   */
+  ndn::util::Signal<ManifestHandle, std::string> afterManifestRequested;
+
 private:
   /**
   * @brief Information of insert process including variables for response
@@ -79,11 +93,6 @@ private:
   struct ProcessInfo
   {
     RepoCommandResponse response;
-    std::queue<SegmentNo> nextSegmentQueue;  ///< queue of waiting segment
-                                        ///  to be sent when having credits
-    SegmentNo nextSegment;  ///< last segment put into the nextSegmentQueue
-    std::map<SegmentNo, int> retryCounts;  ///< to store retrying times of timeout segment
-    int credit;  ///< congestion control credits of process
 
     /**
      * @brief the latest time point at which EndBlockId must be determined
@@ -163,6 +172,56 @@ private: // insert state check command
   void
   handleFindCommand(const Name& prefix, const Interest& interest);
 
+  /**
+   * @brief handle batched find commands
+   *
+   * Name carries one manifest hash per component. Alternatively, StartBlockId and
+   * EndBlockId select a keyspace range (0x00 ~ 0xff); Name then optionally carries the
+   * last hash of a previous reply as cursor. The reply is a segmented dataset of manifests;
+   * if a range reply is truncated, its last segment carries the cursor to continue from.
+   */
+  void
+  handleFindBatchCommand(const Name& prefix, const Interest& interest);
+
+private: // content index
+  /**
+   * @brief reply with the manifest of the content whose digest is Name, or empty
+   */
+  void
+  handleContentFindCommand(const Name& prefix, const Interest& interest);
+
+  /**
+   * @brief Name is /<digest>/<key>, Manifest the manifest of the shared copy
+   *
+   * Only adds a reference to a record that exists; replies 404 otherwise.
+   */
+  void
+  handleContentRefCommand(const Name& prefix, const Interest& interest);
+
+  /**
+   * @brief like content-ref, but may create the record; the command Interest must validate
+   *
+   * Sent by the node that stored the content once it checked the digest. Replies 409 if the
+   * content is already indexed under another name, in which case the copy keeps its own
+   * segments.
+   */
+  void
+  handleContentRegisterCommand(const Name& prefix, const Interest& interest);
+
+  void
+  addContentRef(const Name& prefix, const Interest& interest, bool canCreate);
+
+  /**
+   * @brief Name is /<digest>/<key>; DeleteNum of the reply is the count of keys left
+   *
+   * Replies 404 if @p key was not a reference, then the segments are not shared.
+   */
+  void
+  handleContentReleaseCommand(const Name& prefix, const Interest& interest);
+
+  std::shared_ptr<ContentRecord>
+  readContentRecord(const std::string& digest);
+
   void
   onRegisterFailed(const Name& prefix, const std::string& reason);
 
@@ -170,11 +229,14 @@ private: // insert state check command
   onCheckValidationFailed(const Interest& interest, const ValidationError& error);
 
 private:
+  /**
+   * @brief erase the processes whose time is up, once per tick
+   */
   void
-  deleteProcess(ProcessId processId);
+  expireProcesses();
 
   /**
-   * @brief schedule a event to delete the process
+   * @brief erase the process a few seconds from now, once its final status could be read
    */
   void
   deferredDeleteProcess(ProcessId processId);
@@ -186,7 +248,8 @@ private:
 private:
   Validator& m_validator;
 
-  std::map<ProcessId, ProcessInfo> m_processes;
+  ProcessTable<ProcessInfo> m_processes;
+  ndn::scheduler::ScopedEventId m_expiryEvent;
 
   int m_credit;
   bool m_canBePrefix;
@@ -0,0 +1,139 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "membership-handle.hpp"
+
+#include <ndn-cxx/util/logger.hpp>
+
+#include <algorithm>
+
+namespace repo {
+
+NDN_LOG_INIT(repo.MembershipHandle);
+
+MembershipHandle::MembershipHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle,
+                                   Scheduler& scheduler, Validator& validator,
+                                   ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+                                   ndn::time::milliseconds heartbeatInterval, double phiThreshold)
+  : CommandBaseHandle(face, storageHandle, scheduler, validator)
+  , m_keySpaceHandle(keySpaceHandle)
+  , m_heartbeatInterval(heartbeatInterval)
+  , m_phiThreshold(phiThreshold)
+  , m_repoPrefix(Name(clusterNodePrefix).append(clusterPrefix))
+{
+  ndn::InterestFilter filterHeartbeat = Name(m_repoPrefix).append("heartbeat");
+  face.setInterestFilter(filterHeartbeat,
+                           std::bind(&MembershipHandle::handleHeartbeatCommand, this, _1, _2),
+                           std::bind(&MembershipHandle::onRegisterFailed, this, _1, _2));
+
+  m_heartbeatEvent = scheduler.schedule(m_heartbeatInterval, [this] { sendHeartbeats(); });
+}
+
+bool
+MembershipHandle::isSuspected(const Name& node) const
+{
+  auto it = m_members.find(node);
+  if (it == m_members.end()) {
+    return false;
+  }
+  // checked here as well, so that routing does not wait for the next round of heartbeats
+  return it->second.isSuspected ||
+         it->second.detector.phi(ndn::time::steady_clock::now()) > m_phiThreshold;
+}
+
+void
+MembershipHandle::handleHeartbeatCommand(const Name& prefix, const Interest& interest)
+{
+  negativeReply(interest, "", 200);
+}
+
+void
+MembershipHandle::sendHeartbeats()
+{
+  auto now = ndn::time::steady_clock::now();
+  auto nodes = m_keySpaceHandle.getNodes();
+
+  // forget nodes that left the keyspace
+  for (auto it = m_members.begin(); it != m_members.end();) {
+    if (std::find(nodes.begin(), nodes.end(), it->first) == nodes.end()) {
+      it = m_members.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+
+  for (const auto& node : nodes) {
+    if (node == m_repoPrefix) {
+      continue;
+    }
+
+    auto it = m_members.find(node);
+    if (it == m_members.end()) {
+      // a new member starts its clock now, so that a node that never answers is suspected too
+      it = m_members.emplace(node, Member(m_heartbeatInterval)).first;
+      it->second.detector.heartbeat(now);
+    }
+
+    Member& member = it->second;
+    if (!member.isSuspected && member.detector.phi(now) > m_phiThreshold) {
+      NDN_LOG_INFO("Node " << node << " suspected");
+      member.isSuspected = true;
+      afterNodeSuspected(node);
+    }
+
+    Interest interest(Name(node).append("heartbeat"));
+    interest.setCanBePrefix(false);
+    interest.setMustBeFresh(true);
+    interest.setInterestLifetime(m_heartbeatInterval);
+
+    face.expressInterest(interest,
+                         std::bind(&MembershipHandle::onHeartbeatResponse, this, node),
+                         [] (const Interest&, const ndn::lp::Nack&) {},
+                         [] (const Interest&) {});
+  }
+
+  m_heartbeatEvent = scheduler.schedule(m_heartbeatInterval, [this] { sendHeartbeats(); });
+}
+
+void
+MembershipHandle::onHeartbeatResponse(const Name& node)
+{
+  auto it = m_members.find(node);
+  if (it == m_members.end()) {
+    return;
+  }
+
+  Member& member = it->second;
+  member.detector.heartbeat(ndn::time::steady_clock::now());
+  if (member.isSuspected) {
+    NDN_LOG_INFO("Node " << node << " recovered");
+    member.isSuspected = false;
+    afterNodeRecovered(node);
+  }
+}
+
+void
+MembershipHandle::onRegisterFailed(const Name& prefix, const std::string& reason)
+{
+  NDN_LOG_ERROR("ERROR: Failed to register prefix in local hub's daemon");
+  face.shutdown();
+}
+
+} // namespace repo
@@ -0,0 +1,115 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_HANDLES_MEMBERSHIP_HANDLE_HPP
+#define REPO_HANDLES_MEMBERSHIP_HANDLE_HPP
+
+#include "command-base-handle.hpp"
+#include "keyspace-handle.hpp"
+#include "../membership/phi-accrual-detector.hpp"
+
+#include <ndn-cxx/util/signal.hpp>
+
+namespace repo {
+
+/**
+ * @brief MembershipHandle tells which nodes of the keyspace are reachable.
+ *
+ * Every node answers `heartbeat` and sends one to each other node of the keyspace every
+ * heartbeat interval. The answers feed one PhiAccrualDetector per node, and a node is
+ * suspected once its phi goes above the threshold, typically after a couple of missed
+ * heartbeats instead of a chain of command timeouts. A suspected node is cleared by its next
+ * answer.
+ */
+class MembershipHandle : public CommandBaseHandle
+{
+public:
+  class Error : public CommandBaseHandle::Error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : CommandBaseHandle::Error(what)
+    {
+    }
+  };
+
+public:
+  MembershipHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle,
+                   Scheduler& scheduler, Validator& validator,
+                   ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+                   ndn::time::milliseconds heartbeatInterval, double phiThreshold);
+
+  /**
+   * @return whether @p node missed too many heartbeats; never true for this node
+   */
+  bool
+  isSuspected(const Name& node) const;
+
+public:
+  ndn::util::Signal<MembershipHandle, ndn::Name> afterNodeSuspected;
+
+  /**
+   * @brief emitted when a suspected node answers again
+   */
+  ndn::util::Signal<MembershipHandle, ndn::Name> afterNodeRecovered;
+
+private:
+  struct Member
+  {
+    explicit
+    Member(ndn::time::milliseconds heartbeatInterval)
+      : detector(heartbeatInterval)
+    {
+    }
+
+    PhiAccrualDetector detector;
+    bool isSuspected = false;
+  };
+
+private:
+  void
+  handleHeartbeatCommand(const Name& prefix, const Interest& interest);
+
+  /**
+   * @brief send a heartbeat to every other node and update suspicions
+   */
+  void
+  sendHeartbeats();
+
+  void
+  onHeartbeatResponse(const Name& node);
+
+  void
+  onRegisterFailed(const Name& prefix, const std::string& reason);
+
+private:
+  KeySpaceHandle& m_keySpaceHandle;
+  std::map<Name, Member> m_members;
+
+  ndn::time::milliseconds m_heartbeatInterval;
+  double m_phiThreshold;
+  ndn::scheduler::ScopedEventId m_heartbeatEvent;
+
+  ndn::Name m_repoPrefix;
+};
+
+} // namespace repo
+
+#endif // REPO_HANDLES_MEMBERSHIP_HANDLE_HPP
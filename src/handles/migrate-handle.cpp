@@ -0,0 +1,610 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "migrate-handle.hpp"
+#include "../manifest/manifest.hpp"
+#include "../util.hpp"
+
+#include <ndn-cxx/util/logger.hpp>
+#include <ndn-cxx/util/random.hpp>
+
+namespace repo {
+
+NDN_LOG_INIT(repo.MigrateHandle);
+
+static const milliseconds DEFAULT_INTEREST_LIFETIME(4000_ms);
+static const int MAX_RETRY = 3;
+static const size_t DRAIN_PAGE = 256;                 // manifests scanned per turn of the io thread
+static const int MAX_RANGE_ATTEMPTS = 5;              // copies of a range before it is given up on
+static const milliseconds RANGE_RETRY_DELAY(30_s);    // times the attempts made so far
+
+MigrateHandle::MigrateHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle,
+                             Scheduler& scheduler, Validator& validator,
+                             ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+                             size_t window, uint64_t maxRate)
+  : CommandBaseHandle(face, storageHandle, scheduler, validator)
+  , m_validator(validator)
+  , m_keySpaceHandle(keySpaceHandle)
+  , m_runningProcess(0)
+  , m_isRunning(false)
+  , m_window(std::max<size_t>(window, 1))
+  , m_sendInterval(maxRate > 0 ? ndn::time::nanoseconds(1_s) / maxRate : ndn::time::nanoseconds::zero())
+  , m_isPacing(false)
+  , m_interestLifetime(DEFAULT_INTEREST_LIFETIME)
+  , m_repoPrefix(Name(clusterNodePrefix).append(clusterPrefix))
+{
+  ndn::InterestFilter filterMigrate = Name(m_repoPrefix).append("migrate");
+  NDN_LOG_DEBUG(m_repoPrefix << " Listening " << filterMigrate);
+  face.setInterestFilter(filterMigrate,
+                           std::bind(&MigrateHandle::handleMigrateCommand, this, _1, _2),
+                           std::bind(&MigrateHandle::onRegisterFailed, this, _1, _2));
+
+  m_afterNodeRemovedConnection = m_keySpaceHandle.afterNodeRemoved.connect(
+    [this] (const Name& node) {
+      drain(node);
+    });
+}
+
+void
+MigrateHandle::handleMigrateCommand(const Name& prefix, const Interest& interest)
+{
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  }
+  catch (const RepoCommandParameter::Error&) {
+    negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+
+  if (!repoParameter.hasFrom()) {
+    negativeReply(interest, "From is required", 403);
+    return;
+  }
+
+  std::string from(reinterpret_cast<const char*>(repoParameter.getFrom().value()),
+                   repoParameter.getFrom().value_size());
+
+  negativeReply(interest, "", 200);
+  drain(Name(from));
+}
+
+void
+MigrateHandle::drain(const Name& node)
+{
+  if (node == m_repoPrefix) {
+    return;
+  }
+  for (const auto& drain : m_drains) {
+    if (drain.node == node) {
+      return;
+    }
+  }
+
+  NDN_LOG_DEBUG("Drain " << node);
+  m_drains.push_back({node, ""});
+  if (!m_isRunning) {
+    startNextProcess();
+  }
+}
+
+size_t
+MigrateHandle::queueNextPage()
+{
+  Drain& drain = m_drains.front();
+  auto keys = storageHandle.readManifestKeys(drain.cursor, DRAIN_PAGE);
+
+  size_t nRanges = 0;
+  for (const auto& hash : keys) {
+    auto storages = m_keySpaceHandle.getManifestStorages(hash);
+    if (storages.empty() || storages.front() != m_repoPrefix) {
+      continue;
+    }
+    auto manifest = storageHandle.readManifest(hash);
+    if (manifest == nullptr) {
+      continue;
+    }
+
+    int index = -1;
+    for (const auto& repo : manifest->getRepos()) {
+      ++index;
+      if (Name(repo.name) != drain.node) {
+        continue;
+      }
+
+      ProcessId processId = ndn::random::generateWord64();
+      ProcessInfo& process = m_processes[processId];
+      process.hash = hash;
+      process.node = drain.node;
+      process.name = Name(manifest->getName());
+      if (manifest->isErasureCoded()) {
+        int k = manifest->getDataFragments();
+        if (index < k)
+          process.stride = k;
+        else
+          process.name = manifest->getParityName(index - k);
+      }
+      process.startBlockId = repo.start;
+      process.endBlockId = repo.end;
+      process.nextSegment = repo.start;
+      process.isChained = !manifest->isErasureCoded();
+      for (const auto& previous : manifest->getRepos()) {
+        if (previous.start < repo.start && previous.end + 1 >= repo.start) {
+          process.anchorNode = Name(previous.name);
+        }
+      }
+
+      m_waitingProcesses.push(processId);
+      ++nRanges;
+    }
+  }
+
+  NDN_LOG_DEBUG("Drain " << drain.node << ": " << nRanges << " segment ranges to copy in "
+                << keys.size() << " manifests after " << drain.cursor);
+  if (keys.size() < DRAIN_PAGE) {
+    NDN_LOG_DEBUG("Drain " << drain.node << ": all manifests scanned");
+    m_drains.pop_front();
+  }
+  else {
+    drain.cursor = keys.back();
+  }
+  return nRanges;
+}
+
+void
+MigrateHandle::startNextProcess()
+{
+  m_isRunning = false;
+  if (m_waitingProcesses.empty() && !m_drains.empty()) {
+    // one page of manifests per turn of the io thread, so that reads and writes go on
+    m_isRunning = true;
+    queueNextPage();
+    scheduler.schedule(0_ms, [this] { startNextProcess(); });
+    return;
+  }
+
+  while (!m_waitingProcesses.empty()) {
+    ProcessId processId = m_waitingProcesses.front();
+    m_waitingProcesses.pop();
+
+    if (m_processes.count(processId) > 0) {
+      m_isRunning = true;
+      m_runningProcess = processId;
+      // segment 0 is signed with a key and anchors the chain itself
+      if (m_processes[processId].isChained && m_processes[processId].startBlockId > 0) {
+        fetchAnchor(processId);
+      }
+      else {
+        sendInterests(processId);
+      }
+      return;
+    }
+  }
+}
+
+void
+MigrateHandle::fetchAnchor(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  Interest interest(Name(process.name).appendSegment(process.startBlockId - 1));
+
+  auto data = storageHandle.readData(interest);
+  if (data != nullptr) {
+    // checked when it was stored here
+    process.hashChain.setAnchor(process.startBlockId, util::getNextHash(*data));
+    sendInterests(processId);
+    return;
+  }
+  if (process.anchorNode.empty()) {
+    NDN_LOG_ERROR("No node stores the segment before " << process.name << " [" << process.startBlockId
+                  << ", " << process.endBlockId << "]");
+    process.isFailed = true;
+    checkProcess(processId);
+    return;
+  }
+
+  interest.setCanBePrefix(false);
+  interest.setInterestLifetime(m_interestLifetime);
+  ndn::Delegation delegation;
+  delegation.name = process.anchorNode;
+  interest.setForwardingHint(ndn::DelegationList{delegation});
+
+  auto onFailure = [this, processId] (const Interest& interest) {
+    auto it = m_processes.find(processId);
+    if (it == m_processes.end()) {
+      return;
+    }
+    NDN_LOG_ERROR("Cannot fetch " << interest.getName() << " to anchor the copy");
+    it->second.isFailed = true;
+    checkProcess(processId);
+  };
+  face.expressInterest(interest,
+                       std::bind(&MigrateHandle::onAnchorData, this, _2, processId),
+                       std::bind(onFailure, _1), // Nack
+                       onFailure);
+}
+
+void
+MigrateHandle::onAnchorData(const Data& data, ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  auto setAnchor = [this, processId] (const Data& data) {
+    auto it = m_processes.find(processId);
+    if (it == m_processes.end()) {
+      return;
+    }
+    it->second.hashChain.setAnchor(it->second.startBlockId, util::getNextHash(data));
+    sendInterests(processId);
+  };
+  if (data.getSignature().getType() == ndn::tlv::DigestSha256) {
+    // the node of the range before stored this segment only once the chain reached it
+    setAnchor(data);
+    return;
+  }
+
+  m_validator.validate(data, setAnchor,
+                       [this, processId] (const Data& data, const ValidationError& error) {
+                         auto it = m_processes.find(processId);
+                         if (it == m_processes.end()) {
+                           return;
+                         }
+                         NDN_LOG_ERROR("Anchor " << data.getName() << " is not valid: " << error);
+                         it->second.isFailed = true;
+                         checkProcess(processId);
+                       });
+}
+
+void
+MigrateHandle::sendInterests(ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  while (!process.isFailed && process.nInFlight < m_window && process.nextSegment <= process.endBlockId) {
+    if (m_sendInterval > ndn::time::nanoseconds::zero()) {
+      auto now = ndn::time::steady_clock::now();
+      if (now < m_nextSendTime) {
+        if (!m_isPacing) {
+          m_isPacing = true;
+          scheduler.schedule(m_nextSendTime - now, [this, processId] {
+            m_isPacing = false;
+            sendInterests(processId);
+          });
+        }
+        return;
+      }
+      m_nextSendTime = now + m_sendInterval;
+    }
+
+    sendInterest(processId, process.nextSegment);
+    process.nextSegment += process.stride;
+  }
+}
+
+void
+MigrateHandle::sendInterest(ProcessId processId, SegmentNo segment)
+{
+  ProcessInfo& process = m_processes[processId];
+
+  Interest interest(Name(process.name).appendSegment(segment));
+  interest.setCanBePrefix(false);
+  interest.setMustBeFresh(false);
+  interest.setInterestLifetime(m_interestLifetime);
+
+  ndn::Delegation delegation;
+  delegation.name = process.node;
+  interest.setForwardingHint(ndn::DelegationList{delegation});
+
+  ++process.nInFlight;
+  face.expressInterest(interest,
+                       std::bind(&MigrateHandle::onData, this, _1, _2, processId),
+                       std::bind(&MigrateHandle::onTimeout, this, _1, processId), // Nack
+                       std::bind(&MigrateHandle::onTimeout, this, _1, processId));
+}
+
+void
+MigrateHandle::onData(const Interest& interest, const Data& data, ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  --process.nInFlight;
+
+  if (data.getName() != interest.getName()) {
+    NDN_LOG_ERROR("Cannot store " << interest.getName() << " copied from " << process.node);
+    process.isFailed = true;
+  }
+  else if (data.getSignature().getType() != ndn::tlv::DigestSha256) {
+    ++process.nArrived;
+    ++process.nValidating;
+    m_validator.validate(data,
+                         [this, processId] (const Data& data) {
+                           onSegmentValidated(data, processId, true);
+                         },
+                         [this, processId] (const Data& data, const ValidationError& error) {
+                           NDN_LOG_ERROR("Error: " << error);
+                           onSegmentValidated(data, processId, false);
+                         });
+  }
+  else if (!process.isChained) {
+    NDN_LOG_ERROR("Digest-signed " << data.getName() << " outside a hash chain");
+    process.isFailed = true;
+  }
+  else {
+    ++process.nArrived;
+    process.unverified.emplace(data.getName().get(-1).toSegment(), data);
+    verifyRuns(processId, process.hashChain.add(util::makeHashChainSegment(data)));
+  }
+
+  if (!checkProcess(processId)) {
+    sendInterests(processId);
+  }
+}
+
+void
+MigrateHandle::onSegmentValidated(const Data& data, ProcessId processId, bool isValid)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  --process.nValidating;
+  if (!isValid || !storageHandle.insertData(data)) {
+    NDN_LOG_ERROR("Cannot store " << data.getName() << " copied from " << process.node);
+    process.isFailed = true;
+  }
+  else {
+    ++process.nReceived;
+    std::vector<uint8_t> nextHash = util::getNextHash(data);
+    if (process.isChained && !nextHash.empty()) {
+      verifyRuns(processId, process.hashChain.setAnchor(data.getName().get(-1).toSegment() + 1,
+                                                        nextHash));
+    }
+  }
+
+  if (!checkProcess(processId)) {
+    sendInterests(processId);
+  }
+}
+
+void
+MigrateHandle::verifyRuns(ProcessId processId, std::vector<HashChainVerifier::Run> runs)
+{
+  ProcessInfo& process = m_processes[processId];
+  uint64_t nSegments = (process.endBlockId - process.startBlockId) / process.stride + 1;
+  if (process.nArrived >= nSegments) {
+    auto rest = process.hashChain.flush();
+    runs.insert(runs.end(), rest.begin(), rest.end());
+  }
+
+  // a few segments at a time, small enough to hash here
+  for (const auto& run : runs) {
+    auto isValid = HashChainVerifier::verify(run);
+    for (size_t i = 0; i < run.segments.size(); ++i) {
+      auto segment = process.unverified.find(run.segments[i].segmentNo);
+      if (segment == process.unverified.end()) {
+        continue;
+      }
+      if (!isValid[i] || !storageHandle.insertData(segment->second)) {
+        NDN_LOG_ERROR("Cannot store " << segment->second.getName() << " copied from " << process.node);
+        process.isFailed = true;
+      }
+      else {
+        ++process.nReceived;
+      }
+      process.unverified.erase(segment);
+    }
+  }
+}
+
+bool
+MigrateHandle::checkProcess(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  if (process.nInFlight > 0 || process.nValidating > 0 ||
+      (!process.isFailed && process.nextSegment <= process.endBlockId)) {
+    return false;
+  }
+
+  onProcessFinished(processId);
+  return true;
+}
+
+void
+MigrateHandle::onTimeout(const Interest& interest, ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  --process.nInFlight;
+
+  SegmentNo segment = interest.getName().get(-1).toSegment();
+  if (!process.isFailed && process.retryCounts[segment]++ < MAX_RETRY) {
+    NDN_LOG_DEBUG("Retry " << interest.getName());
+    sendInterest(processId, segment);
+    return;
+  }
+
+  process.isFailed = true;
+  checkProcess(processId);
+}
+
+void
+MigrateHandle::onProcessFinished(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+
+  uint64_t nSegments = (process.endBlockId - process.startBlockId) / process.stride + 1;
+  if (!process.isFailed && process.nReceived == nSegments) {
+    rewriteManifest(process);
+  }
+  else if (process.nAttempts + 1 < MAX_RANGE_ATTEMPTS) {
+    NDN_LOG_ERROR("Copy of " << process.name << " [" << process.startBlockId << ", "
+                  << process.endBlockId << "] from " << process.node << " failed after "
+                  << process.nReceived << "/" << nSegments << " segments, retry later");
+    retryProcess(process);
+  }
+  else {
+    NDN_LOG_ERROR("Copy of " << process.name << " [" << process.startBlockId << ", "
+                  << process.endBlockId << "] from " << process.node << " failed "
+                  << MAX_RANGE_ATTEMPTS << " times, manifest unchanged");
+  }
+
+  m_processes.erase(processId);
+  startNextProcess();
+}
+
+void
+MigrateHandle::retryProcess(const ProcessInfo& process)
+{
+  ProcessId processId = ndn::random::generateWord64();
+  ProcessInfo& retry = m_processes[processId];
+  retry.hash = process.hash;
+  retry.node = process.node;
+  retry.name = process.name;
+  retry.startBlockId = process.startBlockId;
+  retry.endBlockId = process.endBlockId;
+  retry.stride = process.stride;
+  retry.nextSegment = process.startBlockId;
+  retry.isChained = process.isChained;
+  retry.anchorNode = process.anchorNode;
+  retry.nAttempts = process.nAttempts + 1;
+
+  // segments stored by the failed attempt are stored again, which is harmless
+  scheduler.schedule(RANGE_RETRY_DELAY * retry.nAttempts, [this, processId] {
+    m_waitingProcesses.push(processId);
+    if (!m_isRunning) {
+      startNextProcess();
+    }
+  });
+}
+
+void
+MigrateHandle::rewriteManifest(const ProcessInfo& process)
+{
+  auto manifest = storageHandle.readManifest(process.hash);
+  if (manifest == nullptr) {
+    NDN_LOG_DEBUG("Manifest " << process.hash << " removed during migration");
+    return;
+  }
+
+  std::list<Manifest::Repo> repos = manifest->getRepos();
+  bool isChanged = false;
+  for (auto& repo : repos) {
+    if (Name(repo.name) == process.node &&
+        static_cast<SegmentNo>(repo.start) == process.startBlockId &&
+        static_cast<SegmentNo>(repo.end) == process.endBlockId) {
+      repo.name = m_repoPrefix.toUri();
+      isChanged = true;
+    }
+  }
+
+  if (!isChanged) {
+    return;
+  }
+
+  manifest->setRepos(repos);
+  storageHandle.insertManifest(*manifest);
+  NDN_LOG_DEBUG("Moved " << process.name << " [" << process.startBlockId << ", "
+                << process.endBlockId << "] from " << process.node << " to " << m_repoPrefix);
+
+  // readers fail over to the replicas, which must not point at the drained node either
+  for (const auto& node : m_keySpaceHandle.getManifestStorages(process.hash)) {
+    if (node != m_repoPrefix) {
+      pushManifest(*manifest, node);
+    }
+  }
+
+  RepoCommandParameter parameters;
+  parameters.setName(process.name);
+  parameters.setStartBlockId(process.startBlockId);
+  parameters.setEndBlockId(process.endBlockId);
+  parameters.setProcessId(ndn::random::generateWord64());
+  if (process.stride > 1)
+    parameters.setStride(process.stride);
+
+  Interest deleteDataInterest = util::generateCommandInterest(
+    process.node, "delete-data", parameters, m_interestLifetime);
+
+  face.expressInterest(deleteDataInterest,
+                       [] (const Interest&, const Data&) {},
+                       [] (const Interest&, const ndn::lp::Nack&) {},
+                       [] (const Interest& interest) {
+                         NDN_LOG_DEBUG("Delete data timeout " << interest.getName());
+                       });
+}
+
+void
+MigrateHandle::pushManifest(const Manifest& manifest, const Name& node, int retries)
+{
+  RepoCommandParameter parameters;
+  parameters.setName(manifest.getHash());
+  parameters.setClusterPrefix(ndn::encoding::makeBinaryBlock(tlv::ClusterPrefix, m_repoPrefix.toUri().c_str(),
+                                                             m_repoPrefix.toUri().length()));
+  parameters.setProcessId(ndn::random::generateWord64());
+  parameters.setManifest(manifest.toJson());
+
+  Interest createInterest = util::generateCommandInterest(node, "create", parameters, m_interestLifetime);
+
+  auto onFailure = [this, manifest, node, retries] (const Interest& interest) {
+    if (retries < MAX_RETRY) {
+      pushManifest(manifest, node, retries + 1);
+      return;
+    }
+    NDN_LOG_ERROR("Replica of " << manifest.getHash() << " on " << node << " still points at the drained node");
+  };
+  face.expressInterest(createInterest,
+                       [onFailure] (const Interest& interest, const Data& data) {
+                         try {
+                           RepoCommandResponse response(data.getContent().blockFromValue());
+                           if (response.getCode() < 400) {
+                             return;
+                           }
+                         }
+                         catch (const ndn::tlv::Error&) {
+                         }
+                         onFailure(interest);
+                       },
+                       std::bind(onFailure, _1), // Nack
+                       onFailure);
+}
+
+void
+MigrateHandle::onRegisterFailed(const Name& prefix, const std::string& reason)
+{
+  NDN_LOG_ERROR("ERROR: Failed to register prefix in local hub's daemon");
+  face.shutdown();
+}
+
+} // namespace repo
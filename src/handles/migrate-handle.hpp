@@ -0,0 +1,208 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_HANDLES_MIGRATE_HANDLE_HPP
+#define REPO_HANDLES_MIGRATE_HANDLE_HPP
+
+#include "command-base-handle.hpp"
+#include "process-table.hpp"
+#include "keyspace-handle.hpp"
+#include "../fetch/hash-chain-verifier.hpp"
+#include "../manifest/manifest.hpp"
+
+#include <deque>
+#include <queue>
+
+namespace repo {
+
+/**
+ * @brief MigrateHandle moves data segments off a node that is being drained.
+ *
+ * For every local manifest that stores a segment range on the drained node, the range is
+ * fetched from that node into this one, at most `window` Interests in flight and at most
+ * `maxRate` segments per second (0 means unlimited). Ranges are copied one at a time, and
+ * queued a page of manifests at a time. A range that fails is copied again later.
+ *
+ * Copied segments are checked like inserted ones: key-signed segments with the validator,
+ * digest-signed ones against the hash chain. The chain of a range that starts mid-file is
+ * anchored on the segment before it, read here or from the node that stores it.
+ *
+ * Once every segment of a range is stored locally, the manifest is rewritten to point at
+ * this node, sent to every node keeping a replica of it, and the drained node is asked to
+ * delete its copy. Only the first node keeping a manifest copies its ranges, so that the
+ * replicas are rewritten the same way.
+ *
+ * A drain starts when a node disappears from the keyspace, or explicitly with the
+ * `migrate` command carrying the node to drain in From.
+ */
+class MigrateHandle : public CommandBaseHandle
+{
+public:
+  class Error : public CommandBaseHandle::Error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : CommandBaseHandle::Error(what)
+    {
+    }
+  };
+
+public:
+  MigrateHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle,
+                Scheduler& scheduler, Validator& validator,
+                ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+                size_t window, uint64_t maxRate);
+
+  /**
+   * @brief copy every segment range stored on @p node into this node
+   */
+  void
+  drain(const Name& node);
+
+private:
+  struct ProcessInfo
+  {
+    std::string hash;  ///< manifest to rewrite
+    Name node;         ///< node being drained
+    Name name;         ///< data name without segment
+    SegmentNo startBlockId;
+    SegmentNo endBlockId;
+    SegmentNo stride = 1;
+    SegmentNo nextSegment;
+    uint64_t nReceived = 0;  ///< segments checked and stored
+    uint64_t nArrived = 0;
+    size_t nInFlight = 0;
+    size_t nValidating = 0;  ///< segments waiting for the validator
+    std::map<SegmentNo, int> retryCounts;
+    bool isFailed = false;
+    int nAttempts = 0;       ///< earlier copies of the range that failed
+
+    bool isChained = false;  ///< digest-signed segments are checked against the hash chain
+    Name anchorNode;         ///< node storing segment startBlockId - 1
+    HashChainVerifier hashChain;
+    std::map<SegmentNo, Data> unverified;  ///< digest-signed segments the chain has not reached
+  };
+
+private:
+  void
+  handleMigrateCommand(const Name& prefix, const Interest& interest);
+
+  /**
+   * @brief a node whose ranges are being copied, and the last manifest scanned for them
+   */
+  struct Drain
+  {
+    Name node;
+    std::string cursor;
+  };
+
+  /**
+   * @brief queue the ranges of the next page of manifests of the first drain
+   * @return ranges queued
+   */
+  size_t
+  queueNextPage();
+
+  void
+  startNextProcess();
+
+  /**
+   * @brief copy the range of @p process again after a delay that grows with each attempt
+   */
+  void
+  retryProcess(const ProcessInfo& process);
+
+  /**
+   * @brief anchor the hash chain of a range on the segment before it, then start copying
+   */
+  void
+  fetchAnchor(ProcessId processId);
+
+  void
+  onAnchorData(const Data& data, ProcessId processId);
+
+  void
+  sendInterests(ProcessId processId);
+
+  void
+  sendInterest(ProcessId processId, SegmentNo segment);
+
+  void
+  onData(const Interest& interest, const Data& data, ProcessId processId);
+
+  void
+  onTimeout(const Interest& interest, ProcessId processId);
+
+  void
+  onSegmentValidated(const Data& data, ProcessId processId, bool isValid);
+
+  /**
+   * @brief check the runs the hash chain completed and store their segments
+   */
+  void
+  verifyRuns(ProcessId processId, std::vector<HashChainVerifier::Run> runs);
+
+  /**
+   * @brief finish the range if nothing is in flight anymore
+   * @return whether the range is finished
+   */
+  bool
+  checkProcess(ProcessId processId);
+
+  void
+  onProcessFinished(ProcessId processId);
+
+  /**
+   * @brief point the manifest range at this node once the copy is complete
+   */
+  void
+  rewriteManifest(const ProcessInfo& process);
+
+  /**
+   * @brief replace the replica of @p manifest on @p node, retrying MAX_RETRY times
+   */
+  void
+  pushManifest(const Manifest& manifest, const Name& node, int retries = 0);
+
+  void
+  onRegisterFailed(const Name& prefix, const std::string& reason);
+
+private:
+  Validator& m_validator;
+  KeySpaceHandle& m_keySpaceHandle;
+  ProcessTable<ProcessInfo> m_processes;
+  std::deque<Drain> m_drains;  ///< nodes to drain, scanned a page of manifests at a time
+  std::queue<ProcessId> m_waitingProcesses;
+  ProcessId m_runningProcess;
+  bool m_isRunning;
+
+  size_t m_window;
+  ndn::time::nanoseconds m_sendInterval;  ///< zero when the rate is not limited
+  ndn::time::steady_clock::TimePoint m_nextSendTime;
+  bool m_isPacing;
+
+  ndn::time::milliseconds m_interestLifetime;
+  ndn::Name m_repoPrefix;
+  ndn::util::signal::ScopedConnection m_afterNodeRemovedConnection;
+};
+
+} // namespace repo
+
+#endif // REPO_HANDLES_MIGRATE_HANDLE_HPP
@@ -0,0 +1,271 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "placement-handle.hpp"
+#include "util.hpp"
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <ndn-cxx/util/logger.hpp>
+#include <sys/statvfs.h>
+
+#include <limits>
+
+namespace repo {
+
+NDN_LOG_INIT(repo.PlacementHandle);
+
+static const double MIN_FREE_RATIO = 0.05;
+static const double MIN_THROUGHPUT = 100;   // segments per second assumed for an idle node
+static const double SPACE_WEIGHT = 1;       // seconds of backlog worth a full disk
+static const double SELF_PREFERENCE = 1;    // seconds another node must win by
+static const double THROUGHPUT_GAIN = 0.25;
+static const int STALE_REPORTS = 3;         // missed reports before a node is left out
+static const double MIN_REPORTED_RATE = 0.01;  // bucket request rates below are left out of reports
+
+PlacementHandle::PlacementHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle,
+                                 Scheduler& scheduler, Validator& validator,
+                                 ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+                                 std::string storagePath, ndn::time::milliseconds reportInterval)
+  : CommandBaseHandle(face, storageHandle, scheduler, validator)
+  , m_keySpaceHandle(keySpaceHandle)
+  , m_storagePath(storagePath.empty() ? "/" : storagePath)
+  , m_reportInterval(reportInterval)
+  , m_lastStoredSegments(0)
+  , m_lastPoll(ndn::time::steady_clock::now())
+  , m_throughput(0)
+  , m_repoPrefix(Name(clusterNodePrefix).append(clusterPrefix))
+{
+  ndn::InterestFilter filterLoad = Name(m_repoPrefix).append("load");
+  face.setInterestFilter(filterLoad,
+                           std::bind(&PlacementHandle::handleLoadCommand, this, _1, _2),
+                           std::bind(&PlacementHandle::onRegisterFailed, this, _1, _2));
+
+  m_pollEvent = scheduler.schedule(m_reportInterval, [this] { poll(); });
+}
+
+void
+PlacementHandle::handleLoadCommand(const Name& prefix, const Interest& interest)
+{
+  LoadReport report = makeLocalReport();
+
+  boost::property_tree::ptree root;
+  root.put("free", report.freeSpace);
+  root.put("total", report.totalSpace);
+  root.put("inFlight", report.nInFlight);
+  root.put("pending", report.nPendingSegments);
+  root.put("throughput", report.throughput);
+
+  boost::property_tree::ptree requests;
+  for (int bucket = 0; bucket < HotRangeDetector::N_BUCKETS; ++bucket) {
+    if (report.requestRates[bucket] >= MIN_REPORTED_RATE) {
+      requests.put(std::to_string(bucket), report.requestRates[bucket]);
+    }
+  }
+  root.add_child("requests", requests);
+
+  std::stringstream os;
+  boost::property_tree::write_json(os, root, false);
+
+  reply(interest, os.str());
+}
+
+PlacementHandle::LoadReport
+PlacementHandle::makeLocalReport()
+{
+  LoadReport report;
+
+  struct statvfs sv;
+  if (statvfs(m_storagePath.c_str(), &sv) == 0) {
+    report.freeSpace = static_cast<uint64_t>(sv.f_bavail) * sv.f_frsize;
+    report.totalSpace = static_cast<uint64_t>(sv.f_blocks) * sv.f_frsize;
+  }
+
+  if (m_loadSource) {
+    LocalLoad load = m_loadSource();
+    report.nInFlight = load.nInFlight;
+    report.nPendingSegments = load.nPendingSegments;
+  }
+  report.throughput = m_throughput;
+  report.requestRates = m_requests.getRates();
+  report.receivedAt = ndn::time::steady_clock::now();
+
+  return report;
+}
+
+void
+PlacementHandle::poll()
+{
+  auto now = ndn::time::steady_clock::now();
+  if (m_loadSource) {
+    uint64_t stored = m_loadSource().nStoredSegments;
+    double seconds = ndn::time::duration_cast<ndn::time::milliseconds>(now - m_lastPoll).count() / 1000.0;
+    if (seconds > 0) {
+      double rate = (stored - m_lastStoredSegments) / seconds;
+      m_throughput += THROUGHPUT_GAIN * (rate - m_throughput);
+    }
+    m_lastStoredSegments = stored;
+  }
+  m_requests.update(ndn::time::duration_cast<ndn::time::milliseconds>(now - m_lastPoll).count() / 1000.0);
+  m_lastPoll = now;
+
+  for (const auto& node : m_keySpaceHandle.getNodes()) {
+    if (node == m_repoPrefix) {
+      continue;
+    }
+
+    Interest interest(Name(node).append("load"));
+    interest.setCanBePrefix(false);
+    interest.setMustBeFresh(true);
+    interest.setInterestLifetime(m_reportInterval);
+
+    face.expressInterest(interest,
+                         std::bind(&PlacementHandle::onLoadResponse, this, _1, _2, node),
+                         [] (const Interest&, const ndn::lp::Nack&) {},
+                         [] (const Interest& interest) {
+                           NDN_LOG_DEBUG("No load report from " << interest.getName());
+                         });
+  }
+
+  m_pollEvent = scheduler.schedule(m_reportInterval, [this] { poll(); });
+}
+
+void
+PlacementHandle::onLoadResponse(const Interest& interest, const Data& data, const Name& node)
+{
+  auto content = data.getContent();
+  std::istringstream json(std::string(content.value_begin(), content.value_end()));
+
+  boost::property_tree::ptree root;
+  try {
+    boost::property_tree::read_json(json, root);
+
+    LoadReport& report = m_reports[node];
+    report.freeSpace = root.get<uint64_t>("free");
+    report.totalSpace = root.get<uint64_t>("total");
+    report.nInFlight = root.get<size_t>("inFlight");
+    report.nPendingSegments = root.get<uint64_t>("pending");
+    report.throughput = root.get<double>("throughput");
+    report.requestRates.fill(0);
+    auto requests = root.get_child_optional("requests");
+    if (requests) {
+      for (const auto& item : *requests) {
+        int bucket = std::stoi(item.first);
+        if (bucket >= 0 && bucket < HotRangeDetector::N_BUCKETS) {
+          report.requestRates[bucket] = item.second.get_value<double>();
+        }
+      }
+    }
+    report.receivedAt = ndn::time::steady_clock::now();
+  }
+  catch (const std::exception& e) {
+    NDN_LOG_ERROR("Malformed load report from " << node << ": " << e.what());
+  }
+}
+
+double
+PlacementHandle::getCost(const LoadReport& report)
+{
+  double freeRatio = 1;
+  if (report.totalSpace > 0) {
+    freeRatio = static_cast<double>(report.freeSpace) / report.totalSpace;
+    if (freeRatio < MIN_FREE_RATIO) {
+      return std::numeric_limits<double>::infinity();
+    }
+  }
+
+  double backlog = (report.nPendingSegments + 1) / std::max(report.throughput, MIN_THROUGHPUT);
+  return backlog + SPACE_WEIGHT * (1 - freeRatio);
+}
+
+std::vector<Name>
+PlacementHandle::rankNodes()
+{
+  auto now = ndn::time::steady_clock::now();
+  auto maxAge = m_reportInterval * STALE_REPORTS;
+
+  // ring order starting from this node, used as tie-break
+  std::vector<Name> ring = m_keySpaceHandle.getNodes();
+  auto self = std::find(ring.begin(), ring.end(), m_repoPrefix);
+  if (self != ring.end()) {
+    std::rotate(ring.begin(), self, ring.end());
+  }
+  else {
+    ring.insert(ring.begin(), m_repoPrefix);
+  }
+
+  std::vector<std::pair<double, Name>> candidates;
+  for (const auto& node : ring) {
+    if (node == m_repoPrefix) {
+      candidates.emplace_back(getCost(makeLocalReport()) - SELF_PREFERENCE, node);
+      continue;
+    }
+
+    auto it = m_reports.find(node);
+    if (it == m_reports.end() || now - it->second.receivedAt > maxAge ||
+        !m_keySpaceHandle.isAlive(node)) {
+      continue;
+    }
+    candidates.emplace_back(getCost(it->second), node);
+  }
+
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [] (const std::pair<double, Name>& a, const std::pair<double, Name>& b) {
+                     return a.first < b.first;
+                   });
+
+  std::vector<Name> nodes;
+  for (const auto& candidate : candidates) {
+    nodes.push_back(candidate.second);
+  }
+  return nodes;
+}
+
+void
+PlacementHandle::countRequest(const std::string& hash)
+{
+  m_requests.add(util::getHashBucket(hash));
+}
+
+HotRangeDetector::Rates
+PlacementHandle::getRequestRates()
+{
+  auto now = ndn::time::steady_clock::now();
+  auto maxAge = m_reportInterval * STALE_REPORTS;
+
+  HotRangeDetector::Rates rates = m_requests.getRates();
+  for (const auto& report : m_reports) {
+    if (report.first == m_repoPrefix || now - report.second.receivedAt > maxAge) {
+      continue;
+    }
+    for (int bucket = 0; bucket < HotRangeDetector::N_BUCKETS; ++bucket) {
+      rates[bucket] += report.second.requestRates[bucket];
+    }
+  }
+  return rates;
+}
+
+void
+PlacementHandle::onRegisterFailed(const Name& prefix, const std::string& reason)
+{
+  NDN_LOG_ERROR("ERROR: Failed to register prefix in local hub's daemon");
+  face.shutdown();
+}
+
+} // namespace repo
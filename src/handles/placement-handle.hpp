@@ -0,0 +1,155 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_HANDLES_PLACEMENT_HANDLE_HPP
+#define REPO_HANDLES_PLACEMENT_HANDLE_HPP
+
+#include "command-base-handle.hpp"
+#include "keyspace-handle.hpp"
+#include "../keyspace/hot-range-detector.hpp"
+
+namespace repo {
+
+/**
+ * @brief PlacementHandle chooses the nodes that store the segments of new files.
+ *
+ * Every node answers `load` with a small JSON report: free and total space of the storage
+ * volume, inserts in progress, segments still to fetch and recent ingest throughput. Each
+ * node polls the reports of the other keyspace nodes periodically.
+ *
+ * rankNodes() orders the nodes from the best target to the worst by estimated backlog
+ * (segments still to fetch over throughput). Nodes low on space go last, and nodes whose
+ * report is stale are left out. This node stays first unless another one is clearly better,
+ * so that data only moves when it pays off.
+ *
+ * The reports also carry the manifest request rate of every keyspace bucket served by the
+ * node, which the manager adds up to find hot ranges.
+ */
+class PlacementHandle : public CommandBaseHandle
+{
+public:
+  class Error : public CommandBaseHandle::Error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : CommandBaseHandle::Error(what)
+    {
+    }
+  };
+
+  /**
+   * @brief ingest state of this node, as known by the WriteHandle
+   */
+  struct LocalLoad
+  {
+    size_t nInFlight = 0;          ///< inserts and stripes being fetched
+    uint64_t nPendingSegments = 0; ///< segments of those still to fetch
+    uint64_t nStoredSegments = 0;  ///< segments stored since start, only ever grows
+  };
+
+  using LoadSource = std::function<LocalLoad()>;
+
+public:
+  PlacementHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle,
+                  Scheduler& scheduler, Validator& validator,
+                  ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+                  std::string storagePath, ndn::time::milliseconds reportInterval);
+
+  void
+  setLoadSource(const LoadSource& loadSource)
+  {
+    m_loadSource = loadSource;
+  }
+
+  /**
+   * @return the keyspace nodes with a fresh report, best placement target first
+   */
+  std::vector<Name>
+  rankNodes();
+
+  /**
+   * @brief count a manifest lookup served by this node
+   */
+  void
+  countRequest(const std::string& hash);
+
+  /**
+   * @return manifest requests per second of every bucket, summed over this node and the
+   *         nodes with a fresh report
+   */
+  HotRangeDetector::Rates
+  getRequestRates();
+
+private:
+  struct LoadReport
+  {
+    uint64_t freeSpace = 0;
+    uint64_t totalSpace = 0;
+    size_t nInFlight = 0;
+    uint64_t nPendingSegments = 0;
+    double throughput = 0;  ///< segments per second
+    HotRangeDetector::Rates requestRates{};
+    ndn::time::steady_clock::TimePoint receivedAt;
+  };
+
+  void
+  handleLoadCommand(const Name& prefix, const Interest& interest);
+
+  LoadReport
+  makeLocalReport();
+
+  /**
+   * @brief update the local throughput and ask every other node for its report
+   */
+  void
+  poll();
+
+  void
+  onLoadResponse(const Interest& interest, const Data& data, const Name& node);
+
+  /**
+   * @brief expected seconds before the node gets to new segments; infinite when it is full
+   */
+  static double
+  getCost(const LoadReport& report);
+
+  void
+  onRegisterFailed(const Name& prefix, const std::string& reason);
+
+private:
+  KeySpaceHandle& m_keySpaceHandle;
+  LoadSource m_loadSource;
+  std::map<Name, LoadReport> m_reports;
+
+  std::string m_storagePath;
+  ndn::time::milliseconds m_reportInterval;
+  ndn::scheduler::ScopedEventId m_pollEvent;
+
+  uint64_t m_lastStoredSegments;
+  ndn::time::steady_clock::TimePoint m_lastPoll;
+  double m_throughput;
+  HotRangeDetector m_requests;
+
+  ndn::Name m_repoPrefix;
+};
+
+} // namespace repo
+
+#endif // REPO_HANDLES_PLACEMENT_HANDLE_HPP
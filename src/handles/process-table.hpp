@@ -0,0 +1,423 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_HANDLES_PROCESS_TABLE_HPP
+#define REPO_HANDLES_PROCESS_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace repo {
+
+/**
+ * @brief the processes of a handle, by process id
+ *
+ * Records live in a pool and are reused once erased, so that a record stays at the same
+ * address for its whole life and a busy node does not allocate one per command. Process ids
+ * are found through an open-addressing hash table with linear probing, which holds just the
+ * id and the pool index.
+ *
+ * A process can be set to expire after a number of ticks. The owner calls advance() once
+ * per tick, and a timer wheel erases the expired processes, instead of one scheduler event
+ * per process.
+ *
+ * The interface is the part of std::map the handles use: find, count, operator[], erase
+ * and iteration over (id, record) pairs.
+ */
+template<typename T>
+class ProcessTable
+{
+public:
+  using key_type = uint64_t;
+  using value_type = std::pair<key_type, T>;
+
+private:
+  struct Slot
+  {
+    value_type entry;
+    uint64_t deadline = 0;  ///< tick at which the process expires, zero if it does not
+    bool isUsed = false;
+  };
+
+  /**
+   * @brief walks the pool by index, which stays valid while other processes are added
+   */
+  template<typename Table, typename Value>
+  class Iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Value;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    Iterator(Table* table, size_t slot)
+      : m_table(table)
+      , m_slot(slot)
+    {
+      skipUnused();
+    }
+
+    Value&
+    operator*() const
+    {
+      return m_table->m_pool[m_slot].entry;
+    }
+
+    Value*
+    operator->() const
+    {
+      return &m_table->m_pool[m_slot].entry;
+    }
+
+    Iterator&
+    operator++()
+    {
+      ++m_slot;
+      skipUnused();
+      return *this;
+    }
+
+    bool
+    operator==(const Iterator& other) const
+    {
+      return m_slot == other.m_slot;
+    }
+
+    bool
+    operator!=(const Iterator& other) const
+    {
+      return m_slot != other.m_slot;
+    }
+
+  private:
+    void
+    skipUnused()
+    {
+      while (m_slot < m_table->m_pool.size() && !m_table->m_pool[m_slot].isUsed) {
+        ++m_slot;
+      }
+      if (m_slot >= m_table->m_pool.size()) {
+        m_slot = NOT_FOUND;
+      }
+    }
+
+  private:
+    Table* m_table;
+    size_t m_slot;
+  };
+
+public:
+  using iterator = Iterator<ProcessTable, value_type>;
+  using const_iterator = Iterator<const ProcessTable, const value_type>;
+
+public:
+  /**
+   * @param wheelSize ticks covered by one turn of the timer wheel; longer expiries take
+   *        several turns
+   */
+  explicit
+  ProcessTable(size_t wheelSize = 64)
+    : m_size(0)
+    , m_index(MIN_CAPACITY)
+    , m_wheel(wheelSize > 0 ? wheelSize : 1)
+    , m_now(0)
+  {
+  }
+
+  ProcessTable(const ProcessTable&) = delete;
+
+  ProcessTable&
+  operator=(const ProcessTable&) = delete;
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  bool
+  empty() const
+  {
+    return m_size == 0;
+  }
+
+  iterator
+  begin()
+  {
+    return iterator(this, 0);
+  }
+
+  iterator
+  end()
+  {
+    return iterator(this, NOT_FOUND);
+  }
+
+  const_iterator
+  begin() const
+  {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator
+  end() const
+  {
+    return const_iterator(this, NOT_FOUND);
+  }
+
+  iterator
+  find(key_type id)
+  {
+    size_t i = findIndex(id);
+    return i == NOT_FOUND ? end() : iterator(this, m_index[i].slot);
+  }
+
+  const_iterator
+  find(key_type id) const
+  {
+    size_t i = findIndex(id);
+    return i == NOT_FOUND ? end() : const_iterator(this, m_index[i].slot);
+  }
+
+  size_t
+  count(key_type id) const
+  {
+    return findIndex(id) == NOT_FOUND ? 0 : 1;
+  }
+
+  /**
+   * @return the record of @p id, default-constructed if there was none
+   */
+  T&
+  operator[](key_type id)
+  {
+    size_t i = findIndex(id);
+    if (i != NOT_FOUND) {
+      return m_pool[m_index[i].slot].entry.second;
+    }
+
+    if ((m_size + 1) * 10 > m_index.size() * 7) {
+      rehash(m_index.size() * 2);
+    }
+
+    uint32_t slot;
+    if (!m_free.empty()) {
+      slot = m_free.back();
+      m_free.pop_back();
+    }
+    else {
+      slot = static_cast<uint32_t>(m_pool.size());
+      m_pool.emplace_back();
+    }
+    m_pool[slot].entry.first = id;
+    m_pool[slot].isUsed = true;
+    insertIndex(id, slot);
+    ++m_size;
+    return m_pool[slot].entry.second;
+  }
+
+  size_t
+  erase(key_type id)
+  {
+    size_t i = findIndex(id);
+    if (i == NOT_FOUND) {
+      return 0;
+    }
+
+    uint32_t slot = m_index[i].slot;
+    eraseIndex(i);
+    release(slot);
+    return 1;
+  }
+
+  void
+  erase(iterator it)
+  {
+    erase(it->first);
+  }
+
+  /**
+   * @brief erase @p id after @p ticks calls to advance(), unless it is erased before
+   *
+   * A later call replaces the earlier expiry.
+   */
+  void
+  expireAfter(key_type id, uint64_t ticks)
+  {
+    size_t i = findIndex(id);
+    if (i == NOT_FOUND) {
+      return;
+    }
+
+    uint64_t deadline = m_now + (ticks > 0 ? ticks : 1);
+    m_pool[m_index[i].slot].deadline = deadline;
+    m_wheel[deadline % m_wheel.size()].push_back(id);
+  }
+
+  /**
+   * @brief move on by one tick and erase the processes that expire
+   * @return the number of processes erased
+   */
+  size_t
+  advance()
+  {
+    ++m_now;
+    std::vector<key_type> due;
+    due.swap(m_wheel[m_now % m_wheel.size()]);
+
+    size_t nErased = 0;
+    for (key_type id : due) {
+      size_t i = findIndex(id);
+      if (i == NOT_FOUND) {
+        continue;
+      }
+
+      uint64_t deadline = m_pool[m_index[i].slot].deadline;
+      if (deadline == m_now) {
+        erase(id);
+        ++nErased;
+      }
+      else if (deadline > m_now && deadline % m_wheel.size() == m_now % m_wheel.size()) {
+        // due on a later turn of the wheel
+        m_wheel[m_now % m_wheel.size()].push_back(id);
+      }
+    }
+    return nErased;
+  }
+
+private:
+  struct IndexEntry
+  {
+    key_type id = 0;
+    uint32_t slot = EMPTY;
+  };
+
+  static constexpr uint32_t EMPTY = UINT32_MAX;
+  static constexpr size_t NOT_FOUND = SIZE_MAX;
+  static constexpr size_t MIN_CAPACITY = 16;
+
+  size_t
+  getHome(key_type id) const
+  {
+    // process ids are random, but the mix keeps sequential ids apart too
+    uint64_t h = id * 0x9e3779b97f4a7c15ULL;
+    return static_cast<size_t>(h ^ (h >> 32)) & (m_index.size() - 1);
+  }
+
+  size_t
+  findIndex(key_type id) const
+  {
+    size_t mask = m_index.size() - 1;
+    for (size_t i = getHome(id); m_index[i].slot != EMPTY; i = (i + 1) & mask) {
+      if (m_index[i].id == id) {
+        return i;
+      }
+    }
+    return NOT_FOUND;
+  }
+
+  void
+  insertIndex(key_type id, uint32_t slot)
+  {
+    size_t mask = m_index.size() - 1;
+    size_t i = getHome(id);
+    while (m_index[i].slot != EMPTY) {
+      i = (i + 1) & mask;
+    }
+    m_index[i].id = id;
+    m_index[i].slot = slot;
+  }
+
+  /**
+   * @brief remove entry @p i and shift back the entries of its probe run, without tombstones
+   */
+  void
+  eraseIndex(size_t i)
+  {
+    size_t mask = m_index.size() - 1;
+    size_t j = i;
+    while (true) {
+      j = (j + 1) & mask;
+      if (m_index[j].slot == EMPTY) {
+        break;
+      }
+      size_t home = getHome(m_index[j].id);
+      // the entry at j may move to i if its home is not in (i, j]
+      bool canMove = i <= j ? (home <= i || home > j) : (home <= i && home > j);
+      if (canMove) {
+        m_index[i] = m_index[j];
+        i = j;
+      }
+    }
+    m_index[i] = IndexEntry();
+  }
+
+  void
+  rehash(size_t capacity)
+  {
+    std::vector<IndexEntry> old(capacity);
+    old.swap(m_index);
+    for (const auto& entry : old) {
+      if (entry.slot != EMPTY) {
+        insertIndex(entry.id, entry.slot);
+      }
+    }
+  }
+
+  void
+  release(uint32_t slot)
+  {
+    // the record keeps no memory of the erased process
+    Slot& s = m_pool[slot];
+    s.entry.second = T();
+    s.deadline = 0;
+    s.isUsed = false;
+    m_free.push_back(slot);
+    --m_size;
+  }
+
+private:
+  std::deque<Slot> m_pool;
+  std::vector<uint32_t> m_free;
+  size_t m_size;
+  std::vector<IndexEntry> m_index;
+
+  std::vector<std::vector<key_type>> m_wheel;
+  uint64_t m_now;
+};
+
+template<typename T>
+constexpr uint32_t ProcessTable<T>::EMPTY;
+
+template<typename T>
+constexpr size_t ProcessTable<T>::NOT_FOUND;
+
+template<typename T>
+constexpr size_t ProcessTable<T>::MIN_CAPACITY;
+
+} // namespace repo
+
+#endif // REPO_HANDLES_PROCESS_TABLE_HPP
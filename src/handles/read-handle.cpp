@@ -24,6 +24,11 @@
 
 #include <ndn-cxx/util/logger.hpp>
 #include <ndn-cxx/util/random.hpp>
+#include <ndn-cxx/util/segment-fetcher.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <algorithm>
 
 namespace repo {
 
@@ -36,6 +41,7 @@ ReadHandle::ReadHandle(Face &face, KeySpaceHandle& keySpaceHandle, RepoStorage &
                        size_t prefixSubsetLength,
                        ndn::Name const &clusterNodePrefix)
   : CommandBaseHandle(face, storageHandle, scheduler, validator)
+  , m_validator(validator)
   , m_prefixSubsetLength(prefixSubsetLength)
   , m_face(face)
   , m_storageHandle(storageHandle)
@@ -90,54 +96,244 @@ ReadHandle::onGetInterest(const Name& prefix, const Interest& interest)
   auto name = parameter.getName();
   NDN_LOG_DEBUG("Received get interest " << name);
   auto hash = Manifest::getHash(name.toUri());
-  auto repo = m_keySpaceHandle.getManifestStorage(hash);
 
-  NDN_LOG_DEBUG("Find " << hash << " from " << repo);
   ProcessId processId = ndn::random::generateWord64();
   ProcessInfo& process = m_processes[processId];
   process.interest = interest;
+  process.hash = hash;
+  process.replicas = m_keySpaceHandle.getManifestStorages(hash);
+
+  // suspected replicas go last; among the others, those never measured come first so
+  // that every replica gets an RTT sample
+  std::stable_sort(process.replicas.begin(), process.replicas.end(),
+    [this] (const Name& a, const Name& b) {
+      bool isAliveA = m_keySpaceHandle.isAlive(a);
+      bool isAliveB = m_keySpaceHandle.isAlive(b);
+      if (isAliveA != isAliveB) {
+        return isAliveA;
+      }
+      auto rttA = m_replicaRtts.find(a);
+      auto rttB = m_replicaRtts.find(b);
+      auto valueA = rttA == m_replicaRtts.end() ? ndn::time::nanoseconds::zero() : rttA->second;
+      auto valueB = rttB == m_replicaRtts.end() ? ndn::time::nanoseconds::zero() : rttB->second;
+      return valueA < valueB;
+    });
+
+  if (process.replicas.empty()) {
+    negativeReply(interest, "No manifest storage", 404);
+    m_processes.erase(processId);
+    return;
+  }
+
+  // race the two best replicas, the first manifest wins
+  sendFindCommand(processId);
+  if (process.replicas.size() > 1) {
+    sendFindCommand(processId);
+  }
+}
+
+void
+ReadHandle::sendFindCommand(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  Name repo = process.replicas[process.nextReplica++];
+  ++process.nPending;
+
+  NDN_LOG_DEBUG("Find " << process.hash << " from " << repo);
 
   RepoCommandParameter parameters;
-  parameters.setName(hash);
+  parameters.setName(process.hash);
   parameters.setProcessId(processId);
 
   Interest findInterest = util::generateCommandInterest(
     repo, "find", parameters, m_interestLifetime);
   findInterest.setMustBeFresh(true);
 
+  auto sendTime = ndn::time::steady_clock::now();
   m_face.expressInterest(
     findInterest,
-    std::bind(&ReadHandle::onFindCommandResponse, this, _1, _2, processId),
-    std::bind(&ReadHandle::onFindCommandTimeout, this, _1, processId),
-    std::bind(&ReadHandle::onFindCommandTimeout, this, _1, processId));
+    std::bind(&ReadHandle::onFindCommandResponse, this, _1, _2, processId, repo, sendTime),
+    std::bind(&ReadHandle::onFindCommandTimeout, this, _1, processId, repo),
+    std::bind(&ReadHandle::onFindCommandTimeout, this, _1, processId, repo));
 }
 
 void
-ReadHandle::onFindCommandResponse(const Interest& interest, const Data& data, ProcessId processId)
+ReadHandle::onFindCommandResponse(const Interest& interest, const Data& data, ProcessId processId,
+                                  const Name& replica, const ndn::time::steady_clock::TimePoint& sendTime)
 {
-  auto process = m_processes[processId];
-  Data responseData(process.interest.getName());
+  updateReplicaRtt(replica, ndn::time::steady_clock::now() - sendTime);
+
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  --process.nPending;
+
   auto content = data.getContent();
   std::string json(
     content.value_begin(),
     content.value_end());
 
   if (json.length() == 0) {
-    NDN_LOG_DEBUG("Manifest not found");
-    reply(process.interest, "");
-  } else {
-    NDN_LOG_DEBUG("Forward manifest " << json);
-    reply(process.interest, json);
+    NDN_LOG_DEBUG("Manifest not found on " << replica);
+    if (process.nextReplica < process.replicas.size()) {
+      sendFindCommand(processId);
+    }
+    else if (process.nPending == 0) {
+      reply(process.interest, "");
+      m_processes.erase(it);
+    }
+    return;
+  }
+
+  NDN_LOG_DEBUG("Forward manifest " << json);
+  reply(process.interest, json);
+  m_processes.erase(it);
+}
+
+void
+ReadHandle::onFindCommandTimeout(const Interest& interest, ProcessId processId, const Name& replica)
+{
+  NDN_LOG_DEBUG("Find command timeout on " << replica);
+  updateReplicaRtt(replica, m_interestLifetime);
+
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  --process.nPending;
+
+  if (process.nextReplica < process.replicas.size()) {
+    sendFindCommand(processId);
+  }
+  else if (process.nPending == 0) {
+    negativeReply(process.interest, "Manifest timeout", 403);
+    m_processes.erase(it);
   }
-  m_processes.erase(processId);
 }
 
 void
-ReadHandle::onFindCommandTimeout(const Interest& interest, ProcessId processId)
+ReadHandle::updateReplicaRtt(const Name& replica, ndn::time::nanoseconds rtt)
 {
-  NDN_LOG_DEBUG("Find command timeout");
-  negativeReply(m_processes[processId].interest, "Manifest timeout", 403);
-  m_processes.erase(processId);
+  auto it = m_replicaRtts.find(replica);
+  if (it == m_replicaRtts.end()) {
+    m_replicaRtts[replica] = rtt;
+  }
+  else {
+    it->second = (it->second * 7 + rtt) / 8;
+  }
+}
+
+void
+ReadHandle::onGetBatchInterest(const Name& prefix, const Interest& interest)
+{
+  if (replyFromDataset(interest)) {
+    return;
+  }
+
+  RepoCommandParameter parameter;
+  try {
+    extractParameter(interest, prefix, parameter);
+  }
+  catch (RepoCommandParameter::Error&) {
+    negativeReply(interest, "Parameter malformed", 403);
+    return;
+  }
+
+  std::map<Name, Name> hashesByStorage;
+  for (const auto& component : parameter.getName()) {
+    auto hash = component.toUri();
+    hashesByStorage[m_keySpaceHandle.getManifestStorage(hash)].append(hash);
+  }
+  NDN_LOG_DEBUG("Received get-batch interest for " << parameter.getName().size()
+                << " hashes on " << hashesByStorage.size() << " nodes");
+
+  ProcessId processId = ndn::random::generateWord64();
+  BatchProcessInfo& process = m_batchProcesses[processId];
+  process.interest = interest;
+  process.pendingStorages = hashesByStorage.size();
+
+  if (hashesByStorage.empty()) {
+    onFindBatchDone(processId);
+    return;
+  }
+
+  ndn::util::SegmentFetcher::Options options;
+  options.interestLifetime = m_interestLifetime;
+
+  for (const auto& storage : hashesByStorage) {
+    RepoCommandParameter parameters;
+    parameters.setName(storage.second);
+
+    Interest findInterest = util::generateCommandInterest(
+      storage.first, "find-batch", parameters, m_interestLifetime);
+
+    auto fetcher = ndn::util::SegmentFetcher::start(m_face, findInterest, m_validator, options);
+    fetcher->afterSegmentValidated.connect([this, processId] (const Data& data) {
+      onFindBatchSegment(data, processId);
+    });
+    fetcher->onComplete.connect([this, processId] (const ndn::ConstBufferPtr&) {
+      onFindBatchDone(processId);
+    });
+    fetcher->onError.connect([this, processId] (uint32_t, const std::string& reason) {
+      NDN_LOG_DEBUG("Find batch failed: " << reason);
+      onFindBatchDone(processId);
+    });
+  }
+}
+
+void
+ReadHandle::onFindBatchSegment(const Data& data, ProcessId processId)
+{
+  auto it = m_batchProcesses.find(processId);
+  if (it == m_batchProcesses.end()) {
+    return;
+  }
+
+  auto content = data.getContent();
+  if (content.value_size() == 0) {
+    return;
+  }
+
+  namespace pt = boost::property_tree;
+  pt::ptree root;
+  std::istringstream json(std::string(content.value_begin(), content.value_end()));
+  try {
+    pt::read_json(json, root);
+  }
+  catch (const pt::ptree_error& e) {
+    NDN_LOG_DEBUG("Malformed find-batch segment " << data.getName() << ": " << e.what());
+    return;
+  }
+
+  auto manifests = root.get_child_optional("manifests");
+  if (manifests) {
+    for (const auto& item : *manifests) {
+      it->second.manifests.push_back(item);
+    }
+  }
+}
+
+void
+ReadHandle::onFindBatchDone(ProcessId processId)
+{
+  auto it = m_batchProcesses.find(processId);
+  if (it == m_batchProcesses.end()) {
+    return;
+  }
+
+  BatchProcessInfo& process = it->second;
+  if (process.pendingStorages > 0 && --process.pendingStorages > 0) {
+    return;
+  }
+
+  NDN_LOG_DEBUG("Forward " << process.manifests.size() << " manifests");
+  replySegmented(process.interest, util::segmentJsonArray("manifests", process.manifests));
+  m_batchProcesses.erase(it);
 }
 
 void
@@ -160,6 +356,11 @@ ReadHandle::listen(const Name& prefix)
                            std::bind(&ReadHandle::onGetInterest, this, _1, _2),
                            std::bind(&ReadHandle::onRegisterFailed, this, _1, _2));
 
+  ndn::InterestFilter filterGetBatch(Name("get-batch"));
+  m_face.setInterestFilter(filterGetBatch,
+                           std::bind(&ReadHandle::onGetBatchInterest, this, _1, _2),
+                           std::bind(&ReadHandle::onRegisterFailed, this, _1, _2));
+
   NDN_LOG_DEBUG("read handle listen complete");
 }
 
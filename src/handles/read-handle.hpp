@@ -23,12 +23,15 @@
 #include "common.hpp"
 
 #include "command-base-handle.hpp"
+#include "process-table.hpp"
 #include "storage/repo-storage.hpp"
 #include "keyspace-handle.hpp"
 #include "repo-command-response.hpp"
 #include "repo-command-parameter.hpp"
 #include "repo-command.hpp"
 
+#include <boost/property_tree/ptree.hpp>
+
 namespace repo {
 
 class ReadHandle : public CommandBaseHandle
@@ -78,6 +81,17 @@ private:
   {
     Interest interest;
     ndn::time::steady_clock::TimePoint noEndTime;
+    std::string hash;
+    std::vector<ndn::Name> replicas;  ///< reachable first, ordered by expected latency
+    size_t nextReplica = 0;
+    size_t nPending = 0;
+  };
+
+  struct BatchProcessInfo
+  {
+    Interest interest;
+    boost::property_tree::ptree manifests;
+    size_t pendingStorages = 0;
   };
 
 private:
@@ -90,16 +104,46 @@ private:
   void
   onGetInterest(const Name& prefix, const Interest& interest);
 
+  /**
+   * @brief send find to the next replica of the process
+   */
+  void
+  sendFindCommand(ProcessId processId);
+
+  void
+  onFindCommandResponse(const Interest& interest, const Data& data, ProcessId processId,
+                        const Name& replica, const ndn::time::steady_clock::TimePoint& sendTime);
+
+  void
+  onFindCommandTimeout(const Interest& interest, ProcessId processId, const Name& replica);
+
+  /**
+   * @brief fold a find round trip into the smoothed RTT of @p replica
+   */
+  void
+  updateReplicaRtt(const Name& replica, ndn::time::nanoseconds rtt);
+
+  /**
+   * @brief resolve many manifests at once
+   *
+   * Name carries one manifest hash per component. Hashes are grouped by the node owning
+   * them and fetched with one find-batch command per node; the collected manifests are
+   * returned as a segmented dataset.
+   */
+  void
+  onGetBatchInterest(const Name& prefix, const Interest& interest);
+
   void
-  onFindCommandResponse(const Interest& interest, const Data& data, ProcessId processId);
+  onFindBatchSegment(const Data& data, ProcessId processId);
 
   void
-  onFindCommandTimeout(const Interest& interest, ProcessId processId);
+  onFindBatchDone(ProcessId processId);
 
   void
   onRegisterFailed(const Name& prefix, const std::string& reason);
 
 private:
+  Validator& m_validator;
   size_t m_prefixSubsetLength;
   std::map<ndn::Name, RegisteredDataPrefix> m_insertedDataPrefixes;
   ndn::util::signal::ScopedConnection afterDataDeletionConnection;
@@ -108,7 +152,9 @@ private:
   RepoStorage& m_storageHandle;
 
   ndn::time::milliseconds m_interestLifetime;
-  std::map<ProcessId, ProcessInfo> m_processes;
+  ProcessTable<ProcessInfo> m_processes;
+  std::map<ndn::Name, ndn::time::nanoseconds> m_replicaRtts;  ///< smoothed find RTT per node
+  ProcessTable<BatchProcessInfo> m_batchProcesses;
 
   ndn::Name m_clusterNodePrefix;
   KeySpaceHandle& m_keySpaceHandle;
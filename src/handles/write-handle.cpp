@@ -21,12 +21,16 @@
 
 #include <ndn-cxx/util/logger.hpp>
 #include <ndn-cxx/util/random.hpp>
+#include <ndn-cxx/util/sha256.hpp>
 #include <ndn-cxx/security/signing-helpers.hpp>
+#include <ndn-cxx/lp/tlv.hpp>
 
 #include "manifest/manifest.hpp"
 #include "util.hpp"
 #include "repo.hpp"
 
+#include <boost/property_tree/json_parser.hpp>
+
 namespace repo {
 
 NDN_LOG_INIT(repo.WriteHandle);
@@ -35,23 +39,58 @@ static const int DEFAULT_CREDIT = 12;
 static const bool DEFAULT_CANBE_PREFIX = false;
 static const milliseconds MAX_TIMEOUT(60_s);
 static const milliseconds NOEND_TIMEOUT(10000_ms);
-static const milliseconds PROCESS_DELETE_TIME(10000_ms);
+static const milliseconds PROCESS_TICK(1000_ms);
+static const uint64_t PROCESS_DELETE_TICKS = 10;
 static const milliseconds DEFAULT_INTEREST_LIFETIME(4000_ms);
+static const SegmentNo MIN_STRIPE_SEGMENTS = 64;
+static const SegmentNo MIN_STREAM_SEGMENTS = 64;
+static const size_t MAX_COMPLETION_WAITERS = 8;   // insert-done Interests kept per insert
+static const int MAX_RETRY = 3;
+static const size_t HASH_CHAIN_BATCH = 8;  // digest-signed stripe segments verified together
+static const size_t MAX_HELD_SEGMENTS = 4096;  // stripe segments kept until the hash chain reaches them
+static const uint64_t SAVE_INTERVAL_SEGMENTS = 256;  // stored segments between two saves of a bitmap
+static const char* INSERT_INDEX_RECORD = "inserts";
+static const char* INSERT_RECORD_PREFIX = "insert-";
+static const SegmentNo MAX_SPECULATIVE_SEGMENTS = 256;  // largest file fetched before its name is checked
+static const size_t MAX_INLINE_MANIFEST = 4096;         // bytes of manifest JSON sent along with create
+static const uint64_t UNKNOWN_FETCH_SEGMENTS = 1024;    // size assumed for a fetch without EndBlockId
+static const SegmentNo CONTENT_HASH_CHUNK = 64;         // segments hashed per turn of the io thread
+
+/**
+ * @return seconds on the steady clock, for the IngestScheduler
+ */
+static double
+getIngestTime()
+{
+  auto sinceEpoch = ndn::time::steady_clock::now().time_since_epoch();
+  return ndn::time::duration_cast<ndn::time::microseconds>(sinceEpoch).count() / 1e6;
+}
 
-WriteHandle::WriteHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle, ndn::mgmt::Dispatcher& dispatcher,
-                         Scheduler& scheduler, Validator& validator,
-                         ndn::Name const& clusterNodePrefix, std::string clusterPrefix)
+WriteHandle::WriteHandle(Face& face, KeySpaceHandle& keySpaceHandle, PlacementHandle& placementHandle,
+                         RepoStorage& storageHandle, ndn::mgmt::Dispatcher& dispatcher,
+                         Scheduler& scheduler, Validator& validator, ValidationPool& validationPool,
+                         ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+                         size_t stripeWidth, const std::string& congestionControl, size_t fetchStreams,
+                         const IngestScheduler::Limits& ingestLimits, size_t flowPrefixLength)
   : CommandBaseHandle(face, storageHandle, scheduler, validator)
   , m_validator(validator)
+  , m_validationPool(validationPool)
   , m_credit(DEFAULT_CREDIT)
   , m_canBePrefix(DEFAULT_CANBE_PREFIX)
   , m_maxTimeout(MAX_TIMEOUT)
   , m_noEndTimeout(NOEND_TIMEOUT)
   , m_interestLifetime(DEFAULT_INTEREST_LIFETIME)
+  , m_stripeWidth(std::max<size_t>(stripeWidth, 1))
+  , m_congestionControl(CongestionControl::create(congestionControl))
+  , m_fetchStreams(std::max<size_t>(fetchStreams, 1))
+  , m_ingest(ingestLimits)
+  , m_flowPrefixLength(flowPrefixLength)
   , m_clusterNodePrefix(clusterNodePrefix)
   , m_clusterPrefix(clusterPrefix)
   , m_repoPrefix(Name(clusterNodePrefix).append(clusterPrefix))
   , m_keySpaceHandle(keySpaceHandle)
+  , m_placementHandle(placementHandle)
+  , m_nStoredSegments(0)
 {
   dispatcher.addControlCommand<RepoCommandParameter>(ndn::PartialName("insert"),
     makeAuthorization(),
@@ -63,16 +102,58 @@ WriteHandle::WriteHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage
     std::bind(&WriteHandle::validateParameters<InsertCheckCommand>, this, _1),
     std::bind(&WriteHandle::handleCheckCommand, this, _1, _2, _3, _4));
 
+  dispatcher.addControlCommand<RepoCommandParameter>(ndn::PartialName("insert resume"),
+    makeAuthorization(),
+    std::bind(&WriteHandle::validateParameters<InsertResumeCommand>, this, _1),
+    std::bind(&WriteHandle::handleResumeCommand, this, _1, _2, _3, _4));
+
   ndn::InterestFilter filterGet = Name(m_repoPrefix).append("write-info");
   face.setInterestFilter(filterGet,
                            std::bind(&WriteHandle::handleInfoCommand, this, _1, _2),
                            std::bind(&WriteHandle::onRegisterFailed, this, _1, _2));
+
+  ndn::InterestFilter filterFetchStripe = Name(m_repoPrefix).append("fetch-stripe");
+  face.setInterestFilter(filterFetchStripe,
+                           std::bind(&WriteHandle::handleFetchStripeCommand, this, _1, _2),
+                           std::bind(&WriteHandle::onRegisterFailed, this, _1, _2));
+
+  ndn::InterestFilter filterStripeDone = Name(m_repoPrefix).append("stripe-done");
+  face.setInterestFilter(filterStripeDone,
+                           std::bind(&WriteHandle::handleStripeDoneCommand, this, _1, _2),
+                           std::bind(&WriteHandle::onRegisterFailed, this, _1, _2));
+
+  ndn::InterestFilter filterStripeFailed = Name(m_repoPrefix).append("stripe-failed");
+  face.setInterestFilter(filterStripeFailed,
+                           std::bind(&WriteHandle::handleStripeFailedCommand, this, _1, _2),
+                           std::bind(&WriteHandle::onRegisterFailed, this, _1, _2));
+
+  ndn::InterestFilter filterStripeAnchor = Name(m_repoPrefix).append("stripe-anchor");
+  face.setInterestFilter(filterStripeAnchor,
+                           std::bind(&WriteHandle::handleStripeAnchorCommand, this, _1, _2),
+                           std::bind(&WriteHandle::onRegisterFailed, this, _1, _2));
+
+  ndn::InterestFilter filterStripeCancel = Name(m_repoPrefix).append("stripe-cancel");
+  face.setInterestFilter(filterStripeCancel,
+                           std::bind(&WriteHandle::handleStripeCancelCommand, this, _1, _2),
+                           std::bind(&WriteHandle::onRegisterFailed, this, _1, _2));
+
+  // reached like insert, through the cluster prefix
+  ndn::InterestFilter filterInsertDone = Name(m_clusterPrefix).append("insert-done");
+  face.setInterestFilter(filterInsertDone,
+                           std::bind(&WriteHandle::handleInsertDoneCommand, this, _1, _2),
+                           std::bind(&WriteHandle::onRegisterFailed, this, _1, _2));
+
+  loadProcesses();
+  m_expiryEvent = scheduler.schedule(PROCESS_TICK, [this] { expireProcesses(); });
 }
 
 void
-WriteHandle::deleteProcess(ProcessId processId)
+WriteHandle::expireProcesses()
 {
-  m_processes.erase(processId);
+  m_processes.advance();
+  // the byte budget refills with time
+  pollIngest();
+  m_expiryEvent = scheduler.schedule(PROCESS_TICK, [this] { expireProcesses(); });
 }
 
 void
@@ -83,6 +164,17 @@ WriteHandle::handleInsertCommand(const Name& prefix, const Interest& interest,
   RepoCommandParameter* repoParameter =
     dynamic_cast<RepoCommandParameter*>(const_cast<ndn::mgmt::ControlParameters*>(&parameter));
 
+  auto admission = m_ingest.checkAdmission();
+  if (!admission.isAccepted) {
+    NDN_LOG_DEBUG("Overloaded, " << repoParameter->getName() << " to retry after "
+                  << admission.retryAfter << " s");
+    RepoCommandResponse response(503, "Repo is overloaded");
+    response.setRetryAfter(ndn::time::milliseconds(static_cast<int64_t>(admission.retryAfter * 1000)));
+    response.setBody(response.wireEncode());
+    done(response);
+    return;
+  }
+
   auto difsKey = repoParameter->getName().at(-1).toUri();
 
   auto hash = Manifest::getHash("/" + difsKey);
@@ -93,13 +185,107 @@ WriteHandle::handleInsertCommand(const Name& prefix, const Interest& interest,
 
   Interest findInterest = util::generateCommandInterest(repo, "find", parameters, m_interestLifetime);
 
-  auto nackHandler = std::bind([](const Interest& interest) {}, _1);
+  if (repoParameter->hasStartBlockId() || repoParameter->hasEndBlockId()) {
+    auto nackHandler = std::bind([](const Interest& interest) {}, _1);
+
+    face.expressInterest(
+      findInterest,
+      std::bind(&WriteHandle::onFindResponse, this, _1, _2, interest, *repoParameter, done),
+      nackHandler,
+      nackHandler);
+    return;
+  }
+
+  // the existence check runs alongside the info fetch, and small files along with it;
+  // insert is answered once the check passed
+  if (repoParameter->hasInterestLifetime())
+    m_interestLifetime = repoParameter->getInterestLifetime();
+  ProcessId processId = processSingleInsertCommand(interest, *repoParameter, done);
 
   face.expressInterest(
     findInterest,
-    std::bind(&WriteHandle::onFindResponse, this, _1, _2, interest, *repoParameter, done),
-    nackHandler,
-    nackHandler);
+    std::bind(&WriteHandle::onInsertFindResponse, this, _1, _2, processId),
+    std::bind(&WriteHandle::onInsertFindTimeout, this, _1, processId), // Nack
+    std::bind(&WriteHandle::onInsertFindTimeout, this, _1, processId));
+}
+
+void
+WriteHandle::onInsertFindResponse(const Interest& interest, const Data& data, ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  if (process.response.getCode() >= 400) {
+    return;
+  }
+  if (data.getContent().value_size() > 0) {
+    NDN_LOG_DEBUG("Manifest already exists, abort insert " << processId);
+    finishProcess(processId, 403);
+    return;
+  }
+
+  process.isSpeculative = false;
+  replyInsert(processId, 100);
+  if (process.info == nullptr || process.isContentPending) {
+    // the file is planned once its info arrives and the content index answered
+    return;
+  }
+
+  if (process.sharedContent != nullptr) {
+    shareContent(processId);
+    return;
+  }
+
+  if (!process.isFetchStarted) {
+    startFetch(processId);
+    return;
+  }
+
+  if (!process.manifestSent) {
+    process.manifestSent = true;
+    writeManifest(processId);
+  }
+  storeSpeculativeData(processId);
+}
+
+void
+WriteHandle::onInsertFindTimeout(const Interest& interest, ProcessId processId)
+{
+  if (m_processes.count(processId) == 0) {
+    return;
+  }
+
+  NDN_LOG_DEBUG("Cannot check " << interest.getName() << ", abort insert " << processId);
+  finishProcess(processId, 405);
+}
+
+void
+WriteHandle::storeSpeculativeData(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  RepoCommandResponse& response = process.response;
+
+  if (process.extension == nullptr) {
+    return;
+  }
+
+  for (const auto& data : process.extension->speculativeData) {
+    if (storageHandle.insertData(data) && markStored(processId, data)) {
+      response.setInsertNum(response.getInsertNum() + 1);
+      ++m_nStoredSegments;
+      m_ingest.onStored(processId, data.wireEncode().size(), getIngestTime());
+    }
+  }
+  process.extension->speculativeData.clear();
+
+  if (response.hasEndBlockId() &&
+      response.getInsertNum() >= response.getEndBlockId() - response.getStartBlockId() + 1) {
+    response.setCode(200);
+    deferredDeleteProcess(processId);
+  }
 }
 
 void
@@ -113,13 +299,8 @@ WriteHandle::onFindResponse(
     return;
   }
 
-  if (repoParameter.hasStartBlockId() || repoParameter.hasEndBlockId()) {
-    NDN_LOG_DEBUG("Process segmented insert");
-    processSegmentedInsertCommand(origInterest, repoParameter, done);
-  }
-  else {
-    processSingleInsertCommand(origInterest, repoParameter, done);
-  }
+  NDN_LOG_DEBUG("Process segmented insert");
+  processSegmentedInsertCommand(origInterest, repoParameter, done);
   if (repoParameter.hasInterestLifetime())
     m_interestLifetime = repoParameter.getInterestLifetime();
 }
@@ -129,7 +310,10 @@ WriteHandle::onData(const Interest& interest, const Data& data, ProcessId proces
 {
   m_validator.validate(data,
                        std::bind(&WriteHandle::onDataValidated, this, interest, _1, processId),
-                       [](const Data& data, const ValidationError& error){NDN_LOG_ERROR("Error: " << error);});
+                       [this, processId] (const Data& data, const ValidationError& error) {
+                         NDN_LOG_ERROR("Error: " << error);
+                         finishProcess(processId, 403);
+                       });
 }
 
 void
@@ -140,6 +324,9 @@ WriteHandle::onDataValidated(const Interest& interest, const Data& data, Process
   }
 
   ProcessInfo& process = m_processes[processId];
+  if (process.info != nullptr || process.response.getCode() >= 400) {
+    return;
+  }
 
   auto content = data.getContent();
   std::string json(
@@ -148,6 +335,7 @@ WriteHandle::onDataValidated(const Interest& interest, const Data& data, Process
   );
 
   Manifest manifest = Manifest::fromInfoJson(json);
+  process.info = std::make_shared<Manifest>(manifest);
 
   process.startBlockId = manifest.getStartBlockId();
   process.endBlockId = manifest.getEndBlockId();
@@ -157,29 +345,155 @@ WriteHandle::onDataValidated(const Interest& interest, const Data& data, Process
   std::string difsKey = name.substr(i + 1);
   process.name = difsKey;
   process.repo = m_repoPrefix;
-	
+  process.nodePrefix = interest.getForwardingHint();
+
+  // the same content may be stored already, under another key
+  const std::string& digest = manifest.getDigest();
+  Name contentStorage = m_keySpaceHandle.getContentStorage(digest);
+  if (ContentRecord::isDigest(digest) && !contentStorage.empty()) {
+    process.isContentPending = true;
+
+    RepoCommandParameter parameters;
+    parameters.setName(Name().append(digest));
+    Interest findInterest = util::generateCommandInterest(
+      contentStorage, "content-find", parameters, m_interestLifetime);
+
+    face.expressInterest(
+      findInterest,
+      std::bind(&WriteHandle::onContentFindResponse, this, _1, _2, processId),
+      std::bind(&WriteHandle::onContentFindTimeout, this, _1, processId), // Nack
+      std::bind(&WriteHandle::onContentFindTimeout, this, _1, processId));
+    return;
+  }
+
+  planInsert(processId);
+}
+
+void
+WriteHandle::planInsert(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  if (process.response.getCode() >= 400) {
+    return;
+  }
+
+  const Manifest& manifest = *process.info;
+  std::string name = manifest.getName();
+
+  std::vector<Manifest::Repo> stripes;
+  if (manifest.isErasureCoded()) {
+    stripes = makeErasureStripes(manifest.getDataFragments(), manifest.getParityFragments(),
+                                 process.startBlockId, process.endBlockId);
+    if (stripes.empty()) {
+      NDN_LOG_WARN("Not enough nodes for " << manifest.getDataFragments() << "+"
+                   << manifest.getParityFragments() << " fragments, " << name << " stored without parity");
+    }
+  }
+
+  if (!stripes.empty()) {
+    int k = manifest.getDataFragments();
+    int m = manifest.getParityFragments();
+    process.stripes = stripes;
+    process.dataFragments = k;
+    process.parityFragments = m;
+    process.nPendingParity = m;
+  }
+  else {
+    stripes = makeStripes(process.startBlockId, process.endBlockId);
+    if (stripes.size() > 1 || Name(stripes.front().name) != m_repoPrefix) {
+      process.stripes = stripes;
+      process.lastLocalBlockId = stripes.front().end;
+    }
+  }
+
+  // insert check reports the progress over the whole file
+  RepoCommandResponse& response = process.response;
+  response.setStartBlockId(process.startBlockId);
+  response.setEndBlockId(process.endBlockId);
+
+  if (!process.isSpeculative) {
+    startFetch(processId);
+    return;
+  }
+
+  // a small file kept whole on this node is fetched into memory while its name is checked;
+  // anything that involves other nodes waits for the check
+  bool isSmall = process.endBlockId >= process.startBlockId &&
+                 static_cast<SegmentNo>(process.endBlockId - process.startBlockId) < MAX_SPECULATIVE_SEGMENTS;
+  if (process.stripes.empty() && isSmall) {
+    NDN_LOG_DEBUG("Speculative fetch of " << name << " for " << processId);
+    process.isFetchStarted = true;
+    segInit(processId, makeFetchParameter(process));
+  }
+}
+
+void
+WriteHandle::startFetch(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  const Manifest& info = *process.info;
+  process.isFetchStarted = true;
+
+  if (process.dataFragments > 0) {
+    int k = process.dataFragments;
+    int m = process.parityFragments;
+
+    if (!process.manifestSent) {
+      process.manifestSent = true;
+      writeManifest(processId);
+    }
+
+    // fragments of an erasure coded file are key-signed, since a stride breaks the hash chain
+    for (int i = 0; i < k + m; ++i) {
+      if (i < k)
+        sendFetchStripeCommand(processId, info.getName(), process.stripes[i], k);
+      else
+        sendFetchStripeCommand(processId, info.getParityName(i - k), process.stripes[i], 1);
+    }
+    return;
+  }
+
+  bool isLocalFirst = process.stripes.empty() || Name(process.stripes.front().name) == m_repoPrefix;
+
+  // the first stripe is fetched here with the hash chain if this node was picked for it
+  for (auto it = process.stripes.begin(); it != process.stripes.end(); ++it) {
+    if (it != process.stripes.begin() || !isLocalFirst) {
+      sendFetchStripeCommand(processId, info.getName(), *it, 1, true);
+    }
+  }
+
   if (!process.manifestSent) {
     process.manifestSent = true;
     writeManifest(processId);
   }
 
-  RepoCommandParameter parameter;
-  parameter.setName(manifest.getName());
-  parameter.setStartBlockId(0);
-  if (!interest.getForwardingHint().empty())
-    parameter.setNodePrefix(interest.getForwardingHint());
+  if (!isLocalFirst) {
+    return;
+  }
+
+  segInit(processId, makeFetchParameter(process));
+}
 
-  segInit(processId, parameter);
+RepoCommandParameter
+WriteHandle::makeFetchParameter(const ProcessInfo& process) const
+{
+  RepoCommandParameter parameter;
+  parameter.setName(process.info->getName());
+  parameter.setStartBlockId(process.startBlockId);
+  parameter.setEndBlockId(std::min<SegmentNo>(process.endBlockId, process.lastLocalBlockId));
+  if (!process.nodePrefix.empty())
+    parameter.setNodePrefix(process.nodePrefix);
+  return parameter;
 }
 
 void
 WriteHandle::onTimeout(const Interest& interest, ProcessId processId)
 {
   NDN_LOG_DEBUG("Timeout" << std::endl);
-  m_processes.erase(processId);
+  finishProcess(processId, 405);
 }
 
-void
+ProcessId
 WriteHandle::processSingleInsertCommand(const Interest& interest, const RepoCommandParameter& parameter,
                                         const ndn::mgmt::CommandContinuation& done)
 {
@@ -187,15 +501,15 @@ WriteHandle::processSingleInsertCommand(const Interest& interest, const RepoComm
   NDN_LOG_DEBUG("Insert(manifest) command processId: " << processId << " " << parameter.getName());
 
   ProcessInfo& process = m_processes[processId];
+  process.isSpeculative = true;
+  process.flow = getFlow(util::getCommandSigner(interest), parameter.getName());
+
+  process.insertReply = done;
 
   RepoCommandResponse& response = process.response;
-  response.setCode(100);
+  response.setCode(300);
   response.setProcessId(processId);
   response.setInsertNum(0);
-  response.setBody(response.wireEncode());
-  done(response);
-
-  response.setCode(300);
   Interest fetchInterest(parameter.getName());
   fetchInterest.setCanBePrefix(m_canBePrefix);
   fetchInterest.setInterestLifetime(m_interestLifetime);
@@ -206,6 +520,20 @@ WriteHandle::processSingleInsertCommand(const Interest& interest, const RepoComm
                        std::bind(&WriteHandle::onData, this, _1, _2, processId),
                        std::bind(&WriteHandle::onTimeout, this, _1, processId), // Nack
                        std::bind(&WriteHandle::onTimeout, this, _1, processId));
+  return processId;
+}
+
+/**
+ * @return @p delegations with delegation @p i first, so that each stream tries another path
+ */
+static ndn::DelegationList
+rotateDelegations(const ndn::DelegationList& delegations, size_t i)
+{
+  ndn::DelegationList rotated;
+  for (size_t j = 0; j < delegations.size(); ++j) {
+    rotated.insert(j, delegations[(i + j) % delegations.size()].name);
+  }
+  return rotated;
 }
 
 void
@@ -213,16 +541,11 @@ WriteHandle::segInit(ProcessId processId, const RepoCommandParameter& parameter)
 {
   // use HCSegmentFetcher to send fetch interest.
   ProcessInfo& process = m_processes[processId];
-  Name name = parameter.getName();
   SegmentNo startBlockId = parameter.getStartBlockId();
-
-  uint64_t initialCredit = m_credit;
+  SegmentNo endBlockId = std::numeric_limits<SegmentNo>::max();
 
   if (parameter.hasEndBlockId()) {
-    initialCredit =
-      std::min(initialCredit, parameter.getEndBlockId() - parameter.getStartBlockId() + 1);
-    process.endBlockId = parameter.getEndBlockId();
-
+    endBlockId = parameter.getEndBlockId();
   }
   else {
     // set noEndTimeout timer
@@ -230,33 +553,178 @@ WriteHandle::segInit(ProcessId processId, const RepoCommandParameter& parameter)
                         m_noEndTimeout;
   }
 
+  ndn::DelegationList delegations;
+  if (parameter.hasNodePrefix()) {
+    delegations = parameter.getNodePrefix();
+  }
+
+  // contiguous sub-ranges, each pulled through its own delegation first; segments fetched
+  // before the name is confirmed stay in memory, so they come in one stream
+  std::vector<SegmentBitmap::Range> ranges{{startBlockId, endBlockId}};
+  if (parameter.hasEndBlockId() && !process.isSpeculative) {
+    ranges = SegmentBitmap::split(startBlockId, endBlockId, m_fetchStreams, MIN_STREAM_SEGMENTS);
+  }
+  process.streams.clear();
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    FetchStream stream;
+    stream.start = ranges[i].first;
+    stream.end = ranges[i].second;
+    stream.forwardingHint = rotateDelegations(delegations, i);
+    stream.isChainStart = i == 0;
+    process.streams.push_back(stream);
+  }
+
+  process.fetchName = parameter.getName();
+  if (parameter.hasEndBlockId() && process.stripes.empty() && !process.isSpeculative) {
+    makeResumable(processId, parameter);
+  }
+
+  NDN_LOG_DEBUG("Fetch " << parameter.getName() << " in " << ranges.size() << " streams for " << processId);
+  enqueueFetch(processId);
+}
+
+void
+WriteHandle::startStream(ProcessId processId, const Name& name, size_t streamIndex)
+{
+  unsigned fetchGeneration = m_processes[processId].fetchGeneration;
+  FetchStream& stream = m_processes[processId].streams[streamIndex];
+
+  // HCSegmentFetcher checks the chain from its first segment, so a range starting mid-chain
+  // is fetched like a stripe, whose segments are stored once the chain reaches them from the
+  // stream before it, or from the segment before the range if that one is stored already
+  if (!stream.isChainStart) {
+    SegmentNo start = stream.start;
+    ProcessId stripeId = startStripeFetch(name, start, stream.end, 1, stream.forwardingHint,
+                                          m_repoPrefix, processId, true);
+    ProcessInfo& process = m_processes[processId];
+    ProcessExtension& extension = process.extend();
+    ChainPiece& piece = extension.pieces[start];
+    piece.node = m_repoPrefix;
+    piece.processId = stripeId;
+    if (extension.received != nullptr && start > 0 && extension.received->has(start - 1)) {
+      Interest previous(Name(process.fetchName).appendSegment(start - 1));
+      auto data = storageHandle.readData(previous);
+      if (data == nullptr) {
+        NDN_LOG_ERROR("Cannot read " << previous.getName() << " to anchor the stream after it");
+        finishProcess(stripeId, 405);
+        onStripeFailed(processId, name);
+        return;
+      }
+      piece.anchor = util::getNextHash(*data);
+    }
+    sendStripeAnchor(processId, start);
+    return;
+  }
+
+  // the producer is reached through the first delegation of the hint, or by its own prefix
+  if (!stream.forwardingHint.empty()) {
+    stream.pathKey = stream.forwardingHint[0].name.toUri();
+  }
+  else {
+    stream.pathKey = name.getPrefix(1).toUri();
+  }
+  stream.fetchStart = ndn::time::steady_clock::now();
+
+  FetchWindow window = m_congestionControl->makeWindow(m_pathHistory.get(stream.pathKey));
+  const ProcessInfo& process = m_processes[processId];
+  if (process.window != IngestScheduler::UNLIMITED) {
+    // the fetchers cannot cap a growing window, so the share of the budget is kept constant
+    window.initCwnd = std::max<size_t>(process.window / process.streams.size(), 1);
+    window.useConstantCwnd = true;
+  }
+  if (stream.end != std::numeric_limits<SegmentNo>::max()) {
+    window.initCwnd = std::min<double>(window.initCwnd, stream.end - stream.start + 1);
+  }
+
   Name fetchName = name;
-  SegmentNo segment = startBlockId;
-  fetchName.appendSegment(segment);
+  fetchName.appendSegment(stream.start);
   Interest interest(fetchName);
   interest.setCanBePrefix(m_canBePrefix);
   interest.setMustBeFresh(true);
-  if (parameter.hasNodePrefix()) {
-    interest.setForwardingHint(parameter.getNodePrefix());
+  if (!stream.forwardingHint.empty()) {
+    interest.setForwardingHint(stream.forwardingHint);
   }
 
   ndn::util::SegmentFetcher::Options options;
-  options.initCwnd = initialCredit;
+  options.initCwnd = window.initCwnd;
+  options.initSsthresh = window.initSsthresh;
+  options.aiStep = window.aiStep;
+  options.mdCoef = window.mdCoef;
+  options.useConstantCwnd = window.useConstantCwnd;
   options.interestLifetime = m_interestLifetime;
   options.maxTimeout = m_maxTimeout;
   
   std::shared_ptr<ndn::util::HCSegmentFetcher> hc_fetcher;
   auto hcFetcher = hc_fetcher->start(face, interest, m_validator, options);
-  hcFetcher->onError.connect([] (uint32_t errorCode, const std::string& errorMsg)
-                           {NDN_LOG_ERROR("Error: " << errorMsg);});
-  hcFetcher->afterSegmentValidated.connect([this, hcFetcher, processId] (const Data& data)
-                                         {onSegmentData(*hcFetcher, data, processId);});
+  hcFetcher->onError.connect([this, processId, fetchGeneration] (uint32_t errorCode, const std::string& errorMsg)
+                           {
+                             NDN_LOG_ERROR("Error: " << errorMsg);
+                             // a failed fetch gives its window back, unless it was resumed since
+                             auto it = m_processes.find(processId);
+                             if (it == m_processes.end() || it->second.fetchGeneration != fetchGeneration) {
+                               return;
+                             }
+                             if (it->second.getExtension().received != nullptr) {
+                               // kept at 300 for insert resume
+                               m_ingest.finish(processId);
+                               pollIngest();
+                             }
+                             else {
+                               finishProcess(processId, 405);
+                             }
+                           });
+  hcFetcher->afterSegmentValidated.connect([this, hcFetcher, processId, streamIndex, fetchGeneration] (const Data& data)
+                                         {onSegmentData(*hcFetcher, data, processId, streamIndex, fetchGeneration);});
   hcFetcher->afterSegmentTimedOut.connect([this, hcFetcher, processId] ()
                                         {onSegmentTimeout(*hcFetcher, processId);});
 }
 
 void
-WriteHandle::onSegmentData(ndn::util::HCSegmentFetcher& fetcher, const Data& data, ProcessId processId)
+WriteHandle::enqueueFetch(ProcessId processId)
+{
+  const ProcessInfo& process = m_processes[processId];
+
+  uint64_t nSegments = 0;
+  for (const auto& stream : process.streams) {
+    nSegments += stream.end != std::numeric_limits<SegmentNo>::max() ?
+                 stream.end - stream.start + 1 : UNKNOWN_FETCH_SEGMENTS;
+  }
+
+  std::string flow = process.flow.empty() ? getFlow(Name(), process.fetchName) : process.flow;
+  m_ingest.enqueue({processId, flow, nSegments});
+  pollIngest();
+}
+
+std::string
+WriteHandle::getFlow(const Name& signer, const Name& name) const
+{
+  if (m_flowPrefixLength == 0 && !signer.empty()) {
+    return signer.toUri();
+  }
+  return name.getPrefix(std::min(std::max<size_t>(m_flowPrefixLength, 1), name.size())).toUri();
+}
+
+void
+WriteHandle::pollIngest()
+{
+  for (const auto& grant : m_ingest.poll(getIngestTime())) {
+    auto it = m_processes.find(grant.id);
+    if (it == m_processes.end() || it->second.response.getCode() >= 400) {
+      m_ingest.finish(grant.id);
+      continue;
+    }
+
+    ProcessInfo& process = it->second;
+    process.window = grant.window;
+    for (size_t i = 0; i < process.streams.size(); ++i) {
+      startStream(grant.id, process.fetchName, i);
+    }
+  }
+}
+
+void
+WriteHandle::onSegmentData(ndn::util::HCSegmentFetcher& fetcher, const Data& data, ProcessId processId,
+                           size_t streamIndex, unsigned fetchGeneration)
 {
   auto it = m_processes.find(processId);
   if (it == m_processes.end()) {
@@ -265,13 +733,48 @@ WriteHandle::onSegmentData(ndn::util::HCSegmentFetcher& fetcher, const Data& dat
   }
 
   RepoCommandResponse& response = it->second.response;
+  ProcessInfo& process = it->second;
+
+  if (response.getCode() >= 400 || fetchGeneration != process.fetchGeneration) {
+    fetcher.stop();
+    return;
+  }
+
+  // segments past the stream belong to the next stream or to stripes fetched by other nodes;
+  // the fetcher stops once the segments of its own range are all in
+  FetchStream& stream = process.streams[streamIndex];
+  if (data.getName().get(-1).isSegment() &&
+      data.getName().get(-1).toSegment() > stream.end) {
+    return;
+  }
+
+  onSegmentFetched(stream, data);
+  if (stream.isComplete()) {
+    fetcher.stop();
+  }
+  // the fetcher checked the chain up to here, so the piece after the stream is anchored
+  if (stream.isChainStart && data.getName().get(-1).isSegment() &&
+      data.getName().get(-1).toSegment() == stream.end) {
+    passAnchor(processId, stream.end + 1, util::getNextHash(data));
+  }
+
+  // until the owner confirms that the name is free, segments are only kept in memory
+  if (process.isSpeculative) {
+    process.extend().speculativeData.push_back(data);
+    return;
+  }
 
   //insert data
-  if (storageHandle.insertData(data)) {
+  if (storageHandle.insertData(data) && markStored(processId, data)) {
     response.setInsertNum(response.getInsertNum() + 1);
+    ++m_nStoredSegments;
+    m_ingest.onStored(processId, data.wireEncode().size(), getIngestTime());
   }
 
-  ProcessInfo& process = m_processes[processId];
+  if (!process.stripes.empty()) {
+    checkStripedProcess(processId);
+    return;
+  }
 
   //read whether notime timeout
   if (!response.hasEndBlockId()) {
@@ -304,6 +807,29 @@ WriteHandle::onSegmentData(ndn::util::HCSegmentFetcher& fetcher, const Data& dat
   }
 }
 
+void
+WriteHandle::onSegmentFetched(FetchStream& stream, const Data& data)
+{
+  auto now = ndn::time::steady_clock::now();
+  if (++stream.nFetched == 1) {
+    stream.firstSegmentAt = now;
+  }
+
+  const auto& segment = data.getName().get(-1);
+  bool isLast = stream.isComplete() ||
+                (data.getFinalBlock() && *data.getFinalBlock() == segment);
+  if (!isLast) {
+    return;
+  }
+
+  double rtt = ndn::time::duration_cast<ndn::time::microseconds>(stream.firstSegmentAt - stream.fetchStart).count() / 1e6;
+  double seconds = ndn::time::duration_cast<ndn::time::microseconds>(now - stream.firstSegmentAt).count() / 1e6;
+  double rate = seconds > 0 ? (stream.nFetched - 1) / seconds : 0;
+  NDN_LOG_DEBUG("Fetched " << stream.nFetched << " segments from " << stream.pathKey
+                << ", rtt " << rtt << " s, " << rate << " segments/s");
+  m_pathHistory.addSample(stream.pathKey, rtt, rate);
+}
+
 void
 WriteHandle::onSegmentTimeout(ndn::util::HCSegmentFetcher& fetcher, ProcessId processId)
 {
@@ -314,42 +840,829 @@ WriteHandle::onSegmentTimeout(ndn::util::HCSegmentFetcher& fetcher, ProcessId pr
   }
 }
 
-void
-WriteHandle::processSegmentedInsertCommand(const Interest& interest, const RepoCommandParameter& parameter,
-                                           const ndn::mgmt::CommandContinuation& done)
+PlacementHandle::LocalLoad
+WriteHandle::getLoad() const
 {
-  if (parameter.hasEndBlockId()) {
-    //normal fetch segment
-    SegmentNo startBlockId = parameter.hasStartBlockId() ? parameter.getStartBlockId() : 0;
-    SegmentNo endBlockId = parameter.getEndBlockId();
-    if (startBlockId > endBlockId) {
-      done(negativeReply("Malformed Command", 403));
-      return;
+  PlacementHandle::LocalLoad load;
+  load.nStoredSegments = m_nStoredSegments;
+
+  for (const auto& item : m_processes) {
+    const RepoCommandResponse& response = item.second.response;
+    if (response.getCode() != 300 || !response.hasEndBlockId()) {
+      continue;
     }
 
-    ProcessId processId = ndn::random::generateWord64();
-    NDN_LOG_DEBUG("Insert command processId: " << processId);
-    ProcessInfo& process = m_processes[processId];
-    RepoCommandResponse& response = process.response;
-    response.setCode(100);
-    response.setProcessId(processId);
-    response.setInsertNum(0);
-    response.setStartBlockId(startBlockId);
-    response.setEndBlockId(endBlockId);
-    response.setBody(response.wireEncode());
-    done(response);
+    // stripes and fragments are counted by the processes fetching them
+    const ProcessInfo& process = item.second;
+    if (process.dataFragments > 0 ||
+        (!process.stripes.empty() && Name(process.stripes.front().name) != m_repoPrefix)) {
+      continue;
+    }
+    SegmentNo end = std::min<SegmentNo>(process.endBlockId, process.lastLocalBlockId);
+    if (end < static_cast<SegmentNo>(process.startBlockId)) {
+      continue;
+    }
+    uint64_t nSegments = (end - process.startBlockId) / process.stride + 1;
 
-    //300 means data fetching is in progress
-    response.setCode(300);
+    ++load.nInFlight;
+    if (nSegments > response.getInsertNum()) {
+      load.nPendingSegments += nSegments - response.getInsertNum();
+    }
+  }
 
-    segInit(processId, parameter);
+  return load;
+}
+
+std::vector<Manifest::Repo>
+WriteHandle::makeStripes(SegmentNo startBlockId, SegmentNo endBlockId)
+{
+  std::vector<Manifest::Repo> stripes;
+  SegmentNo nSegments = endBlockId - startBlockId + 1;
+  std::vector<Name> nodes = m_placementHandle.rankNodes();
+
+  size_t width = std::min<size_t>({m_stripeWidth, nodes.size(), nSegments / MIN_STRIPE_SEGMENTS});
+  if (width <= 1) {
+    stripes.push_back({nodes.front().toUri(), static_cast<int>(startBlockId), static_cast<int>(endBlockId)});
+    return stripes;
   }
-  else {
-    //no EndBlockId, so fetch FinalBlockId in data, if timeout, stop
-    ProcessId processId = ndn::random::generateWord64();
-    ProcessInfo& process = m_processes[processId];
-    RepoCommandResponse& response = process.response;
-    response.setCode(100);
+
+  SegmentNo stripeSize = nSegments / width;
+  SegmentNo remainder = nSegments % width;
+  SegmentNo start = startBlockId;
+  for (size_t i = 0; i < width; ++i) {
+    SegmentNo size = stripeSize + (i < remainder ? 1 : 0);
+    stripes.push_back({nodes[i].toUri(), static_cast<int>(start), static_cast<int>(start + size - 1)});
+    start += size;
+  }
+
+  return stripes;
+}
+
+std::vector<Manifest::Repo>
+WriteHandle::makeErasureStripes(int k, int m, SegmentNo startBlockId, SegmentNo endBlockId)
+{
+  std::vector<Manifest::Repo> stripes;
+  SegmentNo nSegments = endBlockId - startBlockId + 1;
+  std::vector<Name> nodes = m_placementHandle.rankNodes();
+
+  // every fragment on its own node, and no empty data fragment
+  if (nodes.size() < static_cast<size_t>(k + m) || nSegments < static_cast<SegmentNo>(k)) {
+    return stripes;
+  }
+
+  SegmentNo rows = (nSegments + k - 1) / k;
+  for (int i = 0; i < k; ++i) {
+    SegmentNo first = startBlockId + i;
+    SegmentNo last = endBlockId - (endBlockId - first) % k;
+    stripes.push_back({nodes[i].toUri(), static_cast<int>(first), static_cast<int>(last)});
+  }
+  for (int j = 0; j < m; ++j) {
+    stripes.push_back({nodes[k + j].toUri(), 0, static_cast<int>(rows - 1)});
+  }
+
+  return stripes;
+}
+
+void
+WriteHandle::sendFetchStripeCommand(ProcessId processId, const Name& name,
+                                    const Manifest::Repo& stripe, SegmentNo stride, bool isChained)
+{
+  ProcessInfo& process = m_processes[processId];
+  if (isChained) {
+    process.extend().pieces[stripe.start].node = Name(stripe.name);
+  }
+
+  if (Name(stripe.name) == m_repoPrefix) {
+    ProcessId stripeId = startStripeFetch(name, stripe.start, stripe.end, stride, process.nodePrefix,
+                                          m_repoPrefix, processId, isChained);
+    if (isChained) {
+      m_processes[processId].extend().pieces[stripe.start].processId = stripeId;
+      sendStripeAnchor(processId, stripe.start);
+    }
+    return;
+  }
+
+  RepoCommandParameter parameters;
+  parameters.setName(name);
+  parameters.setStartBlockId(stripe.start);
+  parameters.setEndBlockId(stripe.end);
+  parameters.setProcessId(processId);
+  parameters.setFrom(ndn::encoding::makeBinaryBlock(tlv::From, m_repoPrefix.toUri().c_str(), m_repoPrefix.toUri().length()));
+  if (stride > 1)
+    parameters.setStride(stride);
+  if (!process.nodePrefix.empty())
+    parameters.setNodePrefix(process.nodePrefix);
+  if (isChained) {
+    // the anchor, unless the stripe starts with a key-signed segment, comes with stripe-anchor
+    parameters.setNextHash({});
+  }
+
+  NDN_LOG_DEBUG("Stripe [" << stripe.start << ", " << stripe.end << "] of " << name << " to " << stripe.name);
+  Interest stripeInterest = util::generateCommandInterest(
+    Name(stripe.name), "fetch-stripe", parameters, m_interestLifetime);
+
+  SegmentNo start = stripe.start;
+  face.expressInterest(
+    stripeInterest,
+    [this, processId, name, start] (const Interest& interest, const Data& data) {
+      try {
+        RepoCommandResponse response(data.getContent().blockFromValue());
+        if (response.getCode() < 400) {
+          auto it = m_processes.find(processId);
+          if (it != m_processes.end() && it->second.getExtension().pieces.count(start) > 0) {
+            it->second.extension->pieces[start].processId = response.getProcessId();
+            sendStripeAnchor(processId, start);
+          }
+          return;
+        }
+        NDN_LOG_ERROR("Fetch stripe refused " << interest.getName() << ": " << response.getCode());
+      }
+      catch (const std::exception& e) {
+        NDN_LOG_ERROR("Fetch stripe reply malformed " << interest.getName() << ": " << e.what());
+      }
+      onStripeFailed(processId, name);
+    },
+    [this, processId, name] (const Interest& interest, const ndn::lp::Nack&) {
+      NDN_LOG_ERROR("Fetch stripe nack " << interest.getName());
+      onStripeFailed(processId, name);
+    },
+    [this, processId, name] (const Interest& interest) {
+      NDN_LOG_ERROR("Fetch stripe timeout " << interest.getName());
+      onStripeFailed(processId, name);
+    });
+}
+
+void
+WriteHandle::handleFetchStripeCommand(const Name& prefix, const Interest& interest)
+{
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  }
+  catch (const RepoCommandParameter::Error&) {
+    CommandBaseHandle::negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+
+  if (!repoParameter.hasStartBlockId() || !repoParameter.hasEndBlockId() || !repoParameter.hasFrom() ||
+      repoParameter.getStartBlockId() > repoParameter.getEndBlockId() || repoParameter.getStride() == 0) {
+    CommandBaseHandle::negativeReply(interest, "Malformed Command", 403);
+    return;
+  }
+
+  Name coordinator(std::string(reinterpret_cast<const char*>(repoParameter.getFrom().value()),
+                               repoParameter.getFrom().value_size()));
+  ndn::DelegationList nodePrefix;
+  if (repoParameter.hasNodePrefix())
+    nodePrefix = repoParameter.getNodePrefix();
+
+  ProcessId processId = startStripeFetch(repoParameter.getName(),
+                                         repoParameter.getStartBlockId(), repoParameter.getEndBlockId(),
+                                         repoParameter.getStride(), nodePrefix,
+                                         coordinator, repoParameter.getProcessId(),
+                                         repoParameter.hasNextHash());
+  reply(interest, m_processes[processId].response);
+
+  if (repoParameter.hasNextHash() && !repoParameter.getNextHash().empty()) {
+    setStripeAnchor(processId, repoParameter.getStartBlockId(), repoParameter.getNextHash());
+  }
+}
+
+ProcessId
+WriteHandle::startStripeFetch(const Name& name, SegmentNo startBlockId, SegmentNo endBlockId,
+                              SegmentNo stride, const ndn::DelegationList& nodePrefix,
+                              const Name& coordinator, ProcessId coordinatorProcessId, bool isChained)
+{
+  ProcessId processId = ndn::random::generateWord64();
+  ProcessInfo& process = m_processes[processId];
+  process.name = name;
+  process.startBlockId = startBlockId;
+  process.endBlockId = endBlockId;
+  process.stride = stride;
+  process.nextSegment = startBlockId;
+  process.credit = m_credit;
+  process.nodePrefix = nodePrefix;
+  ProcessExtension& stripe = process.extend();
+  stripe.coordinator = coordinator;
+  stripe.coordinatorProcessId = coordinatorProcessId;
+  // a chain can only be followed segment after segment
+  stripe.isChained = isChained && stride == 1;
+  stripe.hashChain = HashChainVerifier(HASH_CHAIN_BATCH);
+
+  RepoCommandResponse& response = process.response;
+  response.setCode(300);
+  response.setProcessId(processId);
+  response.setInsertNum(0);
+  response.setStartBlockId(startBlockId);
+  response.setEndBlockId(endBlockId);
+
+  NDN_LOG_DEBUG("Fetch stripe [" << startBlockId << ", " << endBlockId << "] / " << stride << " of "
+                << name << " for " << coordinator);
+
+  stripeSendInterests(processId);
+  return processId;
+}
+
+void
+WriteHandle::stripeSendInterests(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+
+  // segments the chain has not reached yet are kept in memory, so their number is capped
+  while (process.credit > 0 && process.nextSegment <= static_cast<SegmentNo>(process.endBlockId) &&
+         process.getExtension().hashChain.getHeld() < MAX_HELD_SEGMENTS) {
+    Interest interest(Name(process.name).appendSegment(process.nextSegment));
+    interest.setCanBePrefix(m_canBePrefix);
+    interest.setMustBeFresh(true);
+    interest.setInterestLifetime(m_interestLifetime);
+    if (!process.nodePrefix.empty())
+      interest.setForwardingHint(process.nodePrefix);
+
+    process.nextSegment += process.stride;
+    --process.credit;
+    face.expressInterest(interest,
+                         std::bind(&WriteHandle::onStripeData, this, _1, _2, processId),
+                         std::bind(&WriteHandle::onStripeTimeout, this, _1, processId), // Nack
+                         std::bind(&WriteHandle::onStripeTimeout, this, _1, processId));
+  }
+}
+
+void
+WriteHandle::onStripeData(const Interest& interest, const Data& data, ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  if (process.response.getCode() != 300) {
+    return;
+  }
+  if (data.getName() != interest.getName()) {
+    NDN_LOG_ERROR("Cannot store " << interest.getName() << " for stripe of " << process.name);
+    failStripe(processId);
+    return;
+  }
+
+  ++process.credit;
+  ProcessExtension& stripe = process.extend();
+  SegmentNo segmentNo = data.getName().get(-1).toSegment();
+  if (stripe.hashChain.isLinked(segmentNo) || stripe.unverified.count(segmentNo) > 0) {
+    // a retransmitted segment arriving late
+    stripeSendInterests(processId);
+    return;
+  }
+  ++stripe.nReceived;
+
+  if (data.getSignature().getType() != ndn::tlv::DigestSha256) {
+    // signed with a key, like the first segment of a hash chain
+    m_validator.validate(data,
+                         [this, processId] (const Data& data) {
+                           onStripeDataVerified(data, processId, true);
+                           auto it = m_processes.find(processId);
+                           if (it != m_processes.end() && it->second.getExtension().isChained) {
+                             std::vector<uint8_t> nextHash = util::getNextHash(data);
+                             if (!nextHash.empty()) {
+                               setStripeAnchor(processId, data.getName().get(-1).toSegment() + 1,
+                                               nextHash);
+                             }
+                           }
+                         },
+                         [this, processId] (const Data& data, const ValidationError& error) {
+                           NDN_LOG_ERROR("Error: " << error);
+                           onStripeDataVerified(data, processId, false);
+                         });
+  }
+  else if (!stripe.isChained) {
+    // anyone can compute a digest, so it proves nothing without the chain
+    NDN_LOG_ERROR("Digest-signed " << data.getName() << " outside a hash chain");
+    onStripeDataVerified(data, processId, false);
+  }
+  else {
+    stripe.unverified.emplace(segmentNo, data);
+    submitStripeRuns(processId, stripe.hashChain.add(util::makeHashChainSegment(data)));
+  }
+
+  if (m_processes.count(processId) > 0) {
+    stripeSendInterests(processId);
+  }
+}
+
+void
+WriteHandle::setStripeAnchor(ProcessId processId, SegmentNo segmentNo,
+                             const std::vector<uint8_t>& digest)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end() || it->second.response.getCode() != 300 ||
+      !it->second.getExtension().isChained) {
+    return;
+  }
+
+  submitStripeRuns(processId, it->second.extension->hashChain.setAnchor(segmentNo, digest));
+  if (m_processes.count(processId) > 0) {
+    stripeSendInterests(processId);
+  }
+}
+
+void
+WriteHandle::submitStripeRuns(ProcessId processId, std::vector<HashChainVerifier::Run> runs)
+{
+  ProcessInfo& process = m_processes[processId];
+  uint64_t nSegments = (process.endBlockId - process.startBlockId) / process.stride + 1;
+  ProcessExtension& stripe = process.extend();
+  if (stripe.nReceived >= nSegments) {
+    auto rest = stripe.hashChain.flush();
+    runs.insert(runs.end(), rest.begin(), rest.end());
+  }
+  for (auto& run : runs) {
+    verifyStripeRun(processId, std::move(run));
+  }
+}
+
+void
+WriteHandle::verifyStripeRun(ProcessId processId, HashChainVerifier::Run run)
+{
+  auto segments = std::make_shared<HashChainVerifier::Run>(std::move(run));
+  auto isValid = std::make_shared<std::vector<bool>>();
+  m_validationPool.submit(
+    [segments, isValid] {
+      *isValid = HashChainVerifier::verify(*segments);
+      return true;
+    },
+    [this, segments, isValid, processId] (bool) {
+      for (size_t i = 0; i < segments->segments.size(); ++i) {
+        auto it = m_processes.find(processId);
+        if (it == m_processes.end()) {
+          return;
+        }
+        if (it->second.extension == nullptr) {
+          return;
+        }
+        auto& unverified = it->second.extension->unverified;
+        auto segment = unverified.find(segments->segments[i].segmentNo);
+        if (segment == unverified.end()) {
+          continue;
+        }
+        Data data = std::move(segment->second);
+        unverified.erase(segment);
+        onStripeDataVerified(data, processId, i < isValid->size() && (*isValid)[i]);
+      }
+    });
+}
+
+void
+WriteHandle::onStripeDataVerified(const Data& data, ProcessId processId, bool isValid)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  RepoCommandResponse& response = process.response;
+  if (response.getCode() != 300) {
+    return;
+  }
+
+  if (!isValid || !storageHandle.insertData(data)) {
+    NDN_LOG_ERROR("Cannot store " << data.getName() << " for stripe of " << process.name);
+    failStripe(processId);
+    return;
+  }
+  response.setInsertNum(response.getInsertNum() + 1);
+  ++m_nStoredSegments;
+  // stripes keep their own credit window, but their bytes count towards the rate
+  m_ingest.onStored(processId, data.wireEncode().size(), getIngestTime());
+  if (process.getExtension().isChained &&
+      data.getName().get(-1).toSegment() == static_cast<SegmentNo>(process.endBlockId)) {
+    process.extension->tailHash = util::getNextHash(data);
+  }
+
+  uint64_t nSegments = (process.endBlockId - process.startBlockId) / process.stride + 1;
+  if (response.getInsertNum() < nSegments) {
+    return;
+  }
+
+  response.setCode(200);
+  reportStripe(processId, true);
+  deferredDeleteProcess(processId);
+}
+
+void
+WriteHandle::onStripeTimeout(const Interest& interest, ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  if (process.response.getCode() != 300) {
+    return;
+  }
+  SegmentNo segment = interest.getName().get(-1).toSegment();
+  if (process.retryCounts[segment]++ >= MAX_RETRY) {
+    NDN_LOG_ERROR("Stripe of " << process.name << " aborted at segment " << segment);
+    failStripe(processId);
+    return;
+  }
+
+  Interest retryInterest(interest.getName());
+  retryInterest.setCanBePrefix(m_canBePrefix);
+  retryInterest.setMustBeFresh(true);
+  retryInterest.setInterestLifetime(m_interestLifetime);
+  if (!process.nodePrefix.empty())
+    retryInterest.setForwardingHint(process.nodePrefix);
+
+  face.expressInterest(retryInterest,
+                       std::bind(&WriteHandle::onStripeData, this, _1, _2, processId),
+                       std::bind(&WriteHandle::onStripeTimeout, this, _1, processId), // Nack
+                       std::bind(&WriteHandle::onStripeTimeout, this, _1, processId));
+}
+
+void
+WriteHandle::reportStripe(ProcessId processId, bool isStored)
+{
+  const ProcessInfo& process = m_processes[processId];
+  const ProcessExtension& stripe = process.getExtension();
+
+  if (stripe.coordinator == m_repoPrefix) {
+    if (isStored) {
+      if (stripe.isChained) {
+        passAnchor(stripe.coordinatorProcessId, process.endBlockId + 1, stripe.tailHash);
+      }
+      onStripeStored(stripe.coordinatorProcessId, process.name,
+                     process.startBlockId, process.endBlockId, process.stride);
+    }
+    else {
+      onStripeFailed(stripe.coordinatorProcessId, process.name);
+    }
+    return;
+  }
+
+  RepoCommandParameter parameters;
+  parameters.setName(process.name);
+  parameters.setStartBlockId(process.startBlockId);
+  parameters.setEndBlockId(process.endBlockId);
+  parameters.setProcessId(stripe.coordinatorProcessId);
+  if (process.stride > 1)
+    parameters.setStride(process.stride);
+  if (isStored && stripe.isChained)
+    parameters.setNextHash(stripe.tailHash);
+
+  Interest reportInterest = util::generateCommandInterest(
+    stripe.coordinator, isStored ? "stripe-done" : "stripe-failed", parameters, m_interestLifetime);
+
+  face.expressInterest(
+    reportInterest,
+    [] (const Interest&, const Data&) {},
+    [] (const Interest&, const ndn::lp::Nack&) {},
+    [] (const Interest& interest) {
+      NDN_LOG_ERROR("Stripe report timeout " << interest.getName());
+    });
+}
+
+void
+WriteHandle::failStripe(ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end() || it->second.response.getCode() != 300) {
+    return;
+  }
+
+  if (it->second.extension != nullptr) {
+    it->second.extension->unverified.clear();
+  }
+  reportStripe(processId, false);
+  finishProcess(processId, 405);
+}
+
+void
+WriteHandle::handleStripeDoneCommand(const Name& prefix, const Interest& interest)
+{
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  }
+  catch (const RepoCommandParameter::Error&) {
+    CommandBaseHandle::negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+
+  ProcessId processId = repoParameter.getProcessId();
+  if (m_processes.count(processId) == 0 || !repoParameter.hasStartBlockId() ||
+      !repoParameter.hasEndBlockId() || repoParameter.getStride() == 0) {
+    CommandBaseHandle::negativeReply(interest, "No such this process is in progress", 404);
+    return;
+  }
+
+  CommandBaseHandle::negativeReply(interest, "", 200);
+  if (repoParameter.hasNextHash()) {
+    passAnchor(processId, repoParameter.getEndBlockId() + 1, repoParameter.getNextHash());
+  }
+  onStripeStored(processId, repoParameter.getName(), repoParameter.getStartBlockId(),
+                 repoParameter.getEndBlockId(), repoParameter.getStride());
+}
+
+void
+WriteHandle::handleStripeFailedCommand(const Name& prefix, const Interest& interest)
+{
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  }
+  catch (const RepoCommandParameter::Error&) {
+    CommandBaseHandle::negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+
+  ProcessId processId = repoParameter.getProcessId();
+  if (m_processes.count(processId) == 0) {
+    CommandBaseHandle::negativeReply(interest, "No such this process is in progress", 404);
+    return;
+  }
+
+  CommandBaseHandle::negativeReply(interest, "", 200);
+  onStripeFailed(processId, repoParameter.getName());
+}
+
+void
+WriteHandle::handleStripeAnchorCommand(const Name& prefix, const Interest& interest)
+{
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  }
+  catch (const RepoCommandParameter::Error&) {
+    CommandBaseHandle::negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+
+  ProcessId processId = repoParameter.getProcessId();
+  if (m_processes.count(processId) == 0 || !repoParameter.hasStartBlockId() ||
+      !repoParameter.hasNextHash()) {
+    CommandBaseHandle::negativeReply(interest, "No such this process is in progress", 404);
+    return;
+  }
+
+  CommandBaseHandle::negativeReply(interest, "", 200);
+  setStripeAnchor(processId, repoParameter.getStartBlockId(), repoParameter.getNextHash());
+}
+
+void
+WriteHandle::handleStripeCancelCommand(const Name& prefix, const Interest& interest)
+{
+  RepoCommandParameter repoParameter;
+  try {
+    extractParameter(interest, prefix, repoParameter);
+  }
+  catch (const RepoCommandParameter::Error&) {
+    CommandBaseHandle::negativeReply(interest, "command parameter malformed", 403);
+    return;
+  }
+
+  ProcessId processId = repoParameter.getProcessId();
+  if (m_processes.count(processId) == 0) {
+    CommandBaseHandle::negativeReply(interest, "No such this process is in progress", 404);
+    return;
+  }
+
+  CommandBaseHandle::negativeReply(interest, "", 200);
+  finishProcess(processId, 405);
+}
+
+void
+WriteHandle::passAnchor(ProcessId processId, SegmentNo segmentNo, const std::vector<uint8_t>& digest)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end() || it->second.response.getCode() == 200 ||
+      it->second.response.getCode() >= 400 || it->second.extension == nullptr) {
+    return;
+  }
+
+  auto& pieces = it->second.extension->pieces;
+  auto piece = pieces.find(segmentNo);
+  if (piece == pieces.end() || !piece->second.anchor.empty()) {
+    return;
+  }
+  if (digest.empty()) {
+    NDN_LOG_ERROR("Hash chain of insert " << processId << " ends before segment " << segmentNo);
+    onStripeFailed(processId, it->second.name);
+    return;
+  }
+
+  piece->second.anchor = digest;
+  sendStripeAnchor(processId, segmentNo);
+}
+
+void
+WriteHandle::sendStripeAnchor(ProcessId processId, SegmentNo start, int retries)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end() || it->second.response.getCode() == 200 ||
+      it->second.response.getCode() >= 400 || it->second.extension == nullptr) {
+    return;
+  }
+  auto& pieces = it->second.extension->pieces;
+  auto piece = pieces.find(start);
+  if (piece == pieces.end() || piece->second.anchor.empty() ||
+      piece->second.processId == 0 || piece->second.isDone) {
+    // sent once both the anchor and the stripe process are known
+    return;
+  }
+
+  if (piece->second.node == m_repoPrefix) {
+    setStripeAnchor(piece->second.processId, start, piece->second.anchor);
+    return;
+  }
+
+  RepoCommandParameter parameters;
+  parameters.setProcessId(piece->second.processId);
+  parameters.setStartBlockId(start);
+  parameters.setNextHash(piece->second.anchor);
+  Interest anchorInterest = util::generateCommandInterest(
+    piece->second.node, "stripe-anchor", parameters, m_interestLifetime);
+
+  auto onFailure = [this, processId, start, retries] {
+    if (retries < MAX_RETRY) {
+      sendStripeAnchor(processId, start, retries + 1);
+      return;
+    }
+    auto it = m_processes.find(processId);
+    if (it != m_processes.end()) {
+      NDN_LOG_ERROR("Cannot pass the hash chain anchor of segment " << start);
+      onStripeFailed(processId, it->second.name);
+    }
+  };
+  face.expressInterest(
+    anchorInterest,
+    [onFailure] (const Interest&, const Data& data) {
+      try {
+        RepoCommandResponse response(data.getContent().blockFromValue());
+        if (response.getCode() < 400) {
+          return;
+        }
+      }
+      catch (const ndn::tlv::Error&) {
+      }
+      onFailure();
+    },
+    [onFailure] (const Interest&, const ndn::lp::Nack&) { onFailure(); },
+    [onFailure] (const Interest&) { onFailure(); });
+}
+
+void
+WriteHandle::cancelPieces(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  if (process.extension == nullptr) {
+    return;
+  }
+  auto pieces = std::move(process.extension->pieces);
+  process.extension->pieces.clear();
+
+  for (const auto& piece : pieces) {
+    if (piece.second.isDone || piece.second.processId == 0) {
+      continue;
+    }
+    if (piece.second.node == m_repoPrefix) {
+      finishProcess(piece.second.processId, 405);
+      continue;
+    }
+
+    RepoCommandParameter parameters;
+    parameters.setProcessId(piece.second.processId);
+    Interest cancelInterest = util::generateCommandInterest(
+      piece.second.node, "stripe-cancel", parameters, m_interestLifetime);
+    face.expressInterest(cancelInterest,
+                         [] (const Interest&, const Data&) {},
+                         [] (const Interest&, const ndn::lp::Nack&) {},
+                         [] (const Interest&) {});
+  }
+}
+
+void
+WriteHandle::onStripeStored(ProcessId processId, const Name& name,
+                            SegmentNo startBlockId, SegmentNo endBlockId, SegmentNo stride)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  if (process.response.getCode() != 300) {
+    return;
+  }
+  NDN_LOG_DEBUG("Stripe [" << startBlockId << ", " << endBlockId << "] of " << name
+                << " for process " << processId << " done");
+  const auto& received = process.getExtension().received;
+  if (process.extension != nullptr) {
+    auto piece = process.extension->pieces.find(startBlockId);
+    if (piece != process.extension->pieces.end()) {
+      piece->second.isDone = true;
+    }
+  }
+
+  if (process.info == nullptr || name == Name(process.info->getName())) {
+    uint64_t nStored = (endBlockId - startBlockId) / stride + 1;
+    if (received != nullptr) {
+      // a resumed range may cover segments that were stored before
+      nStored = 0;
+      for (SegmentNo segmentNo = startBlockId; segmentNo <= endBlockId; segmentNo += stride) {
+        nStored += received->set(segmentNo);
+      }
+      if (!received->isComplete()) {
+        saveProcess(processId);
+      }
+    }
+    RepoCommandResponse& response = process.response;
+    response.setInsertNum(response.getInsertNum() + nStored);
+  }
+  else if (process.nPendingParity > 0) {
+    --process.nPendingParity;
+  }
+
+  checkStripedProcess(processId);
+}
+
+void
+WriteHandle::onStripeFailed(ProcessId processId, const Name& name)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  if (it->second.getExtension().received != nullptr) {
+    // kept at 300 for insert resume, like a failed stream of its own
+    NDN_LOG_ERROR("Stripe of " << name << " failed for insert " << processId);
+    m_ingest.finish(processId);
+    pollIngest();
+    return;
+  }
+
+  NDN_LOG_ERROR("Stripe of " << name << " failed, abort insert " << processId);
+  finishProcess(processId, 405);
+}
+
+void
+WriteHandle::checkStripedProcess(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  RepoCommandResponse& response = process.response;
+  if (response.getCode() == 200) {
+    return;
+  }
+
+  uint64_t nSegments = response.getEndBlockId() - response.getStartBlockId() + 1;
+  if (response.getInsertNum() >= nSegments && process.nPendingParity == 0) {
+    response.setCode(200);
+    deferredDeleteProcess(processId);
+  }
+}
+
+void
+WriteHandle::processSegmentedInsertCommand(const Interest& interest, const RepoCommandParameter& parameter,
+                                           const ndn::mgmt::CommandContinuation& done)
+{
+  if (parameter.hasEndBlockId()) {
+    //normal fetch segment
+    SegmentNo startBlockId = parameter.hasStartBlockId() ? parameter.getStartBlockId() : 0;
+    SegmentNo endBlockId = parameter.getEndBlockId();
+    if (startBlockId > endBlockId) {
+      done(negativeReply("Malformed Command", 403));
+      return;
+    }
+
+    ProcessId processId = ndn::random::generateWord64();
+    NDN_LOG_DEBUG("Insert command processId: " << processId);
+    ProcessInfo& process = m_processes[processId];
+    process.startBlockId = startBlockId;
+    process.endBlockId = endBlockId;
+    process.flow = getFlow(util::getCommandSigner(interest), parameter.getName());
+    RepoCommandResponse& response = process.response;
+    response.setCode(100);
+    response.setProcessId(processId);
+    response.setInsertNum(0);
+    response.setStartBlockId(startBlockId);
+    response.setEndBlockId(endBlockId);
+    response.setBody(response.wireEncode());
+    done(response);
+
+    //300 means data fetching is in progress
+    response.setCode(300);
+
+    segInit(processId, parameter);
+  }
+  else {
+    //no EndBlockId, so fetch FinalBlockId in data, if timeout, stop
+    ProcessId processId = ndn::random::generateWord64();
+    ProcessInfo& process = m_processes[processId];
+    process.flow = getFlow(util::getCommandSigner(interest), parameter.getName());
+    RepoCommandResponse& response = process.response;
+    response.setCode(100);
     response.setProcessId(processId);
     response.setInsertNum(0);
     response.setStartBlockId(parameter.getStartBlockId());
@@ -400,6 +1713,466 @@ WriteHandle::handleCheckCommand(const Name& prefix, const Interest& interest,
   }
 }
 
+void
+WriteHandle::makeResumable(ProcessId processId, const RepoCommandParameter& parameter)
+{
+  ProcessInfo& process = m_processes[processId];
+  if (process.getExtension().received != nullptr) {
+    return;
+  }
+
+  process.extend().received = std::make_shared<SegmentBitmap>(parameter.getStartBlockId(), parameter.getEndBlockId());
+  saveProcess(processId);
+  if (m_savedProcesses.insert(processId).second) {
+    saveProcessIndex();
+  }
+}
+
+bool
+WriteHandle::markStored(ProcessId processId, const Data& data)
+{
+  ProcessInfo& process = m_processes[processId];
+  if (process.getExtension().received == nullptr) {
+    return true;
+  }
+
+  ProcessExtension& resume = *process.extension;
+  if (!data.getName().get(-1).isSegment() ||
+      !resume.received->set(data.getName().get(-1).toSegment())) {
+    return false;
+  }
+
+  // a restart loses at most the segments stored since the last save, which are fetched again
+  if (++resume.nUnsaved >= SAVE_INTERVAL_SEGMENTS && !resume.received->isComplete()) {
+    saveProcess(processId);
+  }
+  return true;
+}
+
+void
+WriteHandle::saveProcess(ProcessId processId)
+{
+  namespace pt = boost::property_tree;
+  ProcessInfo& process = m_processes[processId];
+  const SegmentBitmap& received = *process.getExtension().received;
+
+  pt::ptree root;
+  root.put("name", process.fetchName.toUri());
+  root.put("flow", process.flow);
+  root.put("start", received.getFirst());
+  root.put("end", received.getLast());
+  root.put("received", received.toString());
+
+  pt::ptree hint;
+  for (const auto& delegation : process.nodePrefix) {
+    pt::ptree item;
+    item.put("", delegation.name.toUri());
+    hint.push_back(std::make_pair("", item));
+  }
+  root.add_child("hint", hint);
+
+  std::stringstream os;
+  pt::write_json(os, root, false);
+  try {
+    storageHandle.writeRecord(INSERT_RECORD_PREFIX + std::to_string(processId), os.str());
+    process.extend().nUnsaved = 0;
+  }
+  catch (const std::exception& e) {
+    NDN_LOG_ERROR("Cannot save insert " << processId << ": " << e.what());
+  }
+}
+
+void
+WriteHandle::forgetProcess(ProcessId processId)
+{
+  if (m_savedProcesses.erase(processId) == 0) {
+    return;
+  }
+
+  storageHandle.eraseRecord(INSERT_RECORD_PREFIX + std::to_string(processId));
+  saveProcessIndex();
+}
+
+void
+WriteHandle::saveProcessIndex()
+{
+  namespace pt = boost::property_tree;
+
+  pt::ptree processes;
+  for (ProcessId processId : m_savedProcesses) {
+    pt::ptree item;
+    item.put("", processId);
+    processes.push_back(std::make_pair("", item));
+  }
+  pt::ptree root;
+  root.add_child("processes", processes);
+
+  std::stringstream os;
+  pt::write_json(os, root, false);
+  try {
+    storageHandle.writeRecord(INSERT_INDEX_RECORD, os.str());
+  }
+  catch (const std::exception& e) {
+    NDN_LOG_ERROR("Cannot save the list of inserts: " << e.what());
+  }
+}
+
+void
+WriteHandle::loadProcesses()
+{
+  namespace pt = boost::property_tree;
+
+  std::string index = storageHandle.readRecord(INSERT_INDEX_RECORD);
+  if (index.empty()) {
+    return;
+  }
+
+  std::vector<ProcessId> processIds;
+  try {
+    pt::ptree root;
+    std::istringstream is(index);
+    pt::read_json(is, root);
+    for (const auto& item : root.get_child("processes")) {
+      processIds.push_back(item.second.get_value<ProcessId>());
+    }
+  }
+  catch (const std::exception& e) {
+    NDN_LOG_ERROR("Saved list of inserts is malformed, ignored: " << e.what());
+    return;
+  }
+
+  for (ProcessId processId : processIds) {
+    std::string record = storageHandle.readRecord(INSERT_RECORD_PREFIX + std::to_string(processId));
+    try {
+      pt::ptree root;
+      std::istringstream is(record);
+      pt::read_json(is, root);
+
+      SegmentNo start = root.get<SegmentNo>("start");
+      SegmentNo end = root.get<SegmentNo>("end");
+      auto received = std::make_shared<SegmentBitmap>(
+        SegmentBitmap::fromString(start, end, root.get<std::string>("received")));
+
+      ProcessInfo& process = m_processes[processId];
+      process.fetchName = Name(root.get<std::string>("name"));
+      process.flow = root.get<std::string>("flow", "");
+      process.startBlockId = start;
+      process.endBlockId = end;
+      process.extend().received = received;
+      size_t preference = 0;
+      for (const auto& item : root.get_child("hint")) {
+        process.nodePrefix.insert(preference++, Name(item.second.get_value<std::string>()));
+      }
+
+      RepoCommandResponse& response = process.response;
+      response.setCode(300);
+      response.setProcessId(processId);
+      response.setInsertNum(received->count());
+      response.setStartBlockId(start);
+      response.setEndBlockId(end);
+
+      m_savedProcesses.insert(processId);
+      NDN_LOG_INFO("Loaded insert " << processId << " of " << process.fetchName << ", "
+                   << received->count() << " of " << end - start + 1 << " segments stored");
+    }
+    catch (const std::exception& e) {
+      NDN_LOG_ERROR("Saved insert " << processId << " is malformed, ignored: " << e.what());
+      m_processes.erase(processId);
+      storageHandle.eraseRecord(INSERT_RECORD_PREFIX + std::to_string(processId));
+    }
+  }
+
+  if (m_savedProcesses.size() != processIds.size()) {
+    saveProcessIndex();
+  }
+}
+
+void
+WriteHandle::handleResumeCommand(const Name& prefix, const Interest& interest,
+                                 const ndn::mgmt::ControlParameters& parameter,
+                                 const ndn::mgmt::CommandContinuation& done)
+{
+  const RepoCommandParameter& repoParameter = dynamic_cast<const RepoCommandParameter&>(parameter);
+
+  ProcessId processId = repoParameter.getProcessId();
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end() || it->second.getExtension().received == nullptr) {
+    NDN_LOG_DEBUG("no resumable process: " << processId);
+    done(negativeReply("No such this process is in progress", 404));
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  if (process.response.getCode() != 300) {
+    done(process.response);
+    return;
+  }
+
+  if (repoParameter.hasNodePrefix()) {
+    process.nodePrefix = repoParameter.getNodePrefix();
+  }
+  done(process.response);
+
+  resumeFetch(processId);
+}
+
+void
+WriteHandle::resumeFetch(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  ++process.fetchGeneration;
+  // the streams of the last attempt stop, their stripes with them
+  cancelPieces(processId);
+
+  // gaps close to each other are fetched as one range; segments stored twice count once
+  const SegmentBitmap& received = *process.getExtension().received;
+  auto missing = received.getMissingRanges(m_fetchStreams);
+  process.streams.clear();
+  for (size_t i = 0; i < missing.size(); ++i) {
+    FetchStream stream;
+    stream.start = missing[i].first;
+    stream.end = missing[i].second;
+    stream.forwardingHint = rotateDelegations(process.nodePrefix, i);
+    stream.isChainStart = stream.start == received.getFirst();
+    process.streams.push_back(stream);
+  }
+
+  NDN_LOG_DEBUG("Resume " << process.fetchName << " with " << received.count()
+                << " segments stored, " << missing.size() << " streams for " << processId);
+  enqueueFetch(processId);
+}
+
+void
+WriteHandle::onContentFindResponse(const Interest& interest, const Data& data, ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end() || !it->second.isContentPending) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  process.isContentPending = false;
+
+  auto content = data.getContent();
+  if (content.value_size() > 0) {
+    try {
+      auto shared = Manifest::fromJson(std::string(content.value_begin(), content.value_end()));
+      if (shared.getDigest() == process.info->getDigest() &&
+          shared.getEndBlockId() - shared.getStartBlockId() ==
+          process.info->getEndBlockId() - process.info->getStartBlockId()) {
+        process.sharedContent = std::make_shared<Manifest>(shared);
+      }
+    }
+    catch (const std::exception& e) {
+      NDN_LOG_ERROR("Content index entry of " << process.info->getDigest() << " is malformed, ignored: "
+                    << e.what());
+    }
+  }
+
+  if (process.sharedContent == nullptr) {
+    planInsert(processId);
+    return;
+  }
+
+  NDN_LOG_DEBUG("Content of " << process.info->getName() << " is stored as "
+                << process.sharedContent->getName());
+  // with the name confirmed, only the manifest is left to write
+  if (!process.isSpeculative && process.response.getCode() < 400) {
+    shareContent(processId);
+  }
+}
+
+void
+WriteHandle::onContentFindTimeout(const Interest& interest, ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end() || !it->second.isContentPending) {
+    return;
+  }
+
+  NDN_LOG_DEBUG("No answer from the content index, fetch " << it->second.info->getName());
+  it->second.isContentPending = false;
+  planInsert(processId);
+}
+
+void
+WriteHandle::shareContent(ProcessId processId)
+{
+  ProcessInfo& process = m_processes[processId];
+  const Manifest& shared = *process.sharedContent;
+
+  RepoCommandParameter parameters;
+  parameters.setName(Name().append(shared.getDigest()).append(Manifest::getHash(process.name.toUri())));
+  parameters.setManifest(shared.toJson());
+  Interest refInterest = util::generateCommandInterest(
+    m_keySpaceHandle.getContentStorage(shared.getDigest()), "content-ref", parameters, m_interestLifetime);
+
+  face.expressInterest(
+    refInterest,
+    std::bind(&WriteHandle::onContentRefResponse, this, _1, _2, processId),
+    std::bind(&WriteHandle::onContentRefFailed, this, processId), // Nack
+    std::bind(&WriteHandle::onContentRefFailed, this, processId));
+}
+
+void
+WriteHandle::onContentRefResponse(const Interest& interest, const Data& data, ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  RepoCommandResponse refResponse(data.getContent().blockFromValue());
+  if (refResponse.getCode() != 200) {
+    onContentRefFailed(processId);
+    return;
+  }
+
+  // a manifest under the new key, naming the segments of the stored copy
+  ProcessInfo& process = it->second;
+  Manifest manifest = *process.sharedContent;
+  manifest.setHash(Manifest::getHash(process.name.toUri()));
+  process.manifest = std::make_shared<Manifest>(manifest);
+  process.manifestSent = true;
+  sendManifest(processId);
+
+  NDN_LOG_DEBUG("Insert " << processId << " shares the segments of " << manifest.getName());
+  RepoCommandResponse& response = process.response;
+  response.setStartBlockId(manifest.getStartBlockId());
+  response.setEndBlockId(manifest.getEndBlockId());
+  response.setInsertNum(manifest.getEndBlockId() - manifest.getStartBlockId() + 1);
+  response.setCode(200);
+  deferredDeleteProcess(processId);
+}
+
+void
+WriteHandle::onContentRefFailed(ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end() || it->second.sharedContent == nullptr) {
+    return;
+  }
+
+  NDN_LOG_DEBUG("Cannot share the content of " << it->second.info->getName() << ", fetch it");
+  it->second.sharedContent.reset();
+  planInsert(processId);
+}
+
+void
+WriteHandle::registerContent(ProcessId processId)
+{
+  const ProcessInfo& process = m_processes[processId];
+  const Manifest& manifest = *process.manifest;
+  Name contentStorage = m_keySpaceHandle.getContentStorage(manifest.getDigest());
+  if (contentStorage.empty()) {
+    return;
+  }
+
+  // later inserts share these segments on the strength of the digest alone, so the one
+  // the producer claimed is only indexed if the segments stored here hash to it
+  if (!process.stripes.empty() || process.dataFragments > 0) {
+    return;
+  }
+
+  // hashed a chunk at a time, so that a large file does not hold up other reads and writes
+  auto task = std::make_shared<ContentHash>();
+  task->manifest = process.manifest;
+  task->contentStorage = contentStorage;
+  task->nextSegment = process.startBlockId;
+  task->endBlockId = process.endBlockId;
+  hashContent(task);
+}
+
+void
+WriteHandle::hashContent(std::shared_ptr<ContentHash> task)
+{
+  const Manifest& manifest = *task->manifest;
+  SegmentNo endBlockId = task->endBlockId;
+  SegmentNo chunkEnd = task->nextSegment + CONTENT_HASH_CHUNK;
+  for (; task->nextSegment <= endBlockId && task->nextSegment < chunkEnd; ++task->nextSegment) {
+    auto data = storageHandle.readData(Interest(Name(manifest.getName()).appendSegment(task->nextSegment)));
+    if (data == nullptr) {
+      NDN_LOG_WARN("Segment " << task->nextSegment << " of " << manifest.getName()
+                   << " is gone, content not indexed");
+      return;
+    }
+    task->digest.update(data->getContent().value(), data->getContent().value_size());
+  }
+
+  if (task->nextSegment <= endBlockId) {
+    scheduler.schedule(0_ms, [this, task] { hashContent(task); });
+    return;
+  }
+
+  if (task->digest.toString() != manifest.getDigest()) {
+    NDN_LOG_WARN("Content of " << manifest.getName() << " does not match digest "
+                 << manifest.getDigest() << ", not indexed");
+    return;
+  }
+
+  Name contentStorage = task->contentStorage;
+  RepoCommandParameter parameters;
+  parameters.setName(Name().append(manifest.getDigest()).append(manifest.getHash()));
+  parameters.setManifest(manifest.toJson());
+  Interest refInterest = util::generateCommandInterest(
+    contentStorage, "content-register", parameters, m_interestLifetime);
+
+  // a copy stored by a concurrent insert keeps its own segments
+  face.expressInterest(
+    refInterest,
+    [] (const Interest& interest, const Data& data) {},
+    [] (const Interest&, const ndn::lp::Nack&) {},
+    [] (const Interest& interest) {
+      NDN_LOG_DEBUG("Content index timeout " << interest.getName());
+    });
+}
+
+void
+WriteHandle::handleInsertDoneCommand(const Name& prefix, const Interest& interest)
+{
+  const Name& name = interest.getName();
+  if (name.size() != prefix.size() + 1 || !name.get(prefix.size()).isNumber()) {
+    return;
+  }
+
+  // another node's insert, or one that is long gone; the client falls back to insert check
+  auto it = m_processes.find(name.get(prefix.size()).toNumber());
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  int code = process.response.getCode();
+  if (code == 200 || code >= 400) {
+    reply(interest, process.response);
+    return;
+  }
+
+  auto& completionWaiters = process.extend().completionWaiters;
+  if (completionWaiters.size() >= MAX_COMPLETION_WAITERS) {
+    completionWaiters.erase(completionWaiters.begin());
+  }
+  completionWaiters.push_back(interest);
+}
+
+void
+WriteHandle::notifyCompletion(ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  ProcessInfo& process = it->second;
+  if (process.extension == nullptr) {
+    return;
+  }
+  for (const auto& interest : process.extension->completionWaiters) {
+    reply(interest, process.response);
+  }
+  process.extension->completionWaiters.clear();
+}
+
 void
 WriteHandle::handleInfoCommand(const Name& prefix, const Interest& interest)
 {
@@ -437,7 +2210,60 @@ WriteHandle::onRegisterFailed(const Name& prefix, const std::string& reason)
 void
 WriteHandle::deferredDeleteProcess(ProcessId processId)
 {
-  scheduler.schedule(PROCESS_DELETE_TIME, [=] { deleteProcess(processId); });
+  notifyCompletion(processId);
+  forgetProcess(processId);
+  m_processes.expireAfter(processId, PROCESS_DELETE_TICKS);
+
+  m_ingest.finish(processId);
+  pollIngest();
+
+  const ProcessInfo& process = m_processes[processId];
+  if (process.response.getCode() == 200 && process.manifest != nullptr &&
+      !process.manifest->getDigest().empty() && process.sharedContent == nullptr) {
+    registerContent(processId);
+  }
+}
+
+void
+WriteHandle::finishProcess(ProcessId processId, int statusCode)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return;
+  }
+
+  RepoCommandResponse& response = it->second.response;
+  if (response.getCode() == 200 || response.getCode() >= 400) {
+    return;
+  }
+
+  // segments fetched before the name was confirmed were never stored
+  if (it->second.extension != nullptr) {
+    it->second.extension->speculativeData.clear();
+  }
+  response.setCode(statusCode);
+  replyInsert(processId, statusCode);
+  cancelPieces(processId);
+  deferredDeleteProcess(processId);
+}
+
+void
+WriteHandle::replyInsert(ProcessId processId, int statusCode)
+{
+  ProcessInfo& process = m_processes[processId];
+  if (process.insertReply == nullptr) {
+    return;
+  }
+
+  auto done = std::move(process.insertReply);
+  process.insertReply = nullptr;
+
+  RepoCommandResponse response;
+  response.setCode(statusCode);
+  response.setProcessId(processId);
+  response.setInsertNum(0);
+  response.setBody(response.wireEncode());
+  done(response);
 }
 
 void
@@ -475,31 +2301,56 @@ WriteHandle::writeManifest(const ProcessId& processId)
   int endBlockId = process.endBlockId;
 
   Manifest manifest(name, startBlockId, endBlockId);
-  manifest.appendRepo(repo, startBlockId, endBlockId);
+  manifest.setErasureCoding(process.dataFragments, process.parityFragments);
+  if (process.info != nullptr && ContentRecord::isDigest(process.info->getDigest())) {
+    manifest.setDigest(process.info->getDigest());
+  }
+  if (process.stripes.empty()) {
+    manifest.appendRepo(repo, startBlockId, endBlockId);
+  }
+  else {
+    for (const auto& stripe : process.stripes) {
+      manifest.appendRepo(stripe.name, stripe.start, stripe.end);
+    }
+  }
   auto hash = manifest.getHash();
   NDN_LOG_DEBUG("Manifest name: " << name << " hash: " << hash << " end: " << endBlockId);
 
   // Save it for later info command
   process.manifest = std::make_shared<Manifest>(manifest);
+  sendManifest(processId);
+}
 
-  auto manifestRepo = m_keySpaceHandle.getManifestStorage(hash);
-
-  NDN_LOG_DEBUG("Using manifest repo: " << manifestRepo);
+void
+WriteHandle::sendManifest(const ProcessId& processId)
+{
+  const Manifest& manifest = *m_processes[processId].manifest;
+  auto hash = manifest.getHash();
 
   RepoCommandParameter parameters;
   parameters.setName(hash);
   parameters.setClusterPrefix(ndn::encoding::makeBinaryBlock(tlv::ClusterPrefix, m_clusterNodePrefix.toUri().c_str(), m_clusterNodePrefix.toUri().length()));
 
   parameters.setProcessId(processId);
+  auto json = manifest.toJson();
+  if (json.size() <= MAX_INLINE_MANIFEST) {
+    parameters.setManifest(json);
+  }
   NDN_LOG_DEBUG("Write manifest for pid " << processId);
-  Interest createInterest = util::generateCommandInterest(
-    manifestRepo, "create", parameters, m_interestLifetime);
-  
-  face.expressInterest(
-    createInterest,
-    std::bind(&WriteHandle::onCreateCommandResponse, this, _1, _2, processId),
-    std::bind(&WriteHandle::onCreateCommandTimeout, this, _1, processId),
-    std::bind(&WriteHandle::onCreateCommandTimeout, this, _1, processId));
+
+  // the owner and its successors each fetch the manifest through write-info
+  for (const auto& manifestRepo : m_keySpaceHandle.getManifestStorages(hash)) {
+    NDN_LOG_DEBUG("Using manifest repo: " << manifestRepo);
+
+    Interest createInterest = util::generateCommandInterest(
+      manifestRepo, "create", parameters, m_interestLifetime);
+
+    face.expressInterest(
+      createInterest,
+      std::bind(&WriteHandle::onCreateCommandResponse, this, _1, _2, processId),
+      std::bind(&WriteHandle::onCreateCommandTimeout, this, _1, processId),
+      std::bind(&WriteHandle::onCreateCommandTimeout, this, _1, processId));
+  }
 }
 
 void
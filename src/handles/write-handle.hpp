@@ -21,12 +21,23 @@
 #define REPO_HANDLES_WRITE_HANDLE_HPP
 
 #include "command-base-handle.hpp"
+#include "process-table.hpp"
 #include "keyspace-handle.hpp"
+#include "placement-handle.hpp"
+#include "../fetch/congestion-control.hpp"
+#include "../fetch/hash-chain-verifier.hpp"
+#include "../fetch/ingest-scheduler.hpp"
+#include "../fetch/segment-bitmap.hpp"
+#include "../fetch/validation-pool.hpp"
+#include "../manifest/content-record.hpp"
 
 #include <ndn-cxx/mgmt/dispatcher.hpp>
 #include <ndn-cxx/util/hc-segment-fetcher.hpp>
+#include <ndn-cxx/util/sha256.hpp>
 
-#include <queue>
+#include <limits>
+#include <memory>
+#include <set>
 
 namespace repo {
 
@@ -50,6 +61,10 @@ namespace repo {
  * If client sends a insert check command, the noendTimeout timer will be set to 0.
  *
  * If repo cannot get FinalBlockId in noendTimeout time, the fetching process will terminate.
+ *
+ * Beyond fetching, WriteHandle places the file on the nodes picked by the PlacementHandle,
+ * as contiguous stripes or erasure-coded fragments fetched by each node, and writes the
+ * manifest once the owner confirms that the name is free.
  */
 class WriteHandle : public CommandBaseHandle
 {
@@ -67,22 +82,109 @@ public:
 
 
 public:
-  WriteHandle(Face& face, KeySpaceHandle& keySpaceHandle, RepoStorage& storageHandle,
+  WriteHandle(Face& face, KeySpaceHandle& keySpaceHandle, PlacementHandle& placementHandle,
+              RepoStorage& storageHandle,
               ndn::mgmt::Dispatcher& dispatcher, Scheduler& scheduler,
-              Validator& validator,
-              ndn::Name const& clusterNodePrefix, std::string clusterPrefix);
+              Validator& validator, ValidationPool& validationPool,
+              ndn::Name const& clusterNodePrefix, std::string clusterPrefix,
+              size_t stripeWidth = 1, const std::string& congestionControl = "aimd",
+              size_t fetchStreams = 1,
+              const IngestScheduler::Limits& ingestLimits = IngestScheduler::Limits(),
+              size_t flowPrefixLength = 0);
+
+  /**
+   * @brief ingest state reported by the PlacementHandle
+   */
+  PlacementHandle::LocalLoad
+  getLoad() const;
 
 private:
+  /**
+   * @brief one segment fetcher of an insert and its share of the segments
+   */
+  struct FetchStream
+  {
+    SegmentNo start = 0;
+    SegmentNo end = std::numeric_limits<SegmentNo>::max();  ///< max while the end is not known
+    ndn::DelegationList forwardingHint;
+    bool isChainStart = false;       ///< starts where the hash chain of the producer is anchored
+
+    std::string pathKey;             ///< producer the segments are fetched from
+    ndn::time::steady_clock::TimePoint fetchStart;
+    ndn::time::steady_clock::TimePoint firstSegmentAt;
+    uint64_t nFetched = 0;           ///< segments of the range received
+
+    bool
+    isComplete() const
+    {
+      return end != std::numeric_limits<SegmentNo>::max() && nFetched >= end - start + 1;
+    }
+  };
+
+  /**
+   * @brief a hash-chained range fetched by a stripe process, here or on another node
+   */
+  struct ChainPiece
+  {
+    ndn::Name node;                  ///< node fetching the range
+    ProcessId processId = 0;         ///< its stripe process, zero until it answered
+    std::vector<uint8_t> anchor;     ///< digest of the first segment, empty while not known
+    bool isDone = false;
+  };
+
+  /**
+   * @brief state that only some processes need: stripe fetches, hash-chain checks,
+   *        segments fetched ahead of the find answer, and resumable inserts
+   */
+  struct ProcessExtension
+  {
+    ndn::Name coordinator;           ///< node waiting for this stripe, if fetching a stripe
+    ProcessId coordinatorProcessId = 0;
+
+    HashChainVerifier hashChain;           ///< digest-signed stripe segments waiting for a run
+    std::map<SegmentNo, Data> unverified;  ///< those segments, by segment number
+    uint64_t nReceived = 0;                ///< stripe segments arrived so far
+    bool isChained = false;                ///< stripe segments are trusted through the hash chain
+    std::vector<uint8_t> tailHash;         ///< digest the last stripe segment chains to
+    std::map<SegmentNo, ChainPiece> pieces;  ///< hash-chained stripes of the insert, by start
+
+    std::vector<Data> speculativeData;  ///< segments fetched while the name was not confirmed
+
+    std::shared_ptr<SegmentBitmap> received;  ///< segments stored, if the insert can be resumed
+    uint64_t nUnsaved = 0;                    ///< segments stored since the bitmap was saved
+    std::vector<Interest> completionWaiters;  ///< insert-done Interests to answer at the end
+  };
+
   /**
   * @brief Information of insert process including variables for response
   *        and credit based flow control
   */
   struct ProcessInfo
   {
+    /**
+     * @return the extension, allocated on first use
+     */
+    ProcessExtension&
+    extend()
+    {
+      if (extension == nullptr) {
+        extension = std::make_unique<ProcessExtension>();
+      }
+      return *extension;
+    }
+
+    /**
+     * @return the extension, or a default one if it is not allocated
+     */
+    const ProcessExtension&
+    getExtension() const
+    {
+      static const ProcessExtension none;
+      return extension != nullptr ? *extension : none;
+    }
+
     RepoCommandResponse response;
-    std::queue<SegmentNo> nextSegmentQueue;  ///< queue of waiting segment
-                                        ///  to be sent when having credits
-    SegmentNo nextSegment;  ///< last segment put into the nextSegmentQueue
+    SegmentNo nextSegment;  ///< next segment of a stripe to request
     std::map<SegmentNo, int> retryCounts;  ///< to store retrying times of timeout segment
     int credit;  ///< congestion control credits of process
 
@@ -103,6 +205,33 @@ private:
     std::shared_ptr<Manifest> manifest;
 
     bool manifestSent = false;
+
+    std::vector<Manifest::Repo> stripes;  ///< empty unless the file is striped
+    SegmentNo lastLocalBlockId = std::numeric_limits<SegmentNo>::max();  ///< end of own stripe
+
+    ndn::DelegationList nodePrefix;  ///< forwarding hint towards the producer
+    SegmentNo stride = 1;            ///< distance between two segments of the stripe
+
+    int dataFragments = 0;           ///< k, zero unless erasure coded
+    int parityFragments = 0;         ///< m
+    size_t nPendingParity = 0;       ///< parity fragments not stored yet
+
+    std::shared_ptr<Manifest> info;  ///< the producer's info, once fetched
+    bool isSpeculative = false;      ///< the owner has not confirmed yet that the name is free
+    bool isFetchStarted = false;
+    ndn::mgmt::CommandContinuation insertReply;  ///< answers insert once the name is confirmed
+
+    std::vector<FetchStream> streams;
+    ndn::Name fetchName;                      ///< name the segments are fetched under
+    std::string flow;                         ///< ingest flow the insert is scheduled in
+    unsigned fetchGeneration = 0;             ///< bumped by resume, so that older fetchers stop
+
+    size_t window = IngestScheduler::UNLIMITED;  ///< segments in flight granted to the fetch
+
+    bool isContentPending = false;          ///< waiting for the content index before planning
+    std::shared_ptr<Manifest> sharedContent;  ///< copy of the same content already stored
+
+    std::unique_ptr<ProcessExtension> extension;  ///< null until a process needs it
   };
 
 private: // insert command
@@ -119,6 +248,21 @@ private: // insert command
       const Interest &findInterest, const Data &findData,
       const Interest &origInterest, const RepoCommandParameter &repoParameter, const ndn::mgmt::CommandContinuation &done);
 
+  /**
+   * @brief go on with a pipelined insert once the owner answered find
+   */
+  void
+  onInsertFindResponse(const Interest& interest, const Data& data, ProcessId processId);
+
+  void
+  onInsertFindTimeout(const Interest& interest, ProcessId processId);
+
+  /**
+   * @brief store the segments fetched before the name was confirmed
+   */
+  void
+  storeSpeculativeData(ProcessId processId);
+
   void onValidationFailed(const Interest &interest, const ValidationError &error);
 
 private: // single data fetching
@@ -137,16 +281,37 @@ private: // single data fetching
   void
   onTimeout(const Interest& interest, ProcessId processId);
 
-  void
+  /**
+   * @brief start a process and fetch the info Data named in @p parameter
+   *
+   * The insert command is answered once the owner confirmed that the name is free.
+   */
+  ProcessId
   processSingleInsertCommand(const Interest& interest, const RepoCommandParameter& parameter,
                              const ndn::mgmt::CommandContinuation& done);
 
+  /**
+   * @brief place the segments of a file once its info is known
+   */
+  void
+  planInsert(ProcessId processId);
+
+  /**
+   * @brief write the manifest and fetch the segments as planned from the info
+   */
+  void
+  startFetch(ProcessId processId);
+
+  RepoCommandParameter
+  makeFetchParameter(const ProcessInfo& process) const;
+
 private:  // segmented data fetching
   /**
    * @brief fetch segmented data
    */
   void
-  onSegmentData(ndn::util::HCSegmentFetcher& fetcher, const Data& data, ProcessId processId);
+  onSegmentData(ndn::util::HCSegmentFetcher& fetcher, const Data& data, ProcessId processId,
+                size_t streamIndex, unsigned fetchGeneration);
 
   /**
    * @brief handle when fetching segmented data timeout
@@ -155,15 +320,175 @@ private:  // segmented data fetching
   onSegmentTimeout(ndn::util::HCSegmentFetcher& fetcher, ProcessId processId);
 
   /**
-   * @brief initiate fetching segmented data
+   * @brief initiate fetching segmented data, split into streams if the range is known
    */
   void
   segInit(ProcessId processId, const RepoCommandParameter& parameter);
 
+  /**
+   * @brief fetch a stream with HCSegmentFetcher, or as a stripe if it starts mid-chain
+   */
+  void
+  startStream(ProcessId processId, const Name& name, size_t streamIndex);
+
+  /**
+   * @brief queue the streams of a process in the IngestScheduler
+   */
+  void
+  enqueueFetch(ProcessId processId);
+
+  /**
+   * @brief the ingest flow of an insert of @p name commanded by @p signer
+   *
+   * Flows are the command signers, unless a flow prefix length is configured or the
+   * command is not signed; then they are that many components of @p name, at least one.
+   */
+  std::string
+  getFlow(const Name& signer, const Name& name) const;
+
+  /**
+   * @brief start the streams of the fetches the IngestScheduler lets through
+   */
+  void
+  pollIngest();
+
+  /**
+   * @brief feed the round-trip time and rate of a finished fetch into the path history
+   */
+  void
+  onSegmentFetched(FetchStream& stream, const Data& data);
+
   void
   processSegmentedInsertCommand(const Interest& interest, const RepoCommandParameter& parameter,
                                 const ndn::mgmt::CommandContinuation& done);
 
+private: // striped data fetching
+  /**
+   * @brief split [startBlockId, endBlockId] across the best placement targets
+   * @return one stripe per node; a single stripe if the file is not striped
+   */
+  std::vector<Manifest::Repo>
+  makeStripes(SegmentNo startBlockId, SegmentNo endBlockId);
+
+  /**
+   * @brief place k data and m parity fragments on distinct nodes, best targets first
+   * @return k+m repos, data fragments first; empty if there are not enough nodes
+   */
+  std::vector<Manifest::Repo>
+  makeErasureStripes(int k, int m, SegmentNo startBlockId, SegmentNo endBlockId);
+
+  /**
+   * @brief have the node of @p stripe fetch it
+   *
+   * A chained stripe is a piece of the producer's hash chain. Its segments are stored only
+   * once the anchor passed from the piece before it reaches them.
+   */
+  void
+  sendFetchStripeCommand(ProcessId processId, const Name& name,
+                         const Manifest::Repo& stripe, SegmentNo stride, bool isChained = false);
+
+  /**
+   * @brief fetch the segments of a stripe for another node
+   */
+  void
+  handleFetchStripeCommand(const Name& prefix, const Interest& interest);
+
+  ProcessId
+  startStripeFetch(const Name& name, SegmentNo startBlockId, SegmentNo endBlockId,
+                   SegmentNo stride, const ndn::DelegationList& nodePrefix,
+                   const Name& coordinator, ProcessId coordinatorProcessId, bool isChained);
+
+  void
+  stripeSendInterests(ProcessId processId);
+
+  void
+  onStripeData(const Interest& interest, const Data& data, ProcessId processId);
+
+  /**
+   * @brief trust the chained stripe of @p processId from @p segmentNo, which has @p digest
+   */
+  void
+  setStripeAnchor(ProcessId processId, SegmentNo segmentNo, const std::vector<uint8_t>& digest);
+
+  void
+  submitStripeRuns(ProcessId processId, std::vector<HashChainVerifier::Run> runs);
+
+  /**
+   * @brief check the digests and links of a run of stripe segments on the ValidationPool
+   */
+  void
+  verifyStripeRun(ProcessId processId, HashChainVerifier::Run run);
+
+  /**
+   * @brief store a stripe segment once its digest or signature is checked
+   */
+  void
+  onStripeDataVerified(const Data& data, ProcessId processId, bool isValid);
+
+  void
+  onStripeTimeout(const Interest& interest, ProcessId processId);
+
+  /**
+   * @brief tell the coordinator whether the stripe of @p processId was stored
+   */
+  void
+  reportStripe(ProcessId processId, bool isStored);
+
+  /**
+   * @brief give up on a stripe, so the insert coordinating it fails too
+   */
+  void
+  failStripe(ProcessId processId);
+
+  void
+  handleStripeDoneCommand(const Name& prefix, const Interest& interest);
+
+  void
+  handleStripeFailedCommand(const Name& prefix, const Interest& interest);
+
+  void
+  handleStripeAnchorCommand(const Name& prefix, const Interest& interest);
+
+  void
+  handleStripeCancelCommand(const Name& prefix, const Interest& interest);
+
+  /**
+   * @brief record the digest of segment @p segmentNo and pass it to the piece starting there
+   *
+   * An empty @p digest means the chain ends before the piece, so the insert fails.
+   */
+  void
+  passAnchor(ProcessId processId, SegmentNo segmentNo, const std::vector<uint8_t>& digest);
+
+  void
+  sendStripeAnchor(ProcessId processId, SegmentNo start, int retries = 0);
+
+  /**
+   * @brief stop the stripe processes of pieces not stored yet
+   */
+  void
+  cancelPieces(ProcessId processId);
+
+  /**
+   * @brief account for a stripe or fragment stored by this node or another one
+   */
+  void
+  onStripeStored(ProcessId processId, const Name& name,
+                 SegmentNo startBlockId, SegmentNo endBlockId, SegmentNo stride);
+
+  /**
+   * @brief fail an insert one of whose stripes could not be fetched or stored
+   */
+  void
+  onStripeFailed(ProcessId processId, const Name& name);
+
+  /**
+   * @brief set StatusCode 200 once all segments and parity fragments of a striped insert
+   *        are stored
+   */
+  void
+  checkStripedProcess(ProcessId processId);
+
 private:
   /**
    * @brief extends noEndTime of process if not noEndTimeout, set StatusCode 405
@@ -174,6 +499,55 @@ private:
   void
   extendNoEndTime(ProcessInfo& process);
 
+private: // content dedup
+  void
+  onContentFindResponse(const Interest& interest, const Data& data, ProcessId processId);
+
+  void
+  onContentFindTimeout(const Interest& interest, ProcessId processId);
+
+  /**
+   * @brief count the new key as a user of the stored copy, then write its manifest
+   */
+  void
+  shareContent(ProcessId processId);
+
+  void
+  onContentRefResponse(const Interest& interest, const Data& data, ProcessId processId);
+
+  /**
+   * @brief fetch the file after all, if its content could not be shared
+   */
+  void
+  onContentRefFailed(ProcessId processId);
+
+  /**
+   * @brief segments of a completed insert being hashed before the content is indexed
+   */
+  struct ContentHash
+  {
+    std::shared_ptr<Manifest> manifest;
+    ndn::Name contentStorage;  ///< node keeping the record of the digest
+    ndn::util::Sha256 digest;
+    SegmentNo nextSegment;
+    SegmentNo endBlockId;
+  };
+
+  /**
+   * @brief index the content of an insert that completed, so that later copies share it
+   *
+   * Only a file stored whole on this node is indexed, once its segments were hashed here.
+   */
+  void
+  registerContent(ProcessId processId);
+
+  /**
+   * @brief hash the next segments of @p task, a chunk per turn of the io thread, then send
+   *        content-register if the digest matches
+   */
+  void
+  hashContent(std::shared_ptr<ContentHash> task);
+
 private: // insert state check command
   /**
    * @brief handle insert check command
@@ -187,6 +561,64 @@ private: // insert state check command
   void
   onCheckValidationFailed(const Interest& interest, const ValidationError& error);
 
+private: // resumable inserts
+  /**
+   * @brief keep the bitmap of a local insert with a known range, and save it
+   */
+  void
+  makeResumable(ProcessId processId, const RepoCommandParameter& parameter);
+
+  /**
+   * @return false if the segment of @p data was already counted for the process
+   */
+  bool
+  markStored(ProcessId processId, const Data& data);
+
+  void
+  saveProcess(ProcessId processId);
+
+  /**
+   * @brief drop the saved state of a process that is over
+   */
+  void
+  forgetProcess(ProcessId processId);
+
+  void
+  saveProcessIndex();
+
+  /**
+   * @brief load the inserts saved before a restart; they wait for insert resume
+   */
+  void
+  loadProcesses();
+
+  void
+  handleResumeCommand(const Name& prefix, const Interest& interest,
+                      const ndn::mgmt::ControlParameters& parameters,
+                      const ndn::mgmt::CommandContinuation& done);
+
+  /**
+   * @brief fetch the missing segments of a process again, over up to fetch-streams streams
+   */
+  void
+  resumeFetch(ProcessId processId);
+
+private: // insert completion notification
+  /**
+   * @brief answer /<cluster prefix>/insert-done/<processId> once the insert is over
+   *
+   * The Interest is not signed: it only reveals the status of an insert to whoever knows
+   * its process id. It is answered right away if the insert is already over.
+   */
+  void
+  handleInsertDoneCommand(const Name& prefix, const Interest& interest);
+
+  /**
+   * @brief answer the insert-done Interests of a process whose status code is final
+   */
+  void
+  notifyCompletion(ProcessId processId);
+
 private:
   void
   handleInfoCommand(const Name& prefix, const Interest& interest);
@@ -195,15 +627,32 @@ private:
   onRegisterFailed(const Name& prefix, const std::string& reason);
 
 private:
+  /**
+   * @brief erase the processes whose time is up, once per tick
+   */
   void
-  deleteProcess(ProcessId processId);
+  expireProcesses();
 
   /**
-   * @brief schedule a event to delete the process
+   * @brief erase the process a few seconds from now, once its final status could be read
    */
   void
   deferredDeleteProcess(ProcessId processId);
 
+  /**
+   * @brief end a process that failed with @p statusCode, dropping the segments kept in memory
+   *
+   * Waiters on insert-done get the final response before the process is erased.
+   */
+  void
+  finishProcess(ProcessId processId, int statusCode);
+
+  /**
+   * @brief answer the insert command of @p processId with @p statusCode, if not done yet
+   */
+  void
+  replyInsert(ProcessId processId, int statusCode);
+
   RepoCommandResponse
   negativeReply(std::string text, int statusCode);
 
@@ -211,6 +660,12 @@ private:
   void
   writeManifest(const ProcessId& processId);
 
+  /**
+   * @brief send create for the manifest of the process to the manifest owners
+   */
+  void
+  sendManifest(const ProcessId& processId);
+
   void
   onCreateCommandResponse(const Interest& interest, const Data& data, const ProcessId& processId);
 
@@ -219,20 +674,31 @@ private:
 
 private:
   Validator& m_validator;
+  ValidationPool& m_validationPool;
 
-  std::map<ProcessId, ProcessInfo> m_processes;
+  ProcessTable<ProcessInfo> m_processes;
+  ndn::scheduler::ScopedEventId m_expiryEvent;
+  std::set<ProcessId> m_savedProcesses;
 
   int m_credit;
   bool m_canBePrefix;
   ndn::time::milliseconds m_maxTimeout;
   ndn::time::milliseconds m_noEndTimeout;
   ndn::time::milliseconds m_interestLifetime;
+  size_t m_stripeWidth;
+  std::unique_ptr<CongestionControl> m_congestionControl;
+  PathHistory m_pathHistory;
+  size_t m_fetchStreams;
+  IngestScheduler m_ingest;
+  size_t m_flowPrefixLength;  ///< zero to key ingest flows by the signer of the insert command
 
   ndn::Name m_clusterNodePrefix;
   std::string m_clusterPrefix;
   ndn::Name m_repoPrefix;
 
   KeySpaceHandle& m_keySpaceHandle;
+  PlacementHandle& m_placementHandle;
+  uint64_t m_nStoredSegments;
 };
 
 } // namespace repo
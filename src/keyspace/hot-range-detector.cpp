@@ -0,0 +1,126 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "hot-range-detector.hpp"
+
+#include <algorithm>
+
+namespace repo {
+
+static const double MIN_RELIEF = 0.1;  // share of the hot range's load a shift must move
+
+HotRangeDetector::HotRangeDetector(double gain)
+  : m_gain(gain)
+{
+  m_counts.fill(0);
+  m_rates.fill(0);
+}
+
+void
+HotRangeDetector::add(int bucket)
+{
+  if (bucket >= 0 && bucket < N_BUCKETS) {
+    ++m_counts[bucket];
+  }
+}
+
+void
+HotRangeDetector::update(double seconds)
+{
+  if (seconds <= 0) {
+    return;
+  }
+
+  for (int bucket = 0; bucket < N_BUCKETS; ++bucket) {
+    m_rates[bucket] += m_gain * (m_counts[bucket] / seconds - m_rates[bucket]);
+    m_counts[bucket] = 0;
+  }
+}
+
+boost::optional<HotRangeDetector::Shift>
+HotRangeDetector::findShift(const std::vector<Range>& ranges, const Rates& rates,
+                            double hotRatio, double minRate)
+{
+  if (ranges.size() < 2) {
+    return boost::none;
+  }
+
+  std::vector<double> loads;
+  double total = 0;
+  for (const auto& range : ranges) {
+    double load = 0;
+    for (int bucket = std::max(range.start, 0); bucket <= std::min(range.end, N_BUCKETS - 1); ++bucket) {
+      load += rates[bucket];
+    }
+    loads.push_back(load);
+    total += load;
+  }
+
+  size_t hot = std::max_element(loads.begin(), loads.end()) - loads.begin();
+  double othersAverage = (total - loads[hot]) / (ranges.size() - 1);
+  if (loads[hot] < minRate || loads[hot] <= hotRatio * othersAverage ||
+      ranges[hot].start == ranges[hot].end) {
+    return boost::none;
+  }
+
+  // try the less loaded neighbour first
+  std::vector<size_t> neighbours;
+  if (hot > 0) {
+    neighbours.push_back(hot - 1);
+  }
+  if (hot + 1 < ranges.size()) {
+    neighbours.push_back(hot + 1);
+  }
+  std::sort(neighbours.begin(), neighbours.end(),
+            [&loads] (size_t a, size_t b) { return loads[a] < loads[b]; });
+
+  for (size_t neighbour : neighbours) {
+    // even the two loads out at most, walking from the shared boundary inwards
+    double excess = (loads[hot] - loads[neighbour]) / 2;
+    bool isAfter = neighbour > hot;
+    int step = isAfter ? -1 : 1;
+    int edge = isAfter ? ranges[hot].end : ranges[hot].start;
+    int size = ranges[hot].end - ranges[hot].start + 1;
+
+    double moved = 0;
+    int nMoved = 0;  // buckets up to the last loaded one, cold ones beyond it stay
+    for (int i = 0; i < size - 1; ++i) {
+      double rate = rates[edge + step * i];
+      if (moved + rate > excess) {
+        break;
+      }
+      if (rate > 0) {
+        moved += rate;
+        nMoved = i + 1;
+      }
+    }
+
+    if (nMoved == 0 || moved < MIN_RELIEF * loads[hot]) {
+      continue;
+    }
+
+    int last = edge + step * (nMoved - 1);
+    return Shift{hot, neighbour, std::min(edge, last), std::max(edge, last)};
+  }
+
+  return boost::none;
+}
+
+} // namespace repo
@@ -0,0 +1,115 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_KEYSPACE_HOT_RANGE_DETECTOR_HPP
+#define REPO_KEYSPACE_HOT_RANGE_DETECTOR_HPP
+
+#include <boost/optional.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace repo {
+
+/**
+ * @brief request rates of the keyspace buckets, and boundary shifts that even them out
+ *
+ * A bucket is the first byte of a manifest hash, the unit the keyspace ranges are made of.
+ * With 256 buckets an exact counter per bucket costs no more than a count-min sketch and
+ * never over-counts, so requests are counted exactly and smoothed into rates on update().
+ *
+ * findShift() moves the edge of the busiest range to the less loaded of its two neighbours,
+ * so that every node keeps a single contiguous range and the usual coordination can move
+ * the manifests. A single hot bucket cannot be split and is left where it is.
+ */
+class HotRangeDetector
+{
+public:
+  static const int N_BUCKETS = 256;
+
+  using Rates = std::array<double, N_BUCKETS>;
+
+  struct Range
+  {
+    int start;
+    int end;
+  };
+
+  /**
+   * @brief buckets [start, end] handed over from ranges[from] to its neighbour ranges[to]
+   */
+  struct Shift
+  {
+    size_t from;
+    size_t to;
+    int start;
+    int end;
+  };
+
+public:
+  /**
+   * @param gain weight of the last interval in the smoothed rates
+   */
+  explicit
+  HotRangeDetector(double gain = 0.25);
+
+  /**
+   * @brief count one request for @p bucket
+   */
+  void
+  add(int bucket);
+
+  /**
+   * @brief fold the requests counted over the last @p seconds into the rates
+   */
+  void
+  update(double seconds);
+
+  /**
+   * @return requests per second of every bucket
+   */
+  const Rates&
+  getRates() const
+  {
+    return m_rates;
+  }
+
+  /**
+   * @brief find a boundary shift that relieves the busiest range
+   * @param ranges contiguous ranges ordered by start
+   * @param rates requests per second of every bucket over the whole cluster
+   * @param hotRatio how much busier than the average of the other ranges a range must be
+   * @param minRate requests per second below which no range is hot
+   * @return nothing if no range is hot, or if the neighbours cannot take any of its load
+   */
+  static boost::optional<Shift>
+  findShift(const std::vector<Range>& ranges, const Rates& rates, double hotRatio, double minRate);
+
+private:
+  double m_gain;
+  std::array<uint64_t, N_BUCKETS> m_counts;
+  Rates m_rates;
+};
+
+} // namespace repo
+
+#endif // REPO_KEYSPACE_HOT_RANGE_DETECTOR_HPP
@@ -0,0 +1,110 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "content-record.hpp"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/throw_exception.hpp>
+
+#include <cctype>
+#include <sstream>
+
+namespace repo {
+
+namespace pt = boost::property_tree;
+
+ContentRecord::ContentRecord(const pt::ptree& manifest)
+  : m_name(manifest.get<std::string>("info.name", ""))
+  , m_manifest(manifest)
+{
+  if (m_name.empty()) {
+    BOOST_THROW_EXCEPTION(Error("Manifest of a content record has no name"));
+  }
+}
+
+bool
+ContentRecord::addRef(const std::string& name, const std::string& key)
+{
+  if (name != m_name) {
+    return false;
+  }
+  m_refs.insert(key);
+  return true;
+}
+
+bool
+ContentRecord::release(const std::string& key)
+{
+  return m_refs.erase(key) > 0;
+}
+
+std::string
+ContentRecord::toJson() const
+{
+  pt::ptree root;
+  root.add_child("manifest", m_manifest);
+
+  pt::ptree refs;
+  for (const auto& key : m_refs) {
+    pt::ptree ref;
+    ref.put_value(key);
+    refs.push_back(std::make_pair("", ref));
+  }
+  root.add_child("refs", refs);
+
+  std::stringstream os;
+  pt::write_json(os, root, false);
+  return os.str();
+}
+
+ContentRecord
+ContentRecord::fromJson(const std::string& json)
+{
+  pt::ptree root;
+  try {
+    std::istringstream is(json);
+    pt::read_json(is, root);
+
+    ContentRecord record(root.get_child("manifest"));
+    for (const auto& ref : root.get_child("refs")) {
+      record.m_refs.insert(ref.second.get_value<std::string>());
+    }
+    return record;
+  }
+  catch (const pt::ptree_error& e) {
+    BOOST_THROW_EXCEPTION(Error(std::string("Malformed content record: ") + e.what()));
+  }
+}
+
+bool
+ContentRecord::isDigest(const std::string& digest)
+{
+  if (digest.size() != 64) {
+    return false;
+  }
+  for (char c : digest) {
+    if (!std::isxdigit(static_cast<unsigned char>(c))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace repo
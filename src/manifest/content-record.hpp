@@ -0,0 +1,123 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_MANIFEST_CONTENT_RECORD_HPP
+#define REPO_MANIFEST_CONTENT_RECORD_HPP
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <set>
+#include <stdexcept>
+#include <string>
+
+namespace repo {
+
+/**
+ * @brief entry of the content index, kept by the keyspace owner of a whole-file digest
+ *
+ * It holds the manifest of the copy whose segments are shared, and the keys of the
+ * manifests that point at those segments. The segments may only be deleted along with the
+ * last key.
+ */
+class ContentRecord
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+public:
+  /**
+   * @param manifest the manifest as written by Manifest::toPtree()
+   * @throw Error the manifest has no name
+   */
+  explicit
+  ContentRecord(const boost::property_tree::ptree& manifest);
+
+  /**
+   * @return name the shared segments are stored under
+   */
+  const std::string&
+  getName() const
+  {
+    return m_name;
+  }
+
+  const boost::property_tree::ptree&
+  getManifest() const
+  {
+    return m_manifest;
+  }
+
+  /**
+   * @brief count the manifest of @p key as a user of the segments
+   * @return false if @p name is not the one of the shared segments
+   */
+  bool
+  addRef(const std::string& name, const std::string& key);
+
+  /**
+   * @return false if @p key did not use the segments
+   */
+  bool
+  release(const std::string& key);
+
+  bool
+  hasRef(const std::string& key) const
+  {
+    return m_refs.count(key) > 0;
+  }
+
+  size_t
+  getRefCount() const
+  {
+    return m_refs.size();
+  }
+
+  std::string
+  toJson() const;
+
+  /**
+   * @throw Error malformed record
+   */
+  static ContentRecord
+  fromJson(const std::string& json);
+
+  /**
+   * @return whether @p digest looks like a hex SHA-256 digest
+   */
+  static bool
+  isDigest(const std::string& digest);
+
+private:
+  std::string m_name;
+  boost::property_tree::ptree m_manifest;
+  std::set<std::string> m_refs;
+};
+
+} // namespace repo
+
+#endif // REPO_MANIFEST_CONTENT_RECORD_HPP
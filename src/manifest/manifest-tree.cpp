@@ -0,0 +1,149 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "manifest-tree.hpp"
+#include "../util.hpp"
+
+#include <boost/uuid/sha1.hpp>
+
+#include <algorithm>
+
+namespace repo {
+
+const size_t ManifestTree::N_BUCKETS;
+const size_t ManifestTree::ROOT;
+
+static ManifestTree::Digest
+toDigest(boost::uuids::detail::sha1& sha1)
+{
+  unsigned hashBlock[5] = {0};
+  sha1.get_digest(hashBlock);
+
+  ManifestTree::Digest digest;
+  for (int i = 0; i < 5; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      digest[4 * i + j] = static_cast<unsigned char>(hashBlock[i] >> (24 - 8 * j));
+    }
+  }
+  return digest;
+}
+
+ManifestTree::ManifestTree()
+  : m_nodes(2 * N_BUCKETS)
+  , m_buckets(N_BUCKETS)
+{
+}
+
+bool
+ManifestTree::insert(const std::string& hash)
+{
+  int bucket = util::getHashBucket(hash);
+  if (bucket < 0 || bucket >= static_cast<int>(N_BUCKETS) || !m_buckets[bucket].insert(hash).second) {
+    return false;
+  }
+
+  updateLeaf(bucket);
+  return true;
+}
+
+bool
+ManifestTree::erase(const std::string& hash)
+{
+  int bucket = util::getHashBucket(hash);
+  if (bucket < 0 || bucket >= static_cast<int>(N_BUCKETS) || m_buckets[bucket].erase(hash) == 0) {
+    return false;
+  }
+
+  updateLeaf(bucket);
+  return true;
+}
+
+void
+ManifestTree::updateLeaf(int bucket)
+{
+  size_t index = N_BUCKETS + bucket;
+  Node& leaf = m_nodes[index];
+  leaf.count = m_buckets[bucket].size();
+  leaf.digest = Digest{};
+  if (leaf.count > 0) {
+    boost::uuids::detail::sha1 sha1;
+    for (const auto& hash : m_buckets[bucket]) {
+      sha1.process_bytes(hash.data(), hash.size());
+      sha1.process_byte('\n');
+    }
+    leaf.digest = toDigest(sha1);
+  }
+
+  for (index /= 2; index >= ROOT; index /= 2) {
+    const Node& left = m_nodes[2 * index];
+    const Node& right = m_nodes[2 * index + 1];
+    Node& node = m_nodes[index];
+    node.count = left.count + right.count;
+    node.digest = Digest{};
+    if (node.count > 0) {
+      boost::uuids::detail::sha1 sha1;
+      sha1.process_bytes(left.digest.data(), left.digest.size());
+      sha1.process_bytes(right.digest.data(), right.digest.size());
+      node.digest = toDigest(sha1);
+    }
+  }
+}
+
+std::vector<size_t>
+ManifestTree::getRangeNodes(int start, int end)
+{
+  std::vector<size_t> left;
+  std::vector<size_t> right;
+  start = std::max(start, 0);
+  end = std::min(end, static_cast<int>(N_BUCKETS) - 1);
+  if (start > end) {
+    return left;
+  }
+
+  // bottom-up segment tree walk over the half-open leaf interval [lo, hi)
+  size_t lo = N_BUCKETS + start;
+  size_t hi = N_BUCKETS + end + 1;
+  while (lo < hi) {
+    if (lo & 1) {
+      left.push_back(lo++);
+    }
+    if (hi & 1) {
+      right.push_back(--hi);
+    }
+    lo /= 2;
+    hi /= 2;
+  }
+
+  left.insert(left.end(), right.rbegin(), right.rend());
+  return left;
+}
+
+std::string
+ManifestTree::toHex(const Digest& digest)
+{
+  static const char HEX[] = "0123456789abcdef";
+  std::string hex;
+  for (unsigned char byte : digest) {
+    hex += HEX[byte >> 4];
+    hex += HEX[byte & 0x0f];
+  }
+  return hex;
+}
+
+} // namespace repo
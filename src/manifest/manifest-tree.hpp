@@ -0,0 +1,121 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_MANIFEST_MANIFEST_TREE_HPP
+#define REPO_MANIFEST_MANIFEST_TREE_HPP
+
+#include <array>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace repo {
+
+/**
+ * @brief Merkle tree over the manifest hashes held by a node
+ *
+ * The tree has a fixed shape: one leaf per keyspace bucket (first byte of the hash) and a
+ * complete binary tree above them, indexed like a heap from the root at 1 to the leaves at
+ * N_BUCKETS ~ 2*N_BUCKETS-1. Any keyspace range is covered by a few subtrees, so two nodes
+ * compare a range by exchanging a handful of digests and only descend where they differ.
+ *
+ * A leaf digest is the SHA-1 of the sorted hashes of its bucket and an inner digest the SHA-1
+ * of its two children. Empty subtrees have an all-zero digest. Inserting or erasing a hash
+ * rehashes one bucket and its ancestors.
+ */
+class ManifestTree
+{
+public:
+  static const size_t N_BUCKETS = 256;
+  static const size_t ROOT = 1;
+
+  using Digest = std::array<unsigned char, 20>;
+
+  struct Node
+  {
+    Digest digest{};
+    size_t count = 0;  ///< hashes below this node
+  };
+
+public:
+  ManifestTree();
+
+  /**
+   * @return false if @p hash was already present or has no bucket
+   */
+  bool
+  insert(const std::string& hash);
+
+  /**
+   * @return false if @p hash was not present
+   */
+  bool
+  erase(const std::string& hash);
+
+  const Node&
+  getNode(size_t index) const
+  {
+    return m_nodes.at(index);
+  }
+
+  const std::set<std::string>&
+  getBucket(int bucket) const
+  {
+    return m_buckets.at(bucket);
+  }
+
+  size_t
+  size() const
+  {
+    return m_nodes[ROOT].count;
+  }
+
+  static bool
+  isLeaf(size_t index)
+  {
+    return index >= N_BUCKETS;
+  }
+
+  static int
+  getLeafBucket(size_t index)
+  {
+    return static_cast<int>(index - N_BUCKETS);
+  }
+
+  /**
+   * @return the fewest subtrees covering buckets [start, end], left to right
+   */
+  static std::vector<size_t>
+  getRangeNodes(int start, int end);
+
+  static std::string
+  toHex(const Digest& digest);
+
+private:
+  void
+  updateLeaf(int bucket);
+
+private:
+  std::vector<Node> m_nodes;  ///< index 0 is unused
+  std::vector<std::set<std::string>> m_buckets;
+};
+
+} // namespace repo
+
+#endif // REPO_MANIFEST_MANIFEST_TREE_HPP
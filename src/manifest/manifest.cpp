@@ -70,6 +70,8 @@ Manifest::fromInfoJson(std::string json)
     std::cerr << "Hash mismatch" << std::endl;
   }
   manifest.setHash(hash);
+  manifest.setErasureCoding(root.get<int>("ec.k", 0), root.get<int>("ec.m", 0));
+  manifest.setDigest(root.get<std::string>("digest", ""));
 
   return manifest;
 }
@@ -83,6 +85,13 @@ Manifest::toInfoJson()
   root.put("name", m_name);
   root.put("hash", getHash());
   root.put("segment", m_endBlockId);
+  if (isErasureCoded()) {
+    root.put("ec.k", m_dataFragments);
+    root.put("ec.m", m_parityFragments);
+  }
+  if (!m_digest.empty()) {
+    root.put("digest", m_digest);
+  }
 
   std::stringstream os;
   pt::write_json(os, root, false);
@@ -100,12 +109,22 @@ Manifest::fromJson(std::string json)
   ss << json;
   pt::read_json(ss, root);
 
+  return fromPtree(root);
+}
+
+Manifest
+Manifest::fromPtree(const boost::property_tree::ptree& root)
+{
   std::string name = root.get<std::string>("info.name");
   std::string hash = root.get<std::string>("info.hash");
   int startBlockId = root.get<int>("info.startBlockId");
   int endBlockId = root.get<int>("info.endBlockId");
 
   Manifest manifest(name, startBlockId, endBlockId);
+  // a manifest sharing the segments of another file is stored under its own key
+  manifest.setHash(hash);
+  manifest.setErasureCoding(root.get<int>("info.ec.k", 0), root.get<int>("info.ec.m", 0));
+  manifest.setDigest(root.get<std::string>("info.digest", ""));
 
   for (auto& item : root.get_child("storages")) {
     std::string repoName = item.second.get<std::string>("storage_name");
@@ -123,11 +142,29 @@ Manifest::toJson() const
 {
   namespace pt = boost::property_tree;
 
+  std::stringstream os;
+  pt::write_json(os, toPtree(), false);
+
+  return os.str();
+}
+
+boost::property_tree::ptree
+Manifest::toPtree() const
+{
+  namespace pt = boost::property_tree;
+
   pt::ptree root;
   root.put("info.name", m_name);
   root.put("info.hash", getHash());
   root.put("info.startBlockId", m_startBlockId);
   root.put("info.endBlockId", m_endBlockId);
+  if (isErasureCoded()) {
+    root.put("info.ec.k", m_dataFragments);
+    root.put("info.ec.m", m_parityFragments);
+  }
+  if (!m_digest.empty()) {
+    root.put("info.digest", m_digest);
+  }
 
   if (!m_repos.empty()) {
     pt::ptree children;
@@ -146,10 +183,7 @@ Manifest::toJson() const
     root.put("segment", m_endBlockId);
   }
 
-  std::stringstream os;
-  pt::write_json(os, root, false);
-
-  return os.str();
+  return root;
 }
 
 ndn::Name
@@ -170,6 +204,12 @@ Manifest::appendRepo(std::string repoName, int start, int end)
   m_repos.push_back(repo);
 }
 
+void
+Manifest::setRepos(const std::list<Repo>& repos)
+{
+  m_repos = repos;
+}
+
 std::string
 Manifest::getName() const
 {
@@ -203,5 +243,18 @@ Manifest::getEndBlockId()
   return m_endBlockId;
 }
 
+void
+Manifest::setErasureCoding(int k, int m)
+{
+  m_dataFragments = k;
+  m_parityFragments = k > 0 ? m : 0;
+}
+
+ndn::Name
+Manifest::getParityName(int j) const
+{
+  return ndn::Name(m_name).append("parity").appendNumber(j);
+}
+
 } // namespace repo
 // vim: cino=g0,N-s,+0 sw=2
@@ -3,6 +3,8 @@
 
 #include <ndn-cxx/face.hpp>
 
+#include <boost/property_tree/ptree.hpp>
+
 namespace repo {
 
 class Manifest
@@ -21,6 +23,8 @@ public:
   , m_repos(std::list<Repo>())
   , m_startBlockId(startBlockId)
   , m_endBlockId(endBlockId)
+  , m_dataFragments(0)
+  , m_parityFragments(0)
   {}
 
 public:
@@ -40,6 +44,12 @@ public:
   static Manifest
   fromJson(std::string json);
 
+  boost::property_tree::ptree
+  toPtree() const;
+
+  static Manifest
+  fromPtree(const boost::property_tree::ptree& root);
+
   std::string
   toInfoJson();
 
@@ -55,6 +65,9 @@ public:
   void
   appendRepo(std::string repoName, int start, int end);
 
+  void
+  setRepos(const std::list<Repo>& repos);
+
   std::string
   getName() const;
 
@@ -64,6 +77,23 @@ public:
   void
   setHash(std::string digest);
 
+  /**
+   * @brief SHA-256 of the whole file content, in hex, as advertised by the producer
+   *
+   * Empty if unknown. Files with the same digest share their segments.
+   */
+  const std::string&
+  getDigest() const
+  {
+    return m_digest;
+  }
+
+  void
+  setDigest(const std::string& digest)
+  {
+    m_digest = digest;
+  }
+
   int
   getStartBlockId();
 
@@ -76,14 +106,51 @@ public:
   void
   setEndBlockId();
 
+  /**
+   * @brief store the file as k data and m parity fragments
+   *
+   * Segment s belongs to data fragment s % k, row s / k. The first k repos hold the data
+   * fragments, the next m repos the parity fragments, named by getParityName().
+   */
+  void
+  setErasureCoding(int k, int m);
+
+  bool
+  isErasureCoded() const
+  {
+    return m_dataFragments > 0;
+  }
+
+  int
+  getDataFragments() const
+  {
+    return m_dataFragments;
+  }
+
+  int
+  getParityFragments() const
+  {
+    return m_parityFragments;
+  }
+
+  /**
+   * @brief name of parity fragment @p j, without segment; its segments are numbered by row
+   */
+  ndn::Name
+  getParityName(int j) const;
+
 private:
   std::string m_name;
   std::string m_hash;
+  std::string m_digest;
   std::list<Repo> m_repos;
 
   int m_startBlockId;
   int m_endBlockId;
 
+  int m_dataFragments;
+  int m_parityFragments;
+
 private:
   std::string
   makeHash() const;
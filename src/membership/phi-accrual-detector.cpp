@@ -0,0 +1,88 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "phi-accrual-detector.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace repo {
+
+PhiAccrualDetector::PhiAccrualDetector(ndn::time::milliseconds expectedInterval,
+                                       ndn::time::milliseconds minStdDev, size_t windowSize)
+  : m_minStdDev(minStdDev)
+  , m_windowSize(std::max<size_t>(windowSize, 1))
+  , m_sum(0)
+  , m_squaredSum(0)
+  , m_hasHeartbeat(false)
+{
+  // seed the window so that the first missed heartbeats are already judged
+  double interval = expectedInterval.count();
+  double deviation = interval / 4;
+  m_intervals.push_back(interval - deviation);
+  m_intervals.push_back(interval + deviation);
+  for (double sample : m_intervals) {
+    m_sum += sample;
+    m_squaredSum += sample * sample;
+  }
+}
+
+void
+PhiAccrualDetector::heartbeat(const ndn::time::steady_clock::TimePoint& now)
+{
+  if (m_hasHeartbeat) {
+    double interval = ndn::time::duration_cast<ndn::time::milliseconds>(now - m_lastHeartbeat).count();
+    m_intervals.push_back(interval);
+    m_sum += interval;
+    m_squaredSum += interval * interval;
+
+    if (m_intervals.size() > m_windowSize) {
+      double oldest = m_intervals.front();
+      m_intervals.pop_front();
+      m_sum -= oldest;
+      m_squaredSum -= oldest * oldest;
+    }
+  }
+
+  m_hasHeartbeat = true;
+  m_lastHeartbeat = now;
+}
+
+double
+PhiAccrualDetector::phi(const ndn::time::steady_clock::TimePoint& now) const
+{
+  if (!m_hasHeartbeat) {
+    return 0;
+  }
+
+  double n = m_intervals.size();
+  double mean = m_sum / n;
+  double variance = std::max(m_squaredSum / n - mean * mean, 0.0);
+  double stdDev = std::max(std::sqrt(variance), static_cast<double>(m_minStdDev.count()));
+
+  double elapsed = ndn::time::duration_cast<ndn::time::milliseconds>(now - m_lastHeartbeat).count();
+  double pLater = 0.5 * std::erfc((elapsed - mean) / (stdDev * std::sqrt(2.0)));
+  if (pLater <= 0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  return -std::log10(pLater);
+}
+
+} // namespace repo
@@ -0,0 +1,80 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_MEMBERSHIP_PHI_ACCRUAL_DETECTOR_HPP
+#define REPO_MEMBERSHIP_PHI_ACCRUAL_DETECTOR_HPP
+
+#include <ndn-cxx/util/time.hpp>
+
+#include <deque>
+
+namespace repo {
+
+/**
+ * @brief phi accrual failure detector of Hayashibara et al.
+ *
+ * Heartbeat inter-arrival times are modelled as a normal distribution estimated over a
+ * sliding window. phi is -log10 of the probability that the next heartbeat is still to come
+ * after the time elapsed since the last one: phi 1 means a 10% chance of a wrong suspicion,
+ * phi 8 a 1e-8 chance. The threshold therefore adapts to the jitter of each link.
+ */
+class PhiAccrualDetector
+{
+public:
+  /**
+   * @param expectedInterval interval assumed until heartbeats have been measured
+   * @param minStdDev lower bound of the deviation, so that a very regular link does not
+   *                  turn every late heartbeat into a suspicion
+   */
+  explicit
+  PhiAccrualDetector(ndn::time::milliseconds expectedInterval,
+                     ndn::time::milliseconds minStdDev = ndn::time::milliseconds(100),
+                     size_t windowSize = 100);
+
+  /**
+   * @brief record a heartbeat received at @p now
+   */
+  void
+  heartbeat(const ndn::time::steady_clock::TimePoint& now);
+
+  /**
+   * @return suspicion level at @p now, 0 before the first heartbeat
+   */
+  double
+  phi(const ndn::time::steady_clock::TimePoint& now) const;
+
+  bool
+  hasHeartbeat() const
+  {
+    return m_hasHeartbeat;
+  }
+
+private:
+  ndn::time::milliseconds m_minStdDev;
+  size_t m_windowSize;
+  std::deque<double> m_intervals;  ///< milliseconds
+  double m_sum;
+  double m_squaredSum;
+  bool m_hasHeartbeat;
+  ndn::time::steady_clock::TimePoint m_lastHeartbeat;
+};
+
+} // namespace repo
+
+#endif // REPO_MEMBERSHIP_PHI_ACCRUAL_DETECTOR_HPP
@@ -111,6 +111,33 @@ RepoCommandParameter::setClusterPrefix(const Block& clusterPrefix)
   return *this;
 }
 
+RepoCommandParameter&
+RepoCommandParameter::setStride(uint64_t stride)
+{
+  m_stride = stride;
+  m_hasFields[REPO_PARAMETER_STRIDE] = true;
+  m_wire.reset();
+  return *this;
+}
+
+RepoCommandParameter&
+RepoCommandParameter::setManifest(const std::string& manifest)
+{
+  m_manifest = manifest;
+  m_hasFields[REPO_PARAMETER_MANIFEST] = true;
+  m_wire.reset();
+  return *this;
+}
+
+RepoCommandParameter&
+RepoCommandParameter::setNextHash(const std::vector<uint8_t>& nextHash)
+{
+  m_nextHash = nextHash;
+  m_hasFields[REPO_PARAMETER_NEXT_HASH] = true;
+  m_wire.reset();
+  return *this;
+}
+
 template<ndn::encoding::Tag T>
 size_t
 RepoCommandParameter::wireEncode(EncodingImpl<T>& encoder) const
@@ -118,6 +145,28 @@ RepoCommandParameter::wireEncode(EncodingImpl<T>& encoder) const
   size_t totalLength = 0;
   size_t variableLength = 0;
 
+  if (m_hasFields[REPO_PARAMETER_NEXT_HASH]) {
+    variableLength = encoder.prependByteArray(m_nextHash.data(), m_nextHash.size());
+    totalLength += variableLength;
+    totalLength += encoder.prependVarNumber(variableLength);
+    totalLength += encoder.prependVarNumber(tlv::NextHash);
+  }
+
+  if (m_hasFields[REPO_PARAMETER_MANIFEST]) {
+    variableLength = encoder.prependByteArray(reinterpret_cast<const uint8_t*>(m_manifest.data()),
+                                              m_manifest.size());
+    totalLength += variableLength;
+    totalLength += encoder.prependVarNumber(variableLength);
+    totalLength += encoder.prependVarNumber(tlv::Manifest);
+  }
+
+  if (m_hasFields[REPO_PARAMETER_STRIDE]) {
+    variableLength = encoder.prependNonNegativeInteger(m_stride);
+    totalLength += variableLength;
+    totalLength += encoder.prependVarNumber(variableLength);
+    totalLength += encoder.prependVarNumber(tlv::Stride);
+  }
+
   if (m_hasFields[REPO_PARAMETER_CLUSTER_PREFIX]) {
     totalLength += encoder.prependBlock(m_clusterPrefix);
   }
@@ -267,6 +316,30 @@ RepoCommandParameter::wireDecode(const Block& wire)
     m_hasFields[REPO_PARAMETER_CLUSTER_PREFIX] = true;
     m_clusterPrefix = m_wire.get(tlv::ClusterPrefix);
   }
+
+  // Stride
+  val = m_wire.find(tlv::Stride);
+  if (val != m_wire.elements_end())
+  {
+    m_hasFields[REPO_PARAMETER_STRIDE] = true;
+    m_stride = readNonNegativeInteger(*val);
+  }
+
+  // Manifest
+  val = m_wire.find(tlv::Manifest);
+  if (val != m_wire.elements_end())
+  {
+    m_hasFields[REPO_PARAMETER_MANIFEST] = true;
+    m_manifest = std::string(reinterpret_cast<const char*>(val->value()), val->value_size());
+  }
+
+  // NextHash
+  val = m_wire.find(tlv::NextHash);
+  if (val != m_wire.elements_end())
+  {
+    m_hasFields[REPO_PARAMETER_NEXT_HASH] = true;
+    m_nextHash.assign(val->value_begin(), val->value_end());
+  }
 }
 
 std::ostream&
@@ -306,6 +379,18 @@ operator<<(std::ostream& os, const RepoCommandParameter& repoCommandParameter)
   if (repoCommandParameter.hasProcessId()) {
     os << " InterestLifetime: " << repoCommandParameter.getInterestLifetime();
   }
+  // Stride
+  if (repoCommandParameter.hasStride()) {
+    os << " Stride: " << repoCommandParameter.getStride();
+  }
+  // Manifest
+  if (repoCommandParameter.hasManifest()) {
+    os << " Manifest: " << repoCommandParameter.getManifest().size() << " bytes";
+  }
+  // NextHash
+  if (repoCommandParameter.hasNextHash()) {
+    os << " NextHash: " << repoCommandParameter.getNextHash().size() << " bytes";
+  }
   os << " )";
   return os;
 }
@@ -47,6 +47,9 @@ enum RepoParameterField {
   REPO_PARAMETER_PROCESS_ID,
   REPO_PARAMETER_INTEREST_LIFETIME,
   REPO_PARAMETER_CLUSTER_PREFIX,
+  REPO_PARAMETER_STRIDE,
+  REPO_PARAMETER_MANIFEST,
+  REPO_PARAMETER_NEXT_HASH,
   REPO_PARAMETER_UBOUND
 };
 
@@ -59,7 +62,10 @@ const std::string REPO_PARAMETER_FIELD[REPO_PARAMETER_UBOUND] = {
   "EndBlockId",
   "ProcessId",
   "InterestLifetime",
-  "ClusterPrefix"
+  "ClusterPrefix",
+  "Stride",
+  "Manifest",
+  "NextHash"
 };
 
 /**
@@ -233,6 +239,62 @@ public:
     return m_hasFields[REPO_PARAMETER_CLUSTER_PREFIX];
   }
 
+  /**
+   * @brief distance between two segments of the range, 1 unless set
+   */
+  uint64_t
+  getStride() const
+  {
+    return hasStride() ? m_stride : 1;
+  }
+
+  RepoCommandParameter&
+  setStride(uint64_t stride);
+
+  bool
+  hasStride() const
+  {
+    return m_hasFields[REPO_PARAMETER_STRIDE];
+  }
+
+  /**
+   * @brief JSON of a small manifest sent along with create, so that it need not be fetched
+   */
+  const std::string&
+  getManifest() const
+  {
+    assert(hasManifest());
+    return m_manifest;
+  }
+
+  RepoCommandParameter&
+  setManifest(const std::string& manifest);
+
+  bool
+  hasManifest() const
+  {
+    return m_hasFields[REPO_PARAMETER_MANIFEST];
+  }
+
+  /**
+   * @brief digest of the first segment of a hash-chained range, empty while not known
+   */
+  const std::vector<uint8_t>&
+  getNextHash() const
+  {
+    assert(hasNextHash());
+    return m_nextHash;
+  }
+
+  RepoCommandParameter&
+  setNextHash(const std::vector<uint8_t>& nextHash);
+
+  bool
+  hasNextHash() const
+  {
+    return m_hasFields[REPO_PARAMETER_NEXT_HASH];
+  }
+
   const std::vector<bool>&
   getPresentFields() const {
     return m_hasFields;
@@ -258,6 +320,9 @@ private:
   uint64_t m_processId;
   milliseconds m_interestLifetime;
   Block m_clusterPrefix;
+  uint64_t m_stride;
+  std::string m_manifest;
+  std::vector<uint8_t> m_nextHash;
 
   mutable Block m_wire;
 };
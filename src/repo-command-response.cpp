@@ -112,6 +112,21 @@ RepoCommandResponse::hasDeleteNum() const
   return m_hasDeleteNum;
 }
 
+RepoCommandResponse&
+RepoCommandResponse::setRetryAfter(ndn::time::milliseconds retryAfter)
+{
+  m_retryAfter = retryAfter;
+  m_hasRetryAfter = true;
+  m_wire.reset();
+  return *this;
+}
+
+bool
+RepoCommandResponse::hasRetryAfter() const
+{
+  return m_hasRetryAfter;
+}
+
 const Block&
 RepoCommandResponse::wireEncode() const
 {
@@ -136,6 +151,13 @@ RepoCommandResponse::wireEncode(EncodingImpl<T>& encoder) const
   size_t totalLength = 0;
   size_t variableLength = 0;
 
+  if (m_hasRetryAfter) {
+    variableLength = encoder.prependNonNegativeInteger(m_retryAfter.count());
+    totalLength += variableLength;
+    totalLength += encoder.prependVarNumber(variableLength);
+    totalLength += encoder.prependVarNumber(tlv::RetryAfter);
+  }
+
   if (m_hasDeleteNum) {
     variableLength = encoder.prependNonNegativeInteger(m_deleteNum);
     totalLength += variableLength;
@@ -195,6 +217,7 @@ RepoCommandResponse::wireDecode(const Block& wire)
   m_hasStatusCode = false;
   m_hasInsertNum = false;
   m_hasDeleteNum = false;
+  m_hasRetryAfter = false;
 
   m_wire = wire;
 
@@ -248,6 +271,13 @@ RepoCommandResponse::wireDecode(const Block& wire)
     m_hasDeleteNum = true;
     m_deleteNum = readNonNegativeInteger(*val);
   }
+
+  // RetryAfter
+  val = m_wire.find(tlv::RetryAfter);
+  if (val != m_wire.elements_end()) {
+    m_hasRetryAfter = true;
+    m_retryAfter = ndn::time::milliseconds(readNonNegativeInteger(*val));
+  }
 }
 
 NDN_CXX_DEFINE_WIRE_ENCODE_INSTANTIATIONS(RepoCommandResponse);
@@ -276,6 +306,9 @@ operator<<(std::ostream& os, const RepoCommandResponse& repoCommandResponse)
     os << " DeleteNum: " << repoCommandResponse.getDeleteNum();
 
   }
+  if (repoCommandResponse.hasRetryAfter()) {
+    os << " RetryAfter: " << repoCommandResponse.getRetryAfter();
+  }
   os << " )";
   return os;
 }
@@ -27,6 +27,7 @@
 #include <ndn-cxx/encoding/block-helpers.hpp>
 #include <ndn-cxx/encoding/encoding-buffer.hpp>
 #include <ndn-cxx/encoding/tlv-nfd.hpp>
+#include <ndn-cxx/util/time.hpp>
 
 namespace repo {
 
@@ -59,11 +60,20 @@ public:
     , m_hasProcessId(false)
     , m_hasInsertNum(false)
     , m_hasDeleteNum(false)
+    , m_hasRetryAfter(false)
     , m_hasStatusCode(true)
   {
   }
 
-  RepoCommandResponse(){
+  RepoCommandResponse()
+    : m_hasStartBlockId(false)
+    , m_hasEndBlockId(false)
+    , m_hasProcessId(false)
+    , m_hasInsertNum(false)
+    , m_hasDeleteNum(false)
+    , m_hasRetryAfter(false)
+    , m_hasStatusCode(false)
+  {
   }
 
   explicit
@@ -139,6 +149,21 @@ public:
   bool
   hasDeleteNum() const;
 
+  /**
+   * @brief how long an overloaded repo asks the client to wait before trying again
+   */
+  ndn::time::milliseconds
+  getRetryAfter() const
+  {
+    return m_retryAfter;
+  }
+
+  RepoCommandResponse&
+  setRetryAfter(ndn::time::milliseconds retryAfter);
+
+  bool
+  hasRetryAfter() const;
+
   template<ndn::encoding::Tag T>
   size_t
   wireEncode(EncodingImpl<T>& block) const;
@@ -155,12 +180,14 @@ private:
   uint64_t m_processId;
   uint64_t m_insertNum;
   uint64_t m_deleteNum;
+  ndn::time::milliseconds m_retryAfter;
 
   bool m_hasStartBlockId;
   bool m_hasEndBlockId;
   bool m_hasProcessId;
   bool m_hasInsertNum;
   bool m_hasDeleteNum;
+  bool m_hasRetryAfter;
   bool m_hasStatusCode;
 
   mutable Block m_wire;
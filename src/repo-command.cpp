@@ -73,6 +73,15 @@ InsertCheckCommand::InsertCheckCommand()
     ;
 }
 
+InsertResumeCommand::InsertResumeCommand()
+{
+  m_requestValidator
+    .required(REPO_PARAMETER_NAME)
+    .required(REPO_PARAMETER_PROCESS_ID)
+    .optional(REPO_PARAMETER_NODE_PREFIX)
+    ;
+}
+
 InfoCommand::InfoCommand()
 {
   m_requestValidator
@@ -104,6 +104,12 @@ public:
   InsertCheckCommand();
 };
 
+class InsertResumeCommand : public RepoCommand
+{
+public:
+  InsertResumeCommand();
+};
+
 class InfoCommand : public RepoCommand
 {
 public:
@@ -40,6 +40,10 @@ enum {
   DeleteNum            = 210,
 
   ClusterPrefix        = 211,
+  Stride               = 212,
+  Manifest             = 213,
+  RetryAfter           = 214,
+  NextHash             = 215,
 };
 
 } // namespace tlv
@@ -123,6 +123,30 @@ parseConfig(const std::string& configPath)
     repoConfig.from = repoConf.get<std::string>("cluster.from");
     repoConfig.to = repoConf.get<std::string>("cluster.to");
   }
+  repoConfig.replicationFactor = repoConf.get<size_t>("cluster.replication-factor", repoConfig.replicationFactor);
+  repoConfig.stripeWidth = repoConf.get<size_t>("cluster.stripe-width", repoConfig.stripeWidth);
+  repoConfig.loadReportInterval = ndn::time::milliseconds(
+    repoConf.get<uint64_t>("cluster.load-report-interval", repoConfig.loadReportInterval.count()));
+  repoConfig.heartbeatInterval = ndn::time::milliseconds(
+    repoConf.get<uint64_t>("cluster.heartbeat-interval", repoConfig.heartbeatInterval.count()));
+  repoConfig.phiThreshold = repoConf.get<double>("cluster.phi-threshold", repoConfig.phiThreshold);
+  repoConfig.antiEntropyInterval = ndn::time::milliseconds(
+    repoConf.get<uint64_t>("cluster.anti-entropy-interval", repoConfig.antiEntropyInterval.count()));
+  repoConfig.rebalanceInterval = ndn::time::milliseconds(
+    repoConf.get<uint64_t>("cluster.rebalance-interval", repoConfig.rebalanceInterval.count()));
+  repoConfig.hotRangeRatio = repoConf.get<double>("cluster.hot-range-ratio", repoConfig.hotRangeRatio);
+  repoConfig.migrationWindow = repoConf.get<size_t>("cluster.migration.window", repoConfig.migrationWindow);
+  repoConfig.migrationRate = repoConf.get<uint64_t>("cluster.migration.rate", repoConfig.migrationRate);
+  repoConfig.reclaimRate = repoConf.get<uint64_t>("cluster.reclaim-rate", repoConfig.reclaimRate);
+  repoConfig.congestionControl = repoConf.get<std::string>("cluster.congestion-control",
+                                                           repoConfig.congestionControl);
+  repoConfig.fetchStreams = repoConf.get<size_t>("cluster.fetch-streams", repoConfig.fetchStreams);
+  repoConfig.validationThreads = repoConf.get<size_t>("cluster.validation-threads",
+                                                      repoConfig.validationThreads);
+  repoConfig.ingestSegments = repoConf.get<size_t>("cluster.ingest.segments", repoConfig.ingestSegments);
+  repoConfig.ingestRate = repoConf.get<uint64_t>("cluster.ingest.rate", repoConfig.ingestRate);
+  repoConfig.ingestQueue = repoConf.get<size_t>("cluster.ingest.queue", repoConfig.ingestQueue);
+  repoConfig.ingestFlowPrefix = repoConf.get<size_t>("cluster.ingest.flow-prefix", repoConfig.ingestFlowPrefix);
 
   return repoConfig;
 }
@@ -139,6 +163,16 @@ createStorage(const RepoConfig& config)
   }
 }
 
+static IngestScheduler::Limits
+makeIngestLimits(const RepoConfig& config)
+{
+  IngestScheduler::Limits limits;
+  limits.maxInFlightSegments = config.ingestSegments;
+  limits.maxBytesPerSecond = config.ingestRate;
+  limits.maxQueued = config.ingestQueue;
+  return limits;
+}
+
 Repo::Repo(boost::asio::io_service& ioService, std::shared_ptr<Storage> storage, const RepoConfig& config)
   : m_config(config)
   , m_scheduler(ioService)
@@ -147,14 +181,33 @@ Repo::Repo(boost::asio::io_service& ioService, std::shared_ptr<Storage> storage,
   , m_store(storage)
   , m_storageHandle(*m_store)
   , m_validator(m_face)  
-  , m_keySpaceHandle(m_face, m_storageHandle, m_dispatcher, m_scheduler, m_validator, m_config.clusterNodePrefix, m_config.clusterPrefix, m_config.managerPrefix, m_config.clusterType, m_config.from)
+  , m_validationPool(ioService, m_config.validationThreads)
+  , m_keySpaceHandle(m_face, m_storageHandle, m_dispatcher, m_scheduler, m_validator, m_config.clusterNodePrefix, m_config.clusterPrefix, m_config.managerPrefix, m_config.clusterType, m_config.from, m_config.replicationFactor)
+  , m_membershipHandle(m_face, m_keySpaceHandle, m_storageHandle, m_scheduler, m_validator, m_config.clusterNodePrefix, m_config.clusterPrefix, m_config.heartbeatInterval, m_config.phiThreshold)
   , m_readHandle(m_face, m_keySpaceHandle, m_storageHandle, m_scheduler, m_validator, m_config.registrationSubset, m_config.clusterNodePrefix)
-  , m_writeHandle(m_face, m_keySpaceHandle, m_storageHandle, m_dispatcher, m_scheduler, m_validator, m_config.clusterNodePrefix, m_config.clusterPrefix)
+  , m_placementHandle(m_face, m_keySpaceHandle, m_storageHandle, m_scheduler, m_validator, m_config.clusterNodePrefix, m_config.clusterPrefix, m_config.fs.dbPath, m_config.loadReportInterval)
+  , m_writeHandle(m_face, m_keySpaceHandle, m_placementHandle, m_storageHandle, m_dispatcher, m_scheduler, m_validator, m_validationPool, m_config.clusterNodePrefix, m_config.clusterPrefix, m_config.stripeWidth, m_config.congestionControl, m_config.fetchStreams, makeIngestLimits(m_config), m_config.ingestFlowPrefix)
   , m_infoHandle(m_face, m_storageHandle, m_scheduler, m_validator, m_config.clusterNodePrefix, m_config.clusterPrefix)
-  , m_deleteHandle(m_face, m_keySpaceHandle, m_storageHandle, m_dispatcher, m_scheduler, m_validator, m_config.clusterNodePrefix, m_config.clusterPrefix)
+  , m_deleteHandle(m_face, m_keySpaceHandle, m_storageHandle, m_dispatcher, m_scheduler, m_validator, m_config.clusterNodePrefix, m_config.clusterPrefix, m_config.reclaimRate)
   , m_manifestHandle(m_face, m_storageHandle, m_dispatcher, m_scheduler, m_validator, m_config.clusterNodePrefix, m_config.clusterPrefix)
+  , m_migrateHandle(m_face, m_keySpaceHandle, m_storageHandle, m_scheduler, m_validator, m_config.clusterNodePrefix, m_config.clusterPrefix, m_config.migrationWindow, m_config.migrationRate)
+  , m_antiEntropyHandle(m_face, m_keySpaceHandle, m_storageHandle, m_scheduler, m_validator, m_config.clusterNodePrefix, m_config.clusterPrefix, m_config.antiEntropyInterval)
   , m_tcpBulkInsertHandle(ioService, m_storageHandle)
 {
+  m_keySpaceHandle.setLivenessCheck([this] (const Name& node) {
+    return !m_membershipHandle.isSuspected(node);
+  });
+  m_membershipHandle.afterNodeRecovered.connect([this] (const Name& node) {
+    m_keySpaceHandle.onNodeRecovered(node);
+  });
+  m_placementHandle.setLoadSource([this] { return m_writeHandle.getLoad(); });
+  m_manifestHandle.afterManifestRequested.connect([this] (const std::string& hash) {
+    m_placementHandle.countRequest(hash);
+  });
+  if (m_config.clusterType == "manager" && m_config.rebalanceInterval > ndn::time::milliseconds::zero()) {
+    m_keySpaceHandle.startRebalancing([this] { return m_placementHandle.getRequestRates(); },
+                                      m_config.rebalanceInterval, m_config.hotRangeRatio);
+  }
   this->enableValidation();
 }
 
@@ -163,6 +216,10 @@ Repo::addNode() {
   if (m_config.clusterType != "node") 
     return;
 
+  // the saved keyspace already has this node, adding it again would split another range
+  if (m_keySpaceHandle.isMember())
+    return;
+
   RepoCommandParameter parameter;
   Block to = ndn::encoding::makeBinaryBlock(tlv::To, m_config.to.c_str(), m_config.to.length());
   Block from = ndn::encoding::makeBinaryBlock(tlv::From, m_config.from.c_str(), m_config.from.length());
@@ -21,6 +21,7 @@
 #define REPO_REPO_HPP
 
 #include "common.hpp"
+#include "handles/anti-entropy-handle.hpp"
 #include "handles/delete-handle.hpp"
 #include "handles/manifest-handle.hpp"
 #include "handles/read-handle.hpp"
@@ -28,6 +29,9 @@
 #include "handles/write-handle.hpp"
 #include "handles/info-handle.hpp"
 #include "handles/keyspace-handle.hpp"
+#include "handles/membership-handle.hpp"
+#include "handles/migrate-handle.hpp"
+#include "handles/placement-handle.hpp"
 #include "storage/repo-storage.hpp"
 #include "storage/storage-method.hpp"
 
@@ -73,6 +77,24 @@ struct RepoConfig
   std::string clusterType;
   ndn::Name managerPrefix;
   std::string from, to;
+  size_t replicationFactor = 1;
+  size_t stripeWidth = 1;
+  ndn::time::milliseconds loadReportInterval = ndn::time::milliseconds(5000);
+  ndn::time::milliseconds heartbeatInterval = ndn::time::milliseconds(500);
+  double phiThreshold = 8;
+  ndn::time::milliseconds antiEntropyInterval = ndn::time::milliseconds(60000);
+  ndn::time::milliseconds rebalanceInterval = ndn::time::milliseconds(30000);
+  double hotRangeRatio = 2;
+  size_t migrationWindow = 32;
+  uint64_t migrationRate = 0;
+  uint64_t reclaimRate = 10000;
+  std::string congestionControl = "aimd";
+  size_t fetchStreams = 1;
+  size_t validationThreads = 0;
+  size_t ingestSegments = 0;
+  uint64_t ingestRate = 0;
+  size_t ingestQueue = 256;
+  size_t ingestFlowPrefix = 0;
 };
 
 RepoConfig
@@ -125,13 +147,18 @@ private:
   RepoStorage m_storageHandle;
   HCKeyChain m_hcKeyChain;
   ValidatorConfig m_validator;
+  ValidationPool m_validationPool;
 
   KeySpaceHandle m_keySpaceHandle;
+  MembershipHandle m_membershipHandle;
   ReadHandle m_readHandle;
+  PlacementHandle m_placementHandle;
   WriteHandle m_writeHandle;
   InfoHandle m_infoHandle;
   DeleteHandle m_deleteHandle;
   ManifestHandle m_manifestHandle;
+  MigrateHandle m_migrateHandle;
+  AntiEntropyHandle m_antiEntropyHandle;
 
   TcpBulkInsertHandle m_tcpBulkInsertHandle;
   std::string m_keySpaceFile;
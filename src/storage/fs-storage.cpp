@@ -36,6 +36,7 @@ NDN_LOG_INIT(repo.FsStorage);
 
 const char* FsStorage::DIRNAME_DATA = "data";
 const char* FsStorage::DIRNAME_MANIFEST = "manifest";
+const char* FsStorage::DIRNAME_RECORD = "record";
 
 int64_t
 FsStorage::hash(std::string const& key)
@@ -84,6 +85,14 @@ FsStorage::FsStorage(const std::string& dbPath)
   m_path = boost::filesystem::path(m_dbPath);
   boost::filesystem::create_directory(m_path / DIRNAME_DATA);
   boost::filesystem::create_directory(m_path / DIRNAME_MANIFEST);
+  boost::filesystem::create_directory(m_path / DIRNAME_RECORD);
+
+  for (boost::filesystem::directory_iterator it(m_path / DIRNAME_MANIFEST);
+       it != boost::filesystem::directory_iterator(); ++it) {
+    if (it->path().extension() != ".tmp") {
+      m_manifestKeys.insert(it->path().filename().string());
+    }
+  }
 }
 
 FsStorage::~FsStorage()
@@ -117,13 +126,20 @@ std::string
 FsStorage::insertManifest(const Manifest& manifest)
 {
   boost::filesystem::path fsPath = m_path / DIRNAME_MANIFEST / manifest.getHash();
+  boost::filesystem::path tmpPath = m_path / DIRNAME_MANIFEST /
+    (manifest.getHash() + boost::filesystem::unique_path(".%%%%%%%%.tmp").string());
 
   auto json = manifest.toJson();
 
-  std::ofstream outFile(fsPath.string());
-  outFile.write(
-      json.c_str(),
-      json.size());
+  // write aside and rename, so readers never see a partially rewritten manifest
+  {
+    std::ofstream outFile(tmpPath.string());
+    outFile.write(
+        json.c_str(),
+        json.size());
+  }
+  boost::filesystem::rename(tmpPath, fsPath);
+  m_manifestKeys.insert(manifest.getHash());
 
   return manifest.getHash();
 }
@@ -143,6 +159,29 @@ FsStorage::erase(const Name& name)
   return true;
 }
 
+uint64_t
+FsStorage::eraseRange(const Name& prefix, uint64_t first, uint64_t last, uint64_t stride)
+{
+  // segments are spread over the hash directories, so each file is unlinked on its own, but
+  // with a single system call and without rebuilding the prefix for every segment
+  uint64_t nErased = 0;
+  Name name(prefix);
+  name.appendSegment(first);
+  for (uint64_t segment = first; segment <= last; segment += stride) {
+    name.set(-1, Name::Component::fromSegment(segment));
+
+    boost::system::error_code ec;
+    if (boost::filesystem::remove(getPath(name, DIRNAME_DATA), ec)) {
+      nErased += 1;
+    }
+    if (last - segment < stride) {
+      break;
+    }
+  }
+
+  return nErased;
+}
+
 bool
 FsStorage::eraseManifest(const std::string& hash)
 {
@@ -155,6 +194,7 @@ FsStorage::eraseManifest(const std::string& hash)
   }
 
   boost::filesystem::remove_all(fsPath);
+  m_manifestKeys.erase(hash);
   return true;
 }
 
@@ -264,6 +304,9 @@ FsStorage::readManifests()
   fs::path fsPath = m_path / DIRNAME_MANIFEST;
   fs::directory_iterator it(fsPath);
   for (; it != fs::directory_iterator(); it++) {
+    if (it->path().extension() == ".tmp") {
+      continue;
+    }
     pt::ptree node;
     node.put("key", it->path().filename().string());
     root.push_back(std::make_pair("", node));
@@ -272,6 +315,54 @@ FsStorage::readManifests()
   return root;
 }
 
+std::vector<std::string>
+FsStorage::readManifestKeys(const std::string& after, size_t limit)
+{
+  std::vector<std::string> keys;
+  for (auto it = m_manifestKeys.upper_bound(after); it != m_manifestKeys.end() && keys.size() < limit; ++it) {
+    keys.push_back(*it);
+  }
+  return keys;
+}
+
+void
+FsStorage::writeRecord(const std::string& key, const std::string& value)
+{
+  boost::filesystem::path fsPath = m_path / DIRNAME_RECORD / key;
+  boost::filesystem::path tmpPath = m_path / DIRNAME_RECORD /
+    (key + boost::filesystem::unique_path(".%%%%%%%%.tmp").string());
+
+  {
+    std::ofstream outFile(tmpPath.string(), std::ios::binary);
+    outFile.write(value.data(), value.size());
+    outFile.flush();
+    if (!outFile) {
+      boost::filesystem::remove(tmpPath);
+      BOOST_THROW_EXCEPTION(Error("Cannot write record " + key));
+    }
+  }
+  boost::filesystem::rename(tmpPath, fsPath);
+}
+
+std::string
+FsStorage::readRecord(const std::string& key)
+{
+  boost::filesystem::ifstream inFile(m_path / DIRNAME_RECORD / key, std::ifstream::binary);
+  if (!inFile.is_open()) {
+    return "";
+  }
+
+  return std::string((std::istreambuf_iterator<char>(inFile)),
+                     std::istreambuf_iterator<char>());
+}
+
+void
+FsStorage::eraseRecord(const std::string& key)
+{
+  boost::system::error_code ec;
+  boost::filesystem::remove(m_path / DIRNAME_RECORD / key, ec);
+}
+
 uint64_t
 FsStorage::size()
 {
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <iostream>
 #include <queue>
+#include <set>
 #include <stdlib.h>
 #include <string>
 #include <sqlite3.h>
@@ -68,6 +69,9 @@ public:
   bool
   erase(const Name& name) override;
 
+  uint64_t
+  eraseRange(const Name& prefix, uint64_t first, uint64_t last, uint64_t stride) override;
+
   bool
   eraseManifest(const std::string& hash) override;
 
@@ -89,6 +93,18 @@ public:
   boost::property_tree::ptree
   readManifests() override;
 
+  std::vector<std::string>
+  readManifestKeys(const std::string& after, size_t limit) override;
+
+  void
+  writeRecord(const std::string& key, const std::string& value) override;
+
+  std::string
+  readRecord(const std::string& key) override;
+
+  void
+  eraseRecord(const std::string& key) override;
+
   /**
    *  @brief  return the size of database
    */
@@ -111,12 +127,14 @@ private:
 private:
   std::string m_dbPath;
   boost::filesystem::path m_path;
+  std::set<std::string> m_manifestKeys;  ///< sorted index of the manifest directory
 
   static const char* FNAME_NAME;
   static const char* FNAME_DATA;
   static const char* FNAME_HASH;
   static const char* DIRNAME_DATA;
   static const char* DIRNAME_MANIFEST;
+  static const char* DIRNAME_RECORD;
 };
 
 
@@ -28,14 +28,21 @@
 
 namespace repo {
 
+using bsoncxx::builder::stream::close_array;
+using bsoncxx::builder::stream::close_document;
 using bsoncxx::builder::stream::document;
 using bsoncxx::builder::stream::finalize;
+using bsoncxx::builder::stream::open_array;
+using bsoncxx::builder::stream::open_document;
 
 NDN_LOG_INIT(repo.MongoDBStorage);
 
 const char* MongoDBStorage::COLLNAME_DATA = "data";
 const char* MongoDBStorage::COLLNAME_MANIFEST = "manifest";
+const char* MongoDBStorage::COLLNAME_RECORD = "record";
 const string MongoDBStorage::FIELDNAME_KEY = "key";
+const string MongoDBStorage::FIELDNAME_PREFIX = "prefix";
+const string MongoDBStorage::FIELDNAME_SEGMENT = "segment";
 const string MongoDBStorage::FIELDNAME_VALUE = "value";
 
 int64_t
@@ -61,6 +68,17 @@ MongoDBStorage::MongoDBStorage(const string& dbName)
   , mClient(mongocxx::client{mongocxx::uri{}})
 {
   mDB = mClient[dbName];
+
+  // lets eraseRange() find the segments of a file without scanning the collection
+  mDB[COLLNAME_DATA].create_index(document{}
+    << FIELDNAME_PREFIX << 1
+    << FIELDNAME_SEGMENT << 1
+    << finalize);
+
+  // lets readManifestKeys() resume a listing from a key
+  mDB[COLLNAME_MANIFEST].create_index(document{}
+    << FIELDNAME_KEY << 1
+    << finalize);
 }
 
 MongoDBStorage::~MongoDBStorage()
@@ -81,15 +99,23 @@ MongoDBStorage::insert(const Data& data)
   dataBinary.bytes = data.wireEncode().wire();
   dataBinary.size = data.wireEncode().size();
 
-  bsoncxx::document::view_or_value replacement = document{}
+  document replacement{};
+  replacement
     << FIELDNAME_KEY << key
-    << FIELDNAME_VALUE << dataBinary
-    << finalize;
+    << FIELDNAME_VALUE << dataBinary;
+
+  // segments also carry their prefix and number, so that a range of them can be removed at once
+  const Name& name = data.getName();
+  if (!name.empty() && name.get(-1).isSegment()) {
+    replacement
+      << FIELDNAME_PREFIX << name.getPrefix(-1).toUri()
+      << FIELDNAME_SEGMENT << static_cast<int64_t>(name.get(-1).toSegment());
+  }
 
   mongocxx::options::replace options;
   options.upsert(true);
-  coll.replace_one(filter, replacement, options);
-  
+  coll.replace_one(filter, replacement.view(), options);
+
   auto id = hash(data.getName().toUri());
   return id;
 }
@@ -135,6 +161,28 @@ MongoDBStorage::erase(const Name& name)
   return true;
 }
 
+uint64_t
+MongoDBStorage::eraseRange(const Name& prefix, uint64_t first, uint64_t last, uint64_t stride)
+{
+  mongocxx::collection coll = mDB[COLLNAME_DATA];
+
+  auto result = coll.delete_many(document{}
+    << FIELDNAME_PREFIX << prefix.toUri()
+    << FIELDNAME_SEGMENT << open_document
+      << "$gte" << static_cast<int64_t>(first)
+      << "$lte" << static_cast<int64_t>(last)
+      << "$mod" << open_array
+        << static_cast<int64_t>(stride) << static_cast<int64_t>(first % stride)
+      << close_array
+    << close_document
+    << finalize);
+
+  if (!result) {
+    return 0;
+  }
+  return result->deleted_count();
+}
+
 bool
 MongoDBStorage::eraseManifest(const string& hash)
 {
@@ -193,6 +241,52 @@ MongoDBStorage::readManifest(const string& hash)
   return std::make_shared<Manifest>(Manifest::fromJson(json));
 }
 
+void
+MongoDBStorage::writeRecord(const string& key, const string& value)
+{
+  mongocxx::collection coll = mDB[COLLNAME_RECORD];
+
+  bsoncxx::document::view_or_value filter = document{}
+    << FIELDNAME_KEY << key
+    << finalize;
+
+  bsoncxx::document::view_or_value replacement = document{}
+    << FIELDNAME_KEY << key
+    << FIELDNAME_VALUE << value
+    << finalize;
+
+  // a single document replacement is atomic
+  mongocxx::options::replace options;
+  options.upsert(true);
+  coll.replace_one(filter, replacement, options);
+}
+
+string
+MongoDBStorage::readRecord(const string& key)
+{
+  mongocxx::collection coll = mDB[COLLNAME_RECORD];
+
+  auto maybe_result = coll.find_one(document{}
+    << FIELDNAME_KEY << key
+    << finalize);
+
+  if (!maybe_result) {
+    return "";
+  }
+
+  return maybe_result.value().view()[FIELDNAME_VALUE].get_utf8().value.to_string();
+}
+
+void
+MongoDBStorage::eraseRecord(const string& key)
+{
+  mongocxx::collection coll = mDB[COLLNAME_RECORD];
+
+  coll.delete_one(document{}
+    << FIELDNAME_KEY << key
+    << finalize);
+}
+
 boost::property_tree::ptree
 MongoDBStorage::readDatas()
 {
@@ -236,6 +330,29 @@ MongoDBStorage::readManifests()
   return root;
 }
 
+std::vector<std::string>
+MongoDBStorage::readManifestKeys(const std::string& after, size_t limit)
+{
+  mongocxx::collection coll = mDB[COLLNAME_MANIFEST];
+
+  mongocxx::options::find options;
+  options.sort(document{} << FIELDNAME_KEY << 1 << finalize);
+  options.limit(static_cast<int64_t>(limit));
+  options.projection(document{} << FIELDNAME_KEY << 1 << finalize);
+
+  auto cursor = coll.find(document{}
+    << FIELDNAME_KEY << open_document
+      << "$gt" << after
+    << close_document
+    << finalize, options);
+
+  std::vector<std::string> keys;
+  for (auto doc : cursor) {
+    keys.push_back(doc[FIELDNAME_KEY].get_utf8().value.to_string());
+  }
+  return keys;
+}
+
 bool
 MongoDBStorage::has(const Name& name)
 {
@@ -68,6 +68,9 @@ public:
   bool
   erase(const Name& name) override;
 
+  uint64_t
+  eraseRange(const Name& prefix, uint64_t first, uint64_t last, uint64_t stride) override;
+
   bool
   eraseManifest(const std::string& hash) override;
 
@@ -89,6 +92,18 @@ public:
   boost::property_tree::ptree
   readManifests() override;
 
+  std::vector<std::string>
+  readManifestKeys(const std::string& after, size_t limit) override;
+
+  void
+  writeRecord(const std::string& key, const std::string& value) override;
+
+  std::string
+  readRecord(const std::string& key) override;
+
+  void
+  eraseRecord(const std::string& key) override;
+
   /**
    *  @brief  return the size of database
    */
@@ -115,7 +130,10 @@ private:
 
   static const char* COLLNAME_DATA;
   static const char* COLLNAME_MANIFEST;
+  static const char* COLLNAME_RECORD;
   static const string FIELDNAME_KEY;
+  static const string FIELDNAME_PREFIX;
+  static const string FIELDNAME_SEGMENT;
   static const string FIELDNAME_VALUE;
 };
 
@@ -21,6 +21,9 @@
 #include "config.hpp"
 
 #include <istream>
+#include <sstream>
+
+#include <boost/property_tree/json_parser.hpp>
 
 #include <ndn-cxx/util/exception.hpp>
 #include <ndn-cxx/util/logger.hpp>
@@ -29,14 +32,51 @@ namespace repo {
 
 NDN_LOG_INIT(repo.RepoStorage);
 
+static const char* TOMBSTONE_RECORD = "tombstones";
+static const uint64_t MAX_TOMBSTONE_JOURNAL = 1024;
+static const ndn::time::seconds MANIFEST_TOMBSTONE_LIFETIME(86400);
+
+static int64_t
+getUnixTime()
+{
+  return ndn::time::duration_cast<ndn::time::seconds>(
+    ndn::time::system_clock::now().time_since_epoch()).count();
+}
+
+static std::string
+getJournalKey(uint64_t seq)
+{
+  return std::string(TOMBSTONE_RECORD) + "-" + std::to_string(seq);
+}
+
 RepoStorage::RepoStorage(Storage& store)
   : m_storage(store)
 {
+  loadTombstones();
 }
 
 bool
 RepoStorage::insertData(const Data& data)
 {
+  // a deleted segment written again must not be erased by the pending reclamation; only its
+  // old copy is erased here, the rest of its range is left to reclaimData()
+  const Name& name = data.getName();
+  if (!m_deletedPrefixes.empty() && !name.empty() && name.get(-1).isSegment() &&
+      m_deletedPrefixes.count(name.getPrefix(-1)) > 0) {
+    Name prefix = name.getPrefix(-1);
+    SegmentNo segment = name.get(-1).toSegment();
+    if (m_tombstones.uncover(prefix.toUri(), segment)) {
+      m_storage.eraseRange(prefix, segment, segment, 1);
+      updateDeletedPrefix(prefix);
+
+      boost::property_tree::ptree change;
+      change.put("op", "uncover");
+      change.put("prefix", prefix.toUri());
+      change.put("segment", segment);
+      journalTombstones(change);
+    }
+  }
+
   bool isExist = m_storage.has(data.getFullName());
 
   if (isExist) {
@@ -69,11 +109,192 @@ RepoStorage::deleteData(const Interest& interest)
   return deleteData(interest.getName());
 }
 
+uint64_t
+RepoStorage::deleteDataRange(const Name& prefix, SegmentNo first, SegmentNo last, SegmentNo stride)
+{
+  NDN_LOG_DEBUG("Delete: " << prefix << " " << first << "~" << last);
+
+  if (first > last || stride == 0) {
+    return 0;
+  }
+
+  m_tombstones.addRange(prefix.toUri(), first, last, stride);
+  m_deletedPrefixes.insert(prefix);
+
+  boost::property_tree::ptree change;
+  change.put("op", "range");
+  change.put("prefix", prefix.toUri());
+  change.put("first", first);
+  change.put("last", last);
+  change.put("stride", stride);
+  journalTombstones(change);
+  return (last - first) / stride + 1;
+}
+
+uint64_t
+RepoStorage::reclaimData(uint64_t maxSegments)
+{
+  if (!m_tombstones.hasRanges()) {
+    return 0;
+  }
+
+  auto batch = m_tombstones.takeBatch(maxSegments);
+  Name prefix(batch.prefix);
+  uint64_t nErased = m_storage.eraseRange(prefix, batch.first, batch.last, batch.stride);
+  updateDeletedPrefix(prefix);
+
+  boost::property_tree::ptree change;
+  change.put("op", "take");
+  change.put("maxSegments", maxSegments);
+  journalTombstones(change);
+
+  NDN_LOG_DEBUG("Reclaimed " << nErased << " segments of " << batch.prefix << " "
+                << batch.first << "~" << batch.last);
+  return nErased;
+}
+
+bool
+RepoStorage::isDeleted(const Name& name) const
+{
+  if (m_deletedPrefixes.empty() || name.empty() || !name.get(-1).isSegment()) {
+    return false;
+  }
+
+  Name prefix = name.getPrefix(-1);
+  if (m_deletedPrefixes.count(prefix) == 0) {
+    return false;
+  }
+  return m_tombstones.covers(prefix.toUri(), name.get(-1).toSegment());
+}
+
+void
+RepoStorage::updateDeletedPrefix(const Name& prefix)
+{
+  if (!m_tombstones.hasPrefix(prefix.toUri())) {
+    m_deletedPrefixes.erase(prefix);
+  }
+}
+
+void
+RepoStorage::loadTombstones()
+{
+  std::string record = m_storage.readRecord(TOMBSTONE_RECORD);
+  if (!record.empty()) {
+    try {
+      boost::property_tree::ptree snapshot;
+      std::istringstream is(record);
+      boost::property_tree::read_json(is, snapshot);
+
+      m_tombstoneSeq = snapshot.get<uint64_t>("seq", 0);
+      // a snapshot saved before the journal is the tombstone set itself
+      auto tombstones = snapshot.get_child_optional("tombstones");
+      m_tombstones = TombstoneSet::fromPtree(tombstones ? *tombstones : snapshot);
+    }
+    catch (const boost::property_tree::ptree_error& e) {
+      NDN_LOG_ERROR("Saved tombstones are malformed, ignored: " << e.what());
+    }
+  }
+
+  // the journal holds the changes made after the snapshot, in order
+  for (;;) {
+    std::string change = m_storage.readRecord(getJournalKey(m_tombstoneSeq + m_nJournaled + 1));
+    if (change.empty()) {
+      break;
+    }
+    ++m_nJournaled;
+
+    try {
+      boost::property_tree::ptree tree;
+      std::istringstream is(change);
+      boost::property_tree::read_json(is, tree);
+      applyTombstoneChange(tree);
+    }
+    catch (const boost::property_tree::ptree_error& e) {
+      NDN_LOG_ERROR("Saved tombstone change is malformed, ignored: " << e.what());
+    }
+  }
+
+  for (const auto& prefix : m_tombstones.getPrefixes()) {
+    m_deletedPrefixes.insert(Name(prefix));
+  }
+}
+
+void
+RepoStorage::applyTombstoneChange(const boost::property_tree::ptree& change)
+{
+  std::string op = change.get<std::string>("op");
+  if (op == "range") {
+    m_tombstones.addRange(change.get<std::string>("prefix"), change.get<uint64_t>("first"),
+                          change.get<uint64_t>("last"), change.get<uint64_t>("stride"));
+  }
+  else if (op == "uncover") {
+    m_tombstones.uncover(change.get<std::string>("prefix"), change.get<uint64_t>("segment"));
+  }
+  else if (op == "take") {
+    if (m_tombstones.hasRanges()) {
+      m_tombstones.takeBatch(change.get<uint64_t>("maxSegments"));
+    }
+  }
+  else if (op == "manifest") {
+    m_tombstones.addManifest(change.get<std::string>("hash"), change.get<int64_t>("deletedAt"));
+    m_tombstones.expireManifests(change.get<int64_t>("expireBefore"));
+  }
+  else if (op == "unmanifest") {
+    m_tombstones.removeManifest(change.get<std::string>("hash"));
+  }
+  else if (op == "hold") {
+    m_tombstones.holdManifest(change.get<std::string>("hash"));
+  }
+  else if (op == "release") {
+    m_tombstones.releaseManifest(change.get<std::string>("hash"));
+  }
+  else {
+    NDN_LOG_ERROR("Unknown tombstone change " << op << ", ignored");
+  }
+}
+
+void
+RepoStorage::journalTombstones(const boost::property_tree::ptree& change)
+{
+  std::stringstream os;
+  boost::property_tree::write_json(os, change, false);
+  m_storage.writeRecord(getJournalKey(m_tombstoneSeq + m_nJournaled + 1), os.str());
+  ++m_nJournaled;
+
+  if (m_nJournaled >= MAX_TOMBSTONE_JOURNAL) {
+    compactTombstones();
+  }
+}
+
+void
+RepoStorage::compactTombstones()
+{
+  uint64_t seq = m_tombstoneSeq + m_nJournaled;
+
+  boost::property_tree::ptree snapshot;
+  snapshot.put("seq", seq);
+  snapshot.add_child("tombstones", m_tombstones.toPtree());
+
+  std::stringstream os;
+  boost::property_tree::write_json(os, snapshot, false);
+  m_storage.writeRecord(TOMBSTONE_RECORD, os.str());
+
+  // once the snapshot is written, the journal before it is never read again
+  for (uint64_t i = m_tombstoneSeq + 1; i <= seq; ++i) {
+    m_storage.eraseRecord(getJournalKey(i));
+  }
+  m_tombstoneSeq = seq;
+  m_nJournaled = 0;
+}
+
 std::shared_ptr<Data>
 RepoStorage::readData(const Interest& interest) const
 {
   NDN_LOG_DEBUG("Reading data for " << interest.getName());
 
+  if (isDeleted(interest.getName())) {
+    return nullptr;
+  }
   return m_storage.read(interest.getName());
 }
 
@@ -83,6 +304,13 @@ RepoStorage::insertManifest(const Manifest& manifest)
   NDN_LOG_DEBUG("Insert manifest for " << manifest.getHash());
 
   m_storage.insertManifest(manifest);
+  if (m_tombstones.removeManifest(manifest.getHash())) {
+    boost::property_tree::ptree change;
+    change.put("op", "unmanifest");
+    change.put("hash", manifest.getHash());
+    journalTombstones(change);
+  }
+  afterManifestInsertion(manifest.getHash());
 
   return true;
 }
@@ -99,18 +327,69 @@ bool
 RepoStorage::deleteManifest(const std::string& hash)
 {
   if (m_storage.eraseManifest(hash)) {
+    int64_t now = getUnixTime();
+    int64_t expireBefore = now - MANIFEST_TOMBSTONE_LIFETIME.count();
+    m_tombstones.addManifest(hash, now);
+    m_tombstones.expireManifests(expireBefore);
+
+    boost::property_tree::ptree change;
+    change.put("op", "manifest");
+    change.put("hash", hash);
+    change.put("deletedAt", now);
+    change.put("expireBefore", expireBefore);
+    journalTombstones(change);
+    afterManifestDeletion(hash);
     return 1;
   }
 
   return -1;
 }
 
+void
+RepoStorage::holdManifestTombstone(const std::string& hash)
+{
+  if (!m_tombstones.hasManifest(hash) || m_tombstones.getHeldManifests().count(hash) > 0) {
+    return;
+  }
+  m_tombstones.holdManifest(hash);
+
+  boost::property_tree::ptree change;
+  change.put("op", "hold");
+  change.put("hash", hash);
+  journalTombstones(change);
+}
+
+void
+RepoStorage::releaseManifestTombstone(const std::string& hash)
+{
+  if (m_tombstones.getHeldManifests().count(hash) == 0) {
+    return;
+  }
+  m_tombstones.releaseManifest(hash);
+
+  boost::property_tree::ptree change;
+  change.put("op", "release");
+  change.put("hash", hash);
+  journalTombstones(change);
+}
+
 boost::property_tree::ptree
 RepoStorage::readDatas()
 {
   NDN_LOG_DEBUG("Reading datas");
 
-  return m_storage.readDatas();
+  auto datas = m_storage.readDatas();
+  if (m_deletedPrefixes.empty()) {
+    return datas;
+  }
+
+  boost::property_tree::ptree visible;
+  for (const auto& item : datas) {
+    if (!isDeleted(Name(item.second.get<std::string>("data")))) {
+      visible.push_back(item);
+    }
+  }
+  return visible;
 }
 
 boost::property_tree::ptree
@@ -121,5 +400,33 @@ RepoStorage::readManifests()
   return m_storage.readManifests();
 }
 
+std::vector<std::string>
+RepoStorage::readManifestKeys(const std::string& after, size_t limit)
+{
+  return m_storage.readManifestKeys(after, limit);
+}
+
+void
+RepoStorage::writeRecord(const std::string& key, const std::string& value)
+{
+  NDN_LOG_DEBUG("Writing record " << key);
+
+  m_storage.writeRecord(key, value);
+}
+
+std::string
+RepoStorage::readRecord(const std::string& key)
+{
+  return m_storage.readRecord(key);
+}
+
+void
+RepoStorage::eraseRecord(const std::string& key)
+{
+  NDN_LOG_DEBUG("Erasing record " << key);
+
+  m_storage.eraseRecord(key);
+}
+
 
 } // namespace repo
@@ -21,17 +21,24 @@
 #define REPO_STORAGE_REPO_STORAGE_HPP
 
 #include "storage.hpp"
+#include "tombstone-set.hpp"
 #include "../repo-command-parameter.hpp"
 
 #include <ndn-cxx/util/signal.hpp>
 
 #include <queue>
+#include <set>
 
 namespace repo {
 
 /**
  *  @brief  RepoStorage handles the storage part of whole repo,
  *          including index and database
+ *
+ *  Deleting a range of segments only records a tombstone: the segments are hidden at once
+ *  and erased later by reclaimData(). Each change to the tombstones is saved as a small
+ *  journal record, and the journal is folded into one snapshot record now and then, so that
+ *  reclamation goes on after a restart.
  */
 class RepoStorage : noncopyable
 {
@@ -74,6 +81,29 @@ public:
   ssize_t
   deleteData(const Interest& interest);
 
+  /**
+   *  @brief   delete the segments @p first to @p last of @p prefix, @p stride apart
+   *
+   *  The segments are hidden right away and their space is reclaimed by reclaimData().
+   *
+   *  @return  the number of segments in the range
+   */
+  uint64_t
+  deleteDataRange(const Name& prefix, SegmentNo first, SegmentNo last, SegmentNo stride = 1);
+
+  bool
+  hasDataToReclaim() const
+  {
+    return m_tombstones.hasRanges();
+  }
+
+  /**
+   *  @brief   erase up to @p maxSegments deleted segments, oldest delete first
+   *  @return  the number of segments that were still stored
+   */
+  uint64_t
+  reclaimData(uint64_t maxSegments);
+
   /**
    *  @brief   read data from repo
    *  @param   interest  used to request data
@@ -91,19 +121,94 @@ public:
   bool
   deleteManifest(const std::string& hash);
 
+  /**
+   *  @return  whether the manifest @p hash was deleted recently and not inserted again
+   */
+  bool
+  isManifestDeleted(const std::string& hash) const
+  {
+    return m_tombstones.hasManifest(hash);
+  }
+
+  /**
+   *  @brief   keep the deleted manifest @p hash from expiring until releaseManifestTombstone()
+   */
+  void
+  holdManifestTombstone(const std::string& hash);
+
+  void
+  releaseManifestTombstone(const std::string& hash);
+
+  /**
+   *  @return  the deleted manifests kept from expiring, also across a restart
+   */
+  const std::set<std::string>&
+  getHeldManifestTombstones() const
+  {
+    return m_tombstones.getHeldManifests();
+  }
+
   boost::property_tree::ptree
   readDatas();
 
   boost::property_tree::ptree
   readManifests();
 
+  /**
+   *  @return  up to @p limit manifest keys greater than @p after, in ascending order
+   */
+  std::vector<std::string>
+  readManifestKeys(const std::string& after, size_t limit);
+
+  void
+  writeRecord(const std::string& key, const std::string& value);
+
+  std::string
+  readRecord(const std::string& key);
+
+  void
+  eraseRecord(const std::string& key);
 
 public:
   ndn::util::Signal<RepoStorage, ndn::Name> afterDataInsertion;
   ndn::util::Signal<RepoStorage, ndn::Name> afterDataDeletion;
+  ndn::util::Signal<RepoStorage, std::string> afterManifestInsertion;
+  ndn::util::Signal<RepoStorage, std::string> afterManifestDeletion;
+
+private:
+  /**
+   *  @return  whether @p name is a segment hidden by a tombstone
+   */
+  bool
+  isDeleted(const Name& name) const;
+
+  void
+  loadTombstones();
+
+  /**
+   *  @brief   save the tombstone change @p change as the next journal record
+   */
+  void
+  journalTombstones(const boost::property_tree::ptree& change);
+
+  void
+  applyTombstoneChange(const boost::property_tree::ptree& change);
+
+  /**
+   *  @brief   save all tombstones as the snapshot record and erase the journal
+   */
+  void
+  compactTombstones();
+
+  void
+  updateDeletedPrefix(const Name& prefix);
 
 private:
   Storage& m_storage;
+  TombstoneSet m_tombstones;
+  std::set<Name> m_deletedPrefixes;  ///< prefixes in m_tombstones, checked before any URI is built
+  uint64_t m_tombstoneSeq = 0;  ///< last journal record in the snapshot
+  uint64_t m_nJournaled = 0;  ///< journal records after the snapshot
   const int NOTFOUND = -1;
 };
 
@@ -24,6 +24,7 @@
 #include <string>
 #include <iostream>
 #include <stdlib.h>
+#include <vector>
 #include "../manifest/manifest.hpp"
 
 namespace repo {
@@ -65,6 +66,13 @@ public:
   virtual bool
   erase(const Name& name) = 0;
 
+  /**
+   *  @brief  remove the segments @p first, @p first + @p stride, ... up to @p last of @p prefix
+   *  @return the number of segments that were stored and are now removed
+   */
+  virtual uint64_t
+  eraseRange(const Name& prefix, uint64_t first, uint64_t last, uint64_t stride) = 0;
+
   virtual bool
   eraseManifest(const std::string& hash) = 0;
 
@@ -94,6 +102,35 @@ public:
   virtual boost::property_tree::ptree
   readManifests() = 0;
 
+  /**
+   *  @return  up to @p limit manifest keys greater than @p after, in ascending order
+   *
+   *  Lets a listing resume from the last key it returned without reading the whole store.
+   */
+  virtual std::vector<std::string>
+  readManifestKeys(const std::string& after, size_t limit) = 0;
+
+  /**
+   *  @brief  replace the record @p key with @p value at once
+   *
+   *  Records hold small pieces of node state, such as the keyspace, that must survive a
+   *  restart. A reader sees either the old or the new value, never a mix of both.
+   */
+  virtual void
+  writeRecord(const std::string& key, const std::string& value) = 0;
+
+  /**
+   *  @return the record @p key, or an empty string if it was never written
+   */
+  virtual std::string
+  readRecord(const std::string& key) = 0;
+
+  /**
+   *  @brief  remove the record @p key, if it exists
+   */
+  virtual void
+  eraseRecord(const std::string& key) = 0;
+
   /**
    *  @brief  return the size of database
    */
@@ -0,0 +1,221 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tombstone-set.hpp"
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <sstream>
+
+namespace repo {
+
+namespace pt = boost::property_tree;
+
+static bool
+isInRange(const TombstoneSet::Range& range, const std::string& prefix, uint64_t segment)
+{
+  return range.prefix == prefix && segment >= range.first && segment <= range.last &&
+         (segment - range.first) % range.stride == 0;
+}
+
+void
+TombstoneSet::addRange(const std::string& prefix, uint64_t first, uint64_t last, uint64_t stride)
+{
+  if (first > last || stride == 0) {
+    return;
+  }
+  m_ranges.push_back({prefix, first, last, stride});
+  m_index.emplace(prefix, std::prev(m_ranges.end()));
+}
+
+std::vector<std::string>
+TombstoneSet::getPrefixes() const
+{
+  std::vector<std::string> prefixes;
+  for (auto it = m_index.begin(); it != m_index.end(); it = m_index.upper_bound(it->first)) {
+    prefixes.push_back(it->first);
+  }
+  return prefixes;
+}
+
+bool
+TombstoneSet::covers(const std::string& prefix, uint64_t segment) const
+{
+  auto ranges = m_index.equal_range(prefix);
+  for (auto it = ranges.first; it != ranges.second; ++it) {
+    if (isInRange(*it->second, prefix, segment)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool
+TombstoneSet::uncover(const std::string& prefix, uint64_t segment)
+{
+  std::vector<std::list<Range>::iterator> covering;
+  auto ranges = m_index.equal_range(prefix);
+  for (auto it = ranges.first; it != ranges.second; ++it) {
+    if (isInRange(*it->second, prefix, segment)) {
+      covering.push_back(it->second);
+    }
+  }
+
+  for (auto range : covering) {
+    // the pieces keep the place of the range in the reclaim order
+    if (segment > range->first) {
+      auto piece = m_ranges.insert(range, {prefix, range->first, segment - range->stride, range->stride});
+      m_index.emplace(prefix, piece);
+    }
+    if (segment + range->stride <= range->last) {
+      auto piece = m_ranges.insert(range, {prefix, segment + range->stride, range->last, range->stride});
+      m_index.emplace(prefix, piece);
+    }
+    unindex(range);
+    m_ranges.erase(range);
+  }
+  return !covering.empty();
+}
+
+void
+TombstoneSet::unindex(std::list<Range>::iterator range)
+{
+  auto ranges = m_index.equal_range(range->prefix);
+  for (auto it = ranges.first; it != ranges.second; ++it) {
+    if (it->second == range) {
+      m_index.erase(it);
+      return;
+    }
+  }
+}
+
+TombstoneSet::Range
+TombstoneSet::takeBatch(uint64_t maxSegments)
+{
+  Range& range = m_ranges.front();
+  Range batch = range;
+
+  if (maxSegments > 0 && (range.last - range.first) / range.stride >= maxSegments) {
+    batch.last = range.first + (maxSegments - 1) * range.stride;
+    range.first = batch.last + range.stride;
+  }
+  else {
+    unindex(m_ranges.begin());
+    m_ranges.pop_front();
+  }
+  return batch;
+}
+
+void
+TombstoneSet::addManifest(const std::string& hash, int64_t deletedAt)
+{
+  m_manifests[hash] = deletedAt;
+}
+
+size_t
+TombstoneSet::expireManifests(int64_t deletedAt)
+{
+  size_t nExpired = 0;
+  for (auto it = m_manifests.begin(); it != m_manifests.end();) {
+    if (it->second < deletedAt && m_heldManifests.count(it->first) == 0) {
+      it = m_manifests.erase(it);
+      ++nExpired;
+    }
+    else {
+      ++it;
+    }
+  }
+  return nExpired;
+}
+
+pt::ptree
+TombstoneSet::toPtree() const
+{
+  pt::ptree ranges;
+  for (const auto& range : m_ranges) {
+    pt::ptree node;
+    node.put("prefix", range.prefix);
+    node.put("first", range.first);
+    node.put("last", range.last);
+    node.put("stride", range.stride);
+    ranges.push_back(std::make_pair("", node));
+  }
+
+  pt::ptree manifests;
+  for (const auto& manifest : m_manifests) {
+    pt::ptree node;
+    node.put("hash", manifest.first);
+    node.put("deletedAt", manifest.second);
+    if (m_heldManifests.count(manifest.first) > 0) {
+      node.put("held", true);
+    }
+    manifests.push_back(std::make_pair("", node));
+  }
+
+  pt::ptree root;
+  root.add_child("ranges", ranges);
+  root.add_child("manifests", manifests);
+  return root;
+}
+
+TombstoneSet
+TombstoneSet::fromPtree(const pt::ptree& root)
+{
+  TombstoneSet tombstones;
+  auto ranges = root.get_child_optional("ranges");
+  if (ranges) {
+    for (const auto& item : *ranges) {
+      tombstones.addRange(item.second.get<std::string>("prefix"),
+                          item.second.get<uint64_t>("first"),
+                          item.second.get<uint64_t>("last"),
+                          item.second.get<uint64_t>("stride"));
+    }
+  }
+  auto manifests = root.get_child_optional("manifests");
+  if (manifests) {
+    for (const auto& item : *manifests) {
+      auto hash = item.second.get<std::string>("hash");
+      tombstones.addManifest(hash, item.second.get<int64_t>("deletedAt"));
+      if (item.second.get<bool>("held", false)) {
+        tombstones.holdManifest(hash);
+      }
+    }
+  }
+  return tombstones;
+}
+
+std::string
+TombstoneSet::toJson() const
+{
+  std::stringstream os;
+  pt::write_json(os, toPtree(), false);
+  return os.str();
+}
+
+TombstoneSet
+TombstoneSet::fromJson(const std::string& json)
+{
+  pt::ptree root;
+  std::istringstream is(json);
+  pt::read_json(is, root);
+  return fromPtree(root);
+}
+
+} // namespace repo
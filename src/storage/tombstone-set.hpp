@@ -0,0 +1,204 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_STORAGE_TOMBSTONE_SET_HPP
+#define REPO_STORAGE_TOMBSTONE_SET_HPP
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace repo {
+
+/**
+ * @brief deleted segment ranges whose space is not reclaimed yet, and deleted manifests
+ *
+ * A delete only adds a range here; the segments are hidden from then on and erased later a
+ * batch at a time, oldest range first. Deleted manifest hashes are remembered for a while so
+ * that anti-entropy does not bring them back from a peer that still holds a copy, and for as
+ * long as they are held, while such a peer is still being asked to drop its copy.
+ *
+ * Prefixes are kept as URIs so that the set can be saved as a storage record. Ranges are
+ * indexed by prefix, so that checking a segment does not scan the ranges of other prefixes.
+ */
+class TombstoneSet
+{
+public:
+  /**
+   * @brief segments first, first + stride, ... up to last of prefix
+   */
+  struct Range
+  {
+    std::string prefix;
+    uint64_t first;
+    uint64_t last;
+    uint64_t stride;
+  };
+
+public:
+  TombstoneSet() = default;
+
+  // the index points into m_ranges, which a move keeps valid but a copy would not
+  TombstoneSet(const TombstoneSet&) = delete;
+  TombstoneSet(TombstoneSet&&) = default;
+
+  TombstoneSet&
+  operator=(const TombstoneSet&) = delete;
+
+  TombstoneSet&
+  operator=(TombstoneSet&&) = default;
+
+  void
+  addRange(const std::string& prefix, uint64_t first, uint64_t last, uint64_t stride);
+
+  /**
+   * @return whether a segment of @p prefix is deleted
+   */
+  bool
+  hasPrefix(const std::string& prefix) const
+  {
+    return m_index.count(prefix) > 0;
+  }
+
+  /**
+   * @return the prefixes with deleted segments
+   */
+  std::vector<std::string>
+  getPrefixes() const;
+
+  /**
+   * @return whether segment @p segment of @p prefix is deleted
+   */
+  bool
+  covers(const std::string& prefix, uint64_t segment) const;
+
+  /**
+   * @brief split the ranges covering segment @p segment of @p prefix around it
+   *
+   * The rest of each range stays deleted, and is reclaimed in its turn.
+   *
+   * @return whether @p segment was deleted
+   */
+  bool
+  uncover(const std::string& prefix, uint64_t segment);
+
+  bool
+  hasRanges() const
+  {
+    return !m_ranges.empty();
+  }
+
+  /**
+   * @brief take up to @p maxSegments segments off the oldest range
+   * @pre hasRanges()
+   */
+  Range
+  takeBatch(uint64_t maxSegments);
+
+  /**
+   * @param deletedAt seconds since the epoch
+   */
+  void
+  addManifest(const std::string& hash, int64_t deletedAt);
+
+  bool
+  hasManifest(const std::string& hash) const
+  {
+    return m_manifests.count(hash) > 0;
+  }
+
+  /**
+   * @return whether @p hash was marked deleted
+   */
+  bool
+  removeManifest(const std::string& hash)
+  {
+    m_heldManifests.erase(hash);
+    return m_manifests.erase(hash) > 0;
+  }
+
+  /**
+   * @brief keep the deleted manifest @p hash from expiring until releaseManifest()
+   */
+  void
+  holdManifest(const std::string& hash)
+  {
+    if (hasManifest(hash)) {
+      m_heldManifests.insert(hash);
+    }
+  }
+
+  void
+  releaseManifest(const std::string& hash)
+  {
+    m_heldManifests.erase(hash);
+  }
+
+  const std::set<std::string>&
+  getHeldManifests() const
+  {
+    return m_heldManifests;
+  }
+
+  /**
+   * @brief forget the manifests deleted before @p deletedAt, except the held ones
+   * @return the number of manifests forgotten
+   */
+  size_t
+  expireManifests(int64_t deletedAt);
+
+  boost::property_tree::ptree
+  toPtree() const;
+
+  /**
+   * @throw boost::property_tree::ptree_error @p root is malformed
+   */
+  static TombstoneSet
+  fromPtree(const boost::property_tree::ptree& root);
+
+  std::string
+  toJson() const;
+
+  /**
+   * @throw boost::property_tree::ptree_error @p json is malformed
+   */
+  static TombstoneSet
+  fromJson(const std::string& json);
+
+private:
+  void
+  unindex(std::list<Range>::iterator range);
+
+private:
+  std::list<Range> m_ranges;  ///< oldest first
+  std::multimap<std::string, std::list<Range>::iterator> m_index;  ///< m_ranges by prefix
+  std::map<std::string, int64_t> m_manifests;
+  std::set<std::string> m_heldManifests;
+};
+
+} // namespace repo
+
+#endif // REPO_STORAGE_TOMBSTONE_SET_HPP
@@ -1,11 +1,16 @@
 #include "util.hpp"
 
+#include <ndn-cxx/lp/tlv.hpp>
 #include <ndn-cxx/security/command-interest-signer.hpp>
 #include <ndn-cxx/security/hc-key-chain.hpp>
 #include <ndn-cxx/security/signing-helpers.hpp>
+#include <ndn-cxx/signature-info.hpp>
 
+#include <boost/property_tree/json_parser.hpp>
 #include <boost/uuid/detail/sha1.hpp>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
 namespace repo {
 namespace util {
@@ -32,5 +37,110 @@ generateCommandInterest(
   return interest;
 }
 
+std::vector<std::string>
+segmentJsonArray(const std::string& key, const boost::property_tree::ptree& items,
+                 const boost::property_tree::ptree& trailer, size_t maxSegmentSize)
+{
+  namespace pt = boost::property_tree;
+
+  std::vector<std::string> segments;
+  pt::ptree chunk;
+  size_t chunkSize = 0;
+
+  auto flush = [&] (bool isLast) {
+    pt::ptree root;
+    root.add_child(key, chunk);
+    if (isLast) {
+      for (const auto& child : trailer) {
+        root.add_child(child.first, child.second);
+      }
+    }
+
+    std::stringstream os;
+    pt::write_json(os, root, false);
+    segments.push_back(os.str());
+
+    chunk.clear();
+    chunkSize = 0;
+  };
+
+  for (const auto& item : items) {
+    std::stringstream os;
+    pt::write_json(os, item.second, false);
+    size_t itemSize = os.str().size() + 1;
+
+    if (chunkSize > 0 && chunkSize + itemSize > maxSegmentSize) {
+      flush(false);
+    }
+    chunk.push_back(std::make_pair("", item.second));
+    chunkSize += itemSize;
+  }
+  flush(true);
+
+  return segments;
+}
+
+std::vector<uint8_t>
+getNextHash(const ndn::Data& data)
+{
+  ndn::Block signatureInfo = data.getSignature().getInfo();
+  signatureInfo.parse();
+  auto nextHash = signatureInfo.find(ndn::lp::tlv::HashChain);
+  if (nextHash == signatureInfo.elements_end()) {
+    return {};
+  }
+  return std::vector<uint8_t>(nextHash->value_begin(), nextHash->value_end());
+}
+
+HashChainVerifier::Segment
+makeHashChainSegment(const ndn::Data& data)
+{
+  HashChainVerifier::Segment segment;
+  segment.segmentNo = data.getName().get(-1).toSegment();
+
+  const ndn::Block& wire = data.wireEncode();
+  const ndn::Block& signatureValue = data.getSignature().getValue();
+  segment.signedPortion.assign(wire.value_begin(), wire.value_end() - signatureValue.size());
+  segment.signatureValue.assign(signatureValue.value_begin(), signatureValue.value_end());
+  segment.nextHash = getNextHash(data);
+  return segment;
+}
+
+ndn::Name
+getCommandSigner(const ndn::Interest& interest)
+{
+  const ndn::Name& name = interest.getName();
+  if (name.size() < ndn::signed_interest::MIN_SIZE) {
+    return ndn::Name();
+  }
+
+  try {
+    ndn::SignatureInfo info(name[ndn::signed_interest::POS_SIG_INFO].blockFromValue());
+    if (info.hasKeyLocator() && info.getKeyLocator().getType() == ndn::tlv::Name) {
+      return info.getKeyLocator().getName();
+    }
+  }
+  catch (const ndn::tlv::Error&) {
+  }
+  return ndn::Name();
+}
+
+int
+getHashBucket(const std::string& hash)
+{
+  if (hash.size() < 2) {
+    return -1;
+  }
+  return std::stoi(hash.substr(0, 2), nullptr, 16);
+}
+
+std::string
+getBucketPrefix(int bucket)
+{
+  std::ostringstream os;
+  os << std::hex << std::setw(2) << std::setfill('0') << bucket;
+  return os.str();
+}
+
 } // namespace util
 } // namespace repo
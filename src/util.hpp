@@ -3,15 +3,76 @@
 
 #include <ndn-cxx/face.hpp>
 #include "repo-command-parameter.hpp"
+#include "fetch/hash-chain-verifier.hpp"
+
+#include <boost/property_tree/ptree.hpp>
 
 namespace repo {
 namespace util {
 
+/**
+ * @brief maximum size of the JSON document carried by one segment of a dataset reply
+ *
+ * Leaves room below ndn::MAX_NDN_PACKET_SIZE for the (signed command) name and signature.
+ */
+static const size_t DATASET_SEGMENT_SIZE = 6000;
+
 ndn::Interest
 generateCommandInterest(
     const ndn::Name& commandPrefix, const std::string& command,
     const RepoCommandParameter& commandParameter,
     milliseconds interestLifetime);
+
+/**
+ * @brief split a JSON array into self-contained JSON documents of bounded size
+ *
+ * Every returned document is an object holding a part of @p items under @p key, so that
+ * each segment of a dataset can be parsed on its own as soon as it arrives.
+ * Children of @p trailer are added to the last document. At least one document is returned.
+ */
+std::vector<std::string>
+segmentJsonArray(const std::string& key, const boost::property_tree::ptree& items,
+                 const boost::property_tree::ptree& trailer = boost::property_tree::ptree(),
+                 size_t maxSegmentSize = DATASET_SEGMENT_SIZE);
+
+/**
+ * @brief the digest of the next segment, a HashChain element of the SignatureInfo
+ *
+ * Empty if the producer did not chain @p data to a next segment.
+ */
+std::vector<uint8_t>
+getNextHash(const ndn::Data& data);
+
+/**
+ * @brief the parts of a digest-signed segment checked by HashChainVerifier
+ *
+ * The signed portion is the Data value up to the SignatureValue.
+ */
+HashChainVerifier::Segment
+makeHashChainSegment(const ndn::Data& data);
+
+/**
+ * @brief the name of the key a signed command Interest was signed with
+ *
+ * Empty if @p interest is not a signed command or names no key.
+ */
+ndn::Name
+getCommandSigner(const ndn::Interest& interest);
+
+/**
+ * @brief return the keyspace bucket (0x00 ~ 0xff) a manifest hash belongs to
+ */
+int
+getHashBucket(const std::string& hash);
+
+/**
+ * @brief return the two hex digits every hash of @p bucket starts with
+ *
+ * The prefix sorts right before the hashes of @p bucket and after those of earlier buckets.
+ */
+std::string
+getBucketPrefix(int bucket);
+
 } // namespace util
 } // namespace repo
 #endif // REPO_UTIL
@@ -0,0 +1,93 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fetch/congestion-control.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestCongestionControl)
+
+BOOST_AUTO_TEST_CASE(UnknownPath)
+{
+  for (const char* name : {"aimd", "cubic", "bbr"}) {
+    FetchWindow window = CongestionControl::create(name)->makeWindow(PathEstimate());
+    BOOST_CHECK_EQUAL(window.initCwnd, 12);
+    BOOST_CHECK(!window.useConstantCwnd);
+  }
+  BOOST_CHECK_THROW(CongestionControl::create("reno"), CongestionControl::Error);
+}
+
+BOOST_AUTO_TEST_CASE(SeededWindow)
+{
+  PathEstimate path;
+  path.rtt = 0.12;
+  path.minRtt = 0.1;
+  path.rate = 500;  // 50 segments in flight fill the path
+
+  FetchWindow aimd = AimdControl().makeWindow(path);
+  BOOST_CHECK_CLOSE(aimd.initCwnd, 50, 0.001);
+  BOOST_CHECK_CLOSE(aimd.initSsthresh, 100, 0.001);
+  BOOST_CHECK_EQUAL(aimd.mdCoef, 0.5);
+
+  FetchWindow cubic = CubicControl().makeWindow(path);
+  BOOST_CHECK_CLOSE(cubic.initCwnd, 50, 0.001);
+  BOOST_CHECK_CLOSE(cubic.aiStep, 5, 0.001);
+  BOOST_CHECK_EQUAL(cubic.mdCoef, 0.7);
+
+  FetchWindow bbr = BbrControl().makeWindow(path);
+  BOOST_CHECK_CLOSE(bbr.initCwnd, 100, 0.001);
+  BOOST_CHECK(bbr.useConstantCwnd);
+
+  path.rate = 1e9;
+  BOOST_CHECK_EQUAL(AimdControl().makeWindow(path).initCwnd, 4096);
+  path.rate = 1;
+  BOOST_CHECK_EQUAL(AimdControl().makeWindow(path).initCwnd, 2);
+}
+
+BOOST_AUTO_TEST_CASE(History)
+{
+  PathHistory history(2, 0.5);
+  BOOST_CHECK(!history.get("/a").isKnown());
+
+  history.addSample("/a", 0.2, 100);
+  history.addSample("/a", 0.1, 0);
+  PathEstimate a = history.get("/a");
+  BOOST_CHECK_CLOSE(a.rtt, 0.15, 0.001);
+  BOOST_CHECK_CLOSE(a.minRtt, 0.1, 0.001);
+  BOOST_CHECK_CLOSE(a.rate, 100, 0.001);
+
+  history.addSample("/b", 0.1, 10);
+  history.addSample("/a", 0.1, 300);
+  BOOST_CHECK_CLOSE(history.get("/a").rate, 200, 0.001);
+
+  // /b is the least recently updated path
+  history.addSample("/c", 0.1, 10);
+  BOOST_CHECK_EQUAL(history.size(), 2);
+  BOOST_CHECK(!history.get("/b").isKnown());
+  BOOST_CHECK(history.get("/a").isKnown());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
@@ -0,0 +1,89 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "manifest/content-record.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestContentRecord)
+
+static boost::property_tree::ptree
+makeManifest(const std::string& name)
+{
+  boost::property_tree::ptree manifest;
+  manifest.put("info.name", name);
+  manifest.put("info.startBlockId", 0);
+  manifest.put("info.endBlockId", 9);
+  return manifest;
+}
+
+BOOST_AUTO_TEST_CASE(References)
+{
+  ContentRecord record(makeManifest("/a"));
+  BOOST_CHECK_EQUAL(record.getName(), "/a");
+
+  BOOST_CHECK(record.addRef("/a", "k1"));
+  BOOST_CHECK(record.addRef("/a", "k2"));
+  BOOST_CHECK(record.addRef("/a", "k2"));
+  // another copy of the same content, with its own segments
+  BOOST_CHECK(!record.addRef("/b", "k3"));
+  BOOST_CHECK_EQUAL(record.getRefCount(), 2);
+
+  BOOST_CHECK(record.release("k1"));
+  BOOST_CHECK(!record.release("k1"));
+  BOOST_CHECK(!record.release("k3"));
+  BOOST_CHECK(record.hasRef("k2"));
+  BOOST_CHECK_EQUAL(record.getRefCount(), 1);
+
+  BOOST_CHECK_THROW(ContentRecord(boost::property_tree::ptree()), ContentRecord::Error);
+}
+
+BOOST_AUTO_TEST_CASE(Persist)
+{
+  ContentRecord record(makeManifest("/a"));
+  record.addRef("/a", "k1");
+  record.addRef("/a", "k2");
+
+  ContentRecord decoded = ContentRecord::fromJson(record.toJson());
+  BOOST_CHECK_EQUAL(decoded.getName(), "/a");
+  BOOST_CHECK_EQUAL(decoded.getManifest().get<int>("info.endBlockId"), 9);
+  BOOST_CHECK_EQUAL(decoded.getRefCount(), 2);
+  BOOST_CHECK(decoded.hasRef("k1"));
+  BOOST_CHECK(decoded.hasRef("k2"));
+
+  BOOST_CHECK_THROW(ContentRecord::fromJson("{\"refs\": []}"), ContentRecord::Error);
+  BOOST_CHECK_THROW(ContentRecord::fromJson("not json"), ContentRecord::Error);
+}
+
+BOOST_AUTO_TEST_CASE(Digest)
+{
+  BOOST_CHECK(ContentRecord::isDigest(std::string(64, 'a')));
+  BOOST_CHECK(ContentRecord::isDigest("E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855"));
+  BOOST_CHECK(!ContentRecord::isDigest(std::string(63, 'a')));
+  BOOST_CHECK(!ContentRecord::isDigest(std::string(64, 'g')));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
@@ -0,0 +1,184 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fetch/hash-chain-verifier.hpp"
+#include "fetch/multi-buffer-sha256.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestHashChainVerifier)
+
+/**
+ * @brief segments 0 to n-1 where each one carries the digest of the next
+ */
+static std::vector<HashChainVerifier::Segment>
+makeChain(size_t n)
+{
+  std::vector<HashChainVerifier::Segment> chain(n);
+  for (size_t i = n; i-- > 0;) {
+    auto& segment = chain[i];
+    segment.segmentNo = i;
+    segment.signedPortion.assign(100 + i, static_cast<uint8_t>(i));
+    if (i + 1 < n) {
+      segment.nextHash = chain[i + 1].signatureValue;
+      segment.signedPortion.insert(segment.signedPortion.end(),
+                                   segment.nextHash.begin(), segment.nextHash.end());
+    }
+    auto digest = MultiBufferSha256::compute({{segment.signedPortion.data(),
+                                               segment.signedPortion.size()}}).front();
+    segment.signatureValue.assign(digest.begin(), digest.end());
+  }
+  return chain;
+}
+
+BOOST_AUTO_TEST_CASE(InOrderRuns)
+{
+  auto chain = makeChain(20);
+  HashChainVerifier verifier(8);
+  BOOST_CHECK(verifier.setAnchor(0, chain[0].signatureValue).empty());
+
+  std::vector<HashChainVerifier::Run> runs;
+  for (const auto& segment : chain) {
+    for (auto& run : verifier.add(segment)) {
+      runs.push_back(std::move(run));
+    }
+  }
+  BOOST_CHECK_EQUAL(runs.size(), 2);
+  for (auto& run : verifier.flush()) {
+    runs.push_back(std::move(run));
+  }
+  BOOST_REQUIRE_EQUAL(runs.size(), 3);
+  BOOST_CHECK_EQUAL(runs[2].segments.size(), 4);
+  BOOST_CHECK(runs[1].anchor == chain[7].nextHash);
+
+  for (const auto& run : runs) {
+    auto isValid = HashChainVerifier::verify(run);
+    BOOST_CHECK(std::all_of(isValid.begin(), isValid.end(), [] (bool b) { return b; }));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(OutOfOrder)
+{
+  auto chain = makeChain(6);
+  HashChainVerifier verifier(8);
+
+  // nothing is linked before the anchor
+  BOOST_CHECK(verifier.add(chain[4]).empty());
+  BOOST_CHECK(verifier.add(chain[0]).empty());
+  BOOST_CHECK(verifier.flush().empty());
+  BOOST_CHECK_EQUAL(verifier.getHeld(), 2);
+
+  BOOST_CHECK(verifier.setAnchor(0, chain[0].signatureValue).empty());
+  BOOST_CHECK(verifier.add(chain[1]).empty());
+  BOOST_CHECK(verifier.add(chain[5]).empty());
+  BOOST_CHECK_EQUAL(verifier.getHeld(), 2);
+
+  auto runs = verifier.flush();
+  BOOST_REQUIRE_EQUAL(runs.size(), 1);
+  BOOST_CHECK_EQUAL(runs[0].segments.size(), 2);
+  BOOST_CHECK(HashChainVerifier::verify(runs[0]) == std::vector<bool>({true, true}));
+
+  // the gap filled, the held segments follow
+  BOOST_CHECK(verifier.add(chain[3]).empty());
+  BOOST_CHECK(verifier.add(chain[2]).empty());
+  BOOST_CHECK_EQUAL(verifier.getHeld(), 0);
+  runs = verifier.flush();
+  BOOST_REQUIRE_EQUAL(runs.size(), 1);
+  BOOST_CHECK_EQUAL(runs[0].segments.front().segmentNo, 2);
+  BOOST_CHECK(runs[0].anchor == chain[1].nextHash);
+  BOOST_CHECK(HashChainVerifier::verify(runs[0]) == std::vector<bool>({true, true, true, true}));
+}
+
+BOOST_AUTO_TEST_CASE(ForgedOutOfOrder)
+{
+  auto chain = makeChain(4);
+
+  // a segment with a correct digest of its own, but not the one the chain names
+  HashChainVerifier::Segment forged = chain[2];
+  forged.signedPortion[0] ^= 1;
+  auto digest = MultiBufferSha256::compute({{forged.signedPortion.data(),
+                                             forged.signedPortion.size()}}).front();
+  forged.signatureValue.assign(digest.begin(), digest.end());
+
+  HashChainVerifier verifier(8);
+  verifier.setAnchor(0, chain[0].signatureValue);
+  BOOST_CHECK(verifier.add(chain[0]).empty());
+  BOOST_CHECK(verifier.add(forged).empty());
+  BOOST_CHECK(verifier.add(chain[3]).empty());
+
+  // arriving out of order, it is neither run alone nor trusted
+  auto runs = verifier.flush();
+  BOOST_REQUIRE_EQUAL(runs.size(), 1);
+  BOOST_CHECK_EQUAL(runs[0].segments.size(), 1);
+  BOOST_CHECK_EQUAL(verifier.getHeld(), 2);
+
+  BOOST_CHECK(verifier.add(chain[1]).empty());
+  runs = verifier.flush();
+  BOOST_REQUIRE_EQUAL(runs.size(), 1);
+  BOOST_CHECK(HashChainVerifier::verify(runs[0]) == std::vector<bool>({true, false, false}));
+
+  // nor does a run without anchor pass
+  HashChainVerifier::Run run;
+  run.segments = {forged};
+  BOOST_CHECK(HashChainVerifier::verify(run) == std::vector<bool>({false}));
+}
+
+BOOST_AUTO_TEST_CASE(RepeatedAnchor)
+{
+  auto chain = makeChain(4);
+  HashChainVerifier verifier(8);
+  verifier.setAnchor(0, chain[0].signatureValue);
+  verifier.add(chain[0]);
+  verifier.add(chain[1]);
+  BOOST_CHECK(verifier.isLinked(1));
+
+  // the chain reaches these already, so neither is linked twice
+  BOOST_CHECK(verifier.setAnchor(1, chain[1].signatureValue).empty());
+  BOOST_CHECK(verifier.add(chain[1]).empty());
+  auto runs = verifier.flush();
+  BOOST_REQUIRE_EQUAL(runs.size(), 1);
+  BOOST_CHECK_EQUAL(runs[0].segments.size(), 2);
+  BOOST_CHECK_EQUAL(verifier.getHeld(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(BrokenLink)
+{
+  auto chain = makeChain(4);
+  chain[1].signedPortion[0] ^= 1;
+
+  HashChainVerifier::Run run;
+  run.segments = chain;
+  run.anchor = chain[0].signatureValue;
+  BOOST_CHECK(HashChainVerifier::verify(run) == std::vector<bool>({true, false, false, false}));
+
+  run.segments = {chain[2], chain[3]};
+  run.anchor = chain[0].nextHash;
+  BOOST_CHECK(HashChainVerifier::verify(run) == std::vector<bool>({false, false}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
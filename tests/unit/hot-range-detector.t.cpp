@@ -0,0 +1,104 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "keyspace/hot-range-detector.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestHotRangeDetector)
+
+BOOST_AUTO_TEST_CASE(Rates)
+{
+  HotRangeDetector detector(0.5);
+  for (int i = 0; i < 20; ++i) {
+    detector.add(0x10);
+  }
+  detector.add(-1);
+  detector.add(HotRangeDetector::N_BUCKETS);
+
+  detector.update(2);
+  BOOST_CHECK_CLOSE(detector.getRates()[0x10], 5, 0.001);
+  BOOST_CHECK_EQUAL(detector.getRates()[0x11], 0);
+
+  detector.update(2);
+  BOOST_CHECK_CLOSE(detector.getRates()[0x10], 2.5, 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(BalancedRanges)
+{
+  std::vector<HotRangeDetector::Range> ranges{{0x00, 0x7f}, {0x80, 0xff}};
+  HotRangeDetector::Rates rates;
+  rates.fill(1);
+
+  BOOST_CHECK(!HotRangeDetector::findShift(ranges, rates, 2, 10));
+
+  // hot, but below the minimum rate
+  rates.fill(0);
+  rates[0x01] = 5;
+  BOOST_CHECK(!HotRangeDetector::findShift(ranges, rates, 2, 10));
+}
+
+BOOST_AUTO_TEST_CASE(ShiftToColderNeighbour)
+{
+  std::vector<HotRangeDetector::Range> ranges{{0x00, 0x3f}, {0x40, 0xbf}, {0xc0, 0xff}};
+  HotRangeDetector::Rates rates;
+  rates.fill(0);
+  rates[0x10] = 10;
+  rates[0x50] = 30;
+  rates[0x60] = 30;
+  rates[0x70] = 30;
+  rates[0xa0] = 30;
+  rates[0xd0] = 40;
+
+  auto shift = HotRangeDetector::findShift(ranges, rates, 2, 10);
+  BOOST_REQUIRE(shift);
+  BOOST_CHECK_EQUAL(shift->from, 1);
+  BOOST_CHECK_EQUAL(shift->to, 0);
+  // at most half the difference, 55 req/s, may move: 0x50 fits but 0x60 does not
+  BOOST_CHECK_EQUAL(shift->start, 0x40);
+  BOOST_CHECK_EQUAL(shift->end, 0x50);
+}
+
+BOOST_AUTO_TEST_CASE(SingleHotBucket)
+{
+  std::vector<HotRangeDetector::Range> ranges{{0x00, 0x7f}, {0x80, 0xff}};
+  HotRangeDetector::Rates rates;
+  rates.fill(0);
+  rates[0x40] = 100;
+
+  // moving the bucket would only move the hot spot
+  BOOST_CHECK(!HotRangeDetector::findShift(ranges, rates, 2, 10));
+
+  rates[0x7f] = 30;
+  auto shift = HotRangeDetector::findShift(ranges, rates, 2, 10);
+  BOOST_REQUIRE(shift);
+  BOOST_CHECK_EQUAL(shift->from, 0);
+  BOOST_CHECK_EQUAL(shift->to, 1);
+  BOOST_CHECK_EQUAL(shift->start, 0x7f);
+  BOOST_CHECK_EQUAL(shift->end, 0x7f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
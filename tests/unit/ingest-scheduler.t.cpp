@@ -0,0 +1,137 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fetch/ingest-scheduler.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestIngestScheduler)
+
+static IngestScheduler::Limits
+makeLimits(size_t maxInFlightSegments, double maxBytesPerSecond, size_t maxQueued)
+{
+  IngestScheduler::Limits limits;
+  limits.maxInFlightSegments = maxInFlightSegments;
+  limits.maxBytesPerSecond = maxBytesPerSecond;
+  limits.maxQueued = maxQueued;
+  return limits;
+}
+
+BOOST_AUTO_TEST_CASE(FairShare)
+{
+  IngestScheduler scheduler(makeLimits(100, 0, 16));
+  scheduler.enqueue({1, "/a", 1000});
+  scheduler.enqueue({2, "/a", 1000});
+  scheduler.enqueue({3, "/a", 1000});
+  scheduler.enqueue({4, "/b", 1000});
+
+  // the insert of /b goes before the second one of /a, each flow gets half the budget
+  auto grants = scheduler.poll(0);
+  BOOST_REQUIRE_EQUAL(grants.size(), 2);
+  BOOST_CHECK_EQUAL(grants[0].id, 1);
+  BOOST_CHECK_EQUAL(grants[0].window, 50);
+  BOOST_CHECK_EQUAL(grants[1].id, 4);
+  BOOST_CHECK_EQUAL(grants[1].window, 50);
+  BOOST_CHECK_EQUAL(scheduler.getInFlight(), 100);
+  BOOST_CHECK(scheduler.poll(0.5).empty());
+
+  scheduler.finish(1);
+  grants = scheduler.poll(1);
+  BOOST_REQUIRE_EQUAL(grants.size(), 1);
+  BOOST_CHECK_EQUAL(grants[0].id, 2);
+
+  // a small insert overtakes the large one still queued
+  scheduler.finish(4);
+  scheduler.enqueue({5, "/c", 3});
+  grants = scheduler.poll(2);
+  BOOST_REQUIRE_EQUAL(grants.size(), 1);
+  BOOST_CHECK_EQUAL(grants[0].id, 5);
+  BOOST_CHECK_EQUAL(grants[0].window, 3);
+  BOOST_CHECK_EQUAL(scheduler.getQueued(), 1);
+  BOOST_CHECK_EQUAL(scheduler.getRunning(), 2);
+
+  scheduler.finish(3);
+  BOOST_CHECK_EQUAL(scheduler.getQueued(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(FlowShare)
+{
+  IngestScheduler scheduler(makeLimits(90, 0, 16));
+  scheduler.enqueue({1, "/a", 1000});
+  scheduler.enqueue({2, "/b", 1000});
+  scheduler.enqueue({3, "/c", 1000});
+  // queued again under another flow, /c has no insert left
+  scheduler.enqueue({3, "/a", 1000});
+
+  auto grants = scheduler.poll(0);
+  BOOST_REQUIRE_EQUAL(grants.size(), 2);
+  BOOST_CHECK_EQUAL(grants[0].window, 45);
+  BOOST_CHECK_EQUAL(grants[1].window, 45);
+
+  // once /b is done, the remaining flow gets the whole budget
+  scheduler.finish(1);
+  scheduler.finish(2);
+  grants = scheduler.poll(1);
+  BOOST_REQUIRE_EQUAL(grants.size(), 1);
+  BOOST_CHECK_EQUAL(grants[0].id, 3);
+  BOOST_CHECK_EQUAL(grants[0].window, 90);
+}
+
+BOOST_AUTO_TEST_CASE(Admission)
+{
+  IngestScheduler scheduler(makeLimits(10, 0, 2));
+  BOOST_CHECK(scheduler.checkAdmission().isAccepted);
+
+  scheduler.enqueue({1, "/a", 1000});
+  scheduler.enqueue({2, "/b", 500});
+  auto admission = scheduler.checkAdmission();
+  BOOST_CHECK(!admission.isAccepted);
+  // 1500 segments at the throughput assumed before any sample
+  BOOST_CHECK_CLOSE(admission.retryAfter, 15, 0.001);
+
+  scheduler.poll(0);
+  BOOST_CHECK(scheduler.checkAdmission().isAccepted);
+}
+
+BOOST_AUTO_TEST_CASE(ByteRate)
+{
+  IngestScheduler scheduler(makeLimits(0, 1000, 16));
+  scheduler.enqueue({1, "/a", 10});
+  auto grants = scheduler.poll(0);
+  BOOST_REQUIRE_EQUAL(grants.size(), 1);
+  BOOST_CHECK_EQUAL(grants[0].window, IngestScheduler::UNLIMITED);
+
+  scheduler.onStored(1, 3000, 0.5);
+  scheduler.enqueue({2, "/a", 10});
+  BOOST_CHECK(scheduler.poll(1).empty());
+  BOOST_CHECK(scheduler.poll(2.5).empty());
+
+  grants = scheduler.poll(3.1);
+  BOOST_REQUIRE_EQUAL(grants.size(), 1);
+  BOOST_CHECK_EQUAL(grants[0].id, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
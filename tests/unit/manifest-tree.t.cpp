@@ -0,0 +1,107 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "manifest/manifest-tree.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestManifestTree)
+
+BOOST_AUTO_TEST_CASE(InsertErase)
+{
+  ManifestTree tree;
+  BOOST_CHECK_EQUAL(tree.size(), 0);
+  BOOST_CHECK(tree.getNode(ManifestTree::ROOT).digest == ManifestTree::Digest{});
+
+  BOOST_CHECK(tree.insert("0a11"));
+  BOOST_CHECK(!tree.insert("0a11"));
+  BOOST_CHECK(tree.insert("ff22"));
+  BOOST_CHECK(!tree.insert("x"));
+  BOOST_CHECK_EQUAL(tree.size(), 2);
+  BOOST_CHECK_EQUAL(tree.getBucket(0x0a).size(), 1);
+  BOOST_CHECK_EQUAL(tree.getNode(ManifestTree::N_BUCKETS + 0xff).count, 1);
+
+  BOOST_CHECK(tree.erase("ff22"));
+  BOOST_CHECK(!tree.erase("ff22"));
+  BOOST_CHECK_EQUAL(tree.size(), 1);
+  BOOST_CHECK(tree.getNode(ManifestTree::N_BUCKETS + 0xff).digest == ManifestTree::Digest{});
+}
+
+BOOST_AUTO_TEST_CASE(DigestIndependentOfOrder)
+{
+  ManifestTree a;
+  ManifestTree b;
+  a.insert("1000");
+  a.insert("1001");
+  a.insert("8000");
+  b.insert("8000");
+  b.insert("1001");
+  b.insert("1000");
+  BOOST_CHECK(a.getNode(ManifestTree::ROOT).digest == b.getNode(ManifestTree::ROOT).digest);
+
+  b.erase("1001");
+  BOOST_CHECK(a.getNode(ManifestTree::ROOT).digest != b.getNode(ManifestTree::ROOT).digest);
+
+  // only the path to bucket 0x10 differs
+  size_t leaf = ManifestTree::N_BUCKETS + 0x80;
+  BOOST_CHECK(a.getNode(leaf).digest == b.getNode(leaf).digest);
+  BOOST_CHECK(a.getNode(ManifestTree::ROOT * 2 + 1).digest == b.getNode(ManifestTree::ROOT * 2 + 1).digest);
+  BOOST_CHECK(a.getNode(ManifestTree::ROOT * 2).digest != b.getNode(ManifestTree::ROOT * 2).digest);
+}
+
+BOOST_AUTO_TEST_CASE(RangeNodes)
+{
+  std::vector<size_t> all = ManifestTree::getRangeNodes(0x00, 0xff);
+  BOOST_CHECK_EQUAL(all.size(), 1);
+  BOOST_CHECK_EQUAL(all.front(), ManifestTree::ROOT);
+
+  std::vector<size_t> upper = ManifestTree::getRangeNodes(0x80, 0xff);
+  BOOST_CHECK_EQUAL(upper.size(), 1);
+  BOOST_CHECK_EQUAL(upper.front(), 3);
+
+  std::vector<size_t> one = ManifestTree::getRangeNodes(0x42, 0x42);
+  BOOST_CHECK_EQUAL(one.size(), 1);
+  BOOST_CHECK_EQUAL(one.front(), ManifestTree::N_BUCKETS + 0x42);
+
+  // the subtrees cover exactly the range, in order
+  std::vector<size_t> nodes = ManifestTree::getRangeNodes(0x03, 0xbe);
+  int next = 0x03;
+  for (size_t index : nodes) {
+    size_t first = index;
+    size_t last = index;
+    while (!ManifestTree::isLeaf(first)) {
+      first = 2 * first;
+      last = 2 * last + 1;
+    }
+    BOOST_CHECK_EQUAL(ManifestTree::getLeafBucket(first), next);
+    next = ManifestTree::getLeafBucket(last) + 1;
+  }
+  BOOST_CHECK_EQUAL(next, 0xbf);
+  BOOST_CHECK_LE(nodes.size(), 14);
+
+  BOOST_CHECK(ManifestTree::getRangeNodes(0x10, 0x0f).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
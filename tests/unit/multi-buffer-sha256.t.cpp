@@ -0,0 +1,110 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fetch/multi-buffer-sha256.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <string>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestMultiBufferSha256)
+
+static std::string
+toHex(const MultiBufferSha256::Digest& digest)
+{
+  static const char HEX[] = "0123456789abcdef";
+  std::string hex;
+  for (uint8_t byte : digest) {
+    hex += HEX[byte >> 4];
+    hex += HEX[byte & 0x0f];
+  }
+  return hex;
+}
+
+static const MultiBufferSha256::Kernel KERNELS[] = {
+  MultiBufferSha256::Kernel::SCALAR,
+  MultiBufferSha256::Kernel::AVX2,
+  MultiBufferSha256::Kernel::SHA_NI
+};
+
+BOOST_AUTO_TEST_CASE(KnownVectors)
+{
+  std::vector<std::string> inputs = {
+    "",
+    "abc",
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+  };
+  std::vector<std::string> expected = {
+    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+    "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"
+  };
+
+  std::vector<MultiBufferSha256::Message> messages;
+  for (const auto& input : inputs) {
+    messages.push_back({reinterpret_cast<const uint8_t*>(input.data()), input.size()});
+  }
+
+  for (auto kernel : KERNELS) {
+    if (!MultiBufferSha256::isSupported(kernel)) {
+      continue;
+    }
+    auto digests = MultiBufferSha256::compute(messages, kernel);
+    BOOST_REQUIRE_EQUAL(digests.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      BOOST_CHECK_EQUAL(toHex(digests[i]), expected[i]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(KernelsAgree)
+{
+  // lengths around the padding boundaries, and more messages than AVX2 lanes
+  std::mt19937 random(42);
+  std::vector<std::vector<uint8_t>> inputs;
+  for (size_t len : {0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 1000, 4096, 8000}) {
+    std::vector<uint8_t> input(len);
+    for (auto& byte : input) {
+      byte = static_cast<uint8_t>(random());
+    }
+    inputs.push_back(input);
+  }
+
+  std::vector<MultiBufferSha256::Message> messages;
+  for (const auto& input : inputs) {
+    messages.push_back({input.data(), input.size()});
+  }
+
+  auto reference = MultiBufferSha256::compute(messages, MultiBufferSha256::Kernel::SCALAR);
+  for (auto kernel : KERNELS) {
+    if (MultiBufferSha256::isSupported(kernel)) {
+      BOOST_CHECK(MultiBufferSha256::compute(messages, kernel) == reference);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
@@ -0,0 +1,89 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "membership/phi-accrual-detector.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+using namespace ndn::time_literals;
+
+BOOST_AUTO_TEST_SUITE(TestPhiAccrualDetector)
+
+BOOST_AUTO_TEST_CASE(NoHeartbeat)
+{
+  PhiAccrualDetector detector(500_ms);
+  ndn::time::steady_clock::TimePoint now;
+
+  BOOST_CHECK(!detector.hasHeartbeat());
+  BOOST_CHECK_EQUAL(detector.phi(now + 1_h), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GrowsWithSilence)
+{
+  PhiAccrualDetector detector(500_ms);
+  ndn::time::steady_clock::TimePoint now;
+  for (int i = 0; i < 20; ++i) {
+    detector.heartbeat(now);
+    now += 500_ms;
+  }
+  now -= 500_ms;
+
+  BOOST_CHECK_LT(detector.phi(now + 100_ms), 1);
+  BOOST_CHECK_LT(detector.phi(now + 500_ms), 1);
+  BOOST_CHECK_LT(detector.phi(now + 700_ms), detector.phi(now + 900_ms));
+  BOOST_CHECK_GT(detector.phi(now + 2_s), 8);
+}
+
+BOOST_AUTO_TEST_CASE(AdaptsToJitter)
+{
+  PhiAccrualDetector steady(500_ms, 10_ms);
+  PhiAccrualDetector jittery(500_ms, 10_ms);
+  ndn::time::steady_clock::TimePoint steadyNow;
+  ndn::time::steady_clock::TimePoint jitteryNow;
+  for (int i = 0; i < 50; ++i) {
+    steadyNow += 500_ms;
+    jitteryNow += i % 2 == 0 ? 200_ms : 800_ms;
+    steady.heartbeat(steadyNow);
+    jittery.heartbeat(jitteryNow);
+  }
+
+  // the same delay is more suspicious on a link that is usually on time
+  BOOST_CHECK_GT(steady.phi(steadyNow + 600_ms), 3);
+  BOOST_CHECK_LT(jittery.phi(jitteryNow + 600_ms), 1);
+}
+
+BOOST_AUTO_TEST_CASE(RecoversOnHeartbeat)
+{
+  PhiAccrualDetector detector(500_ms);
+  ndn::time::steady_clock::TimePoint now;
+  detector.heartbeat(now);
+  now += 10_s;
+  BOOST_CHECK_GT(detector.phi(now), 8);
+
+  detector.heartbeat(now);
+  BOOST_CHECK_LT(detector.phi(now), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
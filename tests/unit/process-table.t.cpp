@@ -0,0 +1,116 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "handles/process-table.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <random>
+#include <string>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestProcessTable)
+
+BOOST_AUTO_TEST_CASE(LikeMap)
+{
+  ProcessTable<std::string> table;
+  std::map<uint64_t, std::string> reference;
+  std::mt19937_64 random(7);
+
+  // small ids collide in the index, so that erasure has to shift probe runs back
+  for (int i = 0; i < 20000; ++i) {
+    uint64_t id = random() % 3000;
+    if (random() % 3 == 0) {
+      BOOST_REQUIRE_EQUAL(table.erase(id), reference.erase(id));
+    }
+    else {
+      table[id] = std::to_string(i);
+      reference[id] = std::to_string(i);
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(table.size(), reference.size());
+  for (uint64_t id = 0; id < 3000; ++id) {
+    auto it = table.find(id);
+    BOOST_REQUIRE_EQUAL(table.count(id), reference.count(id));
+    if (reference.count(id) > 0) {
+      BOOST_REQUIRE(it != table.end());
+      BOOST_CHECK_EQUAL(it->second, reference[id]);
+    }
+    else {
+      BOOST_CHECK(it == table.end());
+    }
+  }
+
+  size_t nVisited = 0;
+  for (const auto& item : table) {
+    BOOST_CHECK_EQUAL(item.second, reference[item.first]);
+    ++nVisited;
+  }
+  BOOST_CHECK_EQUAL(nVisited, reference.size());
+}
+
+BOOST_AUTO_TEST_CASE(StableRecords)
+{
+  ProcessTable<std::string> table;
+  std::string& first = table[42];
+  first = "first";
+  for (uint64_t id = 100; id < 10000; ++id) {
+    table[id] = "other";
+  }
+  BOOST_CHECK_EQUAL(&table[42], &first);
+  BOOST_CHECK_EQUAL(first, "first");
+
+  // an erased record is reused empty
+  table.erase(42);
+  BOOST_CHECK(table.find(42) == table.end());
+  BOOST_CHECK(table[43].empty());
+}
+
+BOOST_AUTO_TEST_CASE(Expiry)
+{
+  ProcessTable<int> table(4);
+  table[1] = 1;
+  table[2] = 2;
+  table[3] = 3;
+  table.expireAfter(1, 2);
+  table.expireAfter(2, 6);  // more than one turn of the wheel
+  table.expireAfter(3, 1);
+  table.expireAfter(3, 3);  // replaces the earlier expiry
+
+  BOOST_CHECK_EQUAL(table.advance(), 0);
+  BOOST_CHECK_EQUAL(table.advance(), 1);
+  BOOST_CHECK_EQUAL(table.count(1), 0);
+  BOOST_CHECK_EQUAL(table.advance(), 1);
+  BOOST_CHECK_EQUAL(table.count(3), 0);
+  BOOST_CHECK_EQUAL(table.advance(), 0);
+  BOOST_CHECK_EQUAL(table.advance(), 0);
+  BOOST_CHECK_EQUAL(table.count(2), 1);
+  BOOST_CHECK_EQUAL(table.advance(), 1);
+  BOOST_CHECK(table.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
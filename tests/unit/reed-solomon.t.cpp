@@ -0,0 +1,107 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ec/reed-solomon.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestReedSolomon)
+
+static std::vector<std::vector<uint8_t>>
+makeFragments(size_t k, size_t m, size_t len)
+{
+  std::mt19937 random(k * 31 + m);
+  std::vector<std::vector<uint8_t>> fragments(k + m, std::vector<uint8_t>(len));
+  for (size_t i = 0; i < k; ++i) {
+    for (auto& byte : fragments[i]) {
+      byte = static_cast<uint8_t>(random());
+    }
+  }
+
+  ReedSolomon rs(k, m);
+  std::vector<const uint8_t*> data;
+  std::vector<uint8_t*> parity;
+  for (size_t i = 0; i < k; ++i) {
+    data.push_back(fragments[i].data());
+  }
+  for (size_t j = 0; j < m; ++j) {
+    parity.push_back(fragments[k + j].data());
+  }
+  rs.encode(data.data(), parity.data(), len);
+  return fragments;
+}
+
+BOOST_AUTO_TEST_CASE(ReconstructAnyK)
+{
+  const size_t k = 4;
+  const size_t m = 2;
+  // not a multiple of the SIMD width, so that the scalar tail is used too
+  const size_t len = 1000;
+  auto original = makeFragments(k, m, len);
+
+  ReedSolomon rs(k, m);
+  for (size_t lost1 = 0; lost1 < k + m; ++lost1) {
+    for (size_t lost2 = lost1 + 1; lost2 < k + m; ++lost2) {
+      auto fragments = original;
+      std::vector<bool> isPresent(k + m, true);
+      isPresent[lost1] = isPresent[lost2] = false;
+      std::fill(fragments[lost1].begin(), fragments[lost1].end(), 0);
+      std::fill(fragments[lost2].begin(), fragments[lost2].end(), 0);
+
+      std::vector<uint8_t*> buffers;
+      for (auto& fragment : fragments) {
+        buffers.push_back(fragment.data());
+      }
+      BOOST_REQUIRE(rs.reconstruct(buffers.data(), isPresent, len));
+      for (size_t i = 0; i < k; ++i) {
+        BOOST_CHECK(fragments[i] == original[i]);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TooFewFragments)
+{
+  const size_t k = 3;
+  const size_t m = 1;
+  auto fragments = makeFragments(k, m, 64);
+
+  std::vector<uint8_t*> buffers;
+  for (auto& fragment : fragments) {
+    buffers.push_back(fragment.data());
+  }
+  std::vector<bool> isPresent{false, true, false, true};
+  BOOST_CHECK(!ReedSolomon(k, m).reconstruct(buffers.data(), isPresent, 64));
+}
+
+BOOST_AUTO_TEST_CASE(InvalidParameters)
+{
+  BOOST_CHECK_THROW(ReedSolomon(0, 2), ReedSolomon::Error);
+  BOOST_CHECK_THROW(ReedSolomon(200, 57), ReedSolomon::Error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
@@ -54,6 +54,57 @@ BOOST_AUTO_TEST_CASE(EncodeDecode)
   BOOST_CHECK_EQUAL(decoded.getStartBlockId(), parameter.getStartBlockId());
   BOOST_CHECK_EQUAL(decoded.getEndBlockId(), parameter.getEndBlockId());
   BOOST_CHECK_EQUAL(decoded.getProcessId(), parameter.getProcessId());
+  BOOST_CHECK(!decoded.hasStride());
+  BOOST_CHECK_EQUAL(decoded.getStride(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(Stride)
+{
+  repo::RepoCommandParameter parameter;
+  parameter.setName("/a");
+  parameter.setStartBlockId(2);
+  parameter.setEndBlockId(98);
+  parameter.setStride(4);
+
+  repo::RepoCommandParameter decoded(parameter.wireEncode());
+  BOOST_CHECK(decoded.hasStride());
+  BOOST_CHECK_EQUAL(decoded.getStride(), 4);
+  BOOST_CHECK_EQUAL(decoded.getStartBlockId(), 2);
+  BOOST_CHECK_EQUAL(decoded.getEndBlockId(), 98);
+}
+
+BOOST_AUTO_TEST_CASE(InlineManifest)
+{
+  std::string json = "{\"info\": {\"name\": \"/a\"}}";
+
+  repo::RepoCommandParameter parameter;
+  parameter.setName("/hash");
+  parameter.setManifest(json);
+
+  repo::RepoCommandParameter decoded(parameter.wireEncode());
+  BOOST_CHECK(decoded.hasManifest());
+  BOOST_CHECK_EQUAL(decoded.getManifest(), json);
+  BOOST_CHECK(!decoded.hasStride());
+}
+
+BOOST_AUTO_TEST_CASE(NextHash)
+{
+  std::vector<uint8_t> digest(32, 0xAB);
+
+  repo::RepoCommandParameter parameter;
+  parameter.setName("/a");
+  parameter.setStartBlockId(64);
+  parameter.setNextHash(digest);
+
+  repo::RepoCommandParameter decoded(parameter.wireEncode());
+  BOOST_CHECK(decoded.hasNextHash());
+  BOOST_CHECK(decoded.getNextHash() == digest);
+
+  // a chained range whose anchor is still to come
+  parameter.setNextHash({});
+  decoded = repo::RepoCommandParameter(parameter.wireEncode());
+  BOOST_CHECK(decoded.hasNextHash());
+  BOOST_CHECK(decoded.getNextHash().empty());
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -55,6 +55,22 @@ BOOST_AUTO_TEST_CASE(EncodeDecode)
   BOOST_CHECK_EQUAL(decoded.getProcessId(), response.getProcessId());
   BOOST_CHECK_EQUAL(decoded.getInsertNum(), response.getInsertNum());
   BOOST_CHECK_EQUAL(decoded.getDeleteNum(), response.getDeleteNum());
+  BOOST_CHECK(!decoded.hasRetryAfter());
+}
+
+BOOST_AUTO_TEST_CASE(RetryAfter)
+{
+  repo::RepoCommandResponse response(503, "Repo is overloaded");
+  response.setRetryAfter(ndn::time::milliseconds(1500));
+
+  Block wire = response.wireEncode();
+  Block expected = "CF08 D00201F7D60205DC"_block;
+  BOOST_CHECK_EQUAL(wire, expected);
+
+  repo::RepoCommandResponse decoded(wire);
+  BOOST_CHECK_EQUAL(decoded.getCode(), 503);
+  BOOST_REQUIRE(decoded.hasRetryAfter());
+  BOOST_CHECK_EQUAL(decoded.getRetryAfter(), ndn::time::milliseconds(1500));
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -19,12 +19,16 @@
 
 #include "storage/repo-storage.hpp"
 #include "storage/sqlite-storage.hpp"
+#include "storage/fs-storage.hpp"
+#include "storage/mongodb-storage.hpp"
 #include "../dataset-fixtures.hpp"
 #include "../repo-storage-fixture.hpp"
 
 #include <boost/mpl/push_back.hpp>
+#include <boost/mpl/vector.hpp>
 #include <boost/test/unit_test.hpp>
 #include <iostream>
+#include <set>
 #include <string.h>
 
 namespace repo {
@@ -82,6 +86,127 @@ BOOST_FIXTURE_TEST_CASE(NotifyAboutExistingData, Fixture<BasicDataset>)
   BOOST_CHECK_EQUAL(names.size(), this->data.size());
 }
 
+class FsStorageHolder
+{
+public:
+  FsStorageHolder()
+    : store(std::make_shared<FsStorage>("unittestdb"))
+  {
+  }
+
+  ~FsStorageHolder()
+  {
+    boost::filesystem::remove_all(boost::filesystem::path("unittestdb"));
+  }
+
+public:
+  std::shared_ptr<Storage> store;
+};
+
+class MongoDBStorageHolder
+{
+public:
+  MongoDBStorageHolder()
+    : store(getStore())
+  {
+  }
+
+private:
+  static std::shared_ptr<Storage>
+  getStore()
+  {
+    // mongocxx allows a single instance per process, so the cases share the storage
+    static auto store = std::make_shared<MongoDBStorage>("unittestdb");
+    return store;
+  }
+
+public:
+  std::shared_ptr<Storage> store;
+};
+
+using StorageHolders = boost::mpl::vector<FsStorageHolder, MongoDBStorageHolder>;
+
+template<class StorageHolder>
+class EraseRangeFixture : public StorageHolder, public IdentityManagementFixture
+{
+protected:
+  /**
+   * @brief store the segments @p first to @p last of @p prefix, except those in @p missing
+   */
+  void
+  insertSegments(const Name& prefix, SegmentNo first, SegmentNo last,
+                 const std::set<SegmentNo>& missing = {})
+  {
+    // a shared storage may keep segments of an earlier run
+    this->store->eraseRange(prefix, 0, last + 100, 1);
+
+    static std::vector<uint8_t> content(100, '-');
+    for (SegmentNo segment = first; segment <= last; ++segment) {
+      if (missing.count(segment) > 0) {
+        continue;
+      }
+      Data data(Name(prefix).appendSegment(segment));
+      data.setContent(content.data(), content.size());
+      m_hcKeyChain.sign(data);
+      this->store->insert(data);
+    }
+  }
+
+  bool
+  has(const Name& prefix, SegmentNo segment)
+  {
+    return this->store->read(Name(prefix).appendSegment(segment)) != nullptr;
+  }
+};
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(EraseRangeStride, T, StorageHolders, EraseRangeFixture<T>)
+{
+  Name prefix("/erase-range/stride");
+  this->insertSegments(prefix, 0, 11);
+
+  // first is not a multiple of the stride, the segments erased are 1, 4, 7 and 10
+  BOOST_CHECK_EQUAL(this->store->eraseRange(prefix, 1, 11, 3), 4);
+  for (SegmentNo segment = 0; segment <= 11; ++segment) {
+    BOOST_CHECK_EQUAL(this->has(prefix, segment), segment % 3 != 1);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(EraseRangePartial, T, StorageHolders, EraseRangeFixture<T>)
+{
+  Name prefix("/erase-range/partial");
+  Name other("/erase-range/partial-other");
+  Name longer("/erase-range/partial/longer");
+  this->insertSegments(prefix, 0, 9);
+  this->insertSegments(other, 0, 9);
+  this->insertSegments(longer, 0, 9);
+
+  BOOST_CHECK_EQUAL(this->store->eraseRange(prefix, 3, 6, 1), 4);
+  BOOST_CHECK(this->has(prefix, 2));
+  BOOST_CHECK(!this->has(prefix, 3));
+  BOOST_CHECK(!this->has(prefix, 6));
+  BOOST_CHECK(this->has(prefix, 7));
+
+  // segments of other prefixes, even longer ones, are left alone
+  for (SegmentNo segment = 3; segment <= 6; ++segment) {
+    BOOST_CHECK(this->has(other, segment));
+    BOOST_CHECK(this->has(longer, segment));
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(EraseRangeMissing, T, StorageHolders, EraseRangeFixture<T>)
+{
+  Name prefix("/erase-range/missing");
+  this->insertSegments(prefix, 0, 9, {5, 6});
+
+  // only the segments that were stored are counted, the range may run past the last one
+  BOOST_CHECK_EQUAL(this->store->eraseRange(prefix, 4, 20, 1), 4);
+  BOOST_CHECK(this->has(prefix, 3));
+  BOOST_CHECK(!this->has(prefix, 9));
+
+  BOOST_CHECK_EQUAL(this->store->eraseRange(prefix, 4, 20, 1), 0);
+  BOOST_CHECK_EQUAL(this->store->eraseRange("/erase-range/unknown", 0, 9, 1), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace tests
@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fetch/segment-bitmap.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestSegmentBitmap)
+
+BOOST_AUTO_TEST_CASE(SetAndCount)
+{
+  SegmentBitmap bitmap(10, 200);
+  BOOST_CHECK(bitmap.set(10));
+  BOOST_CHECK(!bitmap.set(10));
+  BOOST_CHECK(!bitmap.set(9));
+  BOOST_CHECK(!bitmap.set(201));
+  BOOST_CHECK(bitmap.set(200));
+  BOOST_CHECK(bitmap.has(200));
+  BOOST_CHECK(!bitmap.has(100));
+  BOOST_CHECK_EQUAL(bitmap.count(), 2);
+  BOOST_CHECK(!bitmap.isComplete());
+
+  for (uint64_t segmentNo = 10; segmentNo <= 200; ++segmentNo) {
+    bitmap.set(segmentNo);
+  }
+  BOOST_CHECK(bitmap.isComplete());
+  BOOST_CHECK(bitmap.getMissingRanges().empty());
+  BOOST_CHECK_EQUAL(bitmap.toString(), "10-200");
+
+  BOOST_CHECK_THROW(SegmentBitmap(5, 4), SegmentBitmap::Error);
+}
+
+BOOST_AUTO_TEST_CASE(MissingRanges)
+{
+  SegmentBitmap bitmap(0, 999);
+  for (uint64_t segmentNo = 0; segmentNo < 1000; ++segmentNo) {
+    if (segmentNo < 100 || (segmentNo >= 110 && segmentNo < 500) || (segmentNo >= 520 && segmentNo < 900)) {
+      bitmap.set(segmentNo);
+    }
+  }
+
+  auto missing = bitmap.getMissingRanges();
+  BOOST_REQUIRE_EQUAL(missing.size(), 3);
+  BOOST_CHECK(missing[0] == SegmentBitmap::Range(100, 109));
+  BOOST_CHECK(missing[1] == SegmentBitmap::Range(500, 519));
+  BOOST_CHECK(missing[2] == SegmentBitmap::Range(900, 999));
+
+  // the two gaps closest to each other are merged
+  missing = bitmap.getMissingRanges(2);
+  BOOST_REQUIRE_EQUAL(missing.size(), 2);
+  BOOST_CHECK(missing[0] == SegmentBitmap::Range(100, 109));
+  BOOST_CHECK(missing[1] == SegmentBitmap::Range(500, 999));
+}
+
+BOOST_AUTO_TEST_CASE(Persist)
+{
+  SegmentBitmap bitmap(5, 300);
+  for (uint64_t segmentNo : {5, 6, 7, 70, 128, 129, 130, 300}) {
+    bitmap.set(segmentNo);
+  }
+  BOOST_CHECK_EQUAL(bitmap.toString(), "5-7,70-70,128-130,300-300");
+
+  SegmentBitmap copy = SegmentBitmap::fromString(5, 300, bitmap.toString());
+  BOOST_CHECK_EQUAL(copy.count(), bitmap.count());
+  BOOST_CHECK(copy.getMissingRanges() == bitmap.getMissingRanges());
+
+  BOOST_CHECK_EQUAL(SegmentBitmap::fromString(0, 10, "").count(), 0);
+  BOOST_CHECK_THROW(SegmentBitmap::fromString(0, 10, "3-2"), SegmentBitmap::Error);
+  BOOST_CHECK_THROW(SegmentBitmap::fromString(0, 10, "5-11"), SegmentBitmap::Error);
+  BOOST_CHECK_THROW(SegmentBitmap::fromString(0, 10, "5x"), SegmentBitmap::Error);
+}
+
+BOOST_AUTO_TEST_CASE(Split)
+{
+  auto ranges = SegmentBitmap::split(10, 19, 3);
+  BOOST_REQUIRE_EQUAL(ranges.size(), 3);
+  BOOST_CHECK(ranges[0] == SegmentBitmap::Range(10, 13));
+  BOOST_CHECK(ranges[1] == SegmentBitmap::Range(14, 16));
+  BOOST_CHECK(ranges[2] == SegmentBitmap::Range(17, 19));
+
+  // more ranges asked for than there are segments
+  ranges = SegmentBitmap::split(0, 4, 8);
+  BOOST_REQUIRE_EQUAL(ranges.size(), 5);
+  for (uint64_t i = 0; i < ranges.size(); ++i) {
+    BOOST_CHECK(ranges[i] == SegmentBitmap::Range(i, i));
+  }
+
+  ranges = SegmentBitmap::split(0, 65, 65);
+  BOOST_REQUIRE_EQUAL(ranges.size(), 65);
+  BOOST_CHECK(ranges.front() == SegmentBitmap::Range(0, 1));
+  BOOST_CHECK(ranges.back() == SegmentBitmap::Range(65, 65));
+
+  // too few segments for ranges of minSize
+  ranges = SegmentBitmap::split(0, 199, 8, 64);
+  BOOST_REQUIRE_EQUAL(ranges.size(), 3);
+  BOOST_CHECK(ranges[2] == SegmentBitmap::Range(134, 199));
+
+  ranges = SegmentBitmap::split(7, 7, 4, 64);
+  BOOST_REQUIRE_EQUAL(ranges.size(), 1);
+  BOOST_CHECK(ranges[0] == SegmentBitmap::Range(7, 7));
+
+  BOOST_CHECK(SegmentBitmap::split(5, 4, 4).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
@@ -0,0 +1,181 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "storage/tombstone-set.hpp"
+
+#include <boost/property_tree/exceptions.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestTombstoneSet)
+
+BOOST_AUTO_TEST_CASE(Covers)
+{
+  TombstoneSet tombstones;
+  tombstones.addRange("/a", 2, 10, 4);
+  tombstones.addRange("/b", 5, 3, 1);
+
+  BOOST_CHECK(tombstones.covers("/a", 2));
+  BOOST_CHECK(tombstones.covers("/a", 6));
+  BOOST_CHECK(tombstones.covers("/a", 10));
+  BOOST_CHECK(!tombstones.covers("/a", 3));
+  BOOST_CHECK(!tombstones.covers("/a", 14));
+  BOOST_CHECK(!tombstones.covers("/a/b", 2));
+  BOOST_CHECK(!tombstones.covers("/b", 4));
+
+  BOOST_CHECK(tombstones.uncover("/a", 6));
+  BOOST_CHECK(!tombstones.uncover("/a", 6));
+  BOOST_CHECK(!tombstones.covers("/a", 6));
+  BOOST_CHECK(tombstones.covers("/a", 2));
+  BOOST_CHECK(tombstones.covers("/a", 10));
+}
+
+BOOST_AUTO_TEST_CASE(Uncover)
+{
+  TombstoneSet tombstones;
+  tombstones.addRange("/a", 0, 9, 1);
+  tombstones.addRange("/b", 0, 3, 1);
+
+  // the rest of the range is reclaimed before /b, as the whole range would have been
+  BOOST_CHECK(tombstones.uncover("/a", 4));
+  BOOST_CHECK(tombstones.uncover("/a", 0));
+  BOOST_CHECK(tombstones.uncover("/a", 9));
+
+  auto batch = tombstones.takeBatch(10);
+  BOOST_CHECK_EQUAL(batch.prefix, "/a");
+  BOOST_CHECK_EQUAL(batch.first, 1);
+  BOOST_CHECK_EQUAL(batch.last, 3);
+
+  batch = tombstones.takeBatch(10);
+  BOOST_CHECK_EQUAL(batch.prefix, "/a");
+  BOOST_CHECK_EQUAL(batch.first, 5);
+  BOOST_CHECK_EQUAL(batch.last, 8);
+
+  batch = tombstones.takeBatch(10);
+  BOOST_CHECK_EQUAL(batch.prefix, "/b");
+  BOOST_CHECK(!tombstones.hasRanges());
+}
+
+BOOST_AUTO_TEST_CASE(Prefixes)
+{
+  TombstoneSet tombstones;
+  tombstones.addRange("/a", 0, 3, 1);
+  tombstones.addRange("/b", 0, 0, 1);
+  tombstones.addRange("/a", 10, 13, 1);
+
+  BOOST_CHECK(tombstones.hasPrefix("/a"));
+  BOOST_CHECK(!tombstones.hasPrefix("/c"));
+  BOOST_CHECK_EQUAL(tombstones.getPrefixes().size(), 2);
+
+  BOOST_CHECK(tombstones.uncover("/b", 0));
+  BOOST_CHECK(!tombstones.hasPrefix("/b"));
+
+  tombstones.takeBatch(10);
+  BOOST_CHECK(tombstones.hasPrefix("/a"));
+  BOOST_CHECK(tombstones.covers("/a", 12));
+
+  auto moved = std::move(tombstones);
+  moved.takeBatch(10);
+  BOOST_CHECK(!moved.hasPrefix("/a"));
+  BOOST_CHECK(!moved.hasRanges());
+}
+
+BOOST_AUTO_TEST_CASE(Batches)
+{
+  TombstoneSet tombstones;
+  tombstones.addRange("/a", 0, 9, 1);
+  tombstones.addRange("/b", 1, 7, 3);
+
+  auto batch = tombstones.takeBatch(4);
+  BOOST_CHECK_EQUAL(batch.prefix, "/a");
+  BOOST_CHECK_EQUAL(batch.first, 0);
+  BOOST_CHECK_EQUAL(batch.last, 3);
+  BOOST_CHECK(!tombstones.covers("/a", 3));
+  BOOST_CHECK(tombstones.covers("/a", 4));
+
+  batch = tombstones.takeBatch(4);
+  BOOST_CHECK_EQUAL(batch.first, 4);
+  BOOST_CHECK_EQUAL(batch.last, 7);
+
+  batch = tombstones.takeBatch(4);
+  BOOST_CHECK_EQUAL(batch.first, 8);
+  BOOST_CHECK_EQUAL(batch.last, 9);
+
+  batch = tombstones.takeBatch(2);
+  BOOST_CHECK_EQUAL(batch.prefix, "/b");
+  BOOST_CHECK_EQUAL(batch.first, 1);
+  BOOST_CHECK_EQUAL(batch.last, 4);
+  BOOST_CHECK(tombstones.covers("/b", 7));
+
+  batch = tombstones.takeBatch(2);
+  BOOST_CHECK_EQUAL(batch.first, 7);
+  BOOST_CHECK_EQUAL(batch.last, 7);
+  BOOST_CHECK(!tombstones.hasRanges());
+}
+
+BOOST_AUTO_TEST_CASE(Manifests)
+{
+  TombstoneSet tombstones;
+  tombstones.addManifest("h1", 100);
+  tombstones.addManifest("h2", 200);
+
+  BOOST_CHECK(tombstones.hasManifest("h1"));
+  BOOST_CHECK_EQUAL(tombstones.expireManifests(150), 1);
+  BOOST_CHECK(!tombstones.hasManifest("h1"));
+  BOOST_CHECK(tombstones.removeManifest("h2"));
+  BOOST_CHECK(!tombstones.removeManifest("h2"));
+
+  tombstones.addManifest("h3", 100);
+  tombstones.holdManifest("h3");
+  tombstones.holdManifest("h4");
+  BOOST_CHECK_EQUAL(tombstones.getHeldManifests().size(), 1);
+  BOOST_CHECK_EQUAL(tombstones.expireManifests(150), 0);
+  BOOST_CHECK(TombstoneSet::fromJson(tombstones.toJson()).getHeldManifests().count("h3") > 0);
+
+  tombstones.releaseManifest("h3");
+  BOOST_CHECK_EQUAL(tombstones.expireManifests(150), 1);
+  BOOST_CHECK(!tombstones.hasManifest("h3"));
+}
+
+BOOST_AUTO_TEST_CASE(Json)
+{
+  TombstoneSet tombstones;
+  BOOST_CHECK(!TombstoneSet::fromJson(tombstones.toJson()).hasRanges());
+
+  tombstones.addRange("/a/%00%01", 0, 100, 2);
+  tombstones.addManifest("h1", 100);
+  tombstones.takeBatch(10);
+
+  auto loaded = TombstoneSet::fromJson(tombstones.toJson());
+  BOOST_CHECK(loaded.hasManifest("h1"));
+  BOOST_CHECK(!loaded.covers("/a/%00%01", 18));
+  BOOST_CHECK(loaded.covers("/a/%00%01", 20));
+  BOOST_CHECK(loaded.covers("/a/%00%01", 100));
+
+  BOOST_CHECK_THROW(TombstoneSet::fromJson("{\"ranges\": [{\"prefix\": \"/a\"}]}"),
+                    boost::property_tree::ptree_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
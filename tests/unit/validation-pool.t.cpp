@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fetch/validation-pool.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestValidationPool)
+
+BOOST_AUTO_TEST_CASE(Inline)
+{
+  boost::asio::io_service io;
+  ValidationPool pool(io, 0);
+  BOOST_CHECK_EQUAL(pool.getThreads(), 0);
+
+  std::vector<bool> results;
+  pool.submit([] { return true; }, [&] (bool isValid) { results.push_back(isValid); });
+  pool.submit([] { return false; }, [&] (bool isValid) { results.push_back(isValid); });
+  BOOST_CHECK((results == std::vector<bool>{true, false}));
+}
+
+BOOST_AUTO_TEST_CASE(SubmissionOrder)
+{
+  boost::asio::io_service io;
+  ValidationPool pool(io, 4);
+
+  std::vector<int> order;
+  std::vector<bool> results;
+  for (int i = 0; i < 64; ++i) {
+    // early checks take longest, so that workers finish out of order
+    pool.submit([i] {
+                  std::this_thread::sleep_for(std::chrono::microseconds((64 - i) * 50));
+                  return i % 3 != 0;
+                },
+                [&, i] (bool isValid) {
+                  order.push_back(i);
+                  results.push_back(isValid);
+                  if (order.size() == 64) {
+                    io.stop();
+                  }
+                });
+  }
+
+  boost::asio::io_service::work work(io);
+  io.run();
+
+  BOOST_REQUIRE_EQUAL(order.size(), 64);
+  for (int i = 0; i < 64; ++i) {
+    BOOST_CHECK_EQUAL(order[i], i);
+    BOOST_CHECK_EQUAL(results[i], i % 3 != 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ThrowingCheck)
+{
+  boost::asio::io_service io;
+  ValidationPool pool(io, 2);
+
+  int nDone = 0;
+  pool.submit([] () -> bool { throw std::runtime_error("malformed"); },
+              [&] (bool isValid) {
+                BOOST_CHECK(!isValid);
+                ++nDone;
+              });
+  pool.submit([] { return true; },
+              [&] (bool isValid) {
+                BOOST_CHECK(isValid);
+                ++nDone;
+                io.stop();
+              });
+
+  boost::asio::io_service::work work(io);
+  io.run();
+  BOOST_CHECK_EQUAL(nDone, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
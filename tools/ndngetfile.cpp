@@ -33,12 +33,13 @@ int
 usage(const char* programName)
 {
   std::cerr << "Usage: "
-            << programName << " [-v] [-l lifetime] [-w timeout] [-o filename] \n"
+            << programName << " [-v] [-l lifetime] [-w timeout] [-c control] [-o filename] \n"
             << "\n"
             << "  -v: be verbose\n"
             << "  -f: set forwardingHint\n"
             << "  -l: InterestLifetime in milliseconds\n"
             << "  -w: timeout in milliseconds for whole process (default unlimited)\n"
+            << "  -c: congestion control of the segment fetcher: aimd (default), cubic or bbr\n"
             << "  -o: write to local file name instead of stdout\n"
             << "  ndn-name: NDN Name prefix for Data to be read\n"
             << std::endl;
@@ -50,13 +51,14 @@ main(int argc, char** argv)
 {
   std::string repoPrefix;
   std::string name, forwardingHint;
+  std::string congestionControl;
   const char* outputFile = nullptr;
   bool verbose = false;
   int interestLifetime = 4000;  // in milliseconds
   int timeout = 0;  // in milliseconds
 
   int opt;
-  while ((opt = getopt(argc, argv, "hvf:l:w:o:")) != -1) {
+  while ((opt = getopt(argc, argv, "hvf:l:w:c:o:")) != -1) {
     switch (opt) {
     case 'h':
       usage(argv[0]);
@@ -87,6 +89,9 @@ main(int argc, char** argv)
       }
       timeout = std::max(timeout, 0);
       break;
+    case 'c':
+      congestionControl = optarg;
+      break;
     case 'o':
       outputFile = optarg;
       break;
@@ -133,6 +138,16 @@ main(int argc, char** argv)
     difs.setForwardingHint(ndn::DelegationList{d});
   }
 
+  if (!congestionControl.empty()) {
+    try {
+      difs.setCongestionControl(congestionControl);
+    }
+    catch (const std::exception& e) {
+      std::cerr << "ERROR: " << e.what() << std::endl;
+      return 2;
+    }
+  }
+
   difs.getFile(name, os);
 
   try
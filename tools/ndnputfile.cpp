@@ -20,6 +20,7 @@
 #include <iostream>
 
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 
@@ -39,7 +40,7 @@ usage(const char* programName)
 {
   std::cerr << "Usage: "
             << programName << " [-u] [-D] [-d] [-s block size] [-i identity] [-I identity] [-x freshness]"
-                              " [-l lifetime] [-w timeout] REPO-PREFIX NDN-NAME KEY FILENAME\n"
+                              " [-l lifetime] [-w timeout] [-e k,m] REPO-PREFIX NDN-NAME KEY FILENAME\n"
             << "\n"
             << "Write a file into a repo.\n"
             << "\n"
@@ -52,6 +53,7 @@ usage(const char* programName)
             << "  -l: InterestLifetime in milliseconds for each command\n"
             << "  -w: timeout in milliseconds for whole process (default unlimited)\n"
             << "  -s: block size (default 1000)\n"
+            << "  -e: store as k data and m parity fragments on distinct nodes\n"
             << "  -v: be verbose\n"
             << "  repo-prefix: repo command prefix\n"
             << "  ndn-name: NDN Name prefix for written Data\n"
@@ -69,9 +71,10 @@ main(int argc, char** argv)
   std::string difsKey, forwardingHint, nodePrefix;
   std::istream* insertStream;
   size_t blockSize;
+  int dataFragments = 0, parityFragments = 0;
   
   int opt;
-  while ((opt = getopt(argc, argv, "hDf:n:i:I:x:l:w:s:v")) != -1) {
+  while ((opt = getopt(argc, argv, "hDf:n:i:I:x:l:w:s:e:v")) != -1) {
     switch (opt) {
     case 'h':
       usage(argv[0]);
@@ -128,6 +131,13 @@ main(int argc, char** argv)
         return 1;
       }
       break;
+    case 'e':
+      if (sscanf(optarg, "%d,%d", &dataFragments, &parityFragments) != 2 ||
+          dataFragments <= 0 || parityFragments < 0 || dataFragments + parityFragments > 256) {
+        std::cerr << "-e option should be k,m with k > 0 and k+m <= 256" << std::endl;
+        return 2;
+      }
+      break;
     case 'v':
       verbose = true;
       break;
@@ -177,6 +187,10 @@ main(int argc, char** argv)
     difs.setForwardingHint(ndn::DelegationList{d});
   }
 
+  if (dataFragments > 0) {
+    difs.setErasureCoding(dataFragments, parityFragments);
+  }
+
   difs.putFile(ndnName, *insertStream);
 
   try